@@ -4,21 +4,25 @@
 
 #include <cassert>
 
+#include "X11TouchMultiWindowClusters.h"
 #include "X11TouchMultiWindowPointerHandler.h"
 #include "X11TouchMultiWindowPointerHandlerSystem.h"
+#include "X11TouchMultiWindowUtils.h"
 
 // .NET available interface
 // ----------------------------------------------------------------------------
-extern "C" EXPORT_API Result PointerHandlerSystem_Create(MessageCallback messageCallback, void** handle) throw()
+extern "C" EXPORT_API Result PointerHandlerSystem_Create(const char* displayName, MessageCallback messageCallback,
+	const SystemSettings* settings, void** handle) throw()
 {
-	PointerHandlerSystem* system = PointerHandlerSystem::getInstance();
-	if (system != nullptr)
+	if (handle == nullptr)
 	{
-		*handle = system;
-		return R_OK;
+		return R_ERROR_NULL_POINTER;
 	}
 
-	system = new PointerHandlerSystem(messageCallback);
+	SystemSettings defaultSettings = {};
+	defaultSettings.minMessageType = MT_INFO;
+	PointerHandlerSystem* system = new PointerHandlerSystem(messageCallback,
+		settings != nullptr ? *settings : defaultSettings, displayName);
 	Result result = system->initialize();
 	if (result == R_OK)
 	{
@@ -43,14 +47,61 @@ extern "C" EXPORT_API Result PointerHandlerSystem_Destroy(PointerHandlerSystem*
 	return R_OK;
 }
 // ----------------------------------------------------------------------------
-extern "C" EXPORT_API Result PointerHandlerSystem_ProcessEventQueue(PointerHandlerSystem* system)
+extern "C" EXPORT_API Result PointerHandlerSystem_ProcessEventQueue(PointerHandlerSystem* system,
+	unsigned long long frameTime)
+{
+	if (system == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return system->processEventQueue(frameTime);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandlerSystem_GetTime(PointerHandlerSystem* system, unsigned long long* time)
+{
+	if (system == nullptr || time == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	*time = getMonotonicTime();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandlerSystem_GetFd(PointerHandlerSystem* system, int* fd)
 {
 	if (system == nullptr)
 	{
 		return R_ERROR_NULL_POINTER;
 	}
 
-	return system->processEventQueue();
+	return system->getFd(fd);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandlerSystem_WaitForEvents(PointerHandlerSystem* system, int timeoutMs,
+	int* ready)
+{
+	if (system == nullptr || ready == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	bool eventsReady = false;
+	Result result = system->waitForEvents(timeoutMs, &eventsReady);
+	*ready = eventsReady ? 1 : 0;
+
+	return result;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandlerSystem_Wake(PointerHandlerSystem* system)
+{
+	if (system == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return system->wake();
 }
 // ----------------------------------------------------------------------------
 extern "C" EXPORT_API Result PointerHandlerSystem_GetWindowsOfProcess(PointerHandlerSystem* system,
@@ -74,13 +125,61 @@ extern "C" EXPORT_API Result PointerHandlerSystem_FreeWindowsOfProcess(PointerHa
 	
 	return system->freeWindowsOfProcess(windows);
 }
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandlerSystem_StartRecording(PointerHandlerSystem* system, const char* path)
+{
+	if (system == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
 
+	return system->startRecording(path);
+}
 // ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandlerSystem_StopRecording(PointerHandlerSystem* system)
+{
+	if (system == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return system->stopRecording();
+}
 // ----------------------------------------------------------------------------
-extern "C" EXPORT_API Result PointerHandler_Create(int targetDisplay, Window window,
-	PointerCallback pointerCallback, void** handle) throw()
+extern "C" EXPORT_API Result PointerHandlerSystem_StartReplay(PointerHandlerSystem* system, const char* path,
+	ReplayMode mode, Window window)
+{
+	if (system == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return system->startReplay(path, mode, window);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandlerSystem_StopReplay(PointerHandlerSystem* system)
+{
+	if (system == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return system->stopReplay();
+}
+// ----------------------------------------------------------------------------
+static PointerHandler* getHandler(PointerHandlerSystem* system, HandlerHandle handle)
+{
+	if (system == nullptr)
+	{
+		return nullptr;
+	}
+
+	return system->getHandler(handle);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_Create(PointerHandlerSystem* system, int targetDisplay,
+	Window window, PointerCallback pointerCallback, HandlerHandle* handle) throw()
 {
-	PointerHandlerSystem* system = PointerHandlerSystem::getInstance();
 	if (system == nullptr)
 	{
 		return R_ERROR_NULL_POINTER;
@@ -89,31 +188,328 @@ extern "C" EXPORT_API Result PointerHandler_Create(int targetDisplay, Window win
 	return system->createHandler(targetDisplay, window, pointerCallback, handle);
 }
 // ----------------------------------------------------------------------------
-extern "C" EXPORT_API Result PointerHandler_Destroy(PointerHandler* handler) throw()
+extern "C" EXPORT_API Result PointerHandler_Destroy(PointerHandlerSystem* system, HandlerHandle handle) throw()
 {
-	PointerHandlerSystem* system = PointerHandlerSystem::getInstance();
 	if (system == nullptr)
 	{
 		return R_ERROR_NULL_POINTER;
 	}
 
-	return system->destroyHandler(handler);
+	return system->destroyHandler(handle);
 }
 // ----------------------------------------------------------------------------
-extern "C" EXPORT_API Result PointerHandler_SetTargetDisplay(PointerHandler* handler,
+extern "C" EXPORT_API Result PointerHandler_SetTargetDisplay(PointerHandlerSystem* system, HandlerHandle handle,
 	int targetDisplay)
 {
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
 	return handler->setTargetDisplay(targetDisplay);
 }
 // ----------------------------------------------------------------------------
 extern "C" EXPORT_API Result PointerHandler_GetScreenParams(
-	PointerHandler* handler, int* x, int* y, int* width, int* height, int* screenWidth, int* screenHeight)
+	PointerHandlerSystem* system, HandlerHandle handle, int* x, int* y, int* width, int* height, int* screenWidth,
+	int* screenHeight)
 {
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
 	return handler->getScreenParams(x, y, width, height, screenWidth, screenHeight);
 }
 // ----------------------------------------------------------------------------
 extern "C" EXPORT_API Result PointerHandler_SetScreenParams(
-	PointerHandler* handler, int width, int height, float offsetX, float offsetY, float scaleX, float scaleY)
+	PointerHandlerSystem* system, HandlerHandle handle, int width, int height, float offsetX, float offsetY,
+	float scaleX, float scaleY)
 {
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
 	return handler->setScreenParams(width, height, offsetX, offsetY, scaleX, scaleY);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetPointerEvents(PointerHandlerSystem* system, HandlerHandle handle,
+	PointerEventData* events, int maxEvents, int* numEvents)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->getPointerEvents(events, maxEvents, numEvents);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetNumDroppedEvents(PointerHandlerSystem* system,
+	HandlerHandle handle, unsigned long long* numEvents)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr || numEvents == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	*numEvents = handler->getNumDroppedEvents();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_SetCoalescing(PointerHandlerSystem* system, HandlerHandle handle,
+	int coalesce, int keepHistory)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->setCoalescing(coalesce != 0, keepHistory != 0);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetNumCoalescedEvents(PointerHandlerSystem* system,
+	HandlerHandle handle, unsigned long long* numEvents)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr || numEvents == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	*numEvents = handler->getNumCoalescedEvents();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetPointerHistory(PointerHandlerSystem* system, HandlerHandle handle,
+	PointerType type, int id, Vector2* samples, int maxSamples, int* numSamples)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->getPointerHistory(type, id, samples, maxSamples, numSamples);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetActivePointers(PointerHandlerSystem* system, HandlerHandle handle,
+	ActivePointerData* pointers, int maxPointers, int* numPointers)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->getActivePointers(pointers, maxPointers, numPointers);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_SetFiltering(PointerHandlerSystem* system, HandlerHandle handle,
+	int filter, FilterSettings* settings)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->setFiltering(filter != 0, settings);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetNumSuppressedUpdates(PointerHandlerSystem* system,
+	HandlerHandle handle, unsigned long long* numUpdates)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr || numUpdates == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	*numUpdates = handler->getNumSuppressedUpdates();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_SetPrediction(PointerHandlerSystem* system, HandlerHandle handle,
+	int predict, float horizon)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->setPrediction(predict != 0, horizon);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_SetResampling(PointerHandlerSystem* system, HandlerHandle handle,
+	int resample, float maxExtrapolation)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->setResampling(resample != 0, maxExtrapolation);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_SetGestureRecognition(PointerHandlerSystem* system,
+	HandlerHandle handle, int recognize, GestureSettings* settings)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->setGestureRecognition(recognize != 0, settings);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetGestureEvents(PointerHandlerSystem* system, HandlerHandle handle,
+	GestureEventData* events, int maxEvents, int* numEvents)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->getGestureEvents(events, maxEvents, numEvents);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_AddRegion(PointerHandlerSystem* system, HandlerHandle handle,
+	const RegionData* region, const Vector2* vertices, int numVertices)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr || region == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->addRegion(*region, vertices, numVertices);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_RemoveRegion(PointerHandlerSystem* system, HandlerHandle handle, int id)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->removeRegion(id);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_MoveRegion(PointerHandlerSystem* system, HandlerHandle handle, int id,
+	float x, float y)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->moveRegion(id, Vector2(x, y));
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_ClearRegions(PointerHandlerSystem* system, HandlerHandle handle)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	handler->clearRegions();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_SetSlotTimeout(PointerHandlerSystem* system, HandlerHandle handle,
+	float timeout)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	return handler->setSlotTimeout(timeout);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_CancelTouches(PointerHandlerSystem* system, HandlerHandle handle)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	handler->cancelTouches(XIAllDevices);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetNumCanceledTouches(PointerHandlerSystem* system,
+	HandlerHandle handle, unsigned long long* numTouches)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr || numTouches == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	*numTouches = handler->getNumCanceledTouches();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_GetLatencyStats(PointerHandlerSystem* system, HandlerHandle handle,
+	LatencyStats* stats)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr || stats == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	Result result = handler->getLatencyStats(stats);
+	if (result != R_OK)
+	{
+		return result;
+	}
+
+	const ServerClock& serverClock = system->getServerClock();
+	uint64_t now = getMonotonicTime();
+	stats->clockOffset = serverClock.isValid() ? serverClock.getOffset(now) / 1000 : 0;
+	stats->clockDrift = serverClock.getDrift() * 1000000.0;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result PointerHandler_ResetLatencyStats(PointerHandlerSystem* system, HandlerHandle handle)
+{
+	PointerHandler* handler = getHandler(system, handle);
+	if (handler == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	handler->resetLatencyStats();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result Clusters_ComputeTransforms(const float* x, const float* y, const float* previousX,
+	const float* previousY, const int* clusterOffsets, int numClusters, ClusterTransform* transforms)
+{
+	return computeClusterTransforms(x, y, previousX, previousY, clusterOffsets, numClusters, transforms);
+}
+// ----------------------------------------------------------------------------
+extern "C" EXPORT_API Result Clusters_Split(const float* x, const float* y, int numPoints, float minPointDistance,
+	int* clusters, int* hasClusters)
+{
+	return splitClusters(x, y, numPoints, minPointDistance, clusters, hasClusters);
 }
\ No newline at end of file
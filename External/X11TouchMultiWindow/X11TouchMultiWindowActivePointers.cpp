@@ -0,0 +1,133 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+
+#include "X11TouchMultiWindowActivePointers.h"
+
+#define BUTTON_FLAGS (PF_FIRST_BUTTON | PF_SECOND_BUTTON | PF_THIRD_BUTTON | PF_FOURTH_BUTTON | PF_FIFTH_BUTTON)
+
+// ----------------------------------------------------------------------------
+ActivePointerTable::ActivePointerTable()
+	: mMouseIndex(-1)
+{
+	mPointers.reserve(16);
+	mSlotIndices.reserve(16);
+}
+// ----------------------------------------------------------------------------
+void ActivePointerTable::update(PointerType type, int id, int slot, PointerEvent event, const PointerData& data,
+	uint64_t time, const Vector2& position)
+{
+	int* index = &mMouseIndex;
+	if (type == PT_TOUCH)
+	{
+		if (slot >= (int)mSlotIndices.size())
+		{
+			mSlotIndices.resize(slot + 1, -1);
+		}
+		index = &mSlotIndices[slot];
+
+		if (event == PE_UP)
+		{
+			if (*index >= 0)
+			{
+				remove(*index);
+			}
+			return;
+		}
+	}
+
+	if (*index < 0)
+	{
+		*index = (int)mPointers.size();
+		mPointers.push_back(ActivePointer());
+		ActivePointer& pointer = mPointers.back();
+		pointer.data.buttons = type == PT_TOUCH ? PF_FIRST_BUTTON : PF_NONE;
+		pointer.downTime = time;
+	}
+
+	ActivePointer& pointer = mPointers[*index];
+	if (type == PT_MOUSE)
+	{
+		// Only the button that changed is reported, the pressed ones are tracked here
+		int buttons = pointer.data.buttons;
+		if (event == PE_DOWN)
+		{
+			if ((buttons & BUTTON_FLAGS) == 0)
+			{
+				pointer.downTime = time;
+			}
+			buttons |= data.flags & BUTTON_FLAGS;
+		}
+		else if (event == PE_UP)
+		{
+			buttons &= ~(data.flags & BUTTON_FLAGS);
+		}
+		pointer.data.buttons = (PointerFlags)buttons;
+	}
+
+	pointer.data.id = id;
+	pointer.data.type = type;
+	pointer.data.slot = type == PT_TOUCH ? slot : -1;
+	pointer.data.event = event;
+	pointer.data.pressure = (data.mask & TM_PRESSURE) ? data.pressure : 0.0f;
+	pointer.data.time = time;
+	pointer.position = position;
+}
+// ----------------------------------------------------------------------------
+void ActivePointerTable::clear()
+{
+	mPointers.clear();
+	mSlotIndices.clear();
+	mMouseIndex = -1;
+}
+// ----------------------------------------------------------------------------
+Result ActivePointerTable::getPointers(const ScreenTransform& transform, uint64_t time,
+	ActivePointerData* pointers, int maxPointers, int* numPointers) const
+{
+	if (pointers == nullptr || numPointers == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	int count = std::min((int)mPointers.size(), std::max(maxPointers, 0));
+	for (int i = 0; i < count; i++)
+	{
+		const ActivePointer& pointer = mPointers[i];
+		pointers[i] = pointer.data;
+		pointers[i].position = transform.apply(pointer.position);
+		pointers[i].age = time > pointer.downTime ? (float)((time - pointer.downTime) / 1e9) : 0.0f;
+	}
+	*numPointers = count;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void ActivePointerTable::remove(int index)
+{
+	int last = (int)mPointers.size() - 1;
+	const ActivePointerData& removed = mPointers[index].data;
+	if (removed.type == PT_TOUCH)
+	{
+		mSlotIndices[removed.slot] = -1;
+	}
+	else
+	{
+		mMouseIndex = -1;
+	}
+
+	if (index != last)
+	{
+		mPointers[index] = mPointers[last];
+		const ActivePointerData& moved = mPointers[index].data;
+		if (moved.type == PT_TOUCH)
+		{
+			mSlotIndices[moved.slot] = index;
+		}
+		else
+		{
+			mMouseIndex = index;
+		}
+	}
+	mPointers.pop_back();
+}
\ No newline at end of file
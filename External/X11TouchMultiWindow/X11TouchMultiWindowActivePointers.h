@@ -0,0 +1,51 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowTransform.h"
+
+/// @brief State of an active pointer, in window coordinates.
+struct ActivePointer
+{
+	ActivePointerData data;
+	Vector2 position;
+	/// CLOCK_MONOTONIC time in nanoseconds the age is measured from
+	uint64_t downTime;
+};
+
+/// @brief Keeps the latest state of every pointer of a handler in a dense array, updated with every decoded
+/// event, so callers that only need to know where the pointers are don't have to rebuild it from the event
+/// stream. Touches are found by their slot, a touch going up is removed by moving the last pointer into its
+/// place. The mouse is kept once it reported an event.
+class ActivePointerTable
+{
+private:
+	std::vector<ActivePointer> mPointers;
+	// Index in mPointers per touch slot, -1 for free slots
+	std::vector<int> mSlotIndices;
+	int mMouseIndex;
+
+public:
+	ActivePointerTable();
+
+	/// @param slot Slot of a touch, ignored for the mouse
+	/// @param time CLOCK_MONOTONIC time of the event in nanoseconds
+	/// @param position Window position of the event
+	void update(PointerType type, int id, int slot, PointerEvent event, const PointerData& data, uint64_t time,
+		const Vector2& position);
+	void clear();
+
+	int getNumPointers() const { return mPointers.size(); }
+	/// @brief Copies the state of the pointers with their positions transformed to screen space.
+	/// @param time CLOCK_MONOTONIC time in nanoseconds the ages are measured at
+	Result getPointers(const ScreenTransform& transform, uint64_t time, ActivePointerData* pointers,
+		int maxPointers, int* numPointers) const;
+
+private:
+	void remove(int index);
+};
\ No newline at end of file
@@ -0,0 +1,343 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <cmath>
+
+#include "X11TouchMultiWindowClusters.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X11TOUCH_CLUSTERS_X86
+#include <immintrin.h>
+#endif
+
+#define RAD_TO_DEG 57.29577951308232
+
+// Sums over the points of a cluster, relative to its first point to keep the float sums well conditioned
+struct ClusterSums
+{
+	// Previous positions p and current positions q
+	float px, py;
+	float qx, qy;
+	// Sum of p.q, p x q and p.p
+	float dot, cross, pp;
+};
+
+// ----------------------------------------------------------------------------
+static void sumScalar(const float* x, const float* y, const float* previousX, const float* previousY,
+	int begin, int end, float originX, float originY, float previousOriginX, float previousOriginY,
+	ClusterSums* sums)
+{
+	for (int i = begin; i < end; i++)
+	{
+		float px = previousX[i] - previousOriginX;
+		float py = previousY[i] - previousOriginY;
+		float qx = x[i] - originX;
+		float qy = y[i] - originY;
+		sums->px += px;
+		sums->py += py;
+		sums->qx += qx;
+		sums->qy += qy;
+		sums->dot += px * qx + py * qy;
+		sums->cross += px * qy - py * qx;
+		sums->pp += px * px + py * py;
+	}
+}
+#ifdef X11TOUCH_CLUSTERS_X86
+// ----------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static float horizontalSum(__m128 v)
+{
+	__m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(v, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+// ----------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static int sumSse2(const float* x, const float* y, const float* previousX, const float* previousY,
+	int begin, int end, float originX, float originY, float previousOriginX, float previousOriginY,
+	ClusterSums* sums)
+{
+	const __m128 ox = _mm_set1_ps(originX);
+	const __m128 oy = _mm_set1_ps(originY);
+	const __m128 pox = _mm_set1_ps(previousOriginX);
+	const __m128 poy = _mm_set1_ps(previousOriginY);
+	__m128 spx = _mm_setzero_ps(), spy = _mm_setzero_ps(), sqx = _mm_setzero_ps(), sqy = _mm_setzero_ps();
+	__m128 sdot = _mm_setzero_ps(), scross = _mm_setzero_ps(), spp = _mm_setzero_ps();
+
+	int i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 px = _mm_sub_ps(_mm_loadu_ps(previousX + i), pox);
+		__m128 py = _mm_sub_ps(_mm_loadu_ps(previousY + i), poy);
+		__m128 qx = _mm_sub_ps(_mm_loadu_ps(x + i), ox);
+		__m128 qy = _mm_sub_ps(_mm_loadu_ps(y + i), oy);
+		spx = _mm_add_ps(spx, px);
+		spy = _mm_add_ps(spy, py);
+		sqx = _mm_add_ps(sqx, qx);
+		sqy = _mm_add_ps(sqy, qy);
+		sdot = _mm_add_ps(sdot, _mm_add_ps(_mm_mul_ps(px, qx), _mm_mul_ps(py, qy)));
+		scross = _mm_add_ps(scross, _mm_sub_ps(_mm_mul_ps(px, qy), _mm_mul_ps(py, qx)));
+		spp = _mm_add_ps(spp, _mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)));
+	}
+
+	sums->px += horizontalSum(spx);
+	sums->py += horizontalSum(spy);
+	sums->qx += horizontalSum(sqx);
+	sums->qy += horizontalSum(sqy);
+	sums->dot += horizontalSum(sdot);
+	sums->cross += horizontalSum(scross);
+	sums->pp += horizontalSum(spp);
+	return i;
+}
+// ----------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static float horizontalSum(__m256 v)
+{
+	__m128 sums = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	__m128 shuffled = _mm_movehdup_ps(sums);
+	sums = _mm_add_ps(sums, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+// ----------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static int sumAvx2(const float* x, const float* y, const float* previousX, const float* previousY,
+	int begin, int end, float originX, float originY, float previousOriginX, float previousOriginY,
+	ClusterSums* sums)
+{
+	const __m256 ox = _mm256_set1_ps(originX);
+	const __m256 oy = _mm256_set1_ps(originY);
+	const __m256 pox = _mm256_set1_ps(previousOriginX);
+	const __m256 poy = _mm256_set1_ps(previousOriginY);
+	__m256 spx = _mm256_setzero_ps(), spy = _mm256_setzero_ps();
+	__m256 sqx = _mm256_setzero_ps(), sqy = _mm256_setzero_ps();
+	__m256 sdot = _mm256_setzero_ps(), scross = _mm256_setzero_ps(), spp = _mm256_setzero_ps();
+
+	int i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 px = _mm256_sub_ps(_mm256_loadu_ps(previousX + i), pox);
+		__m256 py = _mm256_sub_ps(_mm256_loadu_ps(previousY + i), poy);
+		__m256 qx = _mm256_sub_ps(_mm256_loadu_ps(x + i), ox);
+		__m256 qy = _mm256_sub_ps(_mm256_loadu_ps(y + i), oy);
+		spx = _mm256_add_ps(spx, px);
+		spy = _mm256_add_ps(spy, py);
+		sqx = _mm256_add_ps(sqx, qx);
+		sqy = _mm256_add_ps(sqy, qy);
+		sdot = _mm256_add_ps(sdot, _mm256_add_ps(_mm256_mul_ps(px, qx), _mm256_mul_ps(py, qy)));
+		scross = _mm256_add_ps(scross, _mm256_sub_ps(_mm256_mul_ps(px, qy), _mm256_mul_ps(py, qx)));
+		spp = _mm256_add_ps(spp, _mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)));
+	}
+
+	sums->px += horizontalSum(spx);
+	sums->py += horizontalSum(spy);
+	sums->qx += horizontalSum(sqx);
+	sums->qy += horizontalSum(sqy);
+	sums->dot += horizontalSum(sdot);
+	sums->cross += horizontalSum(scross);
+	sums->pp += horizontalSum(spp);
+	return i;
+}
+#endif
+// ----------------------------------------------------------------------------
+Result computeClusterTransforms(const float* x, const float* y, const float* previousX, const float* previousY,
+	const int* clusterOffsets, int numClusters, ClusterTransform* transforms)
+{
+	return computeClusterTransforms(x, y, previousX, previousY, clusterOffsets, numClusters, transforms,
+		getTransformKernel());
+}
+// ----------------------------------------------------------------------------
+Result computeClusterTransforms(const float* x, const float* y, const float* previousX, const float* previousY,
+	const int* clusterOffsets, int numClusters, ClusterTransform* transforms, TransformKernel kernel)
+{
+	if (clusterOffsets == NULL || (numClusters > 0 && transforms == NULL))
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+	if (numClusters > 0 && clusterOffsets[numClusters] > clusterOffsets[0] &&
+		(x == NULL || y == NULL || previousX == NULL || previousY == NULL))
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	if (kernel > getTransformKernel())
+	{
+		kernel = getTransformKernel();
+	}
+
+	for (int c = 0; c < numClusters; c++)
+	{
+		int begin = clusterOffsets[c];
+		int end = clusterOffsets[c + 1];
+		ClusterTransform& transform = transforms[c];
+		transform = ClusterTransform();
+		transform.scale = 1.0f;
+		transform.numPoints = end > begin ? end - begin : 0;
+		if (transform.numPoints == 0)
+		{
+			transform.center = transform.previousCenter = Vector2(NAN, NAN);
+			continue;
+		}
+
+		float originX = x[begin];
+		float originY = y[begin];
+		float previousOriginX = previousX[begin];
+		float previousOriginY = previousY[begin];
+
+		ClusterSums sums = {};
+		int done = begin;
+#ifdef X11TOUCH_CLUSTERS_X86
+		// Clusters of less than two vectors are summed faster without the horizontal sums at the end
+		if (kernel == TK_AVX2 && transform.numPoints >= 16)
+		{
+			done = sumAvx2(x, y, previousX, previousY, begin, end, originX, originY, previousOriginX,
+				previousOriginY, &sums);
+		}
+		else if (kernel >= TK_SSE2 && transform.numPoints >= 8)
+		{
+			done = sumSse2(x, y, previousX, previousY, begin, end, originX, originY, previousOriginX,
+				previousOriginY, &sums);
+		}
+#endif
+		sumScalar(x, y, previousX, previousY, done, end, originX, originY, previousOriginX, previousOriginY,
+			&sums);
+
+		float n = (float)transform.numPoints;
+		transform.center = Vector2(originX + sums.qx / n, originY + sums.qy / n);
+		transform.previousCenter = Vector2(previousOriginX + sums.px / n, previousOriginY + sums.py / n);
+		transform.translation = Vector2(transform.center.x - transform.previousCenter.x,
+			transform.center.y - transform.previousCenter.y);
+
+		// Moments around the centroids, from the moments around the first point
+		float dot = sums.dot - (sums.px * sums.qx + sums.py * sums.qy) / n;
+		float cross = sums.cross - (sums.px * sums.qy - sums.py * sums.qx) / n;
+		float pp = sums.pp - (sums.px * sums.px + sums.py * sums.py) / n;
+		if (transform.numPoints > 1 && pp > 0.0f)
+		{
+			transform.scale = std::sqrt(dot * dot + cross * cross) / pp;
+			transform.rotation = (float)(std::atan2(cross, dot) * RAD_TO_DEG);
+		}
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+static float distanceSquared(float x1, float y1, float x2, float y2)
+{
+	float dx = x1 - x2;
+	float dy = y1 - y2;
+	return dx * dx + dy * dy;
+}
+// ----------------------------------------------------------------------------
+static bool canSplit(const float* x, const float* y, int numPoints, float minPointDistance)
+{
+	float minDistance = minPointDistance * minPointDistance;
+	for (int i = 0; i < numPoints - 1; i++)
+	{
+		for (int j = i + 1; j < numPoints; j++)
+		{
+			if (distanceSquared(x[i], y[i], x[j], y[j]) >= minDistance)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+// ----------------------------------------------------------------------------
+Result splitClusters(const float* x, const float* y, int numPoints, float minPointDistance, int* clusters,
+	int* hasClusters)
+{
+	if (hasClusters == NULL || (numPoints > 0 && (x == NULL || y == NULL || clusters == NULL)))
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	*hasClusters = canSplit(x, y, numPoints, minPointDistance) ? 1 : 0;
+	if (*hasClusters == 0)
+	{
+		return R_OK;
+	}
+
+	// The first two points start the clusters, the others are not assigned yet
+	for (int i = 0; i < numPoints; i++)
+	{
+		clusters[i] = -1;
+	}
+	clusters[0] = 0;
+	clusters[1] = 1;
+
+	bool changed = numPoints > 2;
+	for (int iteration = 0; changed && iteration < CLUSTER_MAX_ITERATIONS; iteration++)
+	{
+		float sumX[2] = { 0.0f, 0.0f };
+		float sumY[2] = { 0.0f, 0.0f };
+		int count[2] = { 0, 0 };
+		for (int i = 0; i < numPoints; i++)
+		{
+			if (clusters[i] >= 0)
+			{
+				sumX[clusters[i]] += x[i];
+				sumY[clusters[i]] += y[i];
+				count[clusters[i]]++;
+			}
+		}
+		if (count[0] == 0 || count[1] == 0)
+		{
+			break;
+		}
+
+		float centerX1 = sumX[0] / count[0];
+		float centerY1 = sumY[0] / count[0];
+		float centerX2 = sumX[1] / count[1];
+		float centerY2 = sumY[1] / count[1];
+
+		// The points most distant from either cluster
+		int farthest1 = 0;
+		int farthest2 = 0;
+		float maxDistance1 = -1.0f;
+		float maxDistance2 = -1.0f;
+		for (int i = 0; i < numPoints; i++)
+		{
+			float distance = distanceSquared(centerX1, centerY1, x[i], y[i]);
+			if (distance > maxDistance2)
+			{
+				maxDistance2 = distance;
+				farthest2 = i;
+			}
+
+			distance = distanceSquared(centerX2, centerY2, x[i], y[i]);
+			if (distance > maxDistance1)
+			{
+				maxDistance1 = distance;
+				farthest1 = i;
+			}
+		}
+
+		// A point farthest from both clusters is too far away from both and gets a cluster of its own
+		if (farthest1 == farthest2)
+		{
+			centerX1 = (centerX1 + centerX2) * 0.5f;
+			centerY1 = (centerY1 + centerY2) * 0.5f;
+		}
+		else
+		{
+			centerX1 = x[farthest1];
+			centerY1 = y[farthest1];
+		}
+		centerX2 = x[farthest2];
+		centerY2 = y[farthest2];
+
+		changed = false;
+		for (int i = 0; i < numPoints; i++)
+		{
+			int cluster = distanceSquared(centerX1, centerY1, x[i], y[i]) <
+				distanceSquared(centerX2, centerY2, x[i], y[i]) ? 0 : 1;
+			changed |= clusters[i] != cluster;
+			clusters[i] = cluster;
+		}
+	}
+
+	return R_OK;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowTransform.h"
+
+// Iterations of splitting into two clusters before the assignment is accepted even if it still changes
+#define CLUSTER_MAX_ITERATIONS 64
+
+/// @brief Computes the transform of every cluster of pointers in a single pass over its points. The
+/// rotation and scale are those of the similarity transform that best maps the previous positions around
+/// their centroid to the current ones, which for two pointers are the change of the angle and length of the
+/// line between them, as computed by the managed transform gestures.
+/// @param x Current positions, the points of a cluster are stored consecutively
+/// @param previousX Previous positions, in the same order
+/// @param clusterOffsets numClusters + 1 offsets, cluster i holds the points from clusterOffsets[i] up to
+/// clusterOffsets[i + 1]
+/// @param transforms Receives numClusters transforms
+Result computeClusterTransforms(const float* x, const float* y, const float* previousX, const float* previousY,
+	const int* clusterOffsets, int numClusters, ClusterTransform* transforms);
+/// @brief Computes with a specific kernel, used by the benchmarks. The kernels sum in a different order, so
+/// their results differ in the last bits.
+Result computeClusterTransforms(const float* x, const float* y, const float* previousX, const float* previousY,
+	const int* clusterOffsets, int numClusters, ClusterTransform* transforms, TransformKernel kernel);
+
+/// @brief Splits points into two clusters as Clusters2D does: starting from the first two points, the
+/// points farthest from the centers of the clusters become the new centers and all points are assigned to
+/// the closest one, until the assignment no longer changes.
+/// @param minPointDistance Points are only split if at least two are this far apart
+/// @param clusters Receives 0 or 1 per point, untouched if the points are not split
+/// @param hasClusters Set to 1 if the points were split, 0 otherwise
+Result splitClusters(const float* x, const float* y, int numPoints, float minPointDistance, int* clusters,
+	int* hasClusters);
\ No newline at end of file
@@ -49,7 +49,9 @@ typedef enum
 	PF_FIFTH_BUTTON = 0x00000100,
 	PF_DOWN = 0x00010000,
 	PF_UPDATE = 0x00020000,
-	PF_UP = 0x00040000
+	PF_UP = 0x00040000,
+	/** Set on the PE_UP of a touch whose end never arrived, like after its device was removed */
+	PF_CANCELED = 0x00080000
 } PointerFlags;
 
 typedef enum
@@ -71,6 +73,12 @@ struct Vector2
 {
 	float x, y;
 
+	Vector2()
+	{
+		this->x = 0.0f;
+		this->y = 0.0f;
+	}
+
 	Vector2(float x, float y)
 	{
 		this->x = x;
@@ -78,10 +86,239 @@ struct Vector2
 	}
 };
 
+typedef enum
+{
+	TM_NONE = 0x00000000,
+	TM_CONTACT_AREA = 0x00000001,
+	TM_ORIENTATION = 0x00000002,
+	TM_PRESSURE = 0x00000004,
+	TM_PREDICTION = 0x00000008
+} TouchMask;
+
 struct PointerData
 {
 	PointerFlags flags;
 	PointerButtonChangeType changedButtons;
+	/** Which of the values below were reported by the device */
+	TouchMask mask;
+	/** Normalized to [0, 1] */
+	float pressure;
+	/** In radians */
+	float orientation;
+	/** Contact size along the major and minor axis, normalized to [0, 1] of the device range */
+	float touchMajor;
+	float touchMinor;
+	/** Estimated velocity in position units per second, set if prediction is enabled for the handler */
+	Vector2 velocity;
+	/** Position extrapolated by the prediction horizon of the handler */
+	Vector2 predictedPosition;
+	/** Id of the topmost region registered with the handler the pointer went down in, set for PE_DOWN only,
+		0 if it is outside of every region */
+	int region;
+	/** Index of a touch in the slot table of the handler, stable from its PE_DOWN up to and including its PE_UP.
+		A touch going down gets the lowest free slot. -1 for the mouse */
+	int slot;
+};
+
+/**	Fixed layout record of a single pointer event, as copied to the caller by PointerHandler_GetPointerEvents. */
+struct PointerEventData
+{
+	int id;
+	PointerEvent event;
+	PointerType type;
+	Vector2 position;
+	PointerData data;
+};
+
+/**	Discrete single pointer gestures recognized by a PointerHandler. */
+typedef enum
+{
+	GT_NONE = 0,
+	GT_TAP = 1,
+	GT_LONG_PRESS = 2,
+	GT_FLICK = 3
+} GestureType;
+
+/**	Thresholds of the gesture recognizer of a PointerHandler. Distances are in screen pixels, times in seconds,
+	infinite limits are never exceeded. */
+struct GestureSettings
+{
+	/** Bit per GestureType to recognize, (1 << GT_TAP) and so on */
+	int mask;
+	/** Longest a pointer may be down for a tap, and between the taps of a multi tap */
+	float tapTimeLimit;
+	/** Farthest a pointer may move while down for a tap, and between the taps of a multi tap */
+	float tapDistanceLimit;
+	/** Time a pointer has to be down for a long press */
+	float longPressTime;
+	/** Farthest a pointer may move before its long press is recognized */
+	float longPressDistanceLimit;
+	/** Only the movement during this time before the pointer is released makes up a flick */
+	float flickTime;
+	/** Distance a pointer has to move from where it went down before it can flick */
+	float flickMovementThreshold;
+	/** Shortest flick */
+	float flickMinDistance;
+	/** Slowest flick, in pixels per second */
+	float flickMinVelocity;
+};
+
+/**	Parameters of the One Euro filter smoothing the touch positions of a PointerHandler. Distances are in window
+	pixels, frequencies in Hz. */
+struct FilterSettings
+{
+	/** Cutoff frequency of a touch at rest, lower values smooth out more jitter but lag more */
+	float minCutoff;
+	/** Raise of the cutoff per pixel per second the touch moves, higher values lag less while moving */
+	float beta;
+	/** Cutoff frequency the velocity is smoothed with */
+	float derivativeCutoff;
+	/** Updates moving less than this from the last position reported are dropped, 0 reports all updates */
+	float deadZone;
+};
+
+/**	Compact record of a recognized gesture, as copied to the caller by PointerHandler_GetGestureEvents. */
+struct GestureEventData
+{
+	GestureType type;
+	/** Pointer that completed the gesture */
+	int id;
+	PointerType pointerType;
+	/** Number of consecutive taps for a tap, 1 for the other gestures */
+	int count;
+	/** Screen position of the pointer when the gesture was recognized */
+	Vector2 position;
+	/** Movement of a flick during the flick time */
+	Vector2 vector;
+	/** Time the pointer was down for a tap or long press, the time of the movement for a flick, in seconds */
+	float duration;
+	/** CLOCK_MONOTONIC time in nanoseconds of the event that completed the gesture */
+	unsigned long long time;
+};
+
+/**	Transform of a cluster of pointers between their previous and current positions, as computed by
+	Clusters_ComputeTransforms. */
+struct ClusterTransform
+{
+	/** Centroids of the current and previous positions */
+	Vector2 center;
+	Vector2 previousCenter;
+	/** Movement of the centroid */
+	Vector2 translation;
+	/** Change of the spread of the pointers around the centroid, 1 for clusters of less than two pointers */
+	float scale;
+	/** Rotation of the pointers around the centroid in degrees, counterclockwise */
+	float rotation;
+	int numPoints;
+};
+
+/**	Current state of a pointer of a handler, as copied to the caller by PointerHandler_GetActivePointers. */
+struct ActivePointerData
+{
+	int id;
+	PointerType type;
+	/** Slot of a touch, -1 for the mouse */
+	int slot;
+	/** Latest event of the pointer */
+	PointerEvent event;
+	/** PF_*_BUTTON flags of the pressed mouse buttons, PF_FIRST_BUTTON for a touch */
+	PointerFlags buttons;
+	/** Screen position of the latest event, as reported before resampling and prediction */
+	Vector2 position;
+	/** Pressure of the latest event, 0 if the device doesn't report it */
+	float pressure;
+	/** Seconds since a touch went down, or since the first of the pressed buttons of the mouse was pressed or
+		the mouse was first seen */
+	float age;
+	/** CLOCK_MONOTONIC time in nanoseconds of the latest event */
+	unsigned long long time;
+};
+
+/**	Shapes of the regions registered with PointerHandler_AddRegion. */
+typedef enum
+{
+	RS_RECT = 0,
+	RS_CIRCLE = 1,
+	RS_POLYGON = 2
+} RegionShape;
+
+/**	Application defined area of a window, pointers going down in it are tagged with its id. In screen space,
+	as the positions of the pointer events. */
+struct RegionData
+{
+	/** Reported in PointerData.region, must not be 0 */
+	int id;
+	/** Regions of a higher layer are on top, of regions on the same layer the one added last */
+	int layer;
+	RegionShape shape;
+	/** Minimum corner of a rect, center of a circle, origin of the vertices of a polygon */
+	Vector2 position;
+	/** Width and height of a rect, radius of a circle in x, unused for polygons */
+	Vector2 size;
+};
+
+/**	Generational handle of a PointerHandler, 0 is never a valid handle. */
+typedef unsigned int HandlerHandle;
+
+/**	Timing of a replayed recording. */
+typedef enum
+{
+	/** Events are dispatched once their recorded time has passed since the replay started */
+	RM_REALTIME = 0,
+	/** A fixed number of events is dispatched per call to PointerHandlerSystem_ProcessEventQueue */
+	RM_FAST = 1
+} ReplayMode;
+
+/**	Latencies of the events dispatched to a PointerHandler, in microseconds. */
+struct LatencyStats
+{
+	/** Number of events recorded since creation or the last reset */
+	unsigned long long numEvents;
+	/** From the X server timestamp of an event to its dispatch, corrected for the clock offset */
+	unsigned long long eventP50;
+	unsigned long long eventP99;
+	unsigned long long eventMax;
+	/** From reading an event from the connection to its dispatch */
+	unsigned long long queueP50;
+	unsigned long long queueP99;
+	unsigned long long queueMax;
+	/** Estimated offset of X server time to CLOCK_MONOTONIC */
+	long long clockOffset;
+	/** Estimated drift of the X server clock in parts per million */
+	double clockDrift;
+};
+
+/**	Implementation used to read and decode events from the X server connection. */
+typedef enum
+{
+	/** XNextEvent and XGetEventData */
+	EB_XLIB = 0,
+	/** Events parsed from the xcb-xinput wire structs, only available if built with X11TOUCH_XCB_BACKEND */
+	EB_XCB = 1
+} EventBackend;
+
+/**	Settings passed to PointerHandlerSystem_Create, NULL selects the defaults. */
+struct SystemSettings
+{
+	/** Read events on a dedicated thread with its own display connection */
+	int threaded;
+	/** SCHED_FIFO priority of the reader thread, 0 keeps the default scheduling policy */
+	int threadPriority;
+	/** Mask of the CPUs the reader thread may run on, 0 leaves the affinity untouched */
+	unsigned long long threadAffinityMask;
+	/** Number of events the reader thread can queue ahead of the main thread, 0 selects the default */
+	int queueCapacity;
+	/** Messages of a lower MessageType are discarded before they are formatted */
+	int minMessageType;
+	/** EventBackend events are read with, unavailable backends fall back to EB_XLIB */
+	int backend;
+	/** Read the events published by the broker of the display instead of selecting them on a connection of
+	the system, falls back to the connection if no broker is running */
+	int broker;
+	/** Select raw touch, motion and button events once on the root window instead of the events of every window,
+	and route them to the windows of the handlers natively. Touches stay with the window they began in when they
+	leave it. Ignored when reading through the broker. */
+	int rawEvents;
 };
 
 /**	*/
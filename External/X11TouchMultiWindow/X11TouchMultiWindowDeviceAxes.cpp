@@ -0,0 +1,251 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <cmath>
+
+#include "X11TouchMultiWindowDeviceAxes.h"
+
+// Valuator labels as assigned by the evdev and libinput drivers
+static const char* AXIS_LABELS[NUM_DEVICE_AXES] = {
+	"Abs MT Pressure",
+	"Abs MT Touch Major",
+	"Abs MT Touch Minor",
+	"Abs MT Orientation"
+};
+
+// ----------------------------------------------------------------------------
+static inline double toDouble(double value)
+{
+	return value;
+}
+// ----------------------------------------------------------------------------
+static inline double toDouble(const FixedPoint3232& value)
+{
+	return value.integral + value.frac * (1.0 / 4294967296.0);
+}
+// ----------------------------------------------------------------------------
+template<typename MaskWord, typename Value>
+static void decodeValuators(const DeviceAxes* axes, const MaskWord* mask, int maskLen, const Value* value,
+	DeviceEvent* event)
+{
+	event->axesMask = 0;
+
+	if (axes == nullptr)
+	{
+		return;
+	}
+
+	// Values are packed in the order of the set bits in the mask, so walk the set bits only and
+	// stop after the last valuator of interest
+	const int wordBits = sizeof(MaskWord) * 8;
+	for (int word = 0; word < maskLen; word++)
+	{
+		uint32_t bits = mask[word];
+		while (bits != 0)
+		{
+			int valuator = word * wordBits + __builtin_ctz(bits);
+			bits &= bits - 1;
+
+			if (valuator > axes->lastValuator)
+			{
+				return;
+			}
+
+			int axis = axes->axisOfValuator[valuator];
+			if (axis >= 0)
+			{
+				event->axes[axis] = (float)((toDouble(*value) - axes->offset[axis]) * axes->scale[axis]);
+				event->axesMask |= 1 << axis;
+			}
+			value++;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+// The X server reports the position of a pointer device in its first two valuators
+template<typename MaskWord, typename Value>
+static void decodePosition(const DeviceAxes* axes, const MaskWord* mask, int maskLen, const Value* value,
+	DeviceEvent* event)
+{
+	event->x = NAN;
+	event->y = NAN;
+
+	if (axes == nullptr || !axes->absolute)
+	{
+		event->flags |= DEVICE_EVENT_RELATIVE;
+	}
+
+	if (axes == nullptr || maskLen < 1)
+	{
+		return;
+	}
+
+	// Both come before the values of any other valuator
+	if (mask[0] & 1)
+	{
+		event->x = (toDouble(*value) - axes->positionOffset[0]) * axes->positionScale[0];
+		value++;
+	}
+	if (mask[0] & 2)
+	{
+		event->y = (toDouble(*value) - axes->positionOffset[1]) * axes->positionScale[1];
+	}
+}
+
+// ----------------------------------------------------------------------------
+DeviceAxesTable::DeviceAxesTable()
+{
+	for (int i = 0; i < NUM_DEVICE_AXES; i++)
+	{
+		mLabels[i] = None;
+	}
+}
+// ----------------------------------------------------------------------------
+void DeviceAxesTable::initialize(Display* display)
+{
+	for (int i = 0; i < NUM_DEVICE_AXES; i++)
+	{
+		// Atoms that do not exist yet can't be a label of any device, but may be created by a device
+		// plugged in later
+		if (mLabels[i] == None)
+		{
+			mLabels[i] = XInternAtom(display, AXIS_LABELS[i], True);
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void DeviceAxesTable::update(const XIDeviceInfo& device)
+{
+	if (device.deviceid < 0)
+	{
+		return;
+	}
+
+	if (device.deviceid >= (int)mDevices.size())
+	{
+		// Devices that are not known yet decode raw events as relative motion
+		DeviceAxes empty;
+		empty.lastValuator = -1;
+		empty.absolute = false;
+		empty.positionOffset[0] = empty.positionOffset[1] = 0.0;
+		empty.positionScale[0] = empty.positionScale[1] = 1.0;
+		mDevices.resize(device.deviceid + 1, empty);
+	}
+
+	DeviceAxes& axes = mDevices[device.deviceid];
+	for (int i = 0; i < MAX_DEVICE_VALUATORS; i++)
+	{
+		axes.axisOfValuator[i] = -1;
+	}
+	axes.lastValuator = -1;
+	axes.absolute = false;
+	for (int i = 0; i < 2; i++)
+	{
+		axes.positionOffset[i] = 0.0;
+		axes.positionScale[i] = 1.0;
+	}
+
+	for (int i = 0; i < device.num_classes; i++)
+	{
+		if (device.classes[i]->type != XIValuatorClass)
+		{
+			continue;
+		}
+
+		XIValuatorClassInfo* valuator = (XIValuatorClassInfo*)device.classes[i];
+		if ((valuator->number == 0 || valuator->number == 1) && valuator->mode == XIModeAbsolute)
+		{
+			double range = valuator->max - valuator->min;
+			axes.absolute = true;
+			axes.positionOffset[valuator->number] = valuator->min;
+			axes.positionScale[valuator->number] = range > 0.0 ? 1.0 / range : 0.0;
+		}
+
+		if (valuator->number < 0 || valuator->number >= MAX_DEVICE_VALUATORS || valuator->label == None)
+		{
+			continue;
+		}
+
+		for (int axis = 0; axis < NUM_DEVICE_AXES; axis++)
+		{
+			if (valuator->label != mLabels[axis])
+			{
+				continue;
+			}
+
+			double range = valuator->max - valuator->min;
+			if (axis == DA_ORIENTATION)
+			{
+				// The maximum corresponds to a quarter turn, for both [-max, max] and [0, max] ranges
+				axes.offset[axis] = 0.0;
+				axes.scale[axis] = valuator->max > 0.0 ? (M_PI / 2.0) / valuator->max : 0.0;
+			}
+			else
+			{
+				axes.offset[axis] = valuator->min;
+				axes.scale[axis] = range > 0.0 ? 1.0 / range : 0.0;
+			}
+
+			axes.axisOfValuator[valuator->number] = axis;
+			if (valuator->number > axes.lastValuator)
+			{
+				axes.lastValuator = valuator->number;
+			}
+			break;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void DeviceAxesTable::remove(int deviceId)
+{
+	if (deviceId >= 0 && deviceId < (int)mDevices.size())
+	{
+		mDevices[deviceId].lastValuator = -1;
+	}
+}
+// ----------------------------------------------------------------------------
+unsigned int DeviceAxesTable::getAxesMask(int deviceId) const
+{
+	unsigned int mask = 0;
+
+	const DeviceAxes* axes = get(deviceId);
+	if (axes != nullptr)
+	{
+		for (int i = 0; i <= axes->lastValuator; i++)
+		{
+			if (axes->axisOfValuator[i] >= 0)
+			{
+				mask |= 1 << axes->axisOfValuator[i];
+			}
+		}
+	}
+
+	return mask;
+}
+// ----------------------------------------------------------------------------
+void DeviceAxesTable::decode(int sourceId, const XIValuatorState& valuators, DeviceEvent* event) const
+{
+	decodeValuators(get(sourceId), valuators.mask, valuators.mask_len, valuators.values, event);
+}
+// ----------------------------------------------------------------------------
+void DeviceAxesTable::decode(int sourceId, const uint32_t* mask, int maskLen, const FixedPoint3232* values,
+	DeviceEvent* event) const
+{
+	decodeValuators(get(sourceId), mask, maskLen, values, event);
+}
+// ----------------------------------------------------------------------------
+void DeviceAxesTable::decodeRaw(int sourceId, const XIValuatorState& valuators, DeviceEvent* event) const
+{
+	// Devices without any axes of interest still report a position
+	const DeviceAxes* axes = sourceId >= 0 && sourceId < (int)mDevices.size() ? &mDevices[sourceId] : nullptr;
+	decodePosition(axes, valuators.mask, valuators.mask_len, valuators.values, event);
+	decodeValuators(get(sourceId), valuators.mask, valuators.mask_len, valuators.values, event);
+}
+// ----------------------------------------------------------------------------
+void DeviceAxesTable::decodeRaw(int sourceId, const uint32_t* mask, int maskLen, const FixedPoint3232* values,
+	DeviceEvent* event) const
+{
+	const DeviceAxes* axes = sourceId >= 0 && sourceId < (int)mDevices.size() ? &mDevices[sourceId] : nullptr;
+	decodePosition(axes, mask, maskLen, values, event);
+	decodeValuators(get(sourceId), mask, maskLen, values, event);
+}
\ No newline at end of file
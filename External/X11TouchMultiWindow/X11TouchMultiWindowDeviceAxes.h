@@ -0,0 +1,89 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <vector>
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+
+#include "X11TouchMultiWindowDeviceEvent.h"
+
+#define MAX_DEVICE_VALUATORS 64
+
+/// @brief A valuator value as sent on the wire, layout compatible with xcb_input_fp3232_t.
+struct FixedPoint3232
+{
+	int32_t integral;
+	uint32_t frac;
+};
+
+/// @brief The valuator indices and normalization of the axes of a single source device.
+struct DeviceAxes
+{
+	/// Axis stored at each valuator index, -1 for valuators that are not decoded
+	signed char axisOfValuator[MAX_DEVICE_VALUATORS];
+	/// Highest valuator index mapped to an axis, -1 if the device has none
+	int lastValuator;
+	/// Values are normalized as (value - offset) * scale
+	double offset[NUM_DEVICE_AXES];
+	double scale[NUM_DEVICE_AXES];
+	/// Whether the first two valuators report a position, the motion of the device otherwise
+	bool absolute;
+	/// Positions of raw events are normalized to [0, 1] as (value - positionOffset) * positionScale, the
+	/// motion of relative devices is kept in pixels
+	double positionOffset[2];
+	double positionScale[2];
+};
+
+/// @brief Maps the valuators of every known source device to the axes decoded into a DeviceEvent. The
+/// maps are built from XIQueryDevice once per device, instead of inspecting valuator labels per event.
+class DeviceAxesTable
+{
+private:
+	Atom mLabels[NUM_DEVICE_AXES];
+	// Indexed by device id
+	std::vector<DeviceAxes> mDevices;
+
+public:
+	DeviceAxesTable();
+
+	/// @brief Looks up the valuator labels, labels that did not exist before are looked up again on
+	/// subsequent calls.
+	void initialize(Display* display);
+	/// @brief Assigns the label of an axis directly, for devices described without a display connection.
+	void setLabel(DeviceAxis axis, Atom label) { mLabels[axis] = label; }
+
+	/// @brief Rebuilds the axes of a single device from its classes.
+	void update(const XIDeviceInfo& device);
+	void remove(int deviceId);
+	void clear() { mDevices.clear(); }
+
+	const DeviceAxes* get(int deviceId) const
+	{
+		if (deviceId < 0 || deviceId >= (int)mDevices.size() || mDevices[deviceId].lastValuator < 0)
+		{
+			return nullptr;
+		}
+		return &mDevices[deviceId];
+	}
+
+	/// @brief Returns a bit per DeviceAxis mapped for the device.
+	unsigned int getAxesMask(int deviceId) const;
+
+	/// @brief Stores the normalized values of the mapped valuators present in the event.
+	void decode(int sourceId, const XIValuatorState& valuators, DeviceEvent* event) const;
+	/// @brief Same as above for the valuator mask and values of an event read from the wire.
+	/// @param mask Valuator mask in 32 bit units
+	/// @param maskLen Number of 32 bit units in the mask
+	void decode(int sourceId, const uint32_t* mask, int maskLen, const FixedPoint3232* values,
+		DeviceEvent* event) const;
+
+	/// @brief Stores the normalized axes of a raw event, and its position in x and y. Raw events carry the
+	/// valuators of the device, so x and y are the normalized position of an absolute device or the motion of a
+	/// relative one, NAN if the valuator is not in the event.
+	void decodeRaw(int sourceId, const XIValuatorState& valuators, DeviceEvent* event) const;
+	/// @brief Same as above for the valuator mask and values of a raw event read from the wire.
+	void decodeRaw(int sourceId, const uint32_t* mask, int maskLen, const FixedPoint3232* values,
+		DeviceEvent* event) const;
+};
\ No newline at end of file
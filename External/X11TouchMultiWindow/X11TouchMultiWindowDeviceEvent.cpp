@@ -0,0 +1,114 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include "X11TouchMultiWindowDeviceAxes.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+
+// ----------------------------------------------------------------------------
+bool isDeviceEventType(int evtype)
+{
+	switch (evtype)
+	{
+		case XI_ButtonPress:
+		case XI_ButtonRelease:
+		case XI_Motion:
+		case XI_TouchBegin:
+		case XI_TouchUpdate:
+		case XI_TouchEnd:
+			return true;
+		default:
+			return false;
+	}
+}
+// ----------------------------------------------------------------------------
+bool isRawEventType(int evtype)
+{
+	switch (evtype)
+	{
+		case XI_RawButtonPress:
+		case XI_RawButtonRelease:
+		case XI_RawMotion:
+		case XI_RawTouchBegin:
+		case XI_RawTouchUpdate:
+		case XI_RawTouchEnd:
+			return true;
+		default:
+			return false;
+	}
+}
+// ----------------------------------------------------------------------------
+bool isDeviceChangeEventType(int evtype)
+{
+	return evtype == XI_HierarchyChanged || evtype == XI_DeviceChanged;
+}
+// ----------------------------------------------------------------------------
+void decodeDeviceEvent(const XIDeviceEvent* xiEvent, uint64_t receiveTime, const DeviceAxesTable& deviceAxes,
+	DeviceEvent* event)
+{
+	event->window = xiEvent->event;
+	event->type = xiEvent->evtype;
+	event->deviceId = xiEvent->deviceid;
+	event->sourceId = xiEvent->sourceid;
+	event->detail = xiEvent->detail;
+	event->flags = xiEvent->flags;
+	event->x = xiEvent->event_x;
+	event->y = xiEvent->event_y;
+	event->time = xiEvent->time;
+	event->receiveTime = receiveTime;
+	event->serverTime = 0;
+	event->dispatchTime = 0;
+
+	deviceAxes.decode(xiEvent->sourceid, xiEvent->valuators, event);
+}
+// ----------------------------------------------------------------------------
+void decodeRawEvent(const XIRawEvent* xiEvent, uint64_t receiveTime, const DeviceAxesTable& deviceAxes,
+	DeviceEvent* event)
+{
+	event->window = None;
+	event->type = xiEvent->evtype;
+	event->deviceId = xiEvent->deviceid;
+	event->sourceId = xiEvent->sourceid;
+	event->detail = xiEvent->detail;
+	event->flags = xiEvent->flags;
+	event->time = xiEvent->time;
+	event->receiveTime = receiveTime;
+	event->serverTime = 0;
+	event->dispatchTime = 0;
+
+	// The valuators are accelerated like the motion of the pointer, raw_values are not
+	deviceAxes.decodeRaw(xiEvent->sourceid, xiEvent->valuators, event);
+}
+
+// ----------------------------------------------------------------------------
+void decodeDeviceChangeEvent(const XIEvent* xiEvent, uint64_t receiveTime, std::vector<DeviceEvent>& events)
+{
+	DeviceEvent event = {};
+	event.type = xiEvent->evtype;
+	event.time = xiEvent->time;
+	event.receiveTime = receiveTime;
+
+	if (xiEvent->evtype == XI_HierarchyChanged)
+	{
+		// The server reports every device, only the ones with flags set have changed
+		const XIHierarchyEvent* hierarchyEvent = (const XIHierarchyEvent*)xiEvent;
+		for (int i = 0; i < hierarchyEvent->num_info; i++)
+		{
+			const XIHierarchyInfo& info = hierarchyEvent->info[i];
+			if (info.flags != 0)
+			{
+				event.deviceId = info.deviceid;
+				event.sourceId = info.deviceid;
+				event.flags = info.flags;
+				events.push_back(event);
+			}
+		}
+	}
+	else if (xiEvent->evtype == XI_DeviceChanged)
+	{
+		const XIDeviceChangedEvent* changedEvent = (const XIDeviceChangedEvent*)xiEvent;
+		event.deviceId = changedEvent->deviceid;
+		event.sourceId = changedEvent->sourceid;
+		event.flags = changedEvent->reason;
+		events.push_back(event);
+	}
+}
\ No newline at end of file
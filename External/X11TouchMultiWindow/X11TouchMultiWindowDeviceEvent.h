@@ -0,0 +1,91 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+
+class DeviceAxesTable;
+
+// Set in the flags of the touch ends a handler synthesizes for touches whose end never arrived, no XI event
+// flag uses this bit
+#define DEVICE_EVENT_CANCELED 0x40000000
+// Set in the flags of the raw events of relative devices, whose x and y are the motion of the device instead of
+// its position
+#define DEVICE_EVENT_RELATIVE 0x20000000
+
+/// @brief Axes decoded from the valuators of a device event.
+typedef enum
+{
+	DA_PRESSURE = 0,
+	DA_TOUCH_MAJOR = 1,
+	DA_TOUCH_MINOR = 2,
+	DA_ORIENTATION = 3,
+	NUM_DEVICE_AXES = 4
+} DeviceAxis;
+
+/// @brief An XInput2 device event decoded into a fixed size record, so it can be queued and copied
+/// around after the X event cookie has been freed. Device changes are decoded into the same record, with
+/// the hierarchy flags or change reason in flags.
+struct DeviceEvent
+{
+	Window window;
+	int type;
+	int deviceId;
+	int sourceId;
+	int detail;
+	int flags;
+	double x;
+	double y;
+	/// X server time in milliseconds
+	Time time;
+	/// CLOCK_MONOTONIC time in nanoseconds at which the event was read from the connection
+	uint64_t receiveTime;
+	/// Server time converted to CLOCK_MONOTONIC nanoseconds, 0 while the clock offset is unknown
+	uint64_t serverTime;
+	/// CLOCK_MONOTONIC time in nanoseconds at which the event was dispatched to its handler
+	uint64_t dispatchTime;
+	/// Bit per DeviceAxis present in the event
+	unsigned int axesMask;
+	/// Pressure and touch sizes normalized to [0, 1], orientation in radians
+	float axes[NUM_DEVICE_AXES];
+};
+
+/// @brief Returns whether the XInput2 event type is one of the device events processed by a PointerHandler.
+/// @param evtype 
+bool isDeviceEventType(int evtype);
+
+/// @brief Returns whether the XInput2 event type is one of the raw events selected on the root window, which are
+/// routed to the window of a PointerHandler by a RawEventRouter.
+/// @param evtype 
+bool isRawEventType(int evtype);
+
+/// @brief Returns whether the XInput2 event type reports devices being added, removed or changed.
+/// @param evtype 
+bool isDeviceChangeEventType(int evtype);
+
+/// @brief Copies the fields used for pointer processing from an XInput2 device event.
+/// @param xiEvent 
+/// @param receiveTime 
+/// @param deviceAxes 
+/// @param event 
+void decodeDeviceEvent(const XIDeviceEvent* xiEvent, uint64_t receiveTime, const DeviceAxesTable& deviceAxes,
+	DeviceEvent* event);
+
+/// @brief Copies the fields used for pointer processing from an XInput2 raw event. The event has no window yet,
+/// x and y are decoded as described by DeviceAxesTable::decodeRaw.
+/// @param xiEvent 
+/// @param receiveTime 
+/// @param deviceAxes 
+/// @param event 
+void decodeRawEvent(const XIRawEvent* xiEvent, uint64_t receiveTime, const DeviceAxesTable& deviceAxes,
+	DeviceEvent* event);
+
+/// @brief Appends an event for every device changed by an XI_HierarchyChanged or XI_DeviceChanged event.
+/// @param xiEvent 
+/// @param receiveTime 
+/// @param events 
+void decodeDeviceChangeEvent(const XIEvent* xiEvent, uint64_t receiveTime, std::vector<DeviceEvent>& events);
\ No newline at end of file
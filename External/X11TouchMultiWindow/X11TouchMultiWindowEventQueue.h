@@ -0,0 +1,70 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/// @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+/// The capacity is rounded up to a power of two.
+template<typename T>
+class EventQueue
+{
+private:
+	std::vector<T> mBuffer;
+	size_t mMask;
+
+	// Head and tail are written by different threads, keep them on separate cache lines
+	char mPadding0[64];
+	std::atomic<size_t> mHead;
+	char mPadding1[64];
+	std::atomic<size_t> mTail;
+	char mPadding2[64];
+
+public:
+	EventQueue(size_t capacity)
+		: mHead(0)
+		, mTail(0)
+	{
+		size_t size = 1;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+
+		mBuffer.resize(size);
+		mMask = size - 1;
+	}
+
+	size_t getCapacity() const { return mBuffer.size(); }
+
+	/// @brief Called by the producer. Returns false if the queue is full.
+	bool push(const T& item)
+	{
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mHead.load(std::memory_order_acquire) == mBuffer.size())
+		{
+			return false;
+		}
+
+		mBuffer[tail & mMask] = item;
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// @brief Called by the consumer. Returns false if the queue is empty.
+	bool pop(T& item)
+	{
+		size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		item = mBuffer[head & mMask];
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+};
\ No newline at end of file
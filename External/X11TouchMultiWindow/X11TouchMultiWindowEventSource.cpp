@@ -0,0 +1,273 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cstring>
+#include <X11/extensions/XInput2.h>
+
+#include "X11TouchMultiWindowEventSource.h"
+#include "X11TouchMultiWindowLogger.h"
+#include "X11TouchMultiWindowUtils.h"
+#include "X11TouchMultiWindowWindowCache.h"
+#ifdef X11TOUCH_XCB_BACKEND
+#include "X11TouchMultiWindowXcbEventSource.h"
+#endif
+
+// ----------------------------------------------------------------------------
+EventSource::EventSource(Logger* logger, const DeviceAxesTable* deviceAxes)
+	: mLogger(logger)
+	, mDeviceAxes(deviceAxes)
+	, mOpcode(0)
+	, mNumChangeEventsRead(0)
+{
+
+}
+// ----------------------------------------------------------------------------
+size_t EventSource::takeChangeEvents(DeviceEvent* events, size_t maxEvents)
+{
+	size_t numEvents = std::min(maxEvents, mChangeEvents.size() - mNumChangeEventsRead);
+	std::copy(mChangeEvents.begin() + mNumChangeEventsRead,
+		mChangeEvents.begin() + mNumChangeEventsRead + numEvents, events);
+
+	mNumChangeEventsRead += numEvents;
+	if (mNumChangeEventsRead == mChangeEvents.size())
+	{
+		mChangeEvents.clear();
+		mNumChangeEventsRead = 0;
+	}
+
+	return numEvents;
+}
+
+// ----------------------------------------------------------------------------
+XlibEventSource::XlibEventSource(Logger* logger, const DeviceAxesTable* deviceAxes, const char* displayName,
+	Display* display, WindowCache* windowCache)
+	: EventSource(logger, deviceAxes)
+	, mDisplayName(displayName != NULL ? displayName : "")
+	, mDisplay(display)
+	, mOwnsDisplay(display == NULL)
+	, mWindowCache(windowCache)
+{
+
+}
+// ----------------------------------------------------------------------------
+XlibEventSource::~XlibEventSource()
+{
+	close();
+}
+// ----------------------------------------------------------------------------
+Result XlibEventSource::open()
+{
+	if (mOwnsDisplay)
+	{
+		mDisplay = XOpenDisplay(mDisplayName.empty() ? NULL : mDisplayName.c_str());
+		if (mDisplay == NULL)
+		{
+			LOG_ERROR(mLogger, "Failed to open X11 display connection for events to '%s'.",
+				XDisplayName(mDisplayName.empty() ? NULL : mDisplayName.c_str()));
+			return R_ERROR_API;
+		}
+	}
+
+	int event, error;
+	if (!XQueryExtension(mDisplay, "XInputExtension", &mOpcode, &event, &error))
+	{
+		LOG_ERROR(mLogger, "Failed to get the XInput extension for events.");
+		close();
+		return R_ERROR_API;
+	}
+
+	if (mOwnsDisplay)
+	{
+		// XI2 events are only delivered in the XI2 format to clients that announced their version
+		int major = 2, minor = 3;
+		XIQueryVersion(mDisplay, &major, &minor);
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void XlibEventSource::close()
+{
+	if (mOwnsDisplay && mDisplay != NULL)
+	{
+		XCloseDisplay(mDisplay);
+	}
+	mDisplay = NULL;
+}
+// ----------------------------------------------------------------------------
+Result XlibEventSource::selectEvents(Window window, const int* deviceIds, size_t numDeviceIds)
+{
+	// Setup the event mask fore the events we want to listen to
+	unsigned char mask[XIMaskLen(XI_LASTEVENT)];
+	memset(mask, 0, sizeof(mask));
+	// Mouse buttons
+	XISetMask(mask, XI_ButtonPress);
+	XISetMask(mask, XI_ButtonRelease);
+	// Mouse motion
+	XISetMask(mask, XI_Motion);
+	// Touch
+	XISetMask(mask, XI_TouchBegin);
+	XISetMask(mask, XI_TouchUpdate);
+	XISetMask(mask, XI_TouchEnd);
+
+	Status status = Success;
+	for (size_t i = 0; i < numDeviceIds; i++)
+	{
+		XIEventMask eventMask = {
+			.deviceid = deviceIds[i],
+			.mask_len = sizeof(mask),
+			.mask = mask
+		};
+
+		Status s = XISelectEvents(mDisplay, window, &eventMask, 1);
+		if (s != Success)
+		{
+			LOG_ERROR(mLogger, "Failed to select events for window %lu: %d", window, s);
+			status = s;
+		}
+	}
+
+	if (status != Success)
+	{
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result XlibEventSource::selectDeviceChangeEvents()
+{
+	unsigned char mask[XIMaskLen(XI_LASTEVENT)];
+	memset(mask, 0, sizeof(mask));
+	XISetMask(mask, XI_HierarchyChanged);
+	XISetMask(mask, XI_DeviceChanged);
+
+	XIEventMask eventMask = {
+		.deviceid = XIAllDevices,
+		.mask_len = sizeof(mask),
+		.mask = mask
+	};
+
+	Status status = XISelectEvents(mDisplay, XDefaultRootWindow(mDisplay), &eventMask, 1);
+	if (status != Success)
+	{
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result XlibEventSource::selectRawEvents()
+{
+	unsigned char mask[XIMaskLen(XI_LASTEVENT)];
+	memset(mask, 0, sizeof(mask));
+	XISetMask(mask, XI_RawButtonPress);
+	XISetMask(mask, XI_RawButtonRelease);
+	XISetMask(mask, XI_RawMotion);
+	XISetMask(mask, XI_RawTouchBegin);
+	XISetMask(mask, XI_RawTouchUpdate);
+	XISetMask(mask, XI_RawTouchEnd);
+
+	// Devices plugged in later are included without selecting again
+	XIEventMask eventMask = {
+		.deviceid = XIAllDevices,
+		.mask_len = sizeof(mask),
+		.mask = mask
+	};
+
+	Status status = XISelectEvents(mDisplay, XDefaultRootWindow(mDisplay), &eventMask, 1);
+	if (status != Success)
+	{
+		LOG_ERROR(mLogger, "Failed to select raw events on the root window: %d", status);
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void XlibEventSource::flush()
+{
+	XFlush(mDisplay);
+}
+// ----------------------------------------------------------------------------
+bool XlibEventSource::hasPendingEvents()
+{
+	// Replies to requests on a shared connection may have read events into the queue
+	return mNumChangeEventsRead < mChangeEvents.size() || XEventsQueued(mDisplay, QueuedAfterReading) > 0;
+}
+// ----------------------------------------------------------------------------
+size_t XlibEventSource::read(DeviceEvent* events, size_t maxEvents)
+{
+	size_t numEvents = takeChangeEvents(events, maxEvents);
+
+	XEvent xEvent;
+	while (numEvents < maxEvents && XEventsQueued(mDisplay, QueuedAfterReading) > 0)
+	{
+		XNextEvent(mDisplay, &xEvent);
+		uint64_t receiveTime = getMonotonicTime();
+
+		if (xEvent.type != GenericEvent)
+		{
+			if (mWindowCache != nullptr)
+			{
+				mWindowCache->processEvent(xEvent);
+			}
+			continue;
+		}
+
+		if (xEvent.xcookie.extension != mOpcode)
+		{
+			// Received a non xinput event
+			continue;
+		}
+
+		if (isDeviceChangeEventType(xEvent.xcookie.evtype))
+		{
+			if (XGetEventData(mDisplay, &xEvent.xcookie))
+			{
+				decodeDeviceChangeEvent((XIEvent*)xEvent.xcookie.data, receiveTime, mChangeEvents);
+				XFreeEventData(mDisplay, &xEvent.xcookie);
+
+				numEvents += takeChangeEvents(events + numEvents, maxEvents - numEvents);
+			}
+			continue;
+		}
+
+		bool raw = isRawEventType(xEvent.xcookie.evtype);
+		if ((!raw && !isDeviceEventType(xEvent.xcookie.evtype)) || !XGetEventData(mDisplay, &xEvent.xcookie))
+		{
+			continue;
+		}
+
+		if (raw)
+		{
+			decodeRawEvent((XIRawEvent*)xEvent.xcookie.data, receiveTime, *mDeviceAxes, &events[numEvents]);
+		}
+		else
+		{
+			decodeDeviceEvent((XIDeviceEvent*)xEvent.xcookie.data, receiveTime, *mDeviceAxes, &events[numEvents]);
+		}
+		XFreeEventData(mDisplay, &xEvent.xcookie);
+
+		numEvents++;
+	}
+
+	return numEvents;
+}
+
+// ----------------------------------------------------------------------------
+EventSource* createEventSource(EventBackend backend, Logger* logger, const DeviceAxesTable* deviceAxes,
+	const char* displayName, Display* display, WindowCache* windowCache)
+{
+	if (backend == EB_XCB)
+	{
+#ifdef X11TOUCH_XCB_BACKEND
+		return new XcbEventSource(logger, deviceAxes, displayName);
+#else
+		LOG_WARNING(logger, "XCB event backend is not available in this build, falling back to Xlib");
+#endif
+	}
+
+	return new XlibEventSource(logger, deviceAxes, displayName, display, windowCache);
+}
\ No newline at end of file
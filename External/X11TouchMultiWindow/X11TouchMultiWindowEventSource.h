@@ -0,0 +1,103 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+
+class DeviceAxesTable;
+class Logger;
+class WindowCache;
+
+/// @brief Reads XInput2 events from an X server connection and decodes them into DeviceEvents. Events
+/// are selected on the same connection, as the server only delivers them to the client that selected them.
+class EventSource
+{
+protected:
+	Logger* mLogger;
+	const DeviceAxesTable* mDeviceAxes;
+	int mOpcode;
+
+	// Device change events decoded from a single X event may not fit in the space left by read
+	std::vector<DeviceEvent> mChangeEvents;
+	size_t mNumChangeEventsRead;
+
+public:
+	EventSource(Logger* logger, const DeviceAxesTable* deviceAxes);
+	virtual ~EventSource() {}
+
+	virtual Result open() = 0;
+	virtual void close() = 0;
+
+	/// @brief Returns the file descriptor of the connection, to wait for events with poll.
+	virtual int getFd() const = 0;
+	/// @brief Returns the Xlib connection events are read from, NULL if they are not read through Xlib.
+	virtual Display* getDisplay() const { return NULL; }
+
+	virtual Result selectEvents(Window window, const int* deviceIds, size_t numDeviceIds) = 0;
+	/// @brief Stops reading the events of a window its handler was destroyed for. The X sources keep their
+	/// selections, the system discards the events of windows without a handler.
+	virtual void unselectEvents(Window) {}
+	/// @brief Selects hierarchy and device changes of all devices on the root window.
+	virtual Result selectDeviceChangeEvents() = 0;
+	/// @brief Selects the raw touch, motion and button events of all devices on the root window, which are
+	/// delivered regardless of the window under the pointer and of grabs. Their windows are left to the caller.
+	virtual Result selectRawEvents() { return R_ERROR_UNSUPPORTED; }
+	/// @brief Sends pending requests to the X server.
+	virtual void flush() = 0;
+	/// @brief Returns whether events have been read from the connection but not returned by read yet, in which
+	/// case the file descriptor may not become readable for them.
+	virtual bool hasPendingEvents() = 0;
+
+	/// @brief Reads and decodes up to maxEvents events, without blocking.
+	/// @return The number of events stored, less than maxEvents once no more events are available
+	virtual size_t read(DeviceEvent* events, size_t maxEvents) = 0;
+
+protected:
+	size_t takeChangeEvents(DeviceEvent* events, size_t maxEvents);
+};
+
+/// @brief Reads events through Xlib. It either opens its own display connection, or shares the connection
+/// of the system, in which case the core events of the window cache are read from it as well.
+class XlibEventSource : public EventSource
+{
+private:
+	std::string mDisplayName;
+	Display* mDisplay;
+	bool mOwnsDisplay;
+	WindowCache* mWindowCache;
+
+public:
+	/// @param displayName Display to open a new connection to, NULL for the DISPLAY environment variable
+	/// @param display Connection to share, NULL to open a new one
+	/// @param windowCache Receives the events of a shared connection that are not XInput2 events
+	XlibEventSource(Logger* logger, const DeviceAxesTable* deviceAxes, const char* displayName,
+		Display* display, WindowCache* windowCache);
+	~XlibEventSource();
+
+	Result open() override;
+	void close() override;
+
+	int getFd() const override { return ConnectionNumber(mDisplay); }
+	Display* getDisplay() const override { return mDisplay; }
+
+	Result selectEvents(Window window, const int* deviceIds, size_t numDeviceIds) override;
+	Result selectDeviceChangeEvents() override;
+	Result selectRawEvents() override;
+	void flush() override;
+	bool hasPendingEvents() override;
+
+	size_t read(DeviceEvent* events, size_t maxEvents) override;
+};
+
+/// @brief Creates the source of the requested backend, falling back to Xlib if it is not available.
+/// @param displayName Display a source opens its own connection to, NULL for the DISPLAY environment variable
+/// @param display Connection an Xlib source shares, NULL to let the source open its own
+/// @param windowCache See XlibEventSource
+EventSource* createEventSource(EventBackend backend, Logger* logger, const DeviceAxesTable* deviceAxes,
+	const char* displayName, Display* display, WindowCache* windowCache);
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cmath>
+
+#include "X11TouchMultiWindowFilter.h"
+
+// Defaults, in Hz and pixels. The cutoff smooths the jitter of a touch at rest, beta lets it follow fast moves.
+#define FILTER_DEFAULT_MIN_CUTOFF 1.0f
+#define FILTER_DEFAULT_BETA 0.007f
+#define FILTER_DEFAULT_DERIVATIVE_CUTOFF 1.0f
+#define FILTER_DEFAULT_DEAD_ZONE 0.0f
+// Samples closer together, like those with the same server time in milliseconds, are filtered as this far apart,
+// in seconds
+#define FILTER_MIN_INTERVAL 0.001f
+
+// ----------------------------------------------------------------------------
+static float getAlpha(float cutoff, float interval)
+{
+	float tau = 1.0f / (2.0f * (float)M_PI * cutoff);
+	return 1.0f / (1.0f + tau / interval);
+}
+// ----------------------------------------------------------------------------
+PointerFilter::PointerFilter()
+{
+	reset();
+
+	FilterSettings settings;
+	settings.minCutoff = FILTER_DEFAULT_MIN_CUTOFF;
+	settings.beta = FILTER_DEFAULT_BETA;
+	settings.derivativeCutoff = FILTER_DEFAULT_DERIVATIVE_CUTOFF;
+	settings.deadZone = FILTER_DEFAULT_DEAD_ZONE;
+	setSettings(settings);
+}
+// ----------------------------------------------------------------------------
+void PointerFilter::setSettings(const FilterSettings& settings)
+{
+	// A cutoff of 0 would never let the position move
+	mMinCutoff = std::max(settings.minCutoff, 0.001f);
+	mBeta = std::max(settings.beta, 0.0f);
+	mDerivativeCutoff = std::max(settings.derivativeCutoff, 0.001f);
+	mDeadZone = std::max(settings.deadZone, 0.0f) * std::max(settings.deadZone, 0.0f);
+}
+// ----------------------------------------------------------------------------
+FilterSettings PointerFilter::getSettings() const
+{
+	FilterSettings settings;
+	settings.minCutoff = mMinCutoff;
+	settings.beta = mBeta;
+	settings.derivativeCutoff = mDerivativeCutoff;
+	settings.deadZone = sqrtf(mDeadZone);
+	return settings;
+}
+// ----------------------------------------------------------------------------
+void PointerFilter::reset()
+{
+	for (int i = 0; i < SLOT_MAX_SLOTS; i++)
+	{
+		mStates[i].used = false;
+	}
+}
+// ----------------------------------------------------------------------------
+bool PointerFilter::filter(int slot, PointerEvent event, uint64_t time, Vector2& position)
+{
+	if (slot < 0 || slot >= SLOT_MAX_SLOTS)
+	{
+		return true;
+	}
+
+	FilterState& state = mStates[slot];
+	if (event == PE_DOWN || !state.used)
+	{
+		state.used = event != PE_UP;
+		state.position = position;
+		state.velocity = Vector2();
+		state.emittedPosition = position;
+		state.time = time;
+		return true;
+	}
+
+	float interval = time > state.time ? (time - state.time) * 1e-9f : 0.0f;
+	interval = std::max(interval, FILTER_MIN_INTERVAL);
+	state.time = std::max(time, state.time);
+
+	// The velocity is smoothed with a fixed cutoff, its speed raises the cutoff of the position
+	float alpha = getAlpha(mDerivativeCutoff, interval);
+	state.velocity.x += alpha * ((position.x - state.position.x) / interval - state.velocity.x);
+	state.velocity.y += alpha * ((position.y - state.position.y) / interval - state.velocity.y);
+	float speed = sqrtf(state.velocity.x * state.velocity.x + state.velocity.y * state.velocity.y);
+
+	alpha = getAlpha(mMinCutoff + mBeta * speed, interval);
+	state.position.x += alpha * (position.x - state.position.x);
+	state.position.y += alpha * (position.y - state.position.y);
+	position = state.position;
+
+	// Ends are never suppressed, and report the filtered position as well
+	if (event == PE_UPDATE)
+	{
+		float dx = position.x - state.emittedPosition.x;
+		float dy = position.y - state.emittedPosition.y;
+		if (dx * dx + dy * dy < mDeadZone)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		state.used = false;
+	}
+	state.emittedPosition = position;
+
+	return true;
+}
\ No newline at end of file
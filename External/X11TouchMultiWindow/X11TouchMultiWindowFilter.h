@@ -0,0 +1,54 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowSlots.h"
+
+/// @brief Filter state of a single touch, kept in the entry of its slot.
+struct FilterState
+{
+	bool used;
+	Vector2 position;
+	/// In pixels per second
+	Vector2 velocity;
+	/// Position of the latest sample that was not suppressed
+	Vector2 emittedPosition;
+	/// CLOCK_MONOTONIC time of the latest sample in nanoseconds
+	uint64_t time;
+};
+
+/// @brief Smooths the positions of touches with a One Euro filter, a low-pass filter whose cutoff frequency
+/// rises with the speed of the touch: at rest the jitter of the overlay is filtered out, while moving the lag
+/// stays small. Updates moving less than the dead zone from the last position reported are suppressed, so a
+/// touch held still doesn't report an update every sample.
+/// The state of a touch is indexed by its slot, so filtering a sample costs the same for any number of touches.
+class PointerFilter
+{
+private:
+	float mMinCutoff;
+	float mBeta;
+	float mDerivativeCutoff;
+	// Squared
+	float mDeadZone;
+
+	FilterState mStates[SLOT_MAX_SLOTS];
+
+public:
+	PointerFilter();
+
+	void setSettings(const FilterSettings& settings);
+	FilterSettings getSettings() const;
+	/// @brief Forgets all touches, their next samples start over at their raw positions.
+	void reset();
+
+	/// @brief Filters the position of a sample of the touch in a slot. A touch going down starts at its raw
+	/// position, and is forgotten when it goes up.
+	/// @param time CLOCK_MONOTONIC time of the sample in nanoseconds
+	/// @param position Raw position of the sample, replaced by the filtered position
+	/// @return false if the sample is an update within the dead zone, which should be dropped
+	bool filter(int slot, PointerEvent event, uint64_t time, Vector2& position);
+};
\ No newline at end of file
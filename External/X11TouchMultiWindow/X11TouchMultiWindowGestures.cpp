@@ -0,0 +1,313 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "X11TouchMultiWindowGestures.h"
+
+// Defaults, in seconds and pixels. The distances are those of the managed gestures at 96 dpi
+#define GESTURE_DEFAULT_TAP_TIME_LIMIT 0.3f
+#define GESTURE_DEFAULT_TAP_DISTANCE_LIMIT 19.0f
+#define GESTURE_DEFAULT_LONG_PRESS_TIME 1.0f
+#define GESTURE_DEFAULT_LONG_PRESS_DISTANCE_LIMIT 19.0f
+#define GESTURE_DEFAULT_FLICK_TIME 0.1f
+#define GESTURE_DEFAULT_FLICK_MOVEMENT_THRESHOLD 19.0f
+#define GESTURE_DEFAULT_FLICK_MIN_DISTANCE 38.0f
+#define GESTURE_DEFAULT_FLICK_MIN_VELOCITY 0.0f
+
+// ----------------------------------------------------------------------------
+static uint64_t toNanoseconds(float seconds)
+{
+	// Infinite, NaN and absurdly long limits are never exceeded
+	if (!(seconds < 1e6f))
+	{
+		return UINT64_MAX;
+	}
+	return (uint64_t)(std::max(seconds, 0.0f) * 1e9f);
+}
+// ----------------------------------------------------------------------------
+static float toSquared(float distance)
+{
+	distance = std::max(distance, 0.0f);
+	return distance * distance;
+}
+// ----------------------------------------------------------------------------
+static float distanceSquared(const Vector2& a, const Vector2& b)
+{
+	float dx = a.x - b.x;
+	float dy = a.y - b.y;
+	return dx * dx + dy * dy;
+}
+// ----------------------------------------------------------------------------
+GestureRecognizer::GestureRecognizer()
+	: mNumDroppedEvents(0)
+	, mLastTapType(PT_NONE)
+	, mLastTapTime(0)
+	, mTapCount(0)
+{
+	GestureSettings settings;
+	settings.mask = (1 << GT_TAP) | (1 << GT_LONG_PRESS) | (1 << GT_FLICK);
+	settings.tapTimeLimit = GESTURE_DEFAULT_TAP_TIME_LIMIT;
+	settings.tapDistanceLimit = GESTURE_DEFAULT_TAP_DISTANCE_LIMIT;
+	settings.longPressTime = GESTURE_DEFAULT_LONG_PRESS_TIME;
+	settings.longPressDistanceLimit = GESTURE_DEFAULT_LONG_PRESS_DISTANCE_LIMIT;
+	settings.flickTime = GESTURE_DEFAULT_FLICK_TIME;
+	settings.flickMovementThreshold = GESTURE_DEFAULT_FLICK_MOVEMENT_THRESHOLD;
+	settings.flickMinDistance = GESTURE_DEFAULT_FLICK_MIN_DISTANCE;
+	settings.flickMinVelocity = GESTURE_DEFAULT_FLICK_MIN_VELOCITY;
+	setSettings(settings);
+
+	mTracks.reserve(16);
+	mEvents.reserve(32);
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::setSettings(const GestureSettings& settings)
+{
+	mMask = settings.mask;
+	mTapTimeLimit = toNanoseconds(settings.tapTimeLimit);
+	mLongPressTime = toNanoseconds(settings.longPressTime);
+	mFlickTime = toNanoseconds(settings.flickTime);
+	mTapDistanceLimit = toSquared(settings.tapDistanceLimit);
+	mLongPressDistanceLimit = toSquared(settings.longPressDistanceLimit);
+	mFlickMovementThreshold = toSquared(settings.flickMovementThreshold);
+	mFlickMinDistance = toSquared(settings.flickMinDistance);
+	mFlickMinVelocity = std::max(settings.flickMinVelocity, 0.0f);
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::reset()
+{
+	mTracks.clear();
+	mEvents.clear();
+	mTapCount = 0;
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::update(PointerType type, int id, PointerEvent event, const PointerData& data,
+	uint64_t time, const Vector2& position)
+{
+	// Other mouse buttons neither start nor end a gesture
+	if (type == PT_MOUSE)
+	{
+		if (event == PE_DOWN && data.changedButtons != PBCT_FIRST_DOWN)
+		{
+			return;
+		}
+		if (event == PE_UP && data.changedButtons != PBCT_FIRST_UP)
+		{
+			return;
+		}
+	}
+
+	if (event == PE_DOWN)
+	{
+		GestureTrack* track = getTrack(type, id, true);
+		track->downTime = time;
+		track->downPosition = position;
+		track->tapPossible = (mMask & (1 << GT_TAP)) != 0;
+		track->longPressPossible = (mMask & (1 << GT_LONG_PRESS)) != 0;
+		track->moving = false;
+		track->numSamples = 0;
+		addSample(*track, time, position);
+		return;
+	}
+
+	// Updates of pointers that are not down, like a hovering mouse, are ignored
+	GestureTrack* track = getTrack(type, id, false);
+	if (track == nullptr)
+	{
+		return;
+	}
+
+	// Canceled touches didn't end where they were last seen, they complete no gesture
+	if (event == PE_UP && (data.flags & PF_CANCELED))
+	{
+		track->used = false;
+		return;
+	}
+
+	addSample(*track, time, position);
+
+	float moved = distanceSquared(position, track->downPosition);
+	if (moved > mTapDistanceLimit)
+	{
+		track->tapPossible = false;
+	}
+	if (moved > mLongPressDistanceLimit)
+	{
+		track->longPressPossible = false;
+	}
+	if (moved >= mFlickMovementThreshold)
+	{
+		track->moving = true;
+	}
+	checkLongPress(*track, time);
+
+	if (event == PE_UP)
+	{
+		recognizeTap(*track, time, position);
+		recognizeFlick(*track, time, position);
+		track->used = false;
+	}
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::updateTime(uint64_t time)
+{
+	for (std::vector<GestureTrack>::iterator it = mTracks.begin(); it != mTracks.end(); ++it)
+	{
+		if (it->used)
+		{
+			checkLongPress(*it, time);
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+Result GestureRecognizer::getEvents(GestureEventData* events, int maxEvents, int* numEvents)
+{
+	if (events == NULL || numEvents == NULL)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	int count = std::min((int)mEvents.size(), std::max(maxEvents, 0));
+	if (count > 0)
+	{
+		memcpy(events, mEvents.data(), count * sizeof(GestureEventData));
+		mEvents.erase(mEvents.begin(), mEvents.begin() + count);
+	}
+	*numEvents = count;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+GestureTrack* GestureRecognizer::getTrack(PointerType type, int id, bool create)
+{
+	GestureTrack* freeTrack = nullptr;
+	for (std::vector<GestureTrack>::iterator it = mTracks.begin(); it != mTracks.end(); ++it)
+	{
+		if (!it->used)
+		{
+			if (freeTrack == nullptr)
+			{
+				freeTrack = &(*it);
+			}
+		}
+		else if (it->type == type && it->id == id)
+		{
+			return &(*it);
+		}
+	}
+
+	if (!create)
+	{
+		return nullptr;
+	}
+
+	if (freeTrack == nullptr)
+	{
+		mTracks.push_back(GestureTrack());
+		freeTrack = &mTracks.back();
+	}
+
+	freeTrack->type = type;
+	freeTrack->id = id;
+	freeTrack->used = true;
+	freeTrack->numSamples = 0;
+	freeTrack->latest = 0;
+
+	return freeTrack;
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::addSample(GestureTrack& track, uint64_t time, const Vector2& position)
+{
+	track.latest = (track.latest + 1) % GESTURE_MAX_SAMPLES;
+	track.times[track.latest] = time;
+	track.positions[track.latest] = position;
+	track.numSamples = std::min(track.numSamples + 1, GESTURE_MAX_SAMPLES);
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::checkLongPress(GestureTrack& track, uint64_t time)
+{
+	if (!track.longPressPossible || time < track.downTime || time - track.downTime < mLongPressTime)
+	{
+		return;
+	}
+
+	track.longPressPossible = false;
+	addEvent(GT_LONG_PRESS, track, 1, track.positions[track.latest], Vector2(), time - track.downTime, time);
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::recognizeTap(GestureTrack& track, uint64_t time, const Vector2& position)
+{
+	if (!track.tapPossible || (time > track.downTime && time - track.downTime > mTapTimeLimit))
+	{
+		return;
+	}
+
+	// Pointers going down before the previous tap ended, like a two finger tap, continue it as well
+	bool continues = mTapCount > 0 && mLastTapType == track.type &&
+		(track.downTime <= mLastTapTime || track.downTime - mLastTapTime <= mTapTimeLimit) &&
+		distanceSquared(track.downPosition, mLastTapPosition) <= mTapDistanceLimit;
+	mTapCount = continues ? mTapCount + 1 : 1;
+	mLastTapType = track.type;
+	mLastTapTime = time;
+	mLastTapPosition = position;
+
+	addEvent(GT_TAP, track, mTapCount, position, Vector2(), time - std::min(time, track.downTime), time);
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::recognizeFlick(GestureTrack& track, uint64_t time, const Vector2& position)
+{
+	if ((mMask & (1 << GT_FLICK)) == 0 || !track.moving || track.numSamples < 2)
+	{
+		return;
+	}
+
+	// The movement is measured from the latest sample before the flick time, or from the oldest sample kept
+	// if the pointer was down for a shorter time
+	int reference = track.latest;
+	for (int i = 1; i < track.numSamples; i++)
+	{
+		reference = (track.latest - i + GESTURE_MAX_SAMPLES) % GESTURE_MAX_SAMPLES;
+		if (time < track.times[reference] || time - track.times[reference] >= mFlickTime)
+		{
+			break;
+		}
+	}
+
+	Vector2 vector = Vector2(position.x - track.positions[reference].x, position.y - track.positions[reference].y);
+	uint64_t duration = time > track.times[reference] ? time - track.times[reference] : 0;
+	float distance = vector.x * vector.x + vector.y * vector.y;
+	if (distance < mFlickMinDistance || duration == 0)
+	{
+		return;
+	}
+
+	if (std::sqrt(distance) < mFlickMinVelocity * (float)(duration / 1e9))
+	{
+		return;
+	}
+
+	addEvent(GT_FLICK, track, 1, position, vector, duration, time);
+}
+// ----------------------------------------------------------------------------
+void GestureRecognizer::addEvent(GestureType type, const GestureTrack& track, int count, const Vector2& position,
+	const Vector2& vector, uint64_t duration, uint64_t time)
+{
+	if (mEvents.size() >= GESTURE_MAX_EVENTS)
+	{
+		mNumDroppedEvents++;
+		return;
+	}
+
+	mEvents.push_back(GestureEventData());
+	GestureEventData& event = mEvents.back();
+	event.type = type;
+	event.id = track.id;
+	event.pointerType = track.type;
+	event.count = count;
+	event.position = position;
+	event.vector = vector;
+	event.duration = (float)(duration / 1e9);
+	event.time = time;
+}
\ No newline at end of file
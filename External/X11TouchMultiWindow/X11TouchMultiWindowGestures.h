@@ -0,0 +1,91 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "X11TouchMultiWindowCommon.h"
+
+// Samples kept per pointer to measure the movement of a flick
+#define GESTURE_MAX_SAMPLES 32
+// Recognized gestures are kept until retrieved, later ones are dropped once this many are pending
+#define GESTURE_MAX_EVENTS 256
+
+/// @brief State of a single pointer while it is down, with its recent samples in a ring buffer.
+struct GestureTrack
+{
+	PointerType type;
+	int id;
+	bool used;
+	uint64_t downTime;
+	Vector2 downPosition;
+	bool tapPossible;
+	bool longPressPossible;
+	bool moving;
+	int numSamples;
+	/// Index of the latest sample
+	int latest;
+	/// CLOCK_MONOTONIC times in nanoseconds
+	uint64_t times[GESTURE_MAX_SAMPLES];
+	Vector2 positions[GESTURE_MAX_SAMPLES];
+};
+
+/// @brief Runs the state machines of taps, long presses and flicks over the pointer stream of a handler, so
+/// the managed gestures can adopt the results instead of tracking every pointer update themselves. Every
+/// pointer is recognized on its own, gestures combining several pointers are left to the managed side. A
+/// mouse pointer is down while its first button is.
+class GestureRecognizer
+{
+private:
+	int mMask;
+	// Times in nanoseconds, UINT64_MAX for infinite limits
+	uint64_t mTapTimeLimit;
+	uint64_t mLongPressTime;
+	uint64_t mFlickTime;
+	// Squared distances
+	float mTapDistanceLimit;
+	float mLongPressDistanceLimit;
+	float mFlickMovementThreshold;
+	float mFlickMinDistance;
+	float mFlickMinVelocity;
+
+	std::vector<GestureTrack> mTracks;
+	std::vector<GestureEventData> mEvents;
+	unsigned long long mNumDroppedEvents;
+
+	// The last tap, the next one continues a multi tap if it is close enough in time and distance
+	PointerType mLastTapType;
+	uint64_t mLastTapTime;
+	Vector2 mLastTapPosition;
+	int mTapCount;
+
+public:
+	GestureRecognizer();
+
+	void setSettings(const GestureSettings& settings);
+	void reset();
+
+	/// @param time CLOCK_MONOTONIC time of the event in nanoseconds
+	/// @param position Screen position of the pointer
+	void update(PointerType type, int id, PointerEvent event, const PointerData& data, uint64_t time,
+		const Vector2& position);
+	/// @brief Recognizes the long presses of pointers that are held without reporting updates.
+	/// @param time CLOCK_MONOTONIC time in nanoseconds
+	void updateTime(uint64_t time);
+
+	int getNumEvents() const { return mEvents.size(); }
+	unsigned long long getNumDroppedEvents() const { return mNumDroppedEvents; }
+	/// @brief Copies the oldest recognized gestures and removes them.
+	Result getEvents(GestureEventData* events, int maxEvents, int* numEvents);
+
+private:
+	GestureTrack* getTrack(PointerType type, int id, bool create);
+	void addSample(GestureTrack& track, uint64_t time, const Vector2& position);
+	void checkLongPress(GestureTrack& track, uint64_t time);
+	void recognizeTap(GestureTrack& track, uint64_t time, const Vector2& position);
+	void recognizeFlick(GestureTrack& track, uint64_t time, const Vector2& position);
+	void addEvent(GestureType type, const GestureTrack& track, int count, const Vector2& position,
+		const Vector2& vector, uint64_t duration, uint64_t time);
+};
\ No newline at end of file
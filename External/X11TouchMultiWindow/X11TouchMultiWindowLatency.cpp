@@ -0,0 +1,202 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <cstring>
+
+#include "X11TouchMultiWindowLatency.h"
+
+#define NANOSECONDS_PER_MILLISECOND 1000000LL
+// Length of a window of the minimum filter
+#define CLOCK_WINDOW 1000000000ULL
+// Weight of a new drift measurement
+#define CLOCK_DRIFT_WEIGHT 0.1
+// Drift measurements beyond 1000 ppm are jumps of the clock rather than drift
+#define CLOCK_MAX_DRIFT 0.001
+
+// ----------------------------------------------------------------------------
+static int getBucketIndex(uint64_t value)
+{
+	const uint64_t maxValue = (1ULL << LATENCY_MAX_VALUE_BITS) - 1;
+	if (value > maxValue)
+	{
+		value = maxValue;
+	}
+
+	int shift = (63 - __builtin_clzll(value | 1)) - LATENCY_SUB_BUCKET_BITS;
+	if (shift < 0)
+	{
+		shift = 0;
+	}
+
+	return (shift << LATENCY_SUB_BUCKET_BITS) + (int)(value >> shift);
+}
+// ----------------------------------------------------------------------------
+static uint64_t getHighestEquivalentValue(int index)
+{
+	int shift = (index >> LATENCY_SUB_BUCKET_BITS) - 1;
+	if (shift <= 0)
+	{
+		return index;
+	}
+
+	uint64_t lowest = (uint64_t)(index - (shift << LATENCY_SUB_BUCKET_BITS)) << shift;
+	return lowest + (1ULL << shift) - 1;
+}
+// ----------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+// ----------------------------------------------------------------------------
+void LatencyHistogram::record(uint64_t value)
+{
+	mCounts[getBucketIndex(value)]++;
+	mNumValues++;
+	if (value > mMaxValue)
+	{
+		mMaxValue = value;
+	}
+}
+// ----------------------------------------------------------------------------
+void LatencyHistogram::reset()
+{
+	memset(mCounts, 0, sizeof(mCounts));
+	mNumValues = 0;
+	mMaxValue = 0;
+}
+// ----------------------------------------------------------------------------
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const
+{
+	if (mNumValues == 0)
+	{
+		return 0;
+	}
+
+	uint64_t target = (uint64_t)((percentile / 100.0) * (double)mNumValues + 0.5);
+	if (target < 1)
+	{
+		target = 1;
+	}
+
+	uint64_t count = 0;
+	for (int i = 0; i < LATENCY_NUM_BUCKETS; i++)
+	{
+		count += mCounts[i];
+		if (count >= target)
+		{
+			uint64_t value = getHighestEquivalentValue(i);
+			return value < mMaxValue ? value : mMaxValue;
+		}
+	}
+
+	return mMaxValue;
+}
+// ----------------------------------------------------------------------------
+ServerClock::ServerClock()
+	: mLastServerTime(0)
+	, mServerTimeHigh(0)
+	, mValid(false)
+	, mBaseOffset(0)
+	, mBaseTime(0)
+	, mDrift(0.0)
+	, mWindowOffset(0)
+	, mWindowTime(0)
+	, mWindowStart(0)
+	, mPreviousWindowOffset(0)
+	, mPreviousWindowTime(0)
+{
+
+}
+// ----------------------------------------------------------------------------
+uint64_t ServerClock::unwrap(Time serverTime)
+{
+	uint32_t time = (uint32_t)serverTime;
+	// Events are not strictly ordered across devices, only a large step back is a wrap around
+	if (time < mLastServerTime && mLastServerTime - time > 0x80000000u)
+	{
+		mServerTimeHigh += 1ULL << 32;
+	}
+	mLastServerTime = time;
+
+	return mServerTimeHigh | time;
+}
+// ----------------------------------------------------------------------------
+void ServerClock::update(Time serverTime, uint64_t receiveTime)
+{
+	// Synthesized events may not carry a timestamp
+	if (serverTime == CurrentTime || receiveTime == 0)
+	{
+		return;
+	}
+
+	int64_t offset = (int64_t)receiveTime - (int64_t)(unwrap(serverTime) * NANOSECONDS_PER_MILLISECOND);
+
+	if (!mValid)
+	{
+		mValid = true;
+		mBaseOffset = mWindowOffset = offset;
+		mBaseTime = mWindowTime = mWindowStart = receiveTime;
+		return;
+	}
+
+	// A sample below the estimate has less delay than the estimate assumed
+	if (offset < getOffset(receiveTime))
+	{
+		mBaseOffset = offset;
+		mBaseTime = receiveTime;
+	}
+
+	if (offset < mWindowOffset)
+	{
+		mWindowOffset = offset;
+		mWindowTime = receiveTime;
+	}
+
+	if (receiveTime - mWindowStart < CLOCK_WINDOW)
+	{
+		return;
+	}
+
+	// Close the window, the estimate restarts from its minimum so it can follow the clock upwards too
+	if (mPreviousWindowTime != 0 && mWindowTime > mPreviousWindowTime)
+	{
+		double drift = (double)(mWindowOffset - mPreviousWindowOffset) / (double)(mWindowTime - mPreviousWindowTime);
+		if (drift > -CLOCK_MAX_DRIFT && drift < CLOCK_MAX_DRIFT)
+		{
+			mDrift += CLOCK_DRIFT_WEIGHT * (drift - mDrift);
+		}
+	}
+
+	mBaseOffset = mWindowOffset;
+	mBaseTime = mWindowTime;
+
+	mPreviousWindowOffset = mWindowOffset;
+	mPreviousWindowTime = mWindowTime;
+	mWindowOffset = offset;
+	mWindowTime = receiveTime;
+	mWindowStart = receiveTime;
+}
+// ----------------------------------------------------------------------------
+int64_t ServerClock::getOffset(uint64_t time) const
+{
+	return mBaseOffset + (int64_t)(mDrift * (double)(int64_t)(time - mBaseTime));
+}
+// ----------------------------------------------------------------------------
+uint64_t ServerClock::toMonotonicTime(Time serverTime, uint64_t receiveTime) const
+{
+	if (!mValid || serverTime == CurrentTime)
+	{
+		return 0;
+	}
+
+	// Expand relative to the last update, which happened for this event or one close to it
+	uint32_t time = (uint32_t)serverTime;
+	uint64_t high = mServerTimeHigh;
+	if (time > mLastServerTime && time - mLastServerTime > 0x80000000u && high > 0)
+	{
+		high -= 1ULL << 32;
+	}
+
+	int64_t monotonicTime = (int64_t)((high | time) * NANOSECONDS_PER_MILLISECOND) + getOffset(receiveTime);
+	return monotonicTime > 0 ? (uint64_t)monotonicTime : 0;
+}
\ No newline at end of file
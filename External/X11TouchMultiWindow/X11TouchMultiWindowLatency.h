@@ -0,0 +1,78 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+
+// Each power of two range is divided in 2^LATENCY_SUB_BUCKET_BITS buckets, which bounds the relative
+// error of a recorded value to about 3%
+#define LATENCY_SUB_BUCKET_BITS 5
+// Values are recorded in microseconds, larger values are clamped to about 19 hours
+#define LATENCY_MAX_VALUE_BITS 36
+#define LATENCY_NUM_BUCKETS (((LATENCY_MAX_VALUE_BITS - LATENCY_SUB_BUCKET_BITS) + 1) << LATENCY_SUB_BUCKET_BITS)
+
+/// @brief A log-linear histogram of latencies in the style of HdrHistogram, recording is constant time and
+/// the memory used is fixed.
+class LatencyHistogram
+{
+private:
+	uint32_t mCounts[LATENCY_NUM_BUCKETS];
+	uint64_t mNumValues;
+	uint64_t mMaxValue;
+
+public:
+	LatencyHistogram();
+
+	void record(uint64_t value);
+	void reset();
+
+	uint64_t getNumValues() const { return mNumValues; }
+	uint64_t getMaxValue() const { return mMaxValue; }
+	/// @brief Returns the highest value equivalent to the value at the percentile, 0 if nothing was recorded.
+	/// @param percentile In the range [0, 100]
+	uint64_t getValueAtPercentile(double percentile) const;
+};
+
+/// @brief Estimates the CLOCK_MONOTONIC time of X server timestamps. The offset between both clocks
+/// is the minimum of the receive time minus the server time per window, as every sample only adds
+/// transport delay. The drift is the slope between consecutive window minima.
+class ServerClock
+{
+private:
+	// Server times are 32 bit milliseconds, which wrap around after about 49.7 days
+	uint32_t mLastServerTime;
+	uint64_t mServerTimeHigh;
+
+	bool mValid;
+	// Estimated offset at mBaseTime, in nanoseconds
+	int64_t mBaseOffset;
+	uint64_t mBaseTime;
+	// Drift of the server clock in nanoseconds per nanosecond
+	double mDrift;
+
+	int64_t mWindowOffset;
+	uint64_t mWindowTime;
+	uint64_t mWindowStart;
+	int64_t mPreviousWindowOffset;
+	uint64_t mPreviousWindowTime;
+
+public:
+	ServerClock();
+
+	/// @brief Adds a sample of an event read at receiveTime.
+	void update(Time serverTime, uint64_t receiveTime);
+
+	bool isValid() const { return mValid; }
+	double getDrift() const { return mDrift; }
+	/// @brief Returns the estimated offset of the server clock at the monotonic time.
+	int64_t getOffset(uint64_t time) const;
+	/// @brief Converts a server timestamp to CLOCK_MONOTONIC nanoseconds, 0 while no estimate is available.
+	uint64_t toMonotonicTime(Time serverTime, uint64_t receiveTime) const;
+
+private:
+	uint64_t unwrap(Time serverTime);
+};
\ No newline at end of file
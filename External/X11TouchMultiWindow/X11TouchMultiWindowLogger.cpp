@@ -0,0 +1,100 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include "X11TouchMultiWindowLogger.h"
+
+// ----------------------------------------------------------------------------
+Logger::Logger(MessageCallback messageCallback, MessageType minMessageType)
+	: mMessageCallback(messageCallback)
+	, mMinMessageType(minMessageType)
+	, mHead(0)
+	, mNumMessages(0)
+	, mBatchDepth(0)
+	, mDrainThread(std::this_thread::get_id())
+{
+
+}
+// ----------------------------------------------------------------------------
+Logger::~Logger()
+{
+	flush();
+}
+// ----------------------------------------------------------------------------
+void Logger::log(MessageType type, const char* format, ...)
+{
+	bool shouldFlush;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (mNumMessages == MAX_QUEUED_MESSAGES)
+		{
+			// Another thread filled the ring before it was flushed, drop the oldest message
+			mHead = (mHead + 1) % MAX_QUEUED_MESSAGES;
+			mNumMessages--;
+		}
+
+		Message& message = mMessages[(mHead + mNumMessages) % MAX_QUEUED_MESSAGES];
+		message.type = type;
+
+		va_list args;
+		va_start(args, format);
+		vsnprintf(message.text, MAX_MESSAGE_LENGTH, format, args);
+		va_end(args);
+
+		mNumMessages++;
+		shouldFlush = std::this_thread::get_id() == mDrainThread &&
+			(mBatchDepth == 0 || mNumMessages == MAX_QUEUED_MESSAGES);
+	}
+
+	if (shouldFlush)
+	{
+		flush();
+	}
+}
+// ----------------------------------------------------------------------------
+void Logger::beginBatch()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mBatchDepth++;
+	mDrainThread = std::this_thread::get_id();
+}
+// ----------------------------------------------------------------------------
+void Logger::endBatch()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mBatchDepth--;
+	}
+
+	flush();
+}
+// ----------------------------------------------------------------------------
+void Logger::flush()
+{
+	// The callback may end up logging itself, so it is invoked without holding the lock
+	Message message;
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mNumMessages == 0)
+			{
+				break;
+			}
+
+			message.type = mMessages[mHead].type;
+			memcpy(message.text, mMessages[mHead].text, MAX_MESSAGE_LENGTH);
+			mHead = (mHead + 1) % MAX_QUEUED_MESSAGES;
+			mNumMessages--;
+		}
+
+		if (mMessageCallback)
+		{
+			mMessageCallback((int)message.type, message.text);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <mutex>
+#include <thread>
+
+#include "X11TouchMultiWindowCommon.h"
+
+#define MAX_MESSAGE_LENGTH 256
+#define MAX_QUEUED_MESSAGES 64
+
+// Messages below the minimum type of the logger are rejected before their arguments are formatted
+#define LOG_MESSAGE(logger, type, ...) do { \
+			if ((logger)->isEnabled(type)) (logger)->log(type, __VA_ARGS__); \
+		} while (0)
+
+// Compiling with X11TOUCH_NO_DEBUG_LOG removes all debug messages, including the evaluation of their arguments
+#ifdef X11TOUCH_NO_DEBUG_LOG
+#define LOG_DEBUG(logger, ...) do { } while (0)
+#else
+#define LOG_DEBUG(logger, ...) LOG_MESSAGE(logger, MT_DEBUG, __VA_ARGS__)
+#endif
+#define LOG_INFO(logger, ...) LOG_MESSAGE(logger, MT_INFO, __VA_ARGS__)
+#define LOG_WARNING(logger, ...) LOG_MESSAGE(logger, MT_WARNING, __VA_ARGS__)
+#define LOG_ERROR(logger, ...) LOG_MESSAGE(logger, MT_ERROR, __VA_ARGS__)
+
+/// @brief Formats messages into a preallocated ring of fixed size slots and dispatches them to the
+/// message callback passed from Unity. Within a batch messages are only dispatched when the batch ends
+/// or the ring is full, so no allocations or managed transitions are made per message.
+/// The callback is only invoked on the thread that drains the events, which Unity knows. Messages of other
+/// threads, like the reader thread, wait in the ring until the next batch ends.
+class Logger
+{
+private:
+	struct Message
+	{
+		MessageType type;
+		char text[MAX_MESSAGE_LENGTH];
+	};
+
+	MessageCallback mMessageCallback;
+	MessageType mMinMessageType;
+
+	std::mutex mMutex;
+	Message mMessages[MAX_QUEUED_MESSAGES];
+	int mHead;
+	int mNumMessages;
+	int mBatchDepth;
+	// The thread that created the logger until a batch begins, then the thread of the latest batch
+	std::thread::id mDrainThread;
+
+public:
+	Logger(MessageCallback messageCallback, MessageType minMessageType);
+	~Logger();
+
+	bool isEnabled(MessageType type) const { return mMessageCallback != nullptr && type >= mMinMessageType; }
+	MessageType getMinMessageType() const { return mMinMessageType; }
+
+	void log(MessageType type, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+	/// @brief Defers the dispatching of messages until the matching endBatch.
+	void beginBatch();
+	void endBatch();
+
+	/// @brief Dispatches the queued messages, on the draining thread only.
+	void flush();
+};
\ No newline at end of file
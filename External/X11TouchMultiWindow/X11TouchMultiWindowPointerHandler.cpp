@@ -1,27 +1,39 @@
 /*
 @author Jorrit de Vries (jorrit@ijsfontein.nl)
 */
+#include <algorithm>
 #include <cstring>
 
 #include "X11TouchMultiWindowPointerHandler.h"
+#include "X11TouchMultiWindowLogger.h"
 #include "X11TouchMultiWindowUtils.h"
 
 // ----------------------------------------------------------------------------
 PointerHandler::PointerHandler(Display* display, int targetDisplay, Window window,
-	MessageCallback messageCallback, PointerCallback pointerCallback)
+	Logger* logger, PointerCallback pointerCallback)
 	: mDisplay(display)
 	, mTargetDisplay(targetDisplay)
 	, mWindow(window)
-	, mMessageCallback(messageCallback)
+	, mLogger(logger)
 	, mPointerCallback(pointerCallback)
 	, mWidth(0)
-	, mHeight(0)
-	, mOffsetX(0.0f)
-	, mOffsetY(0.0f)
-	, mScaleX(1.0f)
-	, mScaleY(1.0f)
+	, mNumReadEvents(0)
+	, mNumDroppedEvents(0)
+	, mNumTransformedEvents(0)
+	, mCoalesce(false)
+	, mKeepHistory(false)
+	, mNumCoalescedEvents(0)
+	, mFilter(false)
+	, mNumSuppressedUpdates(0)
+	, mPredict(false)
+	, mResample(false)
+	, mRecognizeGestures(false)
+	, mSlotTimeout((uint64_t)(SLOT_DEFAULT_TIMEOUT * 1e9))
+	, mNumCanceledTouches(0)
+	, mDraining(false)
 {
-
+	mEvents.reserve(256);
+	mPointers.reserve(16);
 }
 // ----------------------------------------------------------------------------
 PointerHandler::~PointerHandler()
@@ -29,65 +41,23 @@ PointerHandler::~PointerHandler()
 
 }
 // ----------------------------------------------------------------------------
-Result PointerHandler::initialize(std::vector<int> deviceIds)
+Result PointerHandler::initialize()
 {
-	sendMessage(mMessageCallback, MT_INFO, "Initializing handler for display " + 
-		std::to_string(mTargetDisplay) + " with window " + std::to_string(mWindow) + "...");
+	LOG_INFO(mLogger, "Initializing handler for display %d with window %lu...", mTargetDisplay, mWindow);
 
 	if (mDisplay == NULL)
 	{
-		sendMessage(mMessageCallback, MT_ERROR, "'display' is NULL");
+		LOG_ERROR(mLogger, "'display' is NULL");
 		return R_ERROR_NULL_POINTER;
 	}
 
 	if (mWindow == None)
 	{
-		sendMessage(mMessageCallback, MT_ERROR, "'window' is None");
+		LOG_ERROR(mLogger, "'window' is None");
 		return R_ERROR_NULL_POINTER;
 	}
 
-	// Setup the event mask fore the events we want to listen to
-	unsigned char mask[XIMaskLen(XI_LASTEVENT)];
-	memset(mask, 0, sizeof(mask));
-	// Mouse buttons
-	XISetMask(mask, XI_ButtonPress);
-	XISetMask(mask, XI_ButtonRelease);
-	// Mouse motion
-	XISetMask(mask, XI_Motion);
-	// Touch
-	XISetMask(mask, XI_TouchBegin);
-	XISetMask(mask, XI_TouchUpdate);
-	XISetMask(mask, XI_TouchEnd);
-
-	Status status = Success;
-	for (std::vector<int>::const_iterator it = deviceIds.begin(); it != deviceIds.end(); ++it)
-	{
-		XIEventMask eventMask = {
-			.deviceid = *it,
-			.mask_len = sizeof(mask),
-			.mask = mask
-		};
-
-		Status s = XISelectEvents(mDisplay, mWindow, &eventMask, 1);
-		if (s != Success)
-		{
-			sendMessage(mMessageCallback, MT_ERROR, "Failed to select events for display " +
-				std::to_string(mTargetDisplay) + ": " + std::to_string(status));
-			status = s;
-		}
-	}
-
-	if (status != Success)
-	{
-		sendMessage(mMessageCallback, MT_ERROR, "Failed to select events for display " +
-			std::to_string(mTargetDisplay) + ": " + std::to_string(status));
-		return R_ERROR_UNSUPPORTED;
-	}
-
-	// Propagate requests to X server
-	XFlush(mDisplay);
-
-	sendMessage(mMessageCallback, MT_INFO, "Handler for display " + std::to_string(mTargetDisplay) + " initialized");
+	LOG_INFO(mLogger, "Handler for display %d initialized", mTargetDisplay);
 
 	return R_OK;
 }
@@ -95,8 +65,7 @@ Result PointerHandler::initialize(std::vector<int> deviceIds)
 Result PointerHandler::getScreenParams(int*x, int*y, int* width, int* height,
 	int* screenWidth, int* screenHeight)
 {
-	sendMessage(mMessageCallback, MT_INFO, "Requesting screen resolution of window " +
-		std::to_string(mWindow));
+	LOG_INFO(mLogger, "Requesting screen resolution of window %lu", mWindow);
 
 	// Get the screen for the window
 	XWindowAttributes attributes;
@@ -110,7 +79,7 @@ Result PointerHandler::getScreenParams(int*x, int*y, int* width, int* height,
 	}
 	else
 	{
-		sendMessage(mMessageCallback, MT_ERROR, "Failed to retrieve XWindowAttributes");
+		LOG_ERROR(mLogger, "Failed to retrieve XWindowAttributes");
 		return R_ERROR_API;
 	}
 }
@@ -119,29 +88,66 @@ Result PointerHandler::setScreenParams(int width, int height, float offsetX, flo
 	float scaleX, float scaleY)
 {
 	mWidth = width;
-	mHeight = height;
-	mOffsetX = offsetX;
-	mOffsetY = offsetY;
-	mScaleX = scaleX;
-	mScaleY = scaleY;
+	mTransform = ScreenTransform(height, offsetX, offsetY, scaleX, scaleY);
 
 	return R_OK;
 }
 // ----------------------------------------------------------------------------
-void PointerHandler::processEvent(XIDeviceEvent* xiEvent)
+void PointerHandler::beginEvents()
+{
+	mDraining = true;
+
+	// Retrieving the events in batches only advances the read index, the retrieved events are removed here
+	// once they make up half of the buffer
+	if (mNumReadEvents > 0 && mNumReadEvents * 2 >= mEvents.size())
+	{
+		mEvents.erase(mEvents.begin(), mEvents.begin() + mNumReadEvents);
+		mNumTransformedEvents -= std::min(mNumTransformedEvents, mNumReadEvents);
+		mNumReadEvents = 0;
+	}
+
+	for (std::vector<PointerState>::iterator it = mPointers.begin(); it != mPointers.end(); ++it)
+	{
+		if (it->ended)
+		{
+			it->used = false;
+			it->ended = false;
+		}
+		it->pendingUpdate = -1;
+		it->numHistory = 0;
+	}
+
+	if (mResample)
+	{
+		mResampler.beginEvents();
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::processEvent(const DeviceEvent& event)
 {
 	int pointerId = 0;
 	PointerType pointerType;
 	PointerEvent pointerEvent;
-	PointerData pointerData;
+	PointerData pointerData = {};
 
-	sendMessage(mMessageCallback, MT_DEBUG, "Processing input for display " + std::to_string(mTargetDisplay));
+	LOG_DEBUG(mLogger, "Processing input for display %d", mTargetDisplay);
 
-	switch (xiEvent->evtype)
+	// Latencies are recorded in microseconds, canceled touches are ended by the handler itself
+	bool canceled = (event.flags & DEVICE_EVENT_CANCELED) != 0;
+	if (event.dispatchTime >= event.receiveTime && !canceled)
+	{
+		mQueueLatency.record((event.dispatchTime - event.receiveTime) / 1000);
+	}
+	if (event.serverTime != 0 && !canceled)
+	{
+		mEventLatency.record(event.dispatchTime > event.serverTime ? (event.dispatchTime - event.serverTime) / 1000 : 0);
+	}
+
+	switch (event.type)
 	{
 		case XI_ButtonPress:
 			{
-				int button = xiEvent->detail;
+				int button = event.detail;
 				if (button < 1 || button > 5)
 				{
 					return;
@@ -156,7 +162,7 @@ void PointerHandler::processEvent(XIDeviceEvent* xiEvent)
 			break;
 		case XI_ButtonRelease:
 			{
-				int button = xiEvent->detail;
+				int button = event.detail;
 				if (button < 1 || button > 5)
 				{
 					return;
@@ -178,32 +184,586 @@ void PointerHandler::processEvent(XIDeviceEvent* xiEvent)
 			break;
 		case XI_TouchBegin:
 			{
-				pointerId = xiEvent->detail;
+				pointerId = event.detail;
 				pointerType = PT_TOUCH;
 				pointerEvent = PE_DOWN;
 			}
 			break;
 		case XI_TouchUpdate:
 			{
-				pointerId = xiEvent->detail;
+				pointerId = event.detail;
 				pointerType = PT_TOUCH;
 				pointerEvent = PE_UPDATE;
 			}
 			break;
 		case XI_TouchEnd:
 			{
-				pointerId = xiEvent->detail;
+				pointerId = event.detail;
 				pointerType = PT_TOUCH;
 				pointerEvent = PE_UP;
+
+				if (canceled)
+				{
+					pointerData.flags = PF_CANCELED;
+				}
 			}
 			break;
 		default:
 			return;
 	}
  
-	Vector2 position = Vector2(
-		((float)xiEvent->event_x - mOffsetX) * mScaleX,
-		mHeight - ((float)xiEvent->event_y - mOffsetY) * mScaleY);
+	if (event.axesMask != 0)
+	{
+		int mask = TM_NONE;
+		if (event.axesMask & (1 << DA_PRESSURE))
+		{
+			mask |= TM_PRESSURE;
+			pointerData.pressure = event.axes[DA_PRESSURE];
+		}
+		if (event.axesMask & (1 << DA_ORIENTATION))
+		{
+			mask |= TM_ORIENTATION;
+			pointerData.orientation = event.axes[DA_ORIENTATION];
+		}
+		if (event.axesMask & (1 << DA_TOUCH_MAJOR))
+		{
+			mask |= TM_CONTACT_AREA;
+			pointerData.touchMajor = event.axes[DA_TOUCH_MAJOR];
+			// Devices without a minor axis report circular contacts
+			pointerData.touchMinor = (event.axesMask & (1 << DA_TOUCH_MINOR)) ?
+				event.axes[DA_TOUCH_MINOR] : pointerData.touchMajor;
+		}
+		pointerData.mask = (TouchMask)mask;
+	}
+
+	// Prediction and resampling are affine, so they work in window coordinates as well
+	Vector2 position = Vector2((float)event.x, (float)event.y);
+
+	pointerData.slot = -1;
+	if (pointerType == PT_TOUCH)
+	{
+		if (pointerEvent == PE_DOWN)
+		{
+			pointerData.slot = mSlots.acquire(pointerId, event.deviceId, event.sourceId, event.dispatchTime,
+				event.time, position);
+			if (pointerData.slot < 0)
+			{
+				LOG_WARNING(mLogger, "All %d slots are taken, dropping touch %d", SLOT_MAX_SLOTS, pointerId);
+				return;
+			}
+		}
+		else
+		{
+			// Touches that began before the handler was created or were canceled are dropped
+			pointerData.slot = mSlots.find(pointerId);
+			if (pointerData.slot < 0)
+			{
+				LOG_DEBUG(mLogger, "Dropping event of touch %d without a slot", pointerId);
+				return;
+			}
+			mSlots.update(pointerData.slot, event.dispatchTime, event.time, position);
+		}
+
+		// The slot can be taken by a touch beginning later in the same cycle, the managed side processes the
+		// events in order
+		if (pointerEvent == PE_UP)
+		{
+			mSlots.release(pointerData.slot);
+		}
+	}
+
+	// Resampling needs the time in the frame clock, which the server time is only converted to once the
+	// clock offset is known
+	uint64_t sampleTime = event.serverTime != 0 ? event.serverTime : event.receiveTime;
+
+	// Filtered before any other stage, so jitter within the dead zone doesn't reach them either
+	if (mFilter && pointerType == PT_TOUCH &&
+		!mFilterStage.filter(pointerData.slot, pointerEvent, sampleTime, position))
+	{
+		mNumSuppressedUpdates++;
+		return;
+	}
+
+	mActivePointers.update(pointerType, pointerId, pointerData.slot, pointerEvent, pointerData, event.dispatchTime,
+		position);
+
+	if (mPredict)
+	{
+		mPredictor.update(pointerType, pointerId, pointerEvent, event.time, position, &pointerData);
+	}
+
+	if (mRecognizeGestures)
+	{
+		// Gesture thresholds are in screen pixels
+		mGestures.update(pointerType, pointerId, pointerEvent, pointerData, sampleTime, mTransform.apply(position));
+	}
+
+	// Regions are in screen space as well. Down events are never merged, so the tag always reaches the caller.
+	if (pointerEvent == PE_DOWN && !mRegions.isEmpty())
+	{
+		pointerData.region = mRegions.hitTest(mTransform.apply(position));
+	}
+
+	// Nobody retrieves the events of a buffered handler of a hidden window. Beyond the limit updates are merged
+	// into the latest update of their pointer, downs and ups are always kept so the pointers stay consistent.
+	if (pointerEvent == PE_UPDATE && isBuffered() && mEvents.size() - mNumReadEvents >= MAX_BUFFERED_EVENTS)
+	{
+		int latest = (int)mEvents.size() - 1;
+		while (latest >= (int)mNumReadEvents &&
+			(mEvents[latest].id != pointerId || mEvents[latest].type != pointerType))
+		{
+			latest--;
+		}
+
+		// An update right after a down is still added, a pointer never adds more than one event that way
+		if (latest >= (int)mNumReadEvents && mEvents[latest].event == PE_UPDATE)
+		{
+			PointerEventData& latestData = mEvents[latest];
+			latestData.position = position;
+			latestData.data = pointerData;
+			// Events of previous drain cycles are already transformed to the screen
+			if (latest < (int)mNumTransformedEvents)
+			{
+				transformEvent(latestData);
+			}
+			if (mNumDroppedEvents++ == 0)
+			{
+				LOG_WARNING(mLogger, "Events of window %lu are not retrieved, merging their updates", mWindow);
+			}
+
+			if (mResample)
+			{
+				mResampler.addSample(pointerType, pointerId, pointerEvent, sampleTime, position, latest);
+			}
+			return;
+		}
+	}
+
+	if (mCoalesce)
+	{
+		PointerState* state = getPointerState(pointerType, pointerId, true);
+		if (pointerEvent == PE_UPDATE && state->pendingUpdate >= (int)mNumReadEvents)
+		{
+			PointerEventData& pendingData = mEvents[state->pendingUpdate];
+			if (mKeepHistory)
+			{
+				if (state->numHistory == MAX_POINTER_HISTORY)
+				{
+					// Keep the most recent samples
+					memmove(state->history, state->history + 1, (MAX_POINTER_HISTORY - 1) * sizeof(Vector2));
+					state->numHistory--;
+				}
+				state->history[state->numHistory++] = pendingData.position;
+			}
+
+			pendingData.position = position;
+			pendingData.data = pointerData;
+			mNumCoalescedEvents++;
+
+			if (mResample)
+			{
+				mResampler.addSample(pointerType, pointerId, pointerEvent, sampleTime, position,
+					state->pendingUpdate);
+			}
+			return;
+		}
+
+		// Down and up events are never merged, and updates are not merged across them
+		state->pendingUpdate = pointerEvent == PE_UPDATE ? (int)mEvents.size() : -1;
+		if (pointerEvent == PE_UP && pointerType == PT_TOUCH)
+		{
+			state->ended = true;
+		}
+		else if (pointerEvent == PE_DOWN)
+		{
+			state->ended = false;
+		}
+	}
+
+	mEvents.push_back(PointerEventData());
+	PointerEventData& eventData = mEvents.back();
+	eventData.id = pointerId;
+	eventData.event = pointerEvent;
+	eventData.type = pointerType;
+	eventData.position = position;
+	eventData.data = pointerData;
+
+	if (mResample)
+	{
+		mResampler.addSample(pointerType, pointerId, pointerEvent, sampleTime, position,
+			pointerEvent == PE_UPDATE ? (int)mEvents.size() - 1 : -1);
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::flushEvents(uint64_t frameTime)
+{
+	mDraining = false;
+
+	if (mSlotTimeout != 0 && mSlots.getNumUsed() > 0)
+	{
+		uint64_t time = getMonotonicTime();
+		for (int slot = 0; slot < mSlots.getEnd(); slot++)
+		{
+			const PointerSlot& entry = mSlots.getSlot(slot);
+			if (entry.used && time > entry.time && time - entry.time > mSlotTimeout)
+			{
+				LOG_WARNING(mLogger, "Touch %d has had no events for %.1f s, canceling it", entry.id,
+					(time - entry.time) / 1e9);
+				cancelTouch(slot, time);
+			}
+		}
+	}
+
+	if (mResample && frameTime != 0)
+	{
+		mResampler.resample(frameTime, mEvents);
+	}
+	transformEvents();
+
+	if (mRecognizeGestures)
+	{
+		mGestures.updateTime(frameTime != 0 ? frameTime : getMonotonicTime());
+	}
+
+	// Buffered handlers keep their events until the caller retrieves them
+	if (isBuffered())
+	{
+		return;
+	}
+
+	for (std::vector<PointerEventData>::const_iterator it = mEvents.begin(); it != mEvents.end(); ++it)
+	{
+		mPointerCallback(it->id, it->event, it->type, it->position, it->data);
+	}
+	mEvents.clear();
+	mNumTransformedEvents = 0;
+	resetPendingUpdates();
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::getPointerEvents(PointerEventData* events, int maxEvents, int* numEvents)
+{
+	if (events == NULL || numEvents == NULL)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	int count = std::min(getNumPointerEvents(), std::max(maxEvents, 0));
+	if (count > 0)
+	{
+		memcpy(events, mEvents.data() + mNumReadEvents, count * sizeof(PointerEventData));
+		mNumReadEvents += count;
+		if (mNumReadEvents == mEvents.size())
+		{
+			mEvents.clear();
+			mNumReadEvents = 0;
+			mNumTransformedEvents = 0;
+		}
+
+		// Delivered events can no longer be merged into
+		resetPendingUpdates();
+	}
+	*numEvents = count;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::setCoalescing(bool coalesce, bool keepHistory)
+{
+	mCoalesce = coalesce;
+	mKeepHistory = coalesce && keepHistory;
+
+	if (!mCoalesce)
+	{
+		mPointers.clear();
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::getPointerHistory(PointerType type, int id, Vector2* samples, int maxSamples,
+	int* numSamples)
+{
+	if (samples == NULL || numSamples == NULL)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	*numSamples = 0;
+
+	PointerState* state = getPointerState(type, id, false);
+	if (state != nullptr)
+	{
+		int count = std::min(state->numHistory, std::max(maxSamples, 0));
+		const Vector2* history = state->history + state->numHistory - count;
+		for (int i = 0; i < count; i++)
+		{
+			samples[i] = mTransform.apply(history[i]);
+		}
+		*numSamples = count;
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::setFiltering(bool filter, const FilterSettings* settings)
+{
+	if (settings != NULL)
+	{
+		mFilterStage.setSettings(*settings);
+	}
+
+	// Touches down while filtering was off start over at their next sample
+	if (filter && !mFilter)
+	{
+		mFilterStage.reset();
+	}
+	mFilter = filter;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::setPrediction(bool predict, float horizon)
+{
+	mPredict = predict;
+	mPredictor.setHorizon(horizon);
+
+	if (!mPredict)
+	{
+		mPredictor.reset();
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::setResampling(bool resample, float maxExtrapolation)
+{
+	mResample = resample;
+	mResampler.setMaxExtrapolation(maxExtrapolation);
+
+	if (!mResample)
+	{
+		mResampler.reset();
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::setGestureRecognition(bool recognize, const GestureSettings* settings)
+{
+	mRecognizeGestures = recognize;
+	if (settings != NULL)
+	{
+		mGestures.setSettings(*settings);
+	}
+
+	if (!mRecognizeGestures)
+	{
+		mGestures.reset();
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::getGestureEvents(GestureEventData* events, int maxEvents, int* numEvents)
+{
+	return mGestures.getEvents(events, maxEvents, numEvents);
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::addRegion(const RegionData& region, const Vector2* vertices, int numVertices)
+{
+	Result result = mRegions.add(region, vertices, numVertices);
+	if (result != R_OK)
+	{
+		LOG_WARNING(mLogger, "Failed to add region %d to the handler of window %lu", region.id, mWindow);
+	}
+
+	return result;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::getActivePointers(ActivePointerData* pointers, int maxPointers, int* numPointers) const
+{
+	return mActivePointers.getPointers(mTransform, getMonotonicTime(), pointers, maxPointers, numPointers);
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::setSlotTimeout(float timeout)
+{
+	mSlotTimeout = timeout > 0.0f ? (uint64_t)(timeout * 1e9) : 0;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::cancelTouches(int deviceId)
+{
+	// Outside of a drain cycle the ends are flushed at once, so they are transformed and delivered like the
+	// events of a cycle
+	bool flush = !mDraining;
+	if (flush)
+	{
+		beginEvents();
+	}
+
+	uint64_t time = getMonotonicTime();
+	for (int slot = 0; slot < mSlots.getEnd(); slot++)
+	{
+		const PointerSlot& entry = mSlots.getSlot(slot);
+		if (entry.used && (deviceId == XIAllDevices || entry.deviceId == deviceId || entry.sourceId == deviceId))
+		{
+			cancelTouch(slot, time);
+		}
+	}
+
+	if (flush)
+	{
+		flushEvents(0);
+	}
+}
+// ----------------------------------------------------------------------------
+PointerState* PointerHandler::getPointerState(PointerType type, int id, bool create)
+{
+	PointerState* freeState = nullptr;
+	for (std::vector<PointerState>::iterator it = mPointers.begin(); it != mPointers.end(); ++it)
+	{
+		if (!it->used)
+		{
+			if (freeState == nullptr)
+			{
+				freeState = &(*it);
+			}
+		}
+		else if (it->type == type && it->id == id)
+		{
+			return &(*it);
+		}
+	}
+
+	if (!create)
+	{
+		return nullptr;
+	}
+
+	if (freeState == nullptr)
+	{
+		mPointers.push_back(PointerState());
+		freeState = &mPointers.back();
+	}
+
+	freeState->type = type;
+	freeState->id = id;
+	freeState->used = true;
+	freeState->ended = false;
+	freeState->pendingUpdate = -1;
+	freeState->numHistory = 0;
+
+	return freeState;
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::resetPendingUpdates()
+{
+	for (std::vector<PointerState>::iterator it = mPointers.begin(); it != mPointers.end(); ++it)
+	{
+		it->pendingUpdate = -1;
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::transformEvents()
+{
+	size_t numEvents = mEvents.size() - mNumTransformedEvents;
+	if (numEvents == 0)
+	{
+		return;
+	}
+
+	// Gather the positions into separate X and Y arrays, followed by the predicted positions
+	mTransformX.resize(numEvents * 2);
+	mTransformY.resize(numEvents * 2);
+	size_t numPoints = 0;
+	for (size_t i = mNumTransformedEvents; i < mEvents.size(); i++)
+	{
+		mTransformX[numPoints] = mEvents[i].position.x;
+		mTransformY[numPoints] = mEvents[i].position.y;
+		numPoints++;
+	}
+	for (size_t i = mNumTransformedEvents; i < mEvents.size(); i++)
+	{
+		const PointerData& data = mEvents[i].data;
+		if (data.mask & TM_PREDICTION)
+		{
+			mTransformX[numPoints] = data.predictedPosition.x;
+			mTransformY[numPoints] = data.predictedPosition.y;
+			numPoints++;
+		}
+	}
+
+	transformPoints(mTransform, mTransformX.data(), mTransformY.data(), numPoints);
+
+	size_t predicted = numEvents;
+	for (size_t i = mNumTransformedEvents, point = 0; i < mEvents.size(); i++, point++)
+	{
+		PointerEventData& eventData = mEvents[i];
+		eventData.position = Vector2(mTransformX[point], mTransformY[point]);
+		if (eventData.data.mask & TM_PREDICTION)
+		{
+			eventData.data.predictedPosition = Vector2(mTransformX[predicted], mTransformY[predicted]);
+			eventData.data.velocity = mTransform.applyLinear(eventData.data.velocity);
+			predicted++;
+		}
+	}
+
+	mNumTransformedEvents = mEvents.size();
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::transformEvent(PointerEventData& eventData) const
+{
+	eventData.position = mTransform.apply(eventData.position);
+	if (eventData.data.mask & TM_PREDICTION)
+	{
+		eventData.data.predictedPosition = mTransform.apply(eventData.data.predictedPosition);
+		eventData.data.velocity = mTransform.applyLinear(eventData.data.velocity);
+	}
+}
+// ----------------------------------------------------------------------------
+Result PointerHandler::getLatencyStats(LatencyStats* stats) const
+{
+	if (stats == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	stats->numEvents = mQueueLatency.getNumValues();
+	stats->eventP50 = mEventLatency.getValueAtPercentile(50.0);
+	stats->eventP99 = mEventLatency.getValueAtPercentile(99.0);
+	stats->eventMax = mEventLatency.getMaxValue();
+	stats->queueP50 = mQueueLatency.getValueAtPercentile(50.0);
+	stats->queueP99 = mQueueLatency.getValueAtPercentile(99.0);
+	stats->queueMax = mQueueLatency.getMaxValue();
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::resetLatencyStats()
+{
+	mEventLatency.reset();
+	mQueueLatency.reset();
+}
+// ----------------------------------------------------------------------------
+void PointerHandler::cancelTouch(int slot, uint64_t time)
+{
+	// The end is processed like one that arrived, at the latest position of the touch, so coalescing,
+	// prediction, resampling and gestures release the touch as well
+	const PointerSlot& entry = mSlots.getSlot(slot);
+	DeviceEvent event = {};
+	event.window = mWindow;
+	event.type = XI_TouchEnd;
+	event.deviceId = entry.deviceId;
+	event.sourceId = entry.sourceId;
+	event.detail = entry.id;
+	event.flags = DEVICE_EVENT_CANCELED;
+	event.x = entry.position.x;
+	event.y = entry.position.y;
+	event.time = entry.serverTime;
+	event.receiveTime = time;
+	event.dispatchTime = time;
 
-	mPointerCallback(pointerId, pointerEvent, pointerType, position, pointerData);
+	processEvent(event);
+	mNumCanceledTouches++;
 }
\ No newline at end of file
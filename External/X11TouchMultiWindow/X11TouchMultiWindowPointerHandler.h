@@ -7,7 +7,38 @@
 #include <X11/Xlib.h>
 #include <X11/extensions/XInput2.h>
 
+#include "X11TouchMultiWindowActivePointers.h"
 #include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+#include "X11TouchMultiWindowFilter.h"
+#include "X11TouchMultiWindowGestures.h"
+#include "X11TouchMultiWindowLatency.h"
+#include "X11TouchMultiWindowPrediction.h"
+#include "X11TouchMultiWindowRegions.h"
+#include "X11TouchMultiWindowResampling.h"
+#include "X11TouchMultiWindowSlots.h"
+#include "X11TouchMultiWindowTransform.h"
+
+class Logger;
+
+#define MAX_POINTER_HISTORY 32
+// Events a buffered handler keeps until they are retrieved, further updates are merged into the latest ones
+#define MAX_BUFFERED_EVENTS 16384
+
+/// @brief State kept per pointer of a handler while it is active.
+struct PointerState
+{
+	PointerType type;
+	int id;
+	bool used;
+	/// Set when the pointer ended, the entry is released at the start of the next drain cycle
+	bool ended;
+	/// Index in the event buffer of the update later updates are merged into, -1 if there is none
+	int pendingUpdate;
+	/// Positions of the updates merged during the current drain cycle, oldest first
+	int numHistory;
+	Vector2 history[MAX_POINTER_HISTORY];
+};
 
 class EXPORT_API PointerHandler
 {
@@ -15,23 +46,66 @@ private:
 	Display* mDisplay;
 	int mTargetDisplay;
 	Window mWindow;
-	MessageCallback mMessageCallback;
+	Logger* mLogger;
 	PointerCallback mPointerCallback;
 
 	int mWidth;
-	int mHeight;
+	ScreenTransform mTransform;
+
+	// Events decoded during the current drain cycle. The capacity is retained between cycles,
+	// so no allocations are needed once the buffer has grown to the peak event rate.
+	std::vector<PointerEventData> mEvents;
+	// The events before this index have been retrieved by getPointerEvents or dropped, the buffer is only
+	// compacted at the start of a drain cycle
+	size_t mNumReadEvents;
+	unsigned long long mNumDroppedEvents;
+	// Events are decoded in window coordinates and transformed to screen space in a batch when the
+	// cycle is flushed, the events before this index have been transformed
+	size_t mNumTransformedEvents;
+	std::vector<float> mTransformX;
+	std::vector<float> mTransformY;
+
+	bool mCoalesce;
+	bool mKeepHistory;
+	unsigned long long mNumCoalescedEvents;
+	std::vector<PointerState> mPointers;
+
+	bool mFilter;
+	PointerFilter mFilterStage;
+	unsigned long long mNumSuppressedUpdates;
+
+	bool mPredict;
+	PointerPredictor mPredictor;
+
+	bool mResample;
+	PointerResampler mResampler;
+
+	bool mRecognizeGestures;
+	GestureRecognizer mGestures;
+
+	RegionIndex mRegions;
+
+	PointerSlotTable mSlots;
+	// In nanoseconds, 0 never times out touches
+	uint64_t mSlotTimeout;
+	unsigned long long mNumCanceledTouches;
+
+	ActivePointerTable mActivePointers;
 
-	float mOffsetX;
-	float mOffsetY;
+	// Set from beginEvents up to flushEvents
+	bool mDraining;
 
-	float mScaleX;
-	float mScaleY;
+	LatencyHistogram mEventLatency;
+	LatencyHistogram mQueueLatency;
 public:
 	PointerHandler(Display* display, int targetDisplay, Window window,
-		MessageCallback messageCallback, PointerCallback pointerCallback);
+		Logger* logger, PointerCallback pointerCallback);
+	PointerHandler(PointerHandler&& other) = default;
 	~PointerHandler();
 
-	Result initialize(std::vector<int> deviceIds);
+	PointerHandler& operator=(PointerHandler&& other) = default;
+
+	Result initialize();
 
 	Window getWindow() const { return mWindow; }
 	int getTargetDisplay() const { return mTargetDisplay; }
@@ -42,5 +116,83 @@ public:
 	Result setScreenParams(int width, int height, float offsetX, float offsetY,
 		float scaleX, float scaleY);
 
-	void processEvent(XIDeviceEvent* xiEvent);
+	void beginEvents();
+	void processEvent(const DeviceEvent& event);
+	/// @param frameTime CLOCK_MONOTONIC time in nanoseconds the updates are resampled to, 0 to not resample
+	void flushEvents(uint64_t frameTime);
+
+	// Handlers created without a pointer callback keep their events until retrieved with
+	// getPointerEvents, so a whole frame of events crosses into managed code at once
+	bool isBuffered() const { return mPointerCallback == nullptr; }
+	int getNumPointerEvents() const { return mEvents.size() - mNumReadEvents; }
+	Result getPointerEvents(PointerEventData* events, int maxEvents, int* numEvents);
+	/// @brief Returns the number of updates a buffered handler merged into the latest update of their pointer
+	/// because more than MAX_BUFFERED_EVENTS events were waiting to be retrieved. Downs and ups are never dropped.
+	unsigned long long getNumDroppedEvents() const { return mNumDroppedEvents; }
+
+	// Consecutive updates of a pointer within a drain cycle are merged into the latest one,
+	// optionally keeping the merged positions as history
+	Result setCoalescing(bool coalesce, bool keepHistory);
+	unsigned long long getNumCoalescedEvents() const { return mNumCoalescedEvents; }
+	Result getPointerHistory(PointerType type, int id, Vector2* samples, int maxSamples, int* numSamples);
+
+	/// @brief Smooths the positions of touches before any other stage sees them, see PointerFilter. Updates
+	/// within the dead zone are dropped and counted.
+	/// @param settings Parameters to filter with, NULL keeps the current ones
+	Result setFiltering(bool filter, const FilterSettings* settings);
+	unsigned long long getNumSuppressedUpdates() const { return mNumSuppressedUpdates; }
+
+	/// @brief Estimates the velocity of every pointer sample and predicts its position the horizon ahead,
+	/// filled in the velocity and predictedPosition of its PointerData.
+	/// @param horizon Time to predict ahead in milliseconds, clamped to PREDICTION_MAX_HORIZON
+	Result setPrediction(bool predict, float horizon);
+
+	/// @brief Moves the last update of every pointer in a drain cycle to its position at the frame time passed
+	/// to flushEvents, see PointerResampler.
+	/// @param maxExtrapolation Time in milliseconds a position may be extrapolated past the latest sample
+	Result setResampling(bool resample, float maxExtrapolation);
+
+	/// @brief Recognizes taps, long presses and flicks of the pointers of the handler, see GestureRecognizer.
+	/// The gestures are kept until retrieved with getGestureEvents.
+	/// @param settings Thresholds to recognize with, NULL keeps the current ones
+	Result setGestureRecognition(bool recognize, const GestureSettings* settings);
+	int getNumGestureEvents() const { return mGestures.getNumEvents(); }
+	Result getGestureEvents(GestureEventData* events, int maxEvents, int* numEvents);
+
+	/// @brief Registers a region pointers going down in are tagged with, see RegionIndex. Regions are hit tested
+	/// natively, so the managed side can skip raycasting pointers that went down in a region it registered.
+	/// @param vertices Vertices of a polygon relative to region.position, ignored for other shapes
+	Result addRegion(const RegionData& region, const Vector2* vertices, int numVertices);
+	Result removeRegion(int id) { return mRegions.remove(id); }
+	/// @param position New minimum corner of a rect, center of a circle or origin of a polygon
+	Result moveRegion(int id, const Vector2& position) { return mRegions.move(id, position); }
+	void clearRegions() { mRegions.clear(); }
+	int getNumRegions() const { return mRegions.getNumRegions(); }
+
+	/// @brief Copies the latest state of every active pointer, as of the events processed so far.
+	int getNumActivePointers() const { return mActivePointers.getNumPointers(); }
+	Result getActivePointers(ActivePointerData* pointers, int maxPointers, int* numPointers) const;
+
+	/// @brief Sets how long a touch may go without events before its end is considered lost, it is then ended
+	/// with a PE_UP flagged PF_CANCELED and its slot is reused.
+	/// @param timeout In seconds, 0 to never time out touches
+	Result setSlotTimeout(float timeout);
+	/// @brief Ends the touches of a device with a PE_UP flagged PF_CANCELED, for when their ends won't arrive,
+	/// like after the device was removed or the window unmapped.
+	/// @param deviceId Master or source device of the touches, XIAllDevices for all touches
+	void cancelTouches(int deviceId);
+	/// @brief Returns the number of touches occupying a slot.
+	int getNumTouches() const { return mSlots.getNumUsed(); }
+	unsigned long long getNumCanceledTouches() const { return mNumCanceledTouches; }
+
+	/// @brief Fills the latency percentiles, the clock estimate is filled in by the system.
+	Result getLatencyStats(LatencyStats* stats) const;
+	void resetLatencyStats();
+
+private:
+	PointerState* getPointerState(PointerType type, int id, bool create);
+	void resetPendingUpdates();
+	void transformEvents();
+	void transformEvent(PointerEventData& eventData) const;
+	void cancelTouch(int slot, uint64_t time);
 };
\ No newline at end of file
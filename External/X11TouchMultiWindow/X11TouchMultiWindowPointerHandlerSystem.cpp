@@ -1,45 +1,164 @@
 /*
 @author Jorrit de Vries (jorrit@ijsfontein.nl)
 */
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <mutex>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <X11/extensions/XInput2.h>
 
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "X11TouchMultiWindowEventSource.h"
 #include "X11TouchMultiWindowPointerHandler.h"
 #include "X11TouchMultiWindowPointerHandlerSystem.h"
+#include "X11TouchMultiWindowReaderThread.h"
+#include "X11TouchMultiWindowRecording.h"
+#include "X11TouchMultiWindowSharedRingEventSource.h"
+#include "X11TouchMultiWindowLogger.h"
 #include "X11TouchMultiWindowUtils.h"
 
-PointerHandlerSystem* PointerHandlerSystem::msInstance = nullptr;
+#define DEFAULT_QUEUE_CAPACITY 4096
+// Events decoded per read from the event source
+#define READ_BATCH_SIZE 64
+// Events dispatched per cycle when replaying as fast as possible
+#define REPLAY_BATCH_SIZE 1024
+
+// ----------------------------------------------------------------------------
+static bool isPointerDevice(const XIDeviceInfo& device)
+{
+	if (device.use != XIMasterPointer && device.use != XISlavePointer && device.use != XIFloatingSlave)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < device.num_classes; i++)
+	{
+		switch (device.classes[i]->type)
+		{
+			// Touch
+			case XITouchClass:
+			// Mouse, touchpad
+			case XIButtonClass:
+			case XIValuatorClass:
+				return true;
+		}
+	}
+
+	return false;
+}
+// ----------------------------------------------------------------------------
+static bool insertDeviceId(std::vector<int>& deviceIds, int deviceId)
+{
+	std::vector<int>::iterator it = std::lower_bound(deviceIds.begin(), deviceIds.end(), deviceId);
+	if (it != deviceIds.end() && *it == deviceId)
+	{
+		return false;
+	}
+
+	deviceIds.insert(it, deviceId);
+	return true;
+}
+// ----------------------------------------------------------------------------
+static bool eraseDeviceId(std::vector<int>& deviceIds, int deviceId)
+{
+	std::vector<int>::iterator it = std::lower_bound(deviceIds.begin(), deviceIds.end(), deviceId);
+	if (it == deviceIds.end() || *it != deviceId)
+	{
+		return false;
+	}
+
+	deviceIds.erase(it);
+	return true;
+}
+// ----------------------------------------------------------------------------
+// A device may already have been removed again by the time it is queried, the BadDevice error would
+// terminate the process with the default error handler. The handler is process wide, while systems of other
+// displays may query their devices from other threads, so only errors of the trapped display are swallowed.
+static std::mutex sXErrorMutex;
+static Display* sXErrorDisplay = NULL;
+static bool sXErrorTrapped = false;
+static XErrorHandler sPreviousXErrorHandler = NULL;
+static int trapXError(Display* display, XErrorEvent* error)
+{
+	if (display != sXErrorDisplay)
+	{
+		return sPreviousXErrorHandler != NULL ? sPreviousXErrorHandler(display, error) : 0;
+	}
+
+	sXErrorTrapped = true;
+	return 0;
+}
+// ----------------------------------------------------------------------------
+static void trapXErrors(Display* display)
+{
+	sXErrorMutex.lock();
+	sXErrorDisplay = display;
+	sXErrorTrapped = false;
+	sPreviousXErrorHandler = XSetErrorHandler(trapXError);
+}
+// ----------------------------------------------------------------------------
+// Returns whether an error was trapped since trapXErrors
+static bool untrapXErrors()
+{
+	XSetErrorHandler(sPreviousXErrorHandler);
+	bool errorTrapped = sXErrorTrapped;
+	sXErrorDisplay = NULL;
+	sXErrorMutex.unlock();
+
+	return errorTrapped;
+}
 
 // ----------------------------------------------------------------------------
-PointerHandlerSystem::PointerHandlerSystem(MessageCallback messageCallback)
-	: mDisplay(NULL)
+PointerHandlerSystem::PointerHandlerSystem(MessageCallback messageCallback, const SystemSettings& settings,
+	const char* displayName)
+	: mDisplayName(displayName != NULL ? displayName : "")
+	, mDisplay(NULL)
 	, mOpcode(0)
-	, mMessageCallback(messageCallback)
+	, mLogger(new Logger(messageCallback, (MessageType)settings.minMessageType))
+	, mSettings(settings)
+	, mRawEvents(false)
+	, mEventSource(nullptr)
+	, mEventSourceSharesDisplay(false)
+	, mReaderThread(nullptr)
+	, mRingWriter(nullptr)
+	, mWaitFd(-1)
+	, mWakeFd(-1)
+	, mWaitEnabled(false)
+	, mRecorder(nullptr)
+	, mReplay(nullptr)
+	, mReplayMode(RM_REALTIME)
 {
-	msInstance = this;
+
 }
 // ----------------------------------------------------------------------------
 PointerHandlerSystem::~PointerHandlerSystem()
 {
 	uninitialize();
-	msInstance = nullptr;
+
+	delete mLogger;
 }
 // ----------------------------------------------------------------------------
 Result PointerHandlerSystem::initialize()
 {
-	sendMessage(mMessageCallback, MT_INFO, "Initializing system...");
+	const char* displayName = mDisplayName.empty() ? NULL : mDisplayName.c_str();
+	LOG_INFO(mLogger, "Initializing system for display '%s'...", XDisplayName(displayName));
 
-	mDisplay = XOpenDisplay(NULL);
+	mDisplay = XOpenDisplay(displayName);
 	if (mDisplay == NULL)
 	{
-		sendMessage(mMessageCallback, MT_ERROR, "Failed to open X11 display connection.");
+		LOG_ERROR(mLogger, "Failed to open X11 display connection to '%s'.", XDisplayName(displayName));
 		return R_ERROR_API;
 	}
 
 	int event, error;
 	if (!XQueryExtension(mDisplay, "XInputExtension", &mOpcode, &event, &error))
 	{
-		sendMessage(mMessageCallback, MT_ERROR, "Failed to get the XInput extension.");
+		LOG_ERROR(mLogger, "Failed to get the XInput extension.");
 
 		XCloseDisplay(mDisplay);
 		mDisplay = NULL;
@@ -50,8 +169,7 @@ Result PointerHandlerSystem::initialize()
 	int major = 2, minor = 3;
 	if (XIQueryVersion(mDisplay, &major, &minor) == BadRequest)
 	{
-		sendMessage(mMessageCallback, MT_ERROR, "Unsupported XInput extension version: expected 2.3+, actual " +
-			std::to_string(major) + "." + std::to_string(minor));
+		LOG_ERROR(mLogger, "Unsupported XInput extension version: expected 2.3+, actual %d.%d", major, minor);
 
 		XCloseDisplay(mDisplay);
 		mDisplay = NULL;
@@ -59,28 +177,19 @@ Result PointerHandlerSystem::initialize()
 		return R_ERROR_API;
 	}
 
+	mDeviceAxes.initialize(mDisplay);
+	mWindowCache.initialize(mDisplay, mLogger);
+
 	Status status = Success;
 	int numDevices;
 	XIDeviceInfo* devices = XIQueryDevice(mDisplay, XIAllDevices, &numDevices);
 	for (int i = 0; i < numDevices; i++)
 	{
-		XIDeviceInfo device = devices[i];
-		if (device.use == XIMasterPointer || device.use == XISlavePointer || device.use == XIFloatingSlave)
+		const XIDeviceInfo& device = devices[i];
+		if (isPointerDevice(device))
 		{
-			for (int j = 0; j < device.num_classes; j++)
-			{
-				XIAnyClassInfo* classInfo = device.classes[j];
-				switch (classInfo->type)
-				{
-					// Touch
-					case XITouchClass:
-					// Mouse, touchpad
-					case XIButtonClass:
-					case XIValuatorClass:
-						mDeviceIds.push_back(classInfo->sourceid);
-						break;
-				}
-			}
+			mDeviceAxes.update(device);
+			insertDeviceId(mDeviceIds, device.deviceid);
 		}
 	}
 
@@ -91,196 +200,1031 @@ Result PointerHandlerSystem::initialize()
 		return R_ERROR_UNSUPPORTED;
 	}
 
+	if (mSettings.broker && connectBroker(displayName) == R_OK)
+	{
+		// The broker already decodes the events off the main thread
+		if (mSettings.threaded)
+		{
+			LOG_INFO(mLogger, "Reading events through the broker, the reader thread is not started");
+		}
+	}
+	else if (mSettings.threaded)
+	{
+		int queueCapacity = mSettings.queueCapacity > 0 ? mSettings.queueCapacity : DEFAULT_QUEUE_CAPACITY;
+		EventSource* source = createEventSource((EventBackend)mSettings.backend, mLogger, &mDeviceAxes, displayName,
+			NULL, nullptr);
+		mReaderThread = new ReaderThread(mLogger, source, queueCapacity);
+
+		Result result = mReaderThread->start(mSettings.threadPriority, mSettings.threadAffinityMask);
+		if (result != R_OK)
+		{
+			delete mReaderThread;
+			mReaderThread = nullptr;
+
+			XCloseDisplay(mDisplay);
+			mDisplay = NULL;
+
+			return result;
+		}
+	}
+	else
+	{
+		mEventSource = createEventSource((EventBackend)mSettings.backend, mLogger, &mDeviceAxes, displayName,
+			mDisplay, &mWindowCache);
+
+		Result result = mEventSource->open();
+		if (result != R_OK)
+		{
+			delete mEventSource;
+			mEventSource = nullptr;
+
+			XCloseDisplay(mDisplay);
+			mDisplay = NULL;
+
+			return result;
+		}
+
+		mEventSourceSharesDisplay = mEventSource->getDisplay() == mDisplay;
+	}
+
+	// Devices plugged in, removed or changed after this point are updated incrementally
+	selectDeviceChangeEvents();
+
+	// The broker selects and routes the events of the windows it publishes itself
+	if (mSettings.rawEvents && dynamic_cast<SharedRingEventSource*>(mEventSource) == nullptr)
+	{
+		selectRawEvents();
+	}
+
+	if (initializeWait() != R_OK)
+	{
+		LOG_WARNING(mLogger, "Failed to create wait descriptors, waiting for events is unsupported: %s",
+			strerror(errno));
+	}
+
 	// Propagate requests to X server
 	XFlush(mDisplay);
 
-	sendMessage(mMessageCallback, MT_INFO, "System intialized with XInput version " +
-			std::to_string(major) + "." + std::to_string(minor));
+	LOG_INFO(mLogger, "System intialized with XInput version %d.%d", major, minor);
 	return R_OK;
 }
 // ----------------------------------------------------------------------------
 Result PointerHandlerSystem::uninitialize()
 {
-	sendMessage(mMessageCallback, MT_INFO, "Uninitializing system...");
+	LOG_INFO(mLogger, "Uninitializing system...");
+
+	stopRecording();
+	stopReplay();
+	stopPublishing();
 
 	// Cleanup remaining handlers
-	PointerHandlerMapIterator it;
-	for (it = mPointerHandlers.begin(); it != mPointerHandlers.end(); ++it)
+	mPointerHandlers.clear();
+	mRawEvents = false;
+
+	if (mReaderThread != nullptr)
 	{
-		delete it->second;
+		delete mReaderThread;
+		mReaderThread = nullptr;
+	}
+
+	if (mEventSource != nullptr)
+	{
+		delete mEventSource;
+		mEventSource = nullptr;
+	}
+
+	if (mWaitFd >= 0)
+	{
+		close(mWaitFd);
+		mWaitFd = -1;
 	}
-	mPointerHandlers.clear();
 
-	sendMessage(mMessageCallback, MT_INFO, "System unintialized");
+	if (mWakeFd >= 0)
+	{
+		close(mWakeFd);
+		mWakeFd = -1;
+	}
+	mWaitEnabled = false;
+
+	// Closed last, the event source, the window cache and the raw event router may use the connection up to here
+	if (mDisplay != NULL)
+	{
+		XCloseDisplay(mDisplay);
+		mDisplay = NULL;
+	}
+	mDeviceIds.clear();
+
+	LOG_INFO(mLogger, "System unintialized");
 	return R_OK;
 }
 // ----------------------------------------------------------------------------
 Result PointerHandlerSystem::createHandler(int targetDisplay, Window window,
-	PointerCallback pointerCallback, void** handle)
+	PointerCallback pointerCallback, HandlerHandle* handle)
 {
-	if (mPointerHandlers.find(window) != mPointerHandlers.end())
+	PointerHandler handler(mDisplay, targetDisplay, window, mLogger, pointerCallback);
+	Result result = handler.initialize();
+	if (result != R_OK)
 	{
-		sendMessage(mMessageCallback, MT_ERROR,
-			"A handler has already been created for window " + std::to_string(window));
+		return result;
+	}
+
+	result = addHandler(std::move(handler), handle);
+	if (result != R_OK)
+	{
+		return result;
+	}
+
+	// Reports the window being unmapped or destroyed, which ends its touches without reporting it
+	mWindowCache.trackGeometry(window);
+
+	if (mRawEvents)
+	{
+		mRawEventRouter.addWindow(window);
+		return R_OK;
+	}
+
+	std::unique_lock<std::mutex> lock;
+	EventSource* source = lockEventSource(lock);
+	result = source->selectEvents(window, mDeviceIds.data(), mDeviceIds.size());
+	unlockEventSource(lock);
+
+	return result;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::addHandler(PointerHandler&& handler, HandlerHandle* handle)
+{
+	Window window = handler.getWindow();
+	if (mPointerHandlers.find(window) != nullptr)
+	{
+		LOG_ERROR(mLogger, "A handler has already been created for window %lu", window);
 		return R_ERROR_DUPLICATE_ITEM;
 	}
 
-	PointerHandler* handler = new PointerHandler(mDisplay, targetDisplay,
-		window, mMessageCallback, pointerCallback);
-	*handle = handler;
+	if (mPointerHandlers.add(std::move(handler), handle) == nullptr)
+	{
+		LOG_ERROR(mLogger, "Failed to add handler for window %lu", window);
+		return R_ERROR_API;
+	}
 
-	mPointerHandlers.insert(std::make_pair(window, handler));
-	return handler->initialize(mDeviceIds);
+	return R_OK;
 }
 // ----------------------------------------------------------------------------
-PointerHandler* PointerHandlerSystem::getHandler(Window window) const
+Result PointerHandlerSystem::connectBroker(const char* displayName)
 {
-	ConstPointerHandlerMapIterator it = mPointerHandlers.find(window);
-	if (it != mPointerHandlers.end())
+	SharedRingEventSource* source = new SharedRingEventSource(mLogger, getSharedRingName(displayName));
+	Result result = source->open();
+	if (result != R_OK)
 	{
-		return it->second;
+		LOG_WARNING(mLogger, "Failed to attach to the broker, reading events from the display instead");
+		delete source;
+		return result;
 	}
 
-	return nullptr;
+	mEventSource = source;
+	mEventSourceSharesDisplay = false;
+
+	return R_OK;
 }
 // ----------------------------------------------------------------------------
-Result PointerHandlerSystem::destroyHandler(PointerHandler* handler)
+EventSource* PointerHandlerSystem::lockEventSource(std::unique_lock<std::mutex>& lock)
 {
-	PointerHandlerMapIterator it = mPointerHandlers.find(handler->getWindow());
-	if (it != mPointerHandlers.end())
+	// Events are delivered to the connection that selected them, which is the reader's own
+	// connection in threaded mode
+	if (mReaderThread != nullptr)
 	{
-		mPointerHandlers.erase(it);
+		lock = std::unique_lock<std::mutex>(mReaderThread->getSourceMutex());
+		return mReaderThread->getSource();
+	}
+
+	return mEventSource;
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::unlockEventSource(std::unique_lock<std::mutex>& lock)
+{
+	if (mReaderThread != nullptr)
+	{
+		// Propagate requests to X server
+		mReaderThread->getSource()->flush();
+
+		// The source may have read pending events into its queue while flushing
+		lock.unlock();
+		mReaderThread->wake();
+	}
+	else
+	{
+		mEventSource->flush();
+	}
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::selectDeviceChangeEvents()
+{
+	std::unique_lock<std::mutex> lock;
+	EventSource* source = lockEventSource(lock);
+	Result result = source->selectDeviceChangeEvents();
+	unlockEventSource(lock);
+
+	if (result != R_OK)
+	{
+		LOG_WARNING(mLogger, "Failed to select device change events, devices plugged in later are ignored");
+		return result;
 	}
 
-	delete handler;
 	return R_OK;
 }
 // ----------------------------------------------------------------------------
-Result PointerHandlerSystem::processEventQueue()
+Result PointerHandlerSystem::selectRawEvents()
 {
-	// Flush the output buffer before reading the number of events queued. This
-	// is needed as we use QueuedAlready when checking for new events. Using this
-	// flag saves a call to flushing, as XNextEvent already flushes the output
-	// buffer
-	XFlush(mDisplay);
+	std::unique_lock<std::mutex> lock;
+	EventSource* source = lockEventSource(lock);
+	Result result = source->selectRawEvents();
+	unlockEventSource(lock);
 
-	// The actual processing of the event queue
-	XEvent xEvent;
-	while (XEventsQueued(mDisplay, QueuedAlready))
+	if (result != R_OK)
 	{
-		XNextEvent(mDisplay, &xEvent);
-		switch (xEvent.type)
+		LOG_WARNING(mLogger, "Failed to select raw events, selecting the events of every window instead");
+		return result;
+	}
+
+	mRawEventRouter.initialize(mDisplay, &mWindowCache, mLogger);
+
+	XSync(mDisplay, False);
+	trapXErrors(mDisplay);
+	for (std::vector<int>::const_iterator it = mDeviceIds.begin(); it != mDeviceIds.end(); ++it)
+	{
+		mRawEventRouter.updateDevice(*it);
+	}
+	untrapXErrors();
+
+	mRawEvents = true;
+
+	LOG_INFO(mLogger, "Selected raw events on the root window");
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::processDeviceChange(const DeviceEvent& event)
+{
+	if (event.type == XI_HierarchyChanged)
+	{
+		if (event.flags & (XIMasterRemoved | XISlaveRemoved))
+		{
+			removeDevice(event.deviceId);
+		}
+		else
+		{
+			// Added devices, but attaching or detaching a slave changes its use as well
+			updateDevice(event.deviceId);
+		}
+	}
+	else if (event.type == XI_DeviceChanged && event.flags == XIDeviceChange)
+	{
+		// A slave switch only changes the classes of the master, axes are decoded per source device
+		updateDevice(event.deviceId);
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::updateDevice(int deviceId)
+{
+	// Labels of devices plugged in after initialization may not have existed yet
+	mDeviceAxes.initialize(mDisplay);
+
+	XSync(mDisplay, False);
+	int numDevices = 0;
+	XIDeviceInfo* devices;
+	trapXErrors(mDisplay);
+	devices = XIQueryDevice(mDisplay, deviceId, &numDevices);
+	if (mRawEvents && devices != NULL && numDevices > 0 && isPointerDevice(devices[0]))
+	{
+		mRawEventRouter.updateDevice(deviceId);
+	}
+	bool errorTrapped = untrapXErrors();
+
+	if (devices == NULL || errorTrapped || numDevices < 1 || !isPointerDevice(devices[0]))
+	{
+		if (devices != NULL)
 		{
-			case GenericEvent:
-				{
-					if (xEvent.xcookie.extension != mOpcode)
-					{
-						// Received a non xinput event
-						// sendMessage(mMessageCallback, MT_INFO,
-						//     "Received event of type " + std::to_string(xEvent.type));
-						continue;
-					}
-
-					XGetEventData(mDisplay, &xEvent.xcookie);
-					XIDeviceEvent* xiEvent = (XIDeviceEvent*)xEvent.xcookie.data;
-					
-					Window window = xiEvent->event;
-					PointerHandlerMapIterator it = mPointerHandlers.find(window);
-					if (it == mPointerHandlers.end())
-					{
-						XFreeEventData(mDisplay, &xEvent.xcookie);
-
-						sendMessage(mMessageCallback, MT_WARNING,
-							"Failed to retrieve handler for window " + std::to_string(window));
-						continue;
-					}
-
-					it->second->processEvent(xiEvent);
-
-					XFreeEventData(mDisplay, &xEvent.xcookie);
-				}
-			break;
+			XIFreeDeviceInfo(devices);
 		}
+
+		removeDevice(deviceId);
+		return;
 	}
 
-	return R_OK;
+	bool added = insertDeviceId(mDeviceIds, deviceId);
+
+	std::unique_lock<std::mutex> lock;
+	EventSource* source = lockEventSource(lock);
+
+	// The reader thread decodes with the axes table while holding the lock
+	mDeviceAxes.update(devices[0]);
+
+	// Raw events are selected for all devices at once
+	if (added && !mRawEvents)
+	{
+		mPointerHandlers.forEach([source, deviceId](PointerHandler& handler)
+			{
+				source->selectEvents(handler.getWindow(), &deviceId, 1);
+			});
+
+		for (std::vector<Window>::const_iterator it = mPublishedWindows.begin(); it != mPublishedWindows.end(); ++it)
+		{
+			source->selectEvents(*it, &deviceId, 1);
+		}
+	}
+
+	unlockEventSource(lock);
+
+	LOG_INFO(mLogger, "Device %d '%s' %s", deviceId, devices[0].name, added ? "added" : "changed");
+	XIFreeDeviceInfo(devices);
 }
 // ----------------------------------------------------------------------------
-Result PointerHandlerSystem::getWindowsOfProcess(unsigned long pid, Window** windows, uint* numWindows)
+void PointerHandlerSystem::removeDevice(int deviceId)
 {
-	if (windows == NULL)
+	if (!eraseDeviceId(mDeviceIds, deviceId))
+	{
+		return;
+	}
+
+	// Selections are removed by the server together with the device
+	std::unique_lock<std::mutex> lock;
+	lockEventSource(lock);
+	mDeviceAxes.remove(deviceId);
+	unlockEventSource(lock);
+
+	if (mRawEvents)
+	{
+		mRawEventRouter.removeDevice(deviceId);
+	}
+
+	// The ends of the touches of the device won't arrive anymore
+	mPointerHandlers.forEach([deviceId](PointerHandler& handler) { handler.cancelTouches(deviceId); });
+
+	LOG_INFO(mLogger, "Device %d removed", deviceId);
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::destroyHandler(HandlerHandle handle)
+{
+	PointerHandler* handler = mPointerHandlers.get(handle);
+	if (handler == nullptr)
 	{
 		return R_ERROR_NULL_POINTER;
 	}
 
-	Window defaultRootWindow = XDefaultRootWindow(mDisplay);
-	Atom atomPID = XInternAtom(mDisplay, "_NET_WM_PID", True);
-	
-	std::vector<Window> result;
-	getWindowsOfProcess(defaultRootWindow, pid, atomPID, result);
+	Window window = handler->getWindow();
+	mPointerHandlers.remove(handle);
+	mWindowCache.untrackGeometry(window);
 
-	*numWindows = result.size();
+	if (mRawEvents)
+	{
+		mRawEventRouter.removeWindow(window);
+		return R_OK;
+	}
 
-	// Copy the data to an array
-	*windows = new Window[result.size()];
-	std::copy(result.begin(), result.end(), *windows);
+	// Handlers added with addHandler to a system without a connection have no events selected
+	if (mEventSource == nullptr && mReaderThread == nullptr)
+	{
+		return R_OK;
+	}
+
+	std::unique_lock<std::mutex> lock;
+	EventSource* source = lockEventSource(lock);
+	source->unselectEvents(window);
+	unlockEventSource(lock);
 
 	return R_OK;
 }
 // ----------------------------------------------------------------------------
-Result PointerHandlerSystem::freeWindowsOfProcess(Window* windows)
+Result PointerHandlerSystem::initializeWait()
 {
-	if (windows == NULL)
+	mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	mWaitFd = epoll_create1(EPOLL_CLOEXEC);
+	if (mWakeFd < 0 || mWaitFd < 0)
+	{
+		return R_ERROR_API;
+	}
+
+	// The window cache notifications are always read from the main connection
+	int fds[3];
+	int numFds = 0;
+	fds[numFds++] = mWakeFd;
+	fds[numFds++] = ConnectionNumber(mDisplay);
+	if (mReaderThread != nullptr)
+	{
+		fds[numFds++] = mReaderThread->getEventFd();
+	}
+	else if (!mEventSourceSharesDisplay)
+	{
+		fds[numFds++] = mEventSource->getFd();
+	}
+
+	for (int i = 0; i < numFds; i++)
+	{
+		struct epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = fds[i];
+		if (epoll_ctl(mWaitFd, EPOLL_CTL_ADD, fds[i], &event) < 0)
+		{
+			return R_ERROR_API;
+		}
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::enableWait()
+{
+	if (!mWaitEnabled)
+	{
+		mWaitEnabled = true;
+		if (mReaderThread != nullptr)
+		{
+			mReaderThread->enableEventSignal();
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+bool PointerHandlerSystem::hasPendingEvents()
+{
+	if (mReplay != nullptr && (mReplayMode == RM_FAST || mReplay->getNextTime() <= getMonotonicTime()))
+	{
+		return true;
+	}
+
+	if (mEventSource != nullptr && mEventSource->hasPendingEvents())
+	{
+		return true;
+	}
+
+	// Replies read from the main connection may have queued window cache notifications
+	return XEventsQueued(mDisplay, QueuedAlready) > 0;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::getFd(int* fd)
+{
+	if (fd == nullptr)
 	{
 		return R_ERROR_NULL_POINTER;
 	}
 
-	delete[] windows;
+	if (mWaitFd < 0)
+	{
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	enableWait();
+
+	*fd = mWaitFd;
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::waitForEvents(int timeoutMs, bool* ready)
+{
+	if (ready == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	if (mWaitFd < 0)
+	{
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	enableWait();
+
+	// Events already read from a connection don't make its descriptor readable
+	if (hasPendingEvents())
+	{
+		*ready = true;
+		return R_OK;
+	}
+
+	if (mReplay != nullptr)
+	{
+		// Wake up in time for the next replayed event
+		uint64_t now = getMonotonicTime();
+		uint64_t next = mReplay->getNextTime();
+		if (next != UINT64_MAX)
+		{
+			int replayTimeoutMs = (int)std::min<uint64_t>((next - now + 999999) / 1000000, INT32_MAX);
+			timeoutMs = timeoutMs < 0 ? replayTimeoutMs : std::min(timeoutMs, replayTimeoutMs);
+		}
+	}
+
+	struct epoll_event events[3];
+	int numEvents = epoll_wait(mWaitFd, events, 3, timeoutMs);
+	if (numEvents < 0 && errno != EINTR)
+	{
+		LOG_ERROR(mLogger, "Failed to wait for events: %s", strerror(errno));
+		return R_ERROR_API;
+	}
+
+	bool received = false;
+	for (int i = 0; i < numEvents; i++)
+	{
+		if (events[i].data.fd == mWakeFd)
+		{
+			uint64_t value;
+			ssize_t r = read(mWakeFd, &value, sizeof(value));
+			(void)r;
+		}
+		else
+		{
+			received = true;
+		}
+	}
+
+	*ready = received || hasPendingEvents();
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::wake()
+{
+	if (mWakeFd < 0)
+	{
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	uint64_t value = 1;
+	ssize_t r = write(mWakeFd, &value, sizeof(value));
+	(void)r;
 
 	return R_OK;
 }
 // ----------------------------------------------------------------------------
-void PointerHandlerSystem::getWindowsOfProcess(Window window, unsigned long pid,
-	Atom atomPID, std::vector<Window>& windows)
+Result PointerHandlerSystem::processEventQueue(uint64_t frameTime)
 {
-	Atom           type;
-	int            format;
-	unsigned long  nItems;
-	unsigned long  bytesAfter;
-	unsigned char *propPID = 0;
+	beginEvents();
+
+	if (mRingWriter != nullptr)
+	{
+		updatePublishedWindows();
+	}
+
+	if (mWaitEnabled)
+	{
+		// Reset before reading, so events arriving while processing signal again
+		uint64_t value;
+		ssize_t r = read(mWakeFd, &value, sizeof(value));
+		(void)r;
 
-	if (XGetWindowProperty(mDisplay, window, atomPID, 0, 1, False, XA_CARDINAL,
-		&type, &format, &nItems, &bytesAfter, &propPID) == Success)
+		if (mReaderThread != nullptr)
+		{
+			mReaderThread->resetEventFd();
+		}
+	}
+
+	if (mReaderThread != nullptr)
 	{
-		if (propPID != 0)
+		// Events have already been read and decoded by the reader thread
+		DeviceEvent event;
+		while (mReaderThread->pop(event))
 		{
-			unsigned long windowPID = *((unsigned long*)propPID);
+			dispatchEvent(event);
+		}
+
+		unsigned long numDroppedEvents = mReaderThread->takeNumDroppedEvents();
+		if (numDroppedEvents > 0)
+		{
+			LOG_WARNING(mLogger, "Reader thread queue overflowed, dropped %lu events", numDroppedEvents);
+		}
 
-			if (windowPID == pid)
+		processWindowEvents();
+	}
+	else if (mEventSource != nullptr)
+	{
+		// Flush the output buffer before reading, the requests issued since the last cycle may
+		// have generated events
+		mEventSource->flush();
+
+		DeviceEvent events[READ_BATCH_SIZE];
+		size_t numEvents;
+		do
+		{
+			numEvents = mEventSource->read(events, READ_BATCH_SIZE);
+			for (size_t i = 0; i < numEvents; i++)
 			{
-				windows.push_back(window);
+				dispatchEvent(events[i]);
 			}
+		} while (numEvents == READ_BATCH_SIZE);
 
-			XFree(propPID);
+		if (!mEventSourceSharesDisplay)
+		{
+			processWindowEvents();
 		}
 	}
 
-	// Recurse into window tree
-	Window rootWindow;
-	Window parentWindow;
-	Window* childWindows;
-	unsigned numChildWindows;
+	cancelHiddenWindows();
+
+	if (mReplay != nullptr)
+	{
+		replayEvents();
+	}
+
+	flushEvents(frameTime);
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::processEvents(DeviceEvent* events, size_t numEvents, uint64_t frameTime)
+{
+	if (events == nullptr && numEvents > 0)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	beginEvents();
+
+	for (size_t i = 0; i < numEvents; i++)
+	{
+		dispatchEvent(events[i]);
+	}
+
+	flushEvents(frameTime);
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::beginEvents()
+{
+	// Messages logged while processing events are dispatched at once when done
+	mLogger->beginBatch();
+
+	mPointerHandlers.forEach([](PointerHandler& handler) { handler.beginEvents(); });
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::flushEvents(uint64_t frameTime)
+{
+	// Deliver the events of this cycle to handlers in callback mode
+	mPointerHandlers.forEach([frameTime](PointerHandler& handler) { handler.flushEvents(frameTime); });
 
-	if (XQueryTree(mDisplay, window, &rootWindow, &parentWindow, &childWindows, &numChildWindows) != 0)
+	if (mRingWriter != nullptr)
 	{
-		for (unsigned i = 0; i < numChildWindows; i++)
+		mRingWriter->notify();
+	}
+
+	mLogger->endBatch();
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::processWindowEvents()
+{
+	// Unless events are read from it, only the notifications of the window cache are delivered to
+	// this connection
+	XEvent xEvent;
+	while (XPending(mDisplay) > 0)
+	{
+		XNextEvent(mDisplay, &xEvent);
+		mWindowCache.processEvent(xEvent);
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::cancelHiddenWindows()
+{
+	mWindowCache.takeHiddenWindows(mHiddenWindows);
+	for (std::vector<Window>::const_iterator it = mHiddenWindows.begin(); it != mHiddenWindows.end(); ++it)
+	{
+		PointerHandler* handler = mPointerHandlers.find(*it);
+		if (handler != nullptr && handler->getNumTouches() > 0)
+		{
+			LOG_INFO(mLogger, "Window %lu was hidden, canceling its touches", *it);
+			handler->cancelTouches(XIAllDevices);
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::replayEvents()
+{
+	uint64_t time = mReplayMode == RM_REALTIME ? getMonotonicTime() : UINT64_MAX;
+
+	size_t numEvents;
+	do
+	{
+		numEvents = mReplay->read(mReplayEvents.data(), mReplayEvents.size(), time);
+		for (size_t i = 0; i < numEvents; i++)
 		{
-			getWindowsOfProcess(childWindows[i], pid, atomPID, windows);
+			dispatchEvent(mReplayEvents[i], true);
 		}
+	} while (numEvents == mReplayEvents.size() && mReplayMode == RM_REALTIME);
+
+	if (mReplay->isFinished())
+	{
+		LOG_INFO(mLogger, "Replay finished");
+		stopReplay();
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::dispatchEvent(DeviceEvent& event, bool replayed)
+{
+	if (isDeviceChangeEventType(event.type))
+	{
+		processDeviceChange(event);
 
-		if (childWindows)
+		// Lets the processes reading through the broker cancel the touches of removed devices
+		if (mRingWriter != nullptr)
 		{
-			XFree(childWindows);
+			mRingWriter->publishToAll(event);
 		}
+		return;
+	}
+
+	// Routed to the window they would have been delivered to before they are recorded or published, raw events
+	// that are not routed to any window are dropped
+	if (isRawEventType(event.type) && !(mRawEvents && mRawEventRouter.route(event)))
+	{
+		return;
+	}
+
+	event.dispatchTime = getMonotonicTime();
+	if (replayed)
+	{
+		// Recorded server times may be far from the live clock, even wrapped, which would corrupt its offset.
+		// The receive times of the replay are shifted to its start, and follow the recorded timing.
+		event.serverTime = event.receiveTime;
+	}
+	else
+	{
+		mServerClock.update(event.time, event.receiveTime);
+		event.serverTime = mServerClock.toMonotonicTime(event.time, event.receiveTime);
+	}
+
+	if (mRecorder != nullptr)
+	{
+		mRecorder->record(event);
+	}
+
+	if (mRingWriter != nullptr)
+	{
+		// The server clock and dispatch time are stamped again by the system of the reading process
+		if (!mRingWriter->publish(event))
+		{
+			LOG_DEBUG(mLogger, "No process reads the events of window %lu", event.window);
+		}
+		return;
+	}
+
+	PointerHandler* handler = mPointerHandlers.find(event.window);
+	if (handler == nullptr)
+	{
+		LOG_WARNING(mLogger, "Failed to retrieve handler for window %lu", event.window);
+		return;
+	}
+
+	handler->processEvent(event);
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::startPublishing(bool groupAccess)
+{
+	if (mRingWriter != nullptr)
+	{
+		return R_OK;
+	}
+
+	// A system reading through a broker has no events of its own to publish
+	if (mDisplay == NULL || dynamic_cast<SharedRingEventSource*>(mEventSource) != nullptr)
+	{
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	const char* displayName = mDisplayName.empty() ? NULL : mDisplayName.c_str();
+	SharedRingWriter* writer = new SharedRingWriter(mLogger, getSharedRingName(displayName), groupAccess);
+	Result result = writer->open();
+	if (result != R_OK)
+	{
+		delete writer;
+		return result;
+	}
+
+	mRingWriter = writer;
+
+	// Claims and releases of windows wake up waitForEvents
+	if (mWaitFd >= 0 && mRingWriter->getFd() >= 0)
+	{
+		struct epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = mRingWriter->getFd();
+		epoll_ctl(mWaitFd, EPOLL_CTL_ADD, mRingWriter->getFd(), &event);
 	}
+
+	updatePublishedWindows();
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::stopPublishing()
+{
+	if (mRingWriter == nullptr)
+	{
+		return R_OK;
+	}
+
+	if (mWaitFd >= 0 && mRingWriter->getFd() >= 0)
+	{
+		epoll_ctl(mWaitFd, EPOLL_CTL_DEL, mRingWriter->getFd(), NULL);
+	}
+
+	delete mRingWriter;
+	mRingWriter = nullptr;
+
+	if (mRawEvents)
+	{
+		for (std::vector<Window>::const_iterator it = mPublishedWindows.begin(); it != mPublishedWindows.end(); ++it)
+		{
+			mRawEventRouter.removeWindow(*it);
+		}
+	}
+	mPublishedWindows.clear();
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerSystem::updatePublishedWindows()
+{
+	std::vector<Window> added;
+	std::vector<Window> removed;
+	mRingWriter->update(added, removed);
+	if (added.empty() && removed.empty())
+	{
+		return;
+	}
+
+	for (std::vector<Window>::const_iterator it = removed.begin(); it != removed.end(); ++it)
+	{
+		// The selection stays until the window is destroyed, its events are no longer published
+		std::vector<Window>::iterator window = std::find(mPublishedWindows.begin(), mPublishedWindows.end(), *it);
+		if (window != mPublishedWindows.end())
+		{
+			if (mRawEvents)
+			{
+				mRawEventRouter.removeWindow(*it);
+			}
+			mPublishedWindows.erase(window);
+			LOG_INFO(mLogger, "Stopped publishing the events of window %lu", *it);
+		}
+	}
+
+	if (mRawEvents)
+	{
+		for (std::vector<Window>::const_iterator it = added.begin(); it != added.end(); ++it)
+		{
+			mRawEventRouter.addWindow(*it);
+			mPublishedWindows.push_back(*it);
+			LOG_INFO(mLogger, "Publishing the events of window %lu", *it);
+		}
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock;
+	EventSource* source = lockEventSource(lock);
+	for (std::vector<Window>::const_iterator it = added.begin(); it != added.end(); ++it)
+	{
+		if (source->selectEvents(*it, mDeviceIds.data(), mDeviceIds.size()) == R_OK)
+		{
+			mPublishedWindows.push_back(*it);
+			LOG_INFO(mLogger, "Publishing the events of window %lu", *it);
+		}
+	}
+	unlockEventSource(lock);
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::startRecording(const char* path)
+{
+	if (path == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	stopRecording();
+
+	std::vector<RecordedDevice> devices;
+	if (mDisplay != NULL)
+	{
+		int numDevices;
+		XIDeviceInfo* deviceInfos = XIQueryDevice(mDisplay, XIAllDevices, &numDevices);
+		for (int i = 0; i < numDevices; i++)
+		{
+			const XIDeviceInfo& deviceInfo = deviceInfos[i];
+			if (!std::binary_search(mDeviceIds.begin(), mDeviceIds.end(), deviceInfo.deviceid))
+			{
+				continue;
+			}
+
+			RecordedDevice device;
+			memset(&device, 0, sizeof(device));
+			device.deviceId = deviceInfo.deviceid;
+			device.use = deviceInfo.use;
+			device.axesMask = mDeviceAxes.getAxesMask(deviceInfo.deviceid);
+			strncpy(device.name, deviceInfo.name, RECORDING_DEVICE_NAME_LENGTH - 1);
+			devices.push_back(device);
+		}
+		XIFreeDeviceInfo(deviceInfos);
+	}
+
+	EventRecorder* recorder = new EventRecorder();
+	Result result = recorder->open(path, devices.data(), devices.size());
+	if (result != R_OK)
+	{
+		LOG_ERROR(mLogger, "Failed to create recording '%s'", path);
+		delete recorder;
+		return result;
+	}
+
+	mRecorder = recorder;
+
+	LOG_INFO(mLogger, "Recording events of %d devices to '%s'", (int)devices.size(), path);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::stopRecording()
+{
+	if (mRecorder == nullptr)
+	{
+		return R_OK;
+	}
+
+	unsigned long long numRecords = mRecorder->getNumRecords();
+	Result result = mRecorder->close();
+	delete mRecorder;
+	mRecorder = nullptr;
+
+	if (result != R_OK)
+	{
+		LOG_ERROR(mLogger, "Failed to finish recording");
+		return result;
+	}
+
+	LOG_INFO(mLogger, "Recorded %llu events", numRecords);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::startReplay(const char* path, ReplayMode mode, Window window)
+{
+	if (path == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	stopReplay();
+
+	EventReplay* replay = new EventReplay();
+	Result result = replay->open(path);
+	if (result != R_OK)
+	{
+		LOG_ERROR(mLogger, "Failed to open recording '%s'", path);
+		delete replay;
+		return result;
+	}
+
+	replay->start(getMonotonicTime(), window);
+	mReplay = replay;
+	mReplayMode = mode;
+	mReplayEvents.resize(REPLAY_BATCH_SIZE);
+
+	LOG_INFO(mLogger, "Replaying %llu events of %d devices from '%s'",
+		(unsigned long long)replay->getNumRecords(), replay->getNumDevices(), path);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::stopReplay()
+{
+	if (mReplay != nullptr)
+	{
+		delete mReplay;
+		mReplay = nullptr;
+	}
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::getWindowsOfProcess(unsigned long pid, Window** windows, uint* numWindows)
+{
+	if (windows == NULL)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	if (!mEventSourceSharesDisplay)
+	{
+		processWindowEvents();
+	}
+
+	std::vector<Window> result;
+	mWindowCache.getWindowsOfProcess(pid, result);
+
+	*numWindows = result.size();
+
+	// Copy the data to an array
+	*windows = new Window[result.size()];
+	std::copy(result.begin(), result.end(), *windows);
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result PointerHandlerSystem::freeWindowsOfProcess(Window* windows)
+{
+	if (windows == NULL)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	delete[] windows;
+
+	return R_OK;
 }
\ No newline at end of file
@@ -3,46 +3,164 @@
 */
 #pragma once
 
-#include <map>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 
 #include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowDeviceAxes.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+#include "X11TouchMultiWindowLatency.h"
+#include "X11TouchMultiWindowPointerHandlerTable.h"
+#include "X11TouchMultiWindowRawEvents.h"
+#include "X11TouchMultiWindowWindowCache.h"
 
+class EventRecorder;
+class EventReplay;
+class EventSource;
+class Logger;
+class ReaderThread;
+class SharedRingWriter;
+
+/// @brief Reads the pointer input of a single X display. Systems are independent of each other, each owns its
+/// connections, devices and handlers, so the systems of different displays can be drained from separate threads.
 class EXPORT_API PointerHandlerSystem
 {
-	typedef std::map<Window, PointerHandler*> PointerHandlerMap;
-	typedef PointerHandlerMap::iterator PointerHandlerMapIterator;
-	typedef PointerHandlerMap::const_iterator ConstPointerHandlerMapIterator;
-
 private:
-	static PointerHandlerSystem* msInstance;
-
+	// Empty for the DISPLAY environment variable
+	std::string mDisplayName;
 	Display* mDisplay;
 	int mOpcode;
-	MessageCallback mMessageCallback;
+	Logger* mLogger;
+	SystemSettings mSettings;
+	// Sorted ids of the pointer devices events are selected for
 	std::vector<int> mDeviceIds;
-	PointerHandlerMap mPointerHandlers;
+	// In threaded mode, the reader thread decodes with this table while holding its source mutex
+	DeviceAxesTable mDeviceAxes;
+	PointerHandlerTable mPointerHandlers;
+	ServerClock mServerClock;
+	WindowCache mWindowCache;
+	// Windows unmapped or destroyed during the current drain cycle
+	std::vector<Window> mHiddenWindows;
+	// Only used if raw events are selected on the root window, instead of the events of every window
+	RawEventRouter mRawEventRouter;
+	bool mRawEvents;
+
+	// Events are selected on and read from this source in the main thread, unless in threaded mode
+	EventSource* mEventSource;
+	// Whether the window cache notifications on mDisplay are read by the event source
+	bool mEventSourceSharesDisplay;
+	// Only set in threaded mode, it then owns the source events are selected on and read from
+	ReaderThread* mReaderThread;
+
+	// Only set while publishing events for the processes reading the display through the broker
+	SharedRingWriter* mRingWriter;
+	// Windows claimed by those processes, events are selected for them instead of for handlers
+	std::vector<Window> mPublishedWindows;
+
+	// Readable once events arrive on any of the connections, or the reader thread queued events
+	int mWaitFd;
+	// Interrupts waitForEvents from other threads
+	int mWakeFd;
+	// Set by the first call to getFd or waitForEvents, the descriptors are only reset from then on
+	bool mWaitEnabled;
+
+	EventRecorder* mRecorder;
+	EventReplay* mReplay;
+	ReplayMode mReplayMode;
+	std::vector<DeviceEvent> mReplayEvents;
 
 public:
-	PointerHandlerSystem(MessageCallback messageCallback);
+	/// @param displayName Display to connect to, like ":0.1" or "host:1", NULL for the DISPLAY environment variable
+	PointerHandlerSystem(MessageCallback messageCallback, const SystemSettings& settings,
+		const char* displayName = NULL);
 	~PointerHandlerSystem();
 
-	static PointerHandlerSystem* getInstance() { return msInstance; }
+	Logger* getLogger() const { return mLogger; }
 
 	Result initialize();
 	Result uninitialize();
 
-	Result createHandler(int targetDisplay, Window window, PointerCallback pointerCallback, void** handle);
-	PointerHandler* getHandler(Window window) const;
+	Result createHandler(int targetDisplay, Window window, PointerCallback pointerCallback, HandlerHandle* handle);
+	/// @brief Adds a handler without selecting any events for its window, so it only receives the
+	/// events passed to processEvents.
+	Result addHandler(PointerHandler&& handler, HandlerHandle* handle);
+	PointerHandler* getHandler(Window window) { return mPointerHandlers.find(window); }
+	PointerHandler* getHandler(HandlerHandle handle) { return mPointerHandlers.get(handle); }
 	const int getNumHandlers() const { return mPointerHandlers.size(); }
-	Result destroyHandler(PointerHandler* handler);
+	Result destroyHandler(HandlerHandle handle);
+
+	/// @brief Returns a descriptor that polls readable when processEventQueue has events to process, to
+	/// integrate the system into an external event loop.
+	Result getFd(int* fd);
+	/// @brief Blocks until events are available to processEventQueue, wake is called or the timeout passed.
+	/// @param timeoutMs Timeout in milliseconds, -1 waits indefinitely and 0 only checks
+	/// @param ready Set to whether processEventQueue has events to process, false if woken up or timed out
+	Result waitForEvents(int timeoutMs, bool* ready);
+	/// @brief Interrupts waitForEvents, may be called from any thread.
+	Result wake();
 
-	Result processEventQueue();
+	/// @param frameTime CLOCK_MONOTONIC time in nanoseconds handlers with resampling enabled resample their
+	/// pointers to, 0 to not resample
+	Result processEventQueue(uint64_t frameTime = 0);
+	/// @brief Runs a drain cycle over already decoded events instead of the events read from the display
+	/// connection. Used to replay recorded events and by the benchmarks, which don't need an X server.
+	Result processEvents(DeviceEvent* events, size_t numEvents, uint64_t frameTime = 0);
+	/// @param replayed Set for the events of a recording, whose server times are from another session and
+	/// don't update the server clock
+	void dispatchEvent(DeviceEvent& event, bool replayed = false);
+
+	const ServerClock& getServerClock() const { return mServerClock; }
+
+	/// @brief Publishes the events of the windows claimed by the processes reading the display through the
+	/// broker to the shared ring of the display, instead of dispatching them to handlers. Used by the broker.
+	/// @param groupAccess Lets processes of other users in the group of the broker read the display, otherwise
+	/// only processes of the same user can
+	Result startPublishing(bool groupAccess = false);
+	Result stopPublishing();
+	bool isPublishing() const { return mRingWriter != nullptr; }
+
+	/// @brief Writes all dispatched pointer events to a recording file until stopRecording is called.
+	Result startRecording(const char* path);
+	Result stopRecording();
+	/// @brief Dispatches the events of a recording in addition to the events read from the display
+	/// connection, until the recording ends or stopReplay is called.
+	/// @param window Window to deliver all events to, None keeps the recorded windows
+	Result startReplay(const char* path, ReplayMode mode, Window window);
+	Result stopReplay();
+	bool isReplaying() const { return mReplay != nullptr; }
 
 	Result getWindowsOfProcess(unsigned long  pid, Window** windows, uint* numWindows);
 	Result freeWindowsOfProcess(Window* windows);
 private:
-	void getWindowsOfProcess(Window window, unsigned long pid, Atom atomPID, std::vector<Window>& windows);
+	/// @brief Reads events from the shared ring of the broker of the display instead of a connection.
+	Result connectBroker(const char* displayName);
+	Result initializeWait();
+	void enableWait();
+	bool hasPendingEvents();
+
+	void beginEvents();
+	void flushEvents(uint64_t frameTime);
+	void replayEvents();
+	void processWindowEvents();
+	/// @brief Cancels the touches of the handlers whose windows were unmapped or destroyed.
+	void cancelHiddenWindows();
+	void updatePublishedWindows();
+
+	/// @brief Returns the source events are selected on and read from, locked in threaded mode.
+	EventSource* lockEventSource(std::unique_lock<std::mutex>& lock);
+	void unlockEventSource(std::unique_lock<std::mutex>& lock);
+
+	Result selectDeviceChangeEvents();
+	/// @brief Selects raw events on the root window, from then on windows are added to the router instead
+	/// of selecting their events.
+	Result selectRawEvents();
+
+	void processDeviceChange(const DeviceEvent& event);
+	/// @brief Queries a single device and updates its axes, events are selected for all handlers if
+	/// the device was not known yet.
+	void updateDevice(int deviceId);
+	void removeDevice(int deviceId);
 };
\ No newline at end of file
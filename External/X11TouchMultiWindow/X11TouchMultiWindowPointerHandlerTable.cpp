@@ -0,0 +1,134 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+
+#include "X11TouchMultiWindowPointerHandlerTable.h"
+
+// ----------------------------------------------------------------------------
+PointerHandlerTable::PointerHandlerTable()
+	: mNumHandlers(0)
+	, mLastWindow(None)
+	, mLastIndex(-1)
+	, mIterating(0)
+{
+
+}
+// ----------------------------------------------------------------------------
+PointerHandler* PointerHandlerTable::add(PointerHandler&& handler, HandlerHandle* handle)
+{
+	Window window = handler.getWindow();
+	if (window == None || findRoute(window) >= 0)
+	{
+		return nullptr;
+	}
+
+	// Free slots are not reused during forEach, which could visit them before the next handler
+	int index = -1;
+	for (int i = 0; i < (int)mSlots.size() && mIterating == 0; i++)
+	{
+		if (!mSlots[i].used)
+		{
+			index = i;
+			break;
+		}
+	}
+
+	if (index < 0)
+	{
+		if (mSlots.size() >= 0xFFFF)
+		{
+			return nullptr;
+		}
+
+		index = mSlots.size();
+		Slot slot = { nullptr, 1, false };
+		mSlots.push_back(std::move(slot));
+	}
+
+	mSlots[index].handler.reset(new PointerHandler(std::move(handler)));
+	mSlots[index].used = true;
+
+	Route route = { window, index };
+	std::vector<Route>::iterator it = std::lower_bound(mRoutes.begin(), mRoutes.end(), route,
+		[](const Route& a, const Route& b) { return a.window < b.window; });
+	mRoutes.insert(it, route);
+	mNumHandlers++;
+
+	*handle = ((HandlerHandle)mSlots[index].generation << 16) | (HandlerHandle)(index + 1);
+	return mSlots[index].handler.get();
+}
+// ----------------------------------------------------------------------------
+bool PointerHandlerTable::remove(HandlerHandle handle)
+{
+	PointerHandler* handler = get(handle);
+	if (handler == nullptr)
+	{
+		return false;
+	}
+
+	int index = (int)(handle & 0xFFFF) - 1;
+	Slot& slot = mSlots[index];
+	slot.used = false;
+	// Generation 0 is skipped so handle 0 is never valid
+	slot.generation = slot.generation == 0xFFFF ? 1 : slot.generation + 1;
+
+	mRoutes.erase(mRoutes.begin() + findRoute(handler->getWindow()));
+	mNumHandlers--;
+
+	// A handler removed by its own pointer callback is still flushing its events
+	if (mIterating > 0)
+	{
+		mRemovedHandlers.push_back(std::move(slot.handler));
+	}
+	slot.handler.reset();
+
+	mLastWindow = None;
+	mLastIndex = -1;
+
+	return true;
+}
+// ----------------------------------------------------------------------------
+void PointerHandlerTable::clear()
+{
+	for (std::vector<Slot>::iterator it = mSlots.begin(); it != mSlots.end() && mIterating > 0; ++it)
+	{
+		if (it->used)
+		{
+			mRemovedHandlers.push_back(std::move(it->handler));
+		}
+	}
+
+	mSlots.clear();
+	mRoutes.clear();
+	mNumHandlers = 0;
+
+	mLastWindow = None;
+	mLastIndex = -1;
+}
+// ----------------------------------------------------------------------------
+int PointerHandlerTable::findRoute(Window window) const
+{
+	// Few windows are expected, a binary search over a contiguous array beats chasing tree nodes
+	int low = 0;
+	int high = (int)mRoutes.size() - 1;
+	while (low <= high)
+	{
+		int mid = (low + high) >> 1;
+		Window midWindow = mRoutes[mid].window;
+		if (midWindow < window)
+		{
+			low = mid + 1;
+		}
+		else if (midWindow > window)
+		{
+			high = mid - 1;
+		}
+		else
+		{
+			return mid;
+		}
+	}
+
+	return -1;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowPointerHandler.h"
+
+/// @brief Stores handlers in slots and routes windows to them through a sorted array with a last-hit
+/// cache. Handlers are referred to by generational handles, so a stale handle of a destroyed handler is
+/// never resolved to a handler that reused its slot.
+/// The pointer callbacks run inside forEach may create and destroy handlers. Handlers never move, handlers
+/// added during forEach get a new slot that is not visited until the next forEach, and handlers removed
+/// during forEach are only destroyed once it returns.
+class PointerHandlerTable
+{
+private:
+	struct Slot
+	{
+		std::unique_ptr<PointerHandler> handler;
+		unsigned short generation;
+		bool used;
+	};
+
+	struct Route
+	{
+		Window window;
+		int index;
+	};
+
+	std::vector<Slot> mSlots;
+	// Sorted by window
+	std::vector<Route> mRoutes;
+	int mNumHandlers;
+
+	Window mLastWindow;
+	int mLastIndex;
+
+	// Depth of the forEach calls in progress
+	int mIterating;
+	// Handlers removed during forEach
+	std::vector<std::unique_ptr<PointerHandler>> mRemovedHandlers;
+
+public:
+	PointerHandlerTable();
+
+	PointerHandler* add(PointerHandler&& handler, HandlerHandle* handle);
+	bool remove(HandlerHandle handle);
+	void clear();
+
+	PointerHandler* get(HandlerHandle handle)
+	{
+		int index = (int)(handle & 0xFFFF) - 1;
+		if (index < 0 || index >= (int)mSlots.size())
+		{
+			return nullptr;
+		}
+
+		Slot& slot = mSlots[index];
+		return slot.used && slot.generation == (handle >> 16) ? slot.handler.get() : nullptr;
+	}
+
+	PointerHandler* find(Window window)
+	{
+		if (window == mLastWindow && mLastIndex >= 0)
+		{
+			return mSlots[mLastIndex].handler.get();
+		}
+
+		int index = findRoute(window);
+		if (index < 0)
+		{
+			return nullptr;
+		}
+
+		mLastWindow = window;
+		mLastIndex = mRoutes[index].index;
+		return mSlots[mLastIndex].handler.get();
+	}
+
+	int size() const { return mNumHandlers; }
+
+	template<typename F>
+	void forEach(F f)
+	{
+		// Indexed, the slots may be reallocated by handlers added from f, or cleared
+		mIterating++;
+		int end = (int)mSlots.size();
+		for (int i = 0; i < end && i < (int)mSlots.size(); i++)
+		{
+			if (mSlots[i].used)
+			{
+				f(*mSlots[i].handler);
+			}
+		}
+
+		if (--mIterating == 0)
+		{
+			mRemovedHandlers.clear();
+		}
+	}
+
+private:
+	int findRoute(Window window) const;
+};
\ No newline at end of file
@@ -0,0 +1,184 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cmath>
+
+#include "X11TouchMultiWindowPrediction.h"
+
+// Tracks without samples for this long are reused, which releases the tracks of touches that never
+// reported their end, in milliseconds
+#define PREDICTION_STALE_TIME 1000
+// Normal equations with a smaller determinant are considered singular. Times are normalized to the
+// window, so three samples about 2 ms apart are still fitted with a quadratic
+#define QUADRATIC_MIN_DETERMINANT 1e-8
+#define LINEAR_MIN_DETERMINANT 1e-12
+
+// ----------------------------------------------------------------------------
+PointerPredictor::PointerPredictor()
+	: mHorizon(0.0f)
+{
+
+}
+// ----------------------------------------------------------------------------
+void PointerPredictor::setHorizon(float horizon)
+{
+	mHorizon = std::max(0.0f, std::min(horizon, PREDICTION_MAX_HORIZON)) / 1000.0f;
+}
+// ----------------------------------------------------------------------------
+void PointerPredictor::reset()
+{
+	mTracks.clear();
+}
+// ----------------------------------------------------------------------------
+void PointerPredictor::update(PointerType type, int id, PointerEvent event, Time time, const Vector2& position,
+	PointerData* data)
+{
+	// Server times are 32 bit, differences are taken modulo 2^32
+	uint32_t sampleTime = (uint32_t)time;
+
+	PredictionTrack* track = getTrack(type, id, sampleTime);
+	if (event == PE_DOWN && type == PT_TOUCH)
+	{
+		track->numSamples = 0;
+	}
+	else if (track->numSamples > 0 && (int32_t)(sampleTime - track->times[track->latest]) < 0)
+	{
+		// Samples going back in time, like a replay restarting, are not fitted with the earlier ones
+		track->numSamples = 0;
+	}
+
+	if (track->numSamples > 0 && track->times[track->latest] == sampleTime)
+	{
+		// Multiple samples within a millisecond would make the fit singular, keep the latest position
+		track->positions[track->latest] = position;
+	}
+	else
+	{
+		track->latest = (track->latest + 1) % PREDICTION_MAX_SAMPLES;
+		track->times[track->latest] = sampleTime;
+		track->positions[track->latest] = position;
+		track->numSamples = std::min(track->numSamples + 1, PREDICTION_MAX_SAMPLES);
+	}
+
+	Vector2 velocity;
+	Vector2 acceleration;
+	fit(*track, &velocity, &acceleration);
+
+	float halfHorizonSquared = 0.5f * mHorizon * mHorizon;
+	data->velocity = velocity;
+	data->predictedPosition = Vector2(
+		position.x + velocity.x * mHorizon + acceleration.x * halfHorizonSquared,
+		position.y + velocity.y * mHorizon + acceleration.y * halfHorizonSquared);
+	data->mask = (TouchMask)(data->mask | TM_PREDICTION);
+
+	if (event == PE_UP && type == PT_TOUCH)
+	{
+		track->used = false;
+	}
+}
+// ----------------------------------------------------------------------------
+PredictionTrack* PointerPredictor::getTrack(PointerType type, int id, uint32_t time)
+{
+	PredictionTrack* freeTrack = nullptr;
+	for (std::vector<PredictionTrack>::iterator it = mTracks.begin(); it != mTracks.end(); ++it)
+	{
+		if (it->used && it->type == type && it->id == id)
+		{
+			return &(*it);
+		}
+
+		if (freeTrack == nullptr && (!it->used || time - it->times[it->latest] > PREDICTION_STALE_TIME))
+		{
+			freeTrack = &(*it);
+		}
+	}
+
+	if (freeTrack == nullptr)
+	{
+		mTracks.push_back(PredictionTrack());
+		freeTrack = &mTracks.back();
+	}
+
+	freeTrack->type = type;
+	freeTrack->id = id;
+	freeTrack->used = true;
+	freeTrack->numSamples = 0;
+	freeTrack->latest = 0;
+
+	return freeTrack;
+}
+// ----------------------------------------------------------------------------
+void PointerPredictor::fit(const PredictionTrack& track, Vector2* velocity, Vector2* acceleration) const
+{
+	// Sums of the normal equations of p(t) = c0 + c1 * t + c2 * t^2, with t the age of a sample relative to
+	// the latest one, normalized to [-1, 0] over the window to keep the equations well conditioned
+	double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0;
+	double bx0 = 0.0, bx1 = 0.0, bx2 = 0.0;
+	double by0 = 0.0, by1 = 0.0, by2 = 0.0;
+
+	uint32_t latestTime = track.times[track.latest];
+	for (int i = 0; i < track.numSamples; i++)
+	{
+		int index = (track.latest - i + PREDICTION_MAX_SAMPLES) % PREDICTION_MAX_SAMPLES;
+		uint32_t age = latestTime - track.times[index];
+		if (age > PREDICTION_WINDOW)
+		{
+			break;
+		}
+
+		double t = -(double)age / PREDICTION_WINDOW;
+		double t2 = t * t;
+		const Vector2& position = track.positions[index];
+
+		s0 += 1.0;
+		s1 += t;
+		s2 += t2;
+		s3 += t2 * t;
+		s4 += t2 * t2;
+		bx0 += position.x;
+		bx1 += t * position.x;
+		bx2 += t2 * position.x;
+		by0 += position.y;
+		by1 += t * position.y;
+		by2 += t2 * position.y;
+	}
+
+	*velocity = Vector2();
+	*acceleration = Vector2();
+
+	// Coefficients per normalized time unit to units per second
+	const double timeScale = 1000.0 / PREDICTION_WINDOW;
+
+	if (s0 >= 3.0)
+	{
+		double determinant = s0 * (s2 * s4 - s3 * s3) - s1 * (s1 * s4 - s3 * s2) + s2 * (s1 * s3 - s2 * s2);
+		if (std::fabs(determinant) > QUADRATIC_MIN_DETERMINANT)
+		{
+			// Cramer's rule for c1 and c2
+			double cx1 = s0 * (bx1 * s4 - s3 * bx2) - bx0 * (s1 * s4 - s3 * s2) + s2 * (s1 * bx2 - bx1 * s2);
+			double cx2 = s0 * (s2 * bx2 - bx1 * s3) - s1 * (s1 * bx2 - bx1 * s2) + bx0 * (s1 * s3 - s2 * s2);
+			double cy1 = s0 * (by1 * s4 - s3 * by2) - by0 * (s1 * s4 - s3 * s2) + s2 * (s1 * by2 - by1 * s2);
+			double cy2 = s0 * (s2 * by2 - by1 * s3) - s1 * (s1 * by2 - by1 * s2) + by0 * (s1 * s3 - s2 * s2);
+
+			*velocity = Vector2(
+				(float)(cx1 / determinant * timeScale),
+				(float)(cy1 / determinant * timeScale));
+			*acceleration = Vector2(
+				(float)(2.0 * cx2 / determinant * timeScale * timeScale),
+				(float)(2.0 * cy2 / determinant * timeScale * timeScale));
+			return;
+		}
+	}
+
+	if (s0 >= 2.0)
+	{
+		double determinant = s0 * s2 - s1 * s1;
+		if (determinant > LINEAR_MIN_DETERMINANT)
+		{
+			*velocity = Vector2(
+				(float)((s0 * bx1 - s1 * bx0) / determinant * timeScale),
+				(float)((s0 * by1 - s1 * by0) / determinant * timeScale));
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+
+// Samples a velocity is fitted over, older samples are dropped
+#define PREDICTION_MAX_SAMPLES 8
+// Samples older than this relative to the latest sample are not fitted, in milliseconds
+#define PREDICTION_WINDOW 64
+// Predictions further ahead are clamped, in milliseconds
+#define PREDICTION_MAX_HORIZON 100.0f
+
+/// @brief Recent samples of a single pointer, in a ring buffer.
+struct PredictionTrack
+{
+	PointerType type;
+	int id;
+	bool used;
+	int numSamples;
+	/// Index of the latest sample
+	int latest;
+	/// X server times in milliseconds
+	uint32_t times[PREDICTION_MAX_SAMPLES];
+	Vector2 positions[PREDICTION_MAX_SAMPLES];
+};
+
+/// @brief Estimates the velocity and acceleration of pointers with a least-squares fit of a quadratic over
+/// their recent samples, and extrapolates their position a fixed time ahead with it.
+class PointerPredictor
+{
+private:
+	std::vector<PredictionTrack> mTracks;
+	// In seconds
+	float mHorizon;
+
+public:
+	PointerPredictor();
+
+	/// @param horizon Time to predict ahead in milliseconds, 0 only estimates the velocity
+	void setHorizon(float horizon);
+	float getHorizon() const { return mHorizon * 1000.0f; }
+	void reset();
+
+	/// @brief Adds a sample of a pointer and sets the velocity and predicted position of its data. A touch
+	/// starts a new track when it goes down and releases it when it goes up.
+	/// @param time X server time of the sample in milliseconds
+	void update(PointerType type, int id, PointerEvent event, Time time, const Vector2& position,
+		PointerData* data);
+
+private:
+	PredictionTrack* getTrack(PointerType type, int id, uint32_t time);
+	void fit(const PredictionTrack& track, Vector2* velocity, Vector2* acceleration) const;
+};
\ No newline at end of file
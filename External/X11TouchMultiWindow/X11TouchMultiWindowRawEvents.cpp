@@ -0,0 +1,328 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <X11/Xatom.h>
+#include <X11/extensions/XInput2.h>
+
+#include "X11TouchMultiWindowRawEvents.h"
+#include "X11TouchMultiWindowLogger.h"
+#include "X11TouchMultiWindowWindowCache.h"
+
+// Raw events of devices with a higher id are dropped
+#define RAW_MAX_DEVICES 256
+
+static const float IDENTITY_MATRIX[9] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+// ----------------------------------------------------------------------------
+RawEventRouter::RawEventRouter()
+	: mDisplay(NULL)
+	, mWindowCache(nullptr)
+	, mLogger(nullptr)
+	, mAtomMatrix(None)
+	, mAtomFloat(None)
+{
+
+}
+// ----------------------------------------------------------------------------
+void RawEventRouter::initialize(Display* display, WindowCache* windowCache, Logger* logger)
+{
+	mDisplay = display;
+	mWindowCache = windowCache;
+	mLogger = logger;
+	// Created by the input drivers, devices without the property are not transformed
+	mAtomMatrix = XInternAtom(display, "Coordinate Transformation Matrix", True);
+	mAtomFloat = XInternAtom(display, "FLOAT", True);
+}
+// ----------------------------------------------------------------------------
+RawDevice& RawEventRouter::getDevice(int deviceId)
+{
+	if (deviceId >= (int)mDevices.size())
+	{
+		RawDevice device;
+		memcpy(device.matrix, IDENTITY_MATRIX, sizeof(IDENTITY_MATRIX));
+		device.x = 0.0;
+		device.y = 0.0;
+		device.positioned = false;
+		device.buttons = 0;
+		device.grabWindow = None;
+		mDevices.resize(deviceId + 1, device);
+	}
+
+	return mDevices[deviceId];
+}
+// ----------------------------------------------------------------------------
+void RawEventRouter::updateDevice(int deviceId)
+{
+	if (deviceId < 0 || deviceId >= RAW_MAX_DEVICES)
+	{
+		return;
+	}
+
+	RawDevice& device = getDevice(deviceId);
+	memcpy(device.matrix, IDENTITY_MATRIX, sizeof(IDENTITY_MATRIX));
+
+	if (mAtomMatrix == None || mAtomFloat == None)
+	{
+		return;
+	}
+
+	Atom type;
+	int format;
+	unsigned long numItems, bytesAfter;
+	unsigned char* data = NULL;
+	if (XIGetProperty(mDisplay, deviceId, mAtomMatrix, 0, 9, False, mAtomFloat, &type, &format, &numItems,
+		&bytesAfter, &data) != Success)
+	{
+		return;
+	}
+
+	// Unlike window properties, items of format 32 are returned as 32 bits each
+	if (type == mAtomFloat && format == 32 && numItems == 9)
+	{
+		memcpy(device.matrix, data, sizeof(device.matrix));
+		LOG_DEBUG(mLogger, "Device %d transformed by [%g %g %g; %g %g %g; %g %g %g]", deviceId,
+			device.matrix[0], device.matrix[1], device.matrix[2], device.matrix[3], device.matrix[4],
+			device.matrix[5], device.matrix[6], device.matrix[7], device.matrix[8]);
+	}
+
+	if (data != NULL)
+	{
+		XFree(data);
+	}
+}
+// ----------------------------------------------------------------------------
+void RawEventRouter::removeDevice(int deviceId)
+{
+	if (deviceId >= 0 && deviceId < (int)mDevices.size())
+	{
+		mDevices[deviceId].positioned = false;
+		mDevices[deviceId].buttons = 0;
+		mDevices[deviceId].grabWindow = None;
+	}
+
+	mTouches.erase(std::remove_if(mTouches.begin(), mTouches.end(),
+		[deviceId](const RawTouch& touch) { return touch.sourceId == deviceId; }), mTouches.end());
+}
+// ----------------------------------------------------------------------------
+void RawEventRouter::addWindow(Window window)
+{
+	mWindowCache->trackGeometry(window);
+}
+// ----------------------------------------------------------------------------
+void RawEventRouter::removeWindow(Window window)
+{
+	mWindowCache->untrackGeometry(window);
+
+	mTouches.erase(std::remove_if(mTouches.begin(), mTouches.end(),
+		[window](const RawTouch& touch) { return touch.window == window; }), mTouches.end());
+
+	for (std::vector<RawDevice>::iterator it = mDevices.begin(); it != mDevices.end(); ++it)
+	{
+		if (it->grabWindow == window)
+		{
+			it->grabWindow = None;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+bool RawEventRouter::route(DeviceEvent& event)
+{
+	// The events of a master device repeat those of its slaves, and emulated pointer events repeat touches
+	if (event.deviceId != event.sourceId || (event.flags & XIPointerEmulated) ||
+		event.sourceId < 0 || event.sourceId >= RAW_MAX_DEVICES)
+	{
+		return false;
+	}
+
+	switch (event.type)
+	{
+		case XI_RawTouchBegin:
+		case XI_RawTouchUpdate:
+		case XI_RawTouchEnd:
+			return routeTouch(event);
+		case XI_RawMotion:
+		case XI_RawButtonPress:
+		case XI_RawButtonRelease:
+			return routePointer(event);
+		default:
+			return false;
+	}
+}
+// ----------------------------------------------------------------------------
+bool RawEventRouter::routeTouch(DeviceEvent& event)
+{
+	// Touches of touchpads follow the pointer, which their raw events don't report
+	if (event.flags & DEVICE_EVENT_RELATIVE)
+	{
+		return false;
+	}
+
+	RawDevice& device = getDevice(event.sourceId);
+	std::vector<RawTouch>::iterator touch = mTouches.begin();
+	while (touch != mTouches.end() && (touch->sourceId != event.sourceId || touch->id != event.detail))
+	{
+		++touch;
+	}
+
+	// Valuators that didn't change may be left out of the event
+	double x = !std::isnan(event.x) ? event.x : touch != mTouches.end() ? touch->x : device.x;
+	double y = !std::isnan(event.y) ? event.y : touch != mTouches.end() ? touch->y : device.y;
+	device.x = x;
+	device.y = y;
+
+	double rootX, rootY;
+	toRoot(device, x, y, &rootX, &rootY);
+
+	if (event.type == XI_RawTouchBegin)
+	{
+		// The end of a previous touch with the same id was lost
+		if (touch != mTouches.end())
+		{
+			mTouches.erase(touch);
+		}
+
+		Window window = mWindowCache->findWindow(rootX, rootY);
+		if (window == None)
+		{
+			return false;
+		}
+
+		RawTouch newTouch;
+		newTouch.sourceId = event.sourceId;
+		newTouch.id = event.detail;
+		newTouch.window = window;
+		newTouch.x = x;
+		newTouch.y = y;
+		mTouches.push_back(newTouch);
+
+		event.type = XI_TouchBegin;
+		return toWindow(window, rootX, rootY, event);
+	}
+
+	// Touches that began outside of the windows are not routed
+	if (touch == mTouches.end())
+	{
+		return false;
+	}
+
+	Window window = touch->window;
+	if (event.type == XI_RawTouchEnd)
+	{
+		mTouches.erase(touch);
+		event.type = XI_TouchEnd;
+	}
+	else
+	{
+		touch->x = x;
+		touch->y = y;
+		event.type = XI_TouchUpdate;
+	}
+
+	return toWindow(window, rootX, rootY, event);
+}
+// ----------------------------------------------------------------------------
+bool RawEventRouter::routePointer(DeviceEvent& event)
+{
+	RawDevice& device = getDevice(event.sourceId);
+
+	double rootX, rootY;
+	if (event.flags & DEVICE_EVENT_RELATIVE)
+	{
+		// The motion is accelerated like the pointer, but the pointer may be warped or held back at the edges of
+		// the outputs. A press is where it matters most, so the position is synchronized on every press.
+		if (!device.positioned || event.type == XI_RawButtonPress)
+		{
+			Window root, child;
+			int pointerX, pointerY, windowX, windowY;
+			unsigned int mask;
+			if (XQueryPointer(mDisplay, XDefaultRootWindow(mDisplay), &root, &child, &pointerX, &pointerY,
+				&windowX, &windowY, &mask))
+			{
+				device.x = pointerX;
+				device.y = pointerY;
+				device.positioned = true;
+			}
+		}
+		else
+		{
+			device.x = std::min(std::max(device.x + (std::isnan(event.x) ? 0.0 : event.x), 0.0),
+				(double)(mWindowCache->getRootWidth() - 1));
+			device.y = std::min(std::max(device.y + (std::isnan(event.y) ? 0.0 : event.y), 0.0),
+				(double)(mWindowCache->getRootHeight() - 1));
+		}
+
+		rootX = device.x;
+		rootY = device.y;
+	}
+	else
+	{
+		device.x = !std::isnan(event.x) ? event.x : device.x;
+		device.y = !std::isnan(event.y) ? event.y : device.y;
+		toRoot(device, device.x, device.y, &rootX, &rootY);
+	}
+
+	// While a button is pressed the events go to the window it was pressed in, even if that is no window at all
+	Window window = device.buttons != 0 ? device.grabWindow : mWindowCache->findWindow(rootX, rootY);
+	unsigned int button = 1u << (event.detail & 31);
+	switch (event.type)
+	{
+		case XI_RawButtonPress:
+			if (device.buttons == 0)
+			{
+				device.grabWindow = window;
+			}
+			device.buttons |= button;
+			event.type = XI_ButtonPress;
+			break;
+		case XI_RawButtonRelease:
+			device.buttons &= ~button;
+			if (device.buttons == 0)
+			{
+				device.grabWindow = None;
+			}
+			event.type = XI_ButtonRelease;
+			break;
+		default:
+			event.type = XI_Motion;
+			break;
+	}
+
+	if (window == None)
+	{
+		return false;
+	}
+
+	return toWindow(window, rootX, rootY, event);
+}
+// ----------------------------------------------------------------------------
+void RawEventRouter::toRoot(const RawDevice& device, double x, double y, double* rootX, double* rootY) const
+{
+	const float* m = device.matrix;
+	double w = m[6] * x + m[7] * y + m[8];
+	if (w == 0.0)
+	{
+		w = 1.0;
+	}
+
+	*rootX = (m[0] * x + m[1] * y + m[2]) / w * mWindowCache->getRootWidth();
+	*rootY = (m[3] * x + m[4] * y + m[5]) / w * mWindowCache->getRootHeight();
+}
+// ----------------------------------------------------------------------------
+bool RawEventRouter::toWindow(Window window, double rootX, double rootY, DeviceEvent& event)
+{
+	const WindowGeometry* geometry = mWindowCache->getGeometry(window);
+	if (geometry == nullptr || geometry->width == 0)
+	{
+		return false;
+	}
+
+	event.window = window;
+	event.x = rootX - geometry->x;
+	event.y = rootY - geometry->y;
+	event.flags &= ~DEVICE_EVENT_RELATIVE;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <vector>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+
+class Logger;
+class WindowCache;
+
+/// @brief State of a single source device whose raw events are routed.
+struct RawDevice
+{
+	/// Coordinate Transformation Matrix, maps the normalized position on the device to the normalized position
+	/// on the root window
+	float matrix[9];
+	/// Latest normalized position of an absolute device, or the position on the root window of a relative one
+	double x;
+	double y;
+	/// Set once the position of a relative device was queried
+	bool positioned;
+	/// Bit per pressed button
+	unsigned int buttons;
+	/// Window the first pressed button was pressed in, which receives the events until all are released
+	Window grabWindow;
+};
+
+/// @brief A touch that began in a routed window.
+struct RawTouch
+{
+	int sourceId;
+	int id;
+	Window window;
+	/// Latest normalized position on the device
+	double x;
+	double y;
+};
+
+/// @brief Routes the raw events selected once on the root window to the windows of the handlers. A touch or press
+/// goes to the topmost mapped window at its position, like the X server hit tests, so windows of other clients on
+/// top of a handler's window take the event; input shapes are not taken into account. Positions are mapped from the
+/// device to the root window with the Coordinate Transformation Matrix of the device, and from there to the window
+/// with the geometry cached by the WindowCache. A touch is routed to the window it began in until it ends, also
+/// while it is outside the window, and so are the events of a pointer while any of its buttons is pressed.
+/// Relative devices report motion instead of a position, their pointer is queried when it is first used and
+/// whenever a button is pressed, and moved by the motion in between.
+class RawEventRouter
+{
+private:
+	Display* mDisplay;
+	WindowCache* mWindowCache;
+	Logger* mLogger;
+	Atom mAtomMatrix;
+	Atom mAtomFloat;
+
+	// Indexed by source device id
+	std::vector<RawDevice> mDevices;
+	std::vector<RawTouch> mTouches;
+
+public:
+	RawEventRouter();
+
+	void initialize(Display* display, WindowCache* windowCache, Logger* logger);
+
+	/// @brief Reads the transformation matrix of a device. X errors of devices removed in the meantime are left to
+	/// the caller to trap.
+	void updateDevice(int deviceId);
+	/// @brief Forgets the touches and buttons of a removed device, their handlers cancel them.
+	void removeDevice(int deviceId);
+
+	/// @brief Starts routing events to a window, whose geometry is tracked from then on.
+	void addWindow(Window window);
+	/// @brief Stops routing events to a window, and forgets the touches that began in it.
+	void removeWindow(Window window);
+
+	/// @brief Turns a raw event into the event the window it is routed to would have received, with its position
+	/// relative to the window.
+	/// @return false if the event is not routed to any window and should be dropped
+	bool route(DeviceEvent& event);
+
+private:
+	RawDevice& getDevice(int deviceId);
+	bool routeTouch(DeviceEvent& event);
+	bool routePointer(DeviceEvent& event);
+
+	void toRoot(const RawDevice& device, double x, double y, double* rootX, double* rootY) const;
+	bool toWindow(Window window, double rootX, double rootY, DeviceEvent& event);
+};
\ No newline at end of file
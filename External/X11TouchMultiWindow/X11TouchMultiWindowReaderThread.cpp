@@ -0,0 +1,208 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "X11TouchMultiWindowEventSource.h"
+#include "X11TouchMultiWindowReaderThread.h"
+#include "X11TouchMultiWindowLogger.h"
+#include "X11TouchMultiWindowUtils.h"
+
+// Events decoded per read from the source
+#define READ_BATCH_SIZE 64
+
+// ----------------------------------------------------------------------------
+ReaderThread::ReaderThread(Logger* logger, EventSource* source, size_t queueCapacity)
+	: mSource(source)
+	, mLogger(logger)
+	, mRunning(false)
+	, mWakeFd(-1)
+	, mEventFd(-1)
+	, mSignalEvents(false)
+	, mQueue(queueCapacity)
+	, mNumDroppedEvents(0)
+{
+
+}
+// ----------------------------------------------------------------------------
+ReaderThread::~ReaderThread()
+{
+	stop();
+
+	delete mSource;
+}
+// ----------------------------------------------------------------------------
+Result ReaderThread::start(int priority, unsigned long long affinityMask)
+{
+	LOG_INFO(mLogger, "Starting reader thread...");
+
+	Result result = mSource->open();
+	if (result != R_OK)
+	{
+		return result;
+	}
+
+	mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	mEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (mWakeFd < 0 || mEventFd < 0)
+	{
+		LOG_ERROR(mLogger, "Failed to create wake up event: %s", strerror(errno));
+
+		stop();
+
+		return R_ERROR_API;
+	}
+
+	mRunning = true;
+	mThread = std::thread(&ReaderThread::run, this);
+
+	pthread_t nativeHandle = mThread.native_handle();
+	if (priority > 0)
+	{
+		sched_param param;
+		param.sched_priority = priority;
+		int r = pthread_setschedparam(nativeHandle, SCHED_FIFO, &param);
+		if (r != 0)
+		{
+			// Usually lacking CAP_SYS_NICE or an rtprio limit, the thread keeps running with default priority
+			LOG_WARNING(mLogger, "Failed to set reader thread priority to %d: %s", priority, strerror(r));
+		}
+	}
+
+	if (affinityMask != 0)
+	{
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		for (int cpu = 0; cpu < 64; cpu++)
+		{
+			if ((affinityMask >> cpu) & 1)
+			{
+				CPU_SET(cpu, &cpuSet);
+			}
+		}
+
+		int r = pthread_setaffinity_np(nativeHandle, sizeof(cpuSet), &cpuSet);
+		if (r != 0)
+		{
+			LOG_WARNING(mLogger, "Failed to set reader thread affinity: %s", strerror(r));
+		}
+	}
+
+	LOG_INFO(mLogger, "Reader thread started");
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void ReaderThread::stop()
+{
+	if (mThread.joinable())
+	{
+		mRunning = false;
+		wake();
+		mThread.join();
+	}
+
+	if (mWakeFd >= 0)
+	{
+		close(mWakeFd);
+		mWakeFd = -1;
+	}
+
+	if (mEventFd >= 0)
+	{
+		close(mEventFd);
+		mEventFd = -1;
+	}
+
+	mSource->close();
+}
+// ----------------------------------------------------------------------------
+void ReaderThread::wake()
+{
+	if (mWakeFd >= 0)
+	{
+		uint64_t value = 1;
+		ssize_t r = write(mWakeFd, &value, sizeof(value));
+		(void)r;
+	}
+}
+// ----------------------------------------------------------------------------
+void ReaderThread::resetEventFd()
+{
+	uint64_t value;
+	ssize_t r = read(mEventFd, &value, sizeof(value));
+	(void)r;
+}
+// ----------------------------------------------------------------------------
+void ReaderThread::run()
+{
+	struct pollfd fds[2];
+	fds[0].fd = mSource->getFd();
+	fds[0].events = POLLIN;
+	fds[1].fd = mWakeFd;
+	fds[1].events = POLLIN;
+
+	while (mRunning)
+	{
+		// Events may already be queued by the source, so drain before blocking on the connection
+		drainConnection();
+
+		fds[0].revents = 0;
+		fds[1].revents = 0;
+		if (poll(fds, 2, -1) < 0 && errno != EINTR)
+		{
+			break;
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			uint64_t value;
+			ssize_t r = read(mWakeFd, &value, sizeof(value));
+			(void)r;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void ReaderThread::drainConnection()
+{
+	std::lock_guard<std::mutex> lock(mSourceMutex);
+
+	// Device changes are queued as well, devices are updated by the main thread which needs the lock
+	// to do so
+	DeviceEvent events[READ_BATCH_SIZE];
+	size_t numEvents;
+	size_t numQueuedEvents = 0;
+	do
+	{
+		numEvents = mSource->read(events, READ_BATCH_SIZE);
+		for (size_t i = 0; i < numEvents; i++)
+		{
+			push(events[i]);
+		}
+		numQueuedEvents += numEvents;
+	} while (numEvents == READ_BATCH_SIZE);
+
+	if (numQueuedEvents > 0 && mSignalEvents)
+	{
+		uint64_t value = 1;
+		ssize_t r = write(mEventFd, &value, sizeof(value));
+		(void)r;
+	}
+}
+
+// ----------------------------------------------------------------------------
+void ReaderThread::push(const DeviceEvent& event)
+{
+	if (!mQueue.push(event))
+	{
+		mNumDroppedEvents++;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+#include "X11TouchMultiWindowEventQueue.h"
+
+class EventSource;
+class Logger;
+
+/// @brief Reads XInput2 events on a dedicated thread using its own display connection. Decoded events
+/// are stamped with their receive time and handed to the main thread through a lock-free queue.
+class ReaderThread
+{
+private:
+	// Owned, opened on start with a connection of its own
+	EventSource* mSource;
+	Logger* mLogger;
+
+	std::thread mThread;
+	std::atomic<bool> mRunning;
+	int mWakeFd;
+	// Signalled after events were queued, once enabled
+	int mEventFd;
+	std::atomic<bool> mSignalEvents;
+
+	// Guards all calls on the source, the reader only holds it while draining the connection
+	std::mutex mSourceMutex;
+
+	EventQueue<DeviceEvent> mQueue;
+	std::atomic<unsigned long> mNumDroppedEvents;
+
+public:
+	ReaderThread(Logger* logger, EventSource* source, size_t queueCapacity);
+	~ReaderThread();
+
+	Result start(int priority, unsigned long long affinityMask);
+	void stop();
+
+	EventSource* getSource() const { return mSource; }
+	std::mutex& getSourceMutex() { return mSourceMutex; }
+
+	/// @brief Wakes up the reader, which is required after other threads issued requests on the source
+	/// as it may have read pending events into its queue while doing so.
+	void wake();
+
+	/// @brief Returns an eventfd that becomes readable once events are queued, after signalling is enabled.
+	/// The consumer resets it with resetEventFd before popping the queue.
+	int getEventFd() const { return mEventFd; }
+	void enableEventSignal() { mSignalEvents = true; }
+	void resetEventFd();
+
+	bool pop(DeviceEvent& event) { return mQueue.pop(event); }
+	unsigned long takeNumDroppedEvents() { return mNumDroppedEvents.exchange(0); }
+
+private:
+	void run();
+	void drainConnection();
+	void push(const DeviceEvent& event);
+};
\ No newline at end of file
@@ -0,0 +1,290 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "X11TouchMultiWindowRecording.h"
+
+static_assert(sizeof(RecordingHeader) == 48, "RecordingHeader is part of the file format");
+static_assert(sizeof(RecordedDevice) == 80, "RecordedDevice is part of the file format");
+static_assert(sizeof(EventRecord) == 52, "EventRecord is part of the file format");
+
+// ----------------------------------------------------------------------------
+EventRecorder::EventRecorder()
+	: mFile(nullptr)
+	, mNumRecords(0)
+	, mLastReceiveTime(0)
+	, mLastServerTime(0)
+	, mStartReceiveTime(0)
+	, mStartServerTime(0)
+	, mStarted(false)
+{
+
+}
+// ----------------------------------------------------------------------------
+EventRecorder::~EventRecorder()
+{
+	close();
+}
+// ----------------------------------------------------------------------------
+Result EventRecorder::open(const char* path, const RecordedDevice* devices, int numDevices)
+{
+	if (path == nullptr || (devices == nullptr && numDevices > 0))
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	close();
+
+	mFile = fopen(path, "wb");
+	if (mFile == nullptr)
+	{
+		return R_ERROR_API;
+	}
+	setvbuf(mFile, mBuffer, _IOFBF, sizeof(mBuffer));
+
+	RecordingHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+	header.version = RECORDING_VERSION;
+	header.headerSize = sizeof(RecordingHeader) + numDevices * sizeof(RecordedDevice);
+	header.recordSize = sizeof(EventRecord);
+	header.numDevices = numDevices;
+
+	// The start times are written with the first record
+	if (fwrite(&header, sizeof(header), 1, mFile) != 1 ||
+		(numDevices > 0 && fwrite(devices, sizeof(RecordedDevice), numDevices, mFile) != (size_t)numDevices))
+	{
+		fclose(mFile);
+		mFile = nullptr;
+		return R_ERROR_API;
+	}
+
+	mNumRecords = 0;
+	mStartReceiveTime = 0;
+	mStartServerTime = 0;
+	mStarted = false;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result EventRecorder::close()
+{
+	if (mFile == nullptr)
+	{
+		return R_OK;
+	}
+
+	// Patch the header now the number of records and the start times are known, numRecords is
+	// followed by the start times
+	bool success = fseek(mFile, offsetof(RecordingHeader, numRecords), SEEK_SET) == 0 &&
+		fwrite(&mNumRecords, sizeof(mNumRecords), 1, mFile) == 1 &&
+		fwrite(&mStartReceiveTime, sizeof(mStartReceiveTime), 1, mFile) == 1 &&
+		fwrite(&mStartServerTime, sizeof(mStartServerTime), 1, mFile) == 1;
+
+	success = fclose(mFile) == 0 && success;
+	mFile = nullptr;
+
+	return success ? R_OK : R_ERROR_API;
+}
+// ----------------------------------------------------------------------------
+void EventRecorder::record(const DeviceEvent& event)
+{
+	if (mFile == nullptr)
+	{
+		return;
+	}
+
+	uint32_t serverTime = (uint32_t)event.time;
+	if (!mStarted)
+	{
+		mStartReceiveTime = mLastReceiveTime = event.receiveTime;
+		mStartServerTime = mLastServerTime = serverTime;
+		mStarted = true;
+	}
+
+	EventRecord record;
+	uint64_t receiveDelta = event.receiveTime > mLastReceiveTime ? (event.receiveTime - mLastReceiveTime) / 1000 : 0;
+	record.receiveDelta = receiveDelta < UINT32_MAX ? (uint32_t)receiveDelta : UINT32_MAX;
+	record.serverDelta = (int32_t)(serverTime - mLastServerTime);
+	record.window = (uint32_t)event.window;
+	record.detail = event.detail;
+	record.flags = event.flags;
+	record.deviceId = (uint16_t)event.deviceId;
+	record.sourceId = (uint16_t)event.sourceId;
+	record.type = (uint8_t)event.type;
+	record.axesMask = (uint8_t)event.axesMask;
+	record.reserved = 0;
+	record.x = (float)event.x;
+	record.y = (float)event.y;
+	for (int i = 0; i < NUM_DEVICE_AXES; i++)
+	{
+		record.axes[i] = (event.axesMask & (1 << i)) ? event.axes[i] : 0.0f;
+	}
+
+	if (fwrite(&record, sizeof(record), 1, mFile) == 1)
+	{
+		// Deltas are accumulated from the stored values, so rounding errors don't add up on replay
+		mLastReceiveTime += (uint64_t)record.receiveDelta * 1000;
+		mLastServerTime = serverTime;
+		mNumRecords++;
+	}
+}
+// ----------------------------------------------------------------------------
+EventReplay::EventReplay()
+	: mData(nullptr)
+	, mSize(0)
+	, mHeader(nullptr)
+	, mDevices(nullptr)
+	, mRecords(nullptr)
+	, mNumRecords(0)
+	, mNextRecord(0)
+	, mReceiveTime(0)
+	, mServerTime(0)
+	, mStartTime(0)
+	, mWindow(None)
+{
+
+}
+// ----------------------------------------------------------------------------
+EventReplay::~EventReplay()
+{
+	close();
+}
+// ----------------------------------------------------------------------------
+Result EventReplay::open(const char* path)
+{
+	if (path == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	close();
+
+	int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return R_ERROR_API;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(RecordingHeader))
+	{
+		::close(fd);
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	void* data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file referenced
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		return R_ERROR_API;
+	}
+
+	madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+	mData = (const unsigned char*)data;
+	mSize = fileStat.st_size;
+
+	const RecordingHeader* header = (const RecordingHeader*)mData;
+	if (memcmp(header->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0 ||
+		header->version != RECORDING_VERSION ||
+		header->recordSize != sizeof(EventRecord) ||
+		header->headerSize != sizeof(RecordingHeader) + header->numDevices * sizeof(RecordedDevice) ||
+		header->headerSize > mSize)
+	{
+		close();
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	mHeader = header;
+	mDevices = (const RecordedDevice*)(mData + sizeof(RecordingHeader));
+	mRecords = (const EventRecord*)(mData + header->headerSize);
+
+	// Recordings that were not stopped properly still contain all complete records
+	uint64_t numRecords = (mSize - header->headerSize) / sizeof(EventRecord);
+	mNumRecords = header->numRecords != 0 && header->numRecords < numRecords ? header->numRecords : numRecords;
+
+	start(0, None);
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void EventReplay::close()
+{
+	if (mData != nullptr)
+	{
+		munmap((void*)mData, mSize);
+	}
+
+	mData = nullptr;
+	mSize = 0;
+	mHeader = nullptr;
+	mDevices = nullptr;
+	mRecords = nullptr;
+	mNumRecords = 0;
+	mNextRecord = 0;
+}
+// ----------------------------------------------------------------------------
+void EventReplay::start(uint64_t startTime, Window window)
+{
+	mNextRecord = 0;
+	mReceiveTime = 0;
+	mServerTime = mHeader != nullptr ? mHeader->startServerTime : 0;
+	mStartTime = startTime;
+	mWindow = window;
+}
+// ----------------------------------------------------------------------------
+uint64_t EventReplay::getNextTime() const
+{
+	if (isFinished())
+	{
+		return UINT64_MAX;
+	}
+
+	return mStartTime + mReceiveTime + (uint64_t)mRecords[mNextRecord].receiveDelta * 1000;
+}
+// ----------------------------------------------------------------------------
+size_t EventReplay::read(DeviceEvent* events, size_t maxEvents, uint64_t time)
+{
+	size_t numEvents = 0;
+	while (numEvents < maxEvents && mNextRecord < mNumRecords)
+	{
+		const EventRecord& record = mRecords[mNextRecord];
+		uint64_t receiveTime = mReceiveTime + (uint64_t)record.receiveDelta * 1000;
+		if (mStartTime + receiveTime > time)
+		{
+			break;
+		}
+
+		mReceiveTime = receiveTime;
+		mServerTime += (uint32_t)record.serverDelta;
+		mNextRecord++;
+
+		DeviceEvent& event = events[numEvents++];
+		event.window = mWindow != None ? mWindow : (Window)record.window;
+		event.type = record.type;
+		event.deviceId = record.deviceId;
+		event.sourceId = record.sourceId;
+		event.detail = record.detail;
+		event.flags = record.flags;
+		event.x = record.x;
+		event.y = record.y;
+		event.time = mServerTime;
+		event.receiveTime = mStartTime + receiveTime;
+		event.serverTime = 0;
+		event.dispatchTime = 0;
+		event.axesMask = record.axesMask;
+		memcpy(event.axes, record.axes, sizeof(event.axes));
+	}
+
+	return numEvents;
+}
\ No newline at end of file
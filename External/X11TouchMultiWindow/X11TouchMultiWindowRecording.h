@@ -0,0 +1,137 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+
+#define RECORDING_MAGIC "X11TREC"
+#define RECORDING_VERSION 1
+#define RECORDING_DEVICE_NAME_LENGTH 64
+
+// All structs are written as is, in host byte order
+
+/// @brief Start of a recording, followed by numDevices RecordedDevice entries and the event records
+/// from headerSize on.
+struct RecordingHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t recordSize;
+	uint32_t numDevices;
+	/// Written when the recording is stopped, as are the start times. It is 0 if the recording was not
+	/// stopped properly, the number of records then follows from the file size.
+	uint64_t numRecords;
+	/// Times of the first record, which has deltas of 0
+	uint64_t startReceiveTime;
+	uint32_t startServerTime;
+	uint32_t reserved;
+};
+
+/// @brief Metadata of a pointer device present when the recording started.
+struct RecordedDevice
+{
+	int32_t deviceId;
+	int32_t use;
+	/// Bit per DeviceAxis decoded for the device
+	uint32_t axesMask;
+	uint32_t reserved;
+	char name[RECORDING_DEVICE_NAME_LENGTH];
+};
+
+/// @brief A decoded device event, with its times relative to the previous record.
+struct EventRecord
+{
+	/// Microseconds since the receive time of the previous record
+	uint32_t receiveDelta;
+	/// Milliseconds since the server time of the previous record
+	int32_t serverDelta;
+	uint32_t window;
+	int32_t detail;
+	int32_t flags;
+	uint16_t deviceId;
+	uint16_t sourceId;
+	uint8_t type;
+	uint8_t axesMask;
+	uint16_t reserved;
+	float x;
+	float y;
+	float axes[NUM_DEVICE_AXES];
+};
+
+/// @brief Writes decoded events to a recording file.
+class EventRecorder
+{
+private:
+	FILE* mFile;
+	uint64_t mNumRecords;
+	uint64_t mLastReceiveTime;
+	uint32_t mLastServerTime;
+	uint64_t mStartReceiveTime;
+	uint32_t mStartServerTime;
+	bool mStarted;
+	char mBuffer[64 * 1024];
+
+public:
+	EventRecorder();
+	~EventRecorder();
+
+	/// @brief Creates the file and writes the header and device table.
+	Result open(const char* path, const RecordedDevice* devices, int numDevices);
+	Result close();
+
+	bool isOpen() const { return mFile != nullptr; }
+	uint64_t getNumRecords() const { return mNumRecords; }
+
+	void record(const DeviceEvent& event);
+};
+
+/// @brief Reads the events of a memory-mapped recording.
+class EventReplay
+{
+private:
+	const unsigned char* mData;
+	size_t mSize;
+
+	const RecordingHeader* mHeader;
+	const RecordedDevice* mDevices;
+	const EventRecord* mRecords;
+	uint64_t mNumRecords;
+
+	uint64_t mNextRecord;
+	// Times of the previous record, relative to the start of the recording
+	uint64_t mReceiveTime;
+	uint32_t mServerTime;
+
+	uint64_t mStartTime;
+	Window mWindow;
+
+public:
+	EventReplay();
+	~EventReplay();
+
+	Result open(const char* path);
+	void close();
+
+	int getNumDevices() const { return mHeader != nullptr ? mHeader->numDevices : 0; }
+	const RecordedDevice& getDevice(int index) const { return mDevices[index]; }
+	uint64_t getNumRecords() const { return mNumRecords; }
+	bool isFinished() const { return mNextRecord >= mNumRecords; }
+	/// @brief Returns the monotonic time the next record is due at, UINT64_MAX once finished.
+	uint64_t getNextTime() const;
+
+	/// @brief Restarts at the first record.
+	/// @param startTime The monotonic time the recording is replayed from, receive times are shifted to it
+	/// @param window Window all events are delivered to, None keeps the recorded windows
+	void start(uint64_t startTime, Window window);
+
+	/// @brief Decodes the next records with a receive time up to time.
+	/// @return The number of events decoded
+	size_t read(DeviceEvent* events, size_t maxEvents, uint64_t time);
+};
\ No newline at end of file
@@ -0,0 +1,293 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cmath>
+
+#include "X11TouchMultiWindowRegions.h"
+
+// ----------------------------------------------------------------------------
+static int toCell(float value)
+{
+	// Coordinates far outside any screen are clamped, so the cell keys can't overflow
+	float cell = std::floor(value / REGION_CELL_SIZE);
+	if (!(cell > -1e6f))
+	{
+		return -1000000;
+	}
+	return (int)std::min(cell, 1e6f);
+}
+// ----------------------------------------------------------------------------
+static uint64_t toCellKey(int cellX, int cellY)
+{
+	return ((uint64_t)(uint32_t)cellX << 32) | (uint32_t)cellY;
+}
+// ----------------------------------------------------------------------------
+static void eraseIndex(std::vector<int>& indices, int index)
+{
+	std::vector<int>::iterator it = std::find(indices.begin(), indices.end(), index);
+	if (it != indices.end())
+	{
+		*it = indices.back();
+		indices.pop_back();
+	}
+}
+// ----------------------------------------------------------------------------
+static bool isAbove(const Region& region, const Region* top)
+{
+	return top == nullptr || region.layer > top->layer || (region.layer == top->layer && region.order > top->order);
+}
+// ----------------------------------------------------------------------------
+RegionIndex::RegionIndex()
+	: mNextOrder(0)
+{
+
+}
+// ----------------------------------------------------------------------------
+Result RegionIndex::add(const RegionData& region, const Vector2* vertices, int numVertices)
+{
+	if (region.shape == RS_POLYGON && vertices == nullptr)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	// 0 is reported for pointers outside of every region
+	if (region.id == 0 || region.shape < RS_RECT || region.shape > RS_POLYGON ||
+		(region.shape == RS_POLYGON && numVertices < 3))
+	{
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	if (mIds.find(region.id) != mIds.end())
+	{
+		return R_ERROR_DUPLICATE_ITEM;
+	}
+
+	int index;
+	if (!mFreeRegions.empty())
+	{
+		index = mFreeRegions.back();
+		mFreeRegions.pop_back();
+	}
+	else
+	{
+		index = (int)mRegions.size();
+		mRegions.push_back(Region());
+	}
+
+	Region& entry = mRegions[index];
+	entry.id = region.id;
+	entry.layer = region.layer;
+	entry.shape = region.shape;
+	entry.used = true;
+	entry.order = mNextOrder++;
+	entry.position = region.position;
+	entry.size = region.size;
+	entry.vertices.clear();
+	if (region.shape == RS_POLYGON)
+	{
+		entry.vertices.assign(vertices, vertices + numVertices);
+	}
+	updateBounds(entry);
+	insertIntoCells(index);
+	mIds[region.id] = index;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result RegionIndex::remove(int id)
+{
+	std::unordered_map<int, int>::iterator it = mIds.find(id);
+	if (it == mIds.end())
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	int index = it->second;
+	removeFromCells(index);
+	mRegions[index].used = false;
+	mFreeRegions.push_back(index);
+	mIds.erase(it);
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result RegionIndex::move(int id, const Vector2& position)
+{
+	std::unordered_map<int, int>::iterator it = mIds.find(id);
+	if (it == mIds.end())
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	int index = it->second;
+	Region& region = mRegions[index];
+	removeFromCells(index);
+	region.position = position;
+	updateBounds(region);
+	insertIntoCells(index);
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void RegionIndex::clear()
+{
+	mRegions.clear();
+	mFreeRegions.clear();
+	mIds.clear();
+	mCells.clear();
+	mLargeRegions.clear();
+}
+// ----------------------------------------------------------------------------
+int RegionIndex::hitTest(const Vector2& point) const
+{
+	const Region* top = nullptr;
+
+	std::unordered_map<uint64_t, std::vector<int>>::const_iterator cell =
+		mCells.find(toCellKey(toCell(point.x), toCell(point.y)));
+	if (cell != mCells.end())
+	{
+		for (std::vector<int>::const_iterator it = cell->second.begin(); it != cell->second.end(); ++it)
+		{
+			const Region& region = mRegions[*it];
+			if (isAbove(region, top) && contains(region, point))
+			{
+				top = &region;
+			}
+		}
+	}
+
+	for (std::vector<int>::const_iterator it = mLargeRegions.begin(); it != mLargeRegions.end(); ++it)
+	{
+		const Region& region = mRegions[*it];
+		if (isAbove(region, top) && contains(region, point))
+		{
+			top = &region;
+		}
+	}
+
+	return top != nullptr ? top->id : 0;
+}
+// ----------------------------------------------------------------------------
+void RegionIndex::updateBounds(Region& region)
+{
+	switch (region.shape)
+	{
+		case RS_RECT:
+			{
+				// Rects with a negative size extend to the left or bottom of their position
+				float x2 = region.position.x + region.size.x;
+				float y2 = region.position.y + region.size.y;
+				region.minX = std::min(region.position.x, x2);
+				region.minY = std::min(region.position.y, y2);
+				region.maxX = std::max(region.position.x, x2);
+				region.maxY = std::max(region.position.y, y2);
+			}
+			break;
+		case RS_CIRCLE:
+			{
+				float radius = std::fabs(region.size.x);
+				region.minX = region.position.x - radius;
+				region.minY = region.position.y - radius;
+				region.maxX = region.position.x + radius;
+				region.maxY = region.position.y + radius;
+			}
+			break;
+		case RS_POLYGON:
+			{
+				region.minX = region.minY = INFINITY;
+				region.maxX = region.maxY = -INFINITY;
+				const std::vector<Vector2>& vertices = region.vertices;
+				for (std::vector<Vector2>::const_iterator it = vertices.begin(); it != vertices.end(); ++it)
+				{
+					region.minX = std::min(region.minX, region.position.x + it->x);
+					region.minY = std::min(region.minY, region.position.y + it->y);
+					region.maxX = std::max(region.maxX, region.position.x + it->x);
+					region.maxY = std::max(region.maxY, region.position.y + it->y);
+				}
+			}
+			break;
+	}
+}
+// ----------------------------------------------------------------------------
+void RegionIndex::insertIntoCells(int index)
+{
+	Region& region = mRegions[index];
+	int minCellX = toCell(region.minX);
+	int minCellY = toCell(region.minY);
+	int maxCellX = toCell(region.maxX);
+	int maxCellY = toCell(region.maxY);
+
+	region.large = (double)(maxCellX - minCellX + 1) * (maxCellY - minCellY + 1) > REGION_MAX_CELLS;
+	if (region.large)
+	{
+		mLargeRegions.push_back(index);
+		return;
+	}
+
+	for (int y = minCellY; y <= maxCellY; y++)
+	{
+		for (int x = minCellX; x <= maxCellX; x++)
+		{
+			mCells[toCellKey(x, y)].push_back(index);
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void RegionIndex::removeFromCells(int index)
+{
+	const Region& region = mRegions[index];
+	if (region.large)
+	{
+		eraseIndex(mLargeRegions, index);
+		return;
+	}
+
+	for (int y = toCell(region.minY); y <= toCell(region.maxY); y++)
+	{
+		for (int x = toCell(region.minX); x <= toCell(region.maxX); x++)
+		{
+			eraseIndex(mCells[toCellKey(x, y)], index);
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+bool RegionIndex::contains(const Region& region, const Vector2& point) const
+{
+	if (point.x < region.minX || point.x > region.maxX || point.y < region.minY || point.y > region.maxY)
+	{
+		return false;
+	}
+
+	switch (region.shape)
+	{
+		case RS_RECT:
+			return true;
+		case RS_CIRCLE:
+			{
+				float dx = point.x - region.position.x;
+				float dy = point.y - region.position.y;
+				return dx * dx + dy * dy <= region.size.x * region.size.x;
+			}
+		case RS_POLYGON:
+			{
+				// Even-odd rule, so self-intersecting polygons have holes where they overlap themselves
+				float x = point.x - region.position.x;
+				float y = point.y - region.position.y;
+				bool inside = false;
+				const std::vector<Vector2>& vertices = region.vertices;
+				for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+				{
+					if ((vertices[i].y > y) != (vertices[j].y > y) &&
+						x < (vertices[j].x - vertices[i].x) * (y - vertices[i].y) / (vertices[j].y - vertices[i].y) +
+						vertices[i].x)
+					{
+						inside = !inside;
+					}
+				}
+				return inside;
+			}
+	}
+
+	return false;
+}
\ No newline at end of file
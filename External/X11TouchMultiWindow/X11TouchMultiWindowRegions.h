@@ -0,0 +1,70 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "X11TouchMultiWindowCommon.h"
+
+// Edge length in screen pixels of the cells of the grid regions are indexed in
+#define REGION_CELL_SIZE 64.0f
+// Regions covering more cells, like backgrounds, are kept in a list tested for every pointer instead
+#define REGION_MAX_CELLS 64
+
+/// @brief A registered region with its bounds in screen space.
+struct Region
+{
+	int id;
+	int layer;
+	RegionShape shape;
+	bool used;
+	/// Kept in the list of large regions instead of in the grid
+	bool large;
+	/// Increases with every region added, of regions on the same layer the latest is on top
+	unsigned int order;
+	Vector2 position;
+	Vector2 size;
+	/// Vertices of a polygon, relative to the position
+	std::vector<Vector2> vertices;
+	float minX, minY, maxX, maxY;
+};
+
+/// @brief Spatial index of the regions of a handler, a uniform grid over screen space hashed by cell so
+/// regions can be added, moved and removed without rebuilding it. A hit test only visits the regions
+/// overlapping the cell of the point.
+class RegionIndex
+{
+private:
+	std::vector<Region> mRegions;
+	std::vector<int> mFreeRegions;
+	std::unordered_map<int, int> mIds;
+	// Indices in mRegions per cell. Emptied cells keep their capacity, so moving a region between cells
+	// that have been used before doesn't allocate.
+	std::unordered_map<uint64_t, std::vector<int>> mCells;
+	std::vector<int> mLargeRegions;
+	unsigned int mNextOrder;
+
+public:
+	RegionIndex();
+
+	/// @param vertices Vertices of a polygon relative to region.position, ignored for other shapes
+	Result add(const RegionData& region, const Vector2* vertices, int numVertices);
+	Result remove(int id);
+	/// @param position New minimum corner of a rect, center of a circle or origin of a polygon
+	Result move(int id, const Vector2& position);
+	void clear();
+
+	int getNumRegions() const { return mIds.size(); }
+	bool isEmpty() const { return mIds.empty(); }
+	/// @brief Returns the id of the topmost region containing the point, 0 if there is none.
+	int hitTest(const Vector2& point) const;
+
+private:
+	void updateBounds(Region& region);
+	void insertIntoCells(int index);
+	void removeFromCells(int index);
+	bool contains(const Region& region, const Vector2& point) const;
+};
\ No newline at end of file
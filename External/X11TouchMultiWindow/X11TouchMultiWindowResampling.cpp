@@ -0,0 +1,173 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+
+#include "X11TouchMultiWindowResampling.h"
+
+// Tracks without samples for this long are reused, which releases the tracks of touches that never
+// reported their end, in nanoseconds
+#define RESAMPLE_STALE_TIME 1000000000ULL
+// Samples closer together are too noisy to extrapolate from, in nanoseconds
+#define RESAMPLE_MIN_DELTA 2000000ULL
+
+// ----------------------------------------------------------------------------
+PointerResampler::PointerResampler()
+	: mMaxExtrapolation(0)
+{
+
+}
+// ----------------------------------------------------------------------------
+void PointerResampler::setMaxExtrapolation(float maxExtrapolation)
+{
+	float clamped = std::max(0.0f, std::min(maxExtrapolation, RESAMPLE_MAX_EXTRAPOLATION));
+	mMaxExtrapolation = (uint64_t)(clamped * 1000000.0f);
+}
+// ----------------------------------------------------------------------------
+void PointerResampler::reset()
+{
+	mTracks.clear();
+}
+// ----------------------------------------------------------------------------
+void PointerResampler::beginEvents()
+{
+	for (std::vector<ResampleTrack>::iterator it = mTracks.begin(); it != mTracks.end(); ++it)
+	{
+		it->eventIndex = -1;
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerResampler::addSample(PointerType type, int id, PointerEvent event, uint64_t time,
+	const Vector2& position, int eventIndex)
+{
+	ResampleTrack* track = getTrack(type, id, time);
+	if (event == PE_DOWN && type == PT_TOUCH)
+	{
+		track->numSamples = 0;
+	}
+
+	if (track->numSamples > 0 && time <= track->times[track->latest])
+	{
+		// Times within a track only increase, a sample that is not newer replaces the latest one
+		track->positions[track->latest] = position;
+	}
+	else
+	{
+		track->latest = (track->latest + 1) % RESAMPLE_MAX_SAMPLES;
+		track->times[track->latest] = time;
+		track->positions[track->latest] = position;
+		track->numSamples = std::min(track->numSamples + 1, RESAMPLE_MAX_SAMPLES);
+	}
+	track->eventIndex = eventIndex;
+
+	if (event == PE_UP && type == PT_TOUCH)
+	{
+		track->used = false;
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerResampler::resample(uint64_t frameTime, std::vector<PointerEventData>& events)
+{
+	for (std::vector<ResampleTrack>::iterator it = mTracks.begin(); it != mTracks.end(); ++it)
+	{
+		if (it->eventIndex < 0)
+		{
+			continue;
+		}
+
+		Vector2 position;
+		if (getPosition(*it, frameTime, &position))
+		{
+			PointerEventData& eventData = events[it->eventIndex];
+			if (eventData.data.mask & TM_PREDICTION)
+			{
+				// Keep the prediction relative to the resampled position
+				eventData.data.predictedPosition.x += position.x - eventData.position.x;
+				eventData.data.predictedPosition.y += position.y - eventData.position.y;
+			}
+			eventData.position = position;
+		}
+
+		it->eventIndex = -1;
+	}
+}
+// ----------------------------------------------------------------------------
+ResampleTrack* PointerResampler::getTrack(PointerType type, int id, uint64_t time)
+{
+	ResampleTrack* freeTrack = nullptr;
+	for (std::vector<ResampleTrack>::iterator it = mTracks.begin(); it != mTracks.end(); ++it)
+	{
+		if (it->used && it->type == type && it->id == id)
+		{
+			return &(*it);
+		}
+
+		if (freeTrack == nullptr && (!it->used ||
+			(time > it->times[it->latest] && time - it->times[it->latest] > RESAMPLE_STALE_TIME)))
+		{
+			freeTrack = &(*it);
+		}
+	}
+
+	if (freeTrack == nullptr)
+	{
+		mTracks.push_back(ResampleTrack());
+		freeTrack = &mTracks.back();
+	}
+
+	freeTrack->type = type;
+	freeTrack->id = id;
+	freeTrack->used = true;
+	freeTrack->numSamples = 0;
+	freeTrack->latest = 0;
+	freeTrack->eventIndex = -1;
+
+	return freeTrack;
+}
+// ----------------------------------------------------------------------------
+bool PointerResampler::getPosition(const ResampleTrack& track, uint64_t frameTime, Vector2* position) const
+{
+	if (track.numSamples < 2)
+	{
+		return false;
+	}
+
+	const uint64_t* times = track.times;
+	const Vector2* positions = track.positions;
+	int latest = track.latest;
+
+	if (frameTime >= times[latest])
+	{
+		int previous = (latest - 1 + RESAMPLE_MAX_SAMPLES) % RESAMPLE_MAX_SAMPLES;
+		uint64_t delta = times[latest] - times[previous];
+		if (delta < RESAMPLE_MIN_DELTA)
+		{
+			return false;
+		}
+
+		// Extrapolating further than half the report interval overshoots on every change of direction
+		uint64_t ahead = std::min(frameTime - times[latest], std::min(mMaxExtrapolation, delta / 2));
+		float alpha = (float)ahead / (float)delta;
+		*position = Vector2(
+			positions[latest].x + (positions[latest].x - positions[previous].x) * alpha,
+			positions[latest].y + (positions[latest].y - positions[previous].y) * alpha);
+		return true;
+	}
+
+	for (int i = 1; i < track.numSamples; i++)
+	{
+		int after = (latest - i + 1 + RESAMPLE_MAX_SAMPLES) % RESAMPLE_MAX_SAMPLES;
+		int before = (latest - i + RESAMPLE_MAX_SAMPLES) % RESAMPLE_MAX_SAMPLES;
+		if (times[before] <= frameTime)
+		{
+			float alpha = (float)(frameTime - times[before]) / (float)(times[after] - times[before]);
+			*position = Vector2(
+				positions[before].x + (positions[after].x - positions[before].x) * alpha,
+				positions[before].y + (positions[after].y - positions[before].y) * alpha);
+			return true;
+		}
+	}
+
+	// The frame time is older than all samples, like right after a touch went down
+	return false;
+}
\ No newline at end of file
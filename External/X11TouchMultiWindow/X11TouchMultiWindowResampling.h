@@ -0,0 +1,65 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "X11TouchMultiWindowCommon.h"
+
+// Samples kept per pointer to find the pair bracketing the frame time
+#define RESAMPLE_MAX_SAMPLES 8
+// Extrapolation further ahead is clamped, in milliseconds
+#define RESAMPLE_MAX_EXTRAPOLATION 20.0f
+
+/// @brief Timestamped recent samples of a single pointer, in a ring buffer.
+struct ResampleTrack
+{
+	PointerType type;
+	int id;
+	bool used;
+	int numSamples;
+	/// Index of the latest sample
+	int latest;
+	/// Index in the event buffer of the handler of the update holding the latest sample, -1 if the pointer
+	/// was not updated during the current drain cycle
+	int eventIndex;
+	/// CLOCK_MONOTONIC times in nanoseconds
+	uint64_t times[RESAMPLE_MAX_SAMPLES];
+	Vector2 positions[RESAMPLE_MAX_SAMPLES];
+};
+
+/// @brief Moves the latest update of every pointer in a drain cycle to where the pointer was at the frame
+/// time, so each frame sees positions of the same age regardless of the report rate of the device. The
+/// position is interpolated between the samples bracketing the frame time, or extrapolated from the last
+/// two samples if the frame time is later than the latest one.
+class PointerResampler
+{
+private:
+	std::vector<ResampleTrack> mTracks;
+	// In nanoseconds
+	uint64_t mMaxExtrapolation;
+
+public:
+	PointerResampler();
+
+	/// @param maxExtrapolation In milliseconds, clamped to RESAMPLE_MAX_EXTRAPOLATION
+	void setMaxExtrapolation(float maxExtrapolation);
+	void reset();
+
+	void beginEvents();
+	/// @brief Adds a sample of a pointer. A touch starts a new track when it goes down and releases it when
+	/// it goes up, updates are never resampled across either.
+	/// @param time CLOCK_MONOTONIC time of the sample in nanoseconds
+	/// @param eventIndex Index of the update in the event buffer of the handler, -1 for down and up events
+	void addSample(PointerType type, int id, PointerEvent event, uint64_t time, const Vector2& position,
+		int eventIndex);
+	/// @brief Resamples the updates added since beginEvents.
+	/// @param frameTime CLOCK_MONOTONIC time in nanoseconds
+	void resample(uint64_t frameTime, std::vector<PointerEventData>& events);
+
+private:
+	ResampleTrack* getTrack(PointerType type, int id, uint64_t time);
+	bool getPosition(const ResampleTrack& track, uint64_t frameTime, Vector2* position) const;
+};
\ No newline at end of file
@@ -0,0 +1,342 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "X11TouchMultiWindowSharedRing.h"
+#include "X11TouchMultiWindowLogger.h"
+#include "X11TouchMultiWindowUtils.h"
+
+// Consumers that exited without releasing their windows are looked for at this interval, in nanoseconds
+#define CONSUMER_CHECK_INTERVAL 1000000000ULL
+
+// ----------------------------------------------------------------------------
+static bool isProcessAlive(int pid)
+{
+	return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+// ----------------------------------------------------------------------------
+std::string getSharedRingName(const char* displayName)
+{
+	// Object names may not contain slashes after the leading one
+	std::string name = "/x11touch-";
+	for (const char* c = XDisplayName(displayName); *c != '\0'; c++)
+	{
+		name += (*c == '/' || *c == ':') ? '_' : *c;
+	}
+	return name;
+}
+// ----------------------------------------------------------------------------
+socklen_t getSharedRingSocketAddress(const std::string& name, int pid, unsigned int token,
+	struct sockaddr_un& address)
+{
+	std::string socketName = pid == 0 ? name + ".broker" :
+		name + "." + std::to_string(pid) + "." + std::to_string(token);
+
+	// Abstract addresses start with a null byte and disappear with the socket, no files are left behind
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	size_t length = std::min(socketName.size(), sizeof(address.sun_path) - 1);
+	memcpy(address.sun_path + 1, socketName.data(), length);
+	return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + length);
+}
+// ----------------------------------------------------------------------------
+void lockSharedRing(SharedRingHeader* header)
+{
+	if (pthread_mutex_lock(&header->mutex) == EOWNERDEAD)
+	{
+		// The partitions are only modified by single stores, whatever the process did before dying left them valid
+		pthread_mutex_consistent(&header->mutex);
+	}
+}
+// ----------------------------------------------------------------------------
+void unlockSharedRing(SharedRingHeader* header)
+{
+	pthread_mutex_unlock(&header->mutex);
+}
+
+// ----------------------------------------------------------------------------
+SharedRingWriter::SharedRingWriter(Logger* logger, const std::string& name, bool groupAccess)
+	: mName(name)
+	, mLogger(logger)
+	, mGroupAccess(groupAccess)
+	, mHeader(nullptr)
+	, mSocket(-1)
+	, mLastConsumerCheck(0)
+{
+	memset(mWindows, 0, sizeof(mWindows));
+	memset(mConsumers, 0, sizeof(mConsumers));
+	memset(mPublished, 0, sizeof(mPublished));
+}
+// ----------------------------------------------------------------------------
+SharedRingWriter::~SharedRingWriter()
+{
+	close();
+}
+// ----------------------------------------------------------------------------
+Result SharedRingWriter::open()
+{
+	// Whoever can write the ring can inject events into every consumer and hold its mutex, never everyone
+	mode_t mode = mGroupAccess ? 0660 : 0600;
+	int fd = shm_open(mName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, mode);
+	if (fd < 0)
+	{
+		LOG_ERROR(mLogger, "Failed to open shared memory '%s': %s", mName.c_str(), strerror(errno));
+		return R_ERROR_API;
+	}
+
+	// The umask may have removed the group permissions, and the object of a previous broker keeps its own mode
+	fchmod(fd, mode);
+
+	struct stat status;
+	bool compatible = fstat(fd, &status) == 0 && status.st_size == (off_t)sizeof(SharedRingHeader);
+	if (!compatible && ftruncate(fd, sizeof(SharedRingHeader)) < 0)
+	{
+		LOG_ERROR(mLogger, "Failed to size shared memory '%s': %s", mName.c_str(), strerror(errno));
+		::close(fd);
+		return R_ERROR_API;
+	}
+
+	void* memory = mmap(NULL, sizeof(SharedRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+	{
+		LOG_ERROR(mLogger, "Failed to map shared memory '%s': %s", mName.c_str(), strerror(errno));
+		return R_ERROR_API;
+	}
+
+	mHeader = (SharedRingHeader*)memory;
+	compatible = compatible && mHeader->magic.load(std::memory_order_acquire) == SHARED_RING_MAGIC &&
+		mHeader->version == SHARED_RING_VERSION && mHeader->size == sizeof(SharedRingHeader);
+	if (compatible && mHeader->brokerPid != getpid() && isProcessAlive(mHeader->brokerPid))
+	{
+		LOG_ERROR(mLogger, "The broker of '%s' is already running as process %d", mName.c_str(),
+			mHeader->brokerPid);
+		close();
+		return R_ERROR_DUPLICATE_ITEM;
+	}
+
+	if (!compatible)
+	{
+		// Memory left by a broker of another version, consumers attached to it check the magic
+		mHeader->magic.store(0, std::memory_order_relaxed);
+		memset((char*)mHeader + sizeof(mHeader->magic), 0, sizeof(SharedRingHeader) - sizeof(mHeader->magic));
+
+		pthread_mutexattr_t attributes;
+		pthread_mutexattr_init(&attributes);
+		pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&mHeader->mutex, &attributes);
+		pthread_mutexattr_destroy(&attributes);
+
+		mHeader->version = SHARED_RING_VERSION;
+		mHeader->size = sizeof(SharedRingHeader);
+	}
+
+	mHeader->brokerPid = getpid();
+	mHeader->magic.store(SHARED_RING_MAGIC, std::memory_order_release);
+
+	mSocket = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	struct sockaddr_un address;
+	socklen_t addressLength = getSharedRingSocketAddress(mName, 0, 0, address);
+	if (mSocket < 0 || bind(mSocket, (struct sockaddr*)&address, addressLength) < 0)
+	{
+		// Windows claimed later are then picked up with the periodic update
+		LOG_WARNING(mLogger, "Failed to create the broker socket, consumers can't wake up the broker: %s",
+			strerror(errno));
+	}
+
+	LOG_INFO(mLogger, "Publishing events to '%s'%s", mName.c_str(), compatible ? ", attached to previous broker" : "");
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void SharedRingWriter::close()
+{
+	if (mSocket >= 0)
+	{
+		::close(mSocket);
+		mSocket = -1;
+	}
+
+	if (mHeader != nullptr)
+	{
+		// The memory stays, so consumers keep their windows until the next broker attaches
+		if (mHeader->brokerPid == getpid())
+		{
+			mHeader->brokerPid = 0;
+		}
+
+		munmap(mHeader, sizeof(SharedRingHeader));
+		mHeader = nullptr;
+	}
+
+	memset(mWindows, 0, sizeof(mWindows));
+	memset(mConsumers, 0, sizeof(mConsumers));
+}
+// ----------------------------------------------------------------------------
+void SharedRingWriter::update(std::vector<Window>& added, std::vector<Window>& removed)
+{
+	if (mSocket >= 0)
+	{
+		// Only a wake up, the partitions are scanned regardless
+		char buffer[16];
+		while (recv(mSocket, buffer, sizeof(buffer), MSG_DONTWAIT) >= 0)
+		{
+		}
+	}
+
+	uint64_t time = getMonotonicTime();
+	bool checkConsumers = time - mLastConsumerCheck >= CONSUMER_CHECK_INTERVAL;
+
+	lockSharedRing(mHeader);
+
+	if (checkConsumers)
+	{
+		mLastConsumerCheck = time;
+		removeExitedConsumers();
+	}
+
+	for (int i = 0; i < SHARED_RING_MAX_PARTITIONS; i++)
+	{
+		const SharedRingPartition& partition = mHeader->partitions[i];
+		for (int c = 0; c < SHARED_RING_MAX_CONSUMERS; c++)
+		{
+			// Addresses are only formatted when consumers change, notify runs every cycle
+			const SharedRingConsumer& consumer = partition.consumers[c];
+			if (consumer.pid != mConsumers[i][c].pid || consumer.token != mConsumers[i][c].token)
+			{
+				mConsumers[i][c] = consumer;
+				mAddressLengths[i][c] = getSharedRingSocketAddress(mName, consumer.pid, consumer.token,
+					mAddresses[i][c]);
+			}
+		}
+
+		Window window = partition.window;
+		if (window == mWindows[i])
+		{
+			continue;
+		}
+
+		if (mWindows[i] != None)
+		{
+			removed.push_back(mWindows[i]);
+		}
+		if (window != None)
+		{
+			added.push_back(window);
+		}
+		mWindows[i] = window;
+	}
+
+	unlockSharedRing(mHeader);
+}
+// ----------------------------------------------------------------------------
+void SharedRingWriter::removeExitedConsumers()
+{
+	for (int i = 0; i < SHARED_RING_MAX_PARTITIONS; i++)
+	{
+		SharedRingPartition& partition = mHeader->partitions[i];
+		if (partition.window == None)
+		{
+			continue;
+		}
+
+		bool used = false;
+		for (int c = 0; c < SHARED_RING_MAX_CONSUMERS; c++)
+		{
+			SharedRingConsumer& consumer = partition.consumers[c];
+			if (consumer.pid != 0 && !isProcessAlive(consumer.pid))
+			{
+				LOG_INFO(mLogger, "Process %d exited without releasing window %lu", consumer.pid, partition.window);
+				consumer.pid = 0;
+			}
+			used = used || consumer.pid != 0;
+		}
+
+		if (!used)
+		{
+			partition.window = None;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+bool SharedRingWriter::publish(const DeviceEvent& event)
+{
+	for (int i = 0; i < SHARED_RING_MAX_PARTITIONS; i++)
+	{
+		if (mWindows[i] == event.window)
+		{
+			write(mHeader->partitions[i], event);
+			mPublished[i] = true;
+			return true;
+		}
+	}
+
+	return false;
+}
+// ----------------------------------------------------------------------------
+void SharedRingWriter::publishToAll(const DeviceEvent& event)
+{
+	for (int i = 0; i < SHARED_RING_MAX_PARTITIONS; i++)
+	{
+		if (mWindows[i] != None)
+		{
+			write(mHeader->partitions[i], event);
+			mPublished[i] = true;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void SharedRingWriter::write(SharedRingPartition& partition, const DeviceEvent& event)
+{
+	uint64_t position = partition.tail.load(std::memory_order_relaxed);
+	SharedRingSlot& slot = partition.slots[position & (SHARED_RING_CAPACITY - 1)];
+
+	// Consumers still copying the previous event of the slot see the odd sequence and discard their copy
+	slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&slot.event, &event, sizeof(DeviceEvent));
+	slot.sequence.store(2 * position + 2, std::memory_order_release);
+
+	partition.tail.store(position + 1, std::memory_order_release);
+}
+// ----------------------------------------------------------------------------
+void SharedRingWriter::notify()
+{
+	if (mSocket < 0)
+	{
+		return;
+	}
+
+	char wake = 0;
+	for (int i = 0; i < SHARED_RING_MAX_PARTITIONS; i++)
+	{
+		if (!mPublished[i])
+		{
+			continue;
+		}
+		mPublished[i] = false;
+
+		for (int c = 0; c < SHARED_RING_MAX_CONSUMERS; c++)
+		{
+			// A full socket buffer already wakes up the consumer, the datagram is not needed
+			if (mConsumers[i][c].pid != 0)
+			{
+				sendto(mSocket, &wake, 1, MSG_DONTWAIT, (struct sockaddr*)&mAddresses[i][c], mAddressLengths[i][c]);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include <string>
+#include <sys/un.h>
+#include <vector>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+#include "X11TouchMultiWindowDeviceEvent.h"
+
+#define SHARED_RING_MAGIC 0x58315452
+// Bumped whenever the layout of the shared memory changes, brokers and plugins of different versions don't attach
+#define SHARED_RING_VERSION 1
+// Windows events are published for at once, the windows of all processes reading through the broker together
+#define SHARED_RING_MAX_PARTITIONS 32
+// Processes reading the events of the same window
+#define SHARED_RING_MAX_CONSUMERS 4
+// Events per partition, a power of two. Consumers falling further behind than this lose the oldest events.
+#define SHARED_RING_CAPACITY 1024
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory atomics must be lock-free to be used across processes");
+
+/// @brief An event in a partition, written with a sequence lock. The sequence is odd while the broker writes the
+/// event, and 2 * (position + 1) once the event published at position is complete.
+struct SharedRingSlot
+{
+	std::atomic<uint64_t> sequence;
+	DeviceEvent event;
+};
+
+/// @brief A process reading a partition, woken up through the datagram socket its token names.
+struct SharedRingConsumer
+{
+	int pid;
+	unsigned int token;
+};
+
+/// @brief The events of a single window. The window and consumers are guarded by the mutex of the header, the
+/// events are written by the broker only and read without locks by any number of consumers.
+struct SharedRingPartition
+{
+	/// None while the partition is free
+	Window window;
+	SharedRingConsumer consumers[SHARED_RING_MAX_CONSUMERS];
+
+	/// Number of events published to the partition, each consumer keeps its own read position
+	alignas(64) std::atomic<uint64_t> tail;
+	alignas(64) SharedRingSlot slots[SHARED_RING_CAPACITY];
+};
+
+/// @brief Layout of the shared memory object of a display, created by the broker.
+struct SharedRingHeader
+{
+	/// Written last once the broker initialized the memory
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	/// Size of the layout, so builds with a different DeviceEvent don't attach
+	uint32_t size;
+	int brokerPid;
+	/// Process shared and robust, so a process dying while holding it doesn't lock out the others
+	pthread_mutex_t mutex;
+	SharedRingPartition partitions[SHARED_RING_MAX_PARTITIONS];
+};
+
+/// @brief Returns the name of the shared memory object the broker of the display publishes to.
+/// @param displayName Display like ":0.1", NULL for the DISPLAY environment variable
+std::string getSharedRingName(const char* displayName);
+/// @brief Fills in the abstract socket address the consumer with the pid and token is woken up on, or the broker
+/// if pid is 0.
+/// @return Length of the address
+socklen_t getSharedRingSocketAddress(const std::string& name, int pid, unsigned int token,
+	struct sockaddr_un& address);
+
+void lockSharedRing(SharedRingHeader* header);
+void unlockSharedRing(SharedRingHeader* header);
+
+class Logger;
+
+/// @brief Publishes decoded events to the partitions of the windows claimed by the consumers of a shared ring.
+/// The broker writes without waiting for consumers, a slow consumer loses events instead of stalling the others.
+class SharedRingWriter
+{
+private:
+	std::string mName;
+	Logger* mLogger;
+	// Lets the users of the group of the broker attach, otherwise only its own user can
+	bool mGroupAccess;
+	SharedRingHeader* mHeader;
+	// Receives a datagram whenever a consumer claims or releases a window
+	int mSocket;
+
+	// Copies of the windows of the partitions, to route events without locking
+	Window mWindows[SHARED_RING_MAX_PARTITIONS];
+	// Copies of the consumers of the partitions and the addresses they are woken up on
+	SharedRingConsumer mConsumers[SHARED_RING_MAX_PARTITIONS][SHARED_RING_MAX_CONSUMERS];
+	struct sockaddr_un mAddresses[SHARED_RING_MAX_PARTITIONS][SHARED_RING_MAX_CONSUMERS];
+	socklen_t mAddressLengths[SHARED_RING_MAX_PARTITIONS][SHARED_RING_MAX_CONSUMERS];
+	// Partitions events were published to since the last notify
+	bool mPublished[SHARED_RING_MAX_PARTITIONS];
+	uint64_t mLastConsumerCheck;
+
+public:
+	SharedRingWriter(Logger* logger, const std::string& name, bool groupAccess);
+	~SharedRingWriter();
+
+	/// @brief Creates the shared memory object, or attaches to the object of a previous broker of the display so
+	/// the windows its consumers claimed are kept.
+	Result open();
+	void close();
+
+	/// @brief Returns a descriptor that polls readable once consumers claimed or released windows.
+	int getFd() const { return mSocket; }
+
+	/// @brief Reads the windows claimed by the consumers, and frees the partitions of consumers that exited.
+	/// @param added Receives the windows claimed since the last update
+	/// @param removed Receives the windows released since the last update
+	void update(std::vector<Window>& added, std::vector<Window>& removed);
+
+	/// @brief Publishes an event to the partition of its window.
+	/// @return false if no consumer claimed the window
+	bool publish(const DeviceEvent& event);
+	/// @brief Publishes an event to all partitions, used for device changes.
+	void publishToAll(const DeviceEvent& event);
+	/// @brief Wakes up the consumers of the partitions events were published to since the last call.
+	void notify();
+
+private:
+	void write(SharedRingPartition& partition, const DeviceEvent& event);
+	void removeExitedConsumers();
+};
\ No newline at end of file
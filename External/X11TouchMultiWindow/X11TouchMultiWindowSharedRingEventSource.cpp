@@ -0,0 +1,331 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "X11TouchMultiWindowSharedRingEventSource.h"
+#include "X11TouchMultiWindowLogger.h"
+
+// Tokens tell the sockets of the sources of different systems in a process apart
+static std::atomic<unsigned int> sNextToken(1);
+
+// ----------------------------------------------------------------------------
+SharedRingEventSource::SharedRingEventSource(Logger* logger, const std::string& name)
+	: EventSource(logger, nullptr)
+	, mName(name)
+	, mHeader(nullptr)
+	, mSocket(-1)
+	, mToken(sNextToken++)
+	, mNextSubscription(0)
+{
+
+}
+// ----------------------------------------------------------------------------
+SharedRingEventSource::~SharedRingEventSource()
+{
+	close();
+}
+// ----------------------------------------------------------------------------
+Result SharedRingEventSource::open()
+{
+	int fd = shm_open(mName.c_str(), O_RDWR | O_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		LOG_WARNING(mLogger, "Failed to open shared memory '%s', is the broker running? %s", mName.c_str(),
+			strerror(errno));
+		return R_ERROR_API;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) < 0 || status.st_size != (off_t)sizeof(SharedRingHeader))
+	{
+		LOG_WARNING(mLogger, "Shared memory '%s' was created by an incompatible broker", mName.c_str());
+		::close(fd);
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	void* memory = mmap(NULL, sizeof(SharedRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+	{
+		LOG_WARNING(mLogger, "Failed to map shared memory '%s': %s", mName.c_str(), strerror(errno));
+		return R_ERROR_API;
+	}
+
+	mHeader = (SharedRingHeader*)memory;
+	if (mHeader->magic.load(std::memory_order_acquire) != SHARED_RING_MAGIC ||
+		mHeader->version != SHARED_RING_VERSION || mHeader->size != sizeof(SharedRingHeader))
+	{
+		LOG_WARNING(mLogger, "Shared memory '%s' was created by an incompatible broker", mName.c_str());
+		close();
+		return R_ERROR_UNSUPPORTED;
+	}
+
+	int brokerPid = mHeader->brokerPid;
+	if (brokerPid == 0 || (kill(brokerPid, 0) < 0 && errno == ESRCH))
+	{
+		LOG_WARNING(mLogger, "The broker of '%s' is not running", mName.c_str());
+		close();
+		return R_ERROR_API;
+	}
+
+	mSocket = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	struct sockaddr_un address;
+	socklen_t addressLength = getSharedRingSocketAddress(mName, getpid(), mToken, address);
+	if (mSocket < 0 || bind(mSocket, (struct sockaddr*)&address, addressLength) < 0)
+	{
+		LOG_ERROR(mLogger, "Failed to create socket to be woken up by the broker: %s", strerror(errno));
+		close();
+		return R_ERROR_API;
+	}
+
+	LOG_INFO(mLogger, "Attached to the broker of '%s', process %d", mName.c_str(), brokerPid);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void SharedRingEventSource::close()
+{
+	if (mHeader != nullptr)
+	{
+		while (!mSubscriptions.empty())
+		{
+			release(mSubscriptions.back().partition);
+			mSubscriptions.pop_back();
+		}
+		wakeBroker();
+
+		munmap(mHeader, sizeof(SharedRingHeader));
+		mHeader = nullptr;
+	}
+
+	if (mSocket >= 0)
+	{
+		::close(mSocket);
+		mSocket = -1;
+	}
+}
+// ----------------------------------------------------------------------------
+Result SharedRingEventSource::selectEvents(Window window, const int*, size_t)
+{
+	for (std::vector<Subscription>::const_iterator it = mSubscriptions.begin(); it != mSubscriptions.end(); ++it)
+	{
+		if (it->window == window)
+		{
+			// Selected again for devices added later
+			return R_OK;
+		}
+	}
+
+	int pid = getpid();
+	int partitionIndex = -1;
+	int consumerIndex = -1;
+
+	lockSharedRing(mHeader);
+
+	// Processes reading the same window share its partition
+	for (int i = 0; i < SHARED_RING_MAX_PARTITIONS && partitionIndex < 0; i++)
+	{
+		if (mHeader->partitions[i].window == window)
+		{
+			partitionIndex = i;
+		}
+	}
+	for (int i = 0; i < SHARED_RING_MAX_PARTITIONS && partitionIndex < 0; i++)
+	{
+		if (mHeader->partitions[i].window == None)
+		{
+			partitionIndex = i;
+		}
+	}
+
+	if (partitionIndex >= 0)
+	{
+		SharedRingPartition& partition = mHeader->partitions[partitionIndex];
+		for (int c = 0; c < SHARED_RING_MAX_CONSUMERS && consumerIndex < 0; c++)
+		{
+			if (partition.consumers[c].pid == 0)
+			{
+				consumerIndex = c;
+			}
+		}
+
+		if (consumerIndex >= 0)
+		{
+			partition.window = window;
+			partition.consumers[consumerIndex].pid = pid;
+			partition.consumers[consumerIndex].token = mToken;
+
+			// Events published before the window was claimed belong to a previous consumer
+			Subscription subscription;
+			subscription.partition = partitionIndex;
+			subscription.window = window;
+			subscription.head = partition.tail.load(std::memory_order_acquire);
+			mSubscriptions.push_back(subscription);
+		}
+	}
+
+	unlockSharedRing(mHeader);
+
+	if (partitionIndex < 0 || consumerIndex < 0)
+	{
+		LOG_ERROR(mLogger, "Failed to claim window %lu, the broker already publishes the events of %d windows "
+			"or %d processes read the window", window, SHARED_RING_MAX_PARTITIONS, SHARED_RING_MAX_CONSUMERS);
+		return R_ERROR_API;
+	}
+
+	// The broker selects the events of the window once it sees the claim
+	wakeBroker();
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void SharedRingEventSource::unselectEvents(Window window)
+{
+	for (std::vector<Subscription>::iterator it = mSubscriptions.begin(); it != mSubscriptions.end(); ++it)
+	{
+		if (it->window == window)
+		{
+			release(it->partition);
+			mSubscriptions.erase(it);
+			mNextSubscription = 0;
+			wakeBroker();
+			return;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void SharedRingEventSource::release(int partitionIndex)
+{
+	int pid = getpid();
+
+	lockSharedRing(mHeader);
+
+	SharedRingPartition& partition = mHeader->partitions[partitionIndex];
+	bool used = false;
+	for (int c = 0; c < SHARED_RING_MAX_CONSUMERS; c++)
+	{
+		SharedRingConsumer& consumer = partition.consumers[c];
+		if (consumer.pid == pid && consumer.token == mToken)
+		{
+			consumer.pid = 0;
+		}
+		used = used || consumer.pid != 0;
+	}
+
+	if (!used)
+	{
+		partition.window = None;
+	}
+
+	unlockSharedRing(mHeader);
+}
+// ----------------------------------------------------------------------------
+void SharedRingEventSource::wakeBroker()
+{
+	if (mSocket < 0)
+	{
+		return;
+	}
+
+	// Without the wake up the broker still sees the change with its periodic update
+	struct sockaddr_un address;
+	socklen_t addressLength = getSharedRingSocketAddress(mName, 0, 0, address);
+	char wake = 0;
+	sendto(mSocket, &wake, 1, MSG_DONTWAIT, (struct sockaddr*)&address, addressLength);
+}
+// ----------------------------------------------------------------------------
+bool SharedRingEventSource::hasPendingEvents()
+{
+	for (std::vector<Subscription>::const_iterator it = mSubscriptions.begin(); it != mSubscriptions.end(); ++it)
+	{
+		if (mHeader->partitions[it->partition].tail.load(std::memory_order_acquire) != it->head)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+// ----------------------------------------------------------------------------
+size_t SharedRingEventSource::read(DeviceEvent* events, size_t maxEvents)
+{
+	// Datagrams only wake up waitForEvents, the partitions are read regardless
+	char buffer[64];
+	while (recv(mSocket, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+	{
+	}
+
+	size_t numEvents = 0;
+	size_t numSubscriptions = mSubscriptions.size();
+	for (size_t i = 0; i < numSubscriptions && numEvents < maxEvents; i++)
+	{
+		size_t index = (mNextSubscription + i) % numSubscriptions;
+		numEvents += readPartition(mSubscriptions[index], index == 0, events + numEvents, maxEvents - numEvents);
+		if (numEvents == maxEvents)
+		{
+			mNextSubscription = index;
+		}
+	}
+
+	return numEvents;
+}
+// ----------------------------------------------------------------------------
+size_t SharedRingEventSource::readPartition(Subscription& subscription, bool changes, DeviceEvent* events,
+	size_t maxEvents)
+{
+	const SharedRingPartition& partition = mHeader->partitions[subscription.partition];
+	uint64_t tail = partition.tail.load(std::memory_order_acquire);
+
+	uint64_t numDroppedEvents = 0;
+	if (tail - subscription.head > SHARED_RING_CAPACITY)
+	{
+		// The broker wrapped around the events not read yet
+		numDroppedEvents = tail - SHARED_RING_CAPACITY - subscription.head;
+		subscription.head = tail - SHARED_RING_CAPACITY;
+	}
+
+	size_t numEvents = 0;
+	for (; subscription.head != tail && numEvents < maxEvents; subscription.head++)
+	{
+		const SharedRingSlot& slot = partition.slots[subscription.head & (SHARED_RING_CAPACITY - 1)];
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		DeviceEvent& event = events[numEvents];
+		memcpy(&event, &slot.event, sizeof(DeviceEvent));
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// Overwritten while copying, the broker wrapped around since the tail was read
+		if (sequence != 2 * subscription.head + 2 || slot.sequence.load(std::memory_order_relaxed) != sequence)
+		{
+			numDroppedEvents++;
+			continue;
+		}
+
+		// Device changes are published to every partition, but processed once per system
+		if (isDeviceChangeEventType(event.type) && !changes)
+		{
+			continue;
+		}
+
+		numEvents++;
+	}
+
+	if (numDroppedEvents > 0)
+	{
+		LOG_WARNING(mLogger, "Fell behind the broker on window %lu, dropped %llu events", subscription.window,
+			(unsigned long long)numDroppedEvents);
+	}
+
+	return numEvents;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "X11TouchMultiWindowEventSource.h"
+#include "X11TouchMultiWindowSharedRing.h"
+
+/// @brief Reads the events the broker of a display publishes to its shared ring, instead of selecting them on a
+/// connection of its own. Selecting events for a window claims the partition of the window, whose events are then
+/// read straight from the shared memory, already decoded by the broker. Device changes are published to every
+/// partition and read from the first partition only.
+class SharedRingEventSource : public EventSource
+{
+private:
+	struct Subscription
+	{
+		int partition;
+		Window window;
+		// Position of the next event to read
+		uint64_t head;
+	};
+
+	std::string mName;
+	SharedRingHeader* mHeader;
+	// Woken up by the broker after it published events to the partitions of the source
+	int mSocket;
+	unsigned int mToken;
+	std::vector<Subscription> mSubscriptions;
+	// Position in mSubscriptions read continues at, so each partition gets its turn once maxEvents is reached
+	size_t mNextSubscription;
+
+public:
+	/// @param name Name of the shared memory object, see getSharedRingName
+	SharedRingEventSource(Logger* logger, const std::string& name);
+	~SharedRingEventSource();
+
+	Result open() override;
+	void close() override;
+
+	int getFd() const override { return mSocket; }
+
+	/// @brief Claims the partition of the window, the device ids are ignored as the broker selects all devices.
+	Result selectEvents(Window window, const int* deviceIds, size_t numDeviceIds) override;
+	void unselectEvents(Window window) override;
+	/// @brief Device changes are always published by the broker.
+	Result selectDeviceChangeEvents() override { return R_OK; }
+	void flush() override {}
+	bool hasPendingEvents() override;
+
+	size_t read(DeviceEvent* events, size_t maxEvents) override;
+
+private:
+	size_t readPartition(Subscription& subscription, bool changes, DeviceEvent* events, size_t maxEvents);
+	void release(int partition);
+	void wakeBroker();
+};
\ No newline at end of file
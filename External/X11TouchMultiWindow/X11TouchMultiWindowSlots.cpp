@@ -0,0 +1,94 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include "X11TouchMultiWindowSlots.h"
+
+// ----------------------------------------------------------------------------
+PointerSlotTable::PointerSlotTable()
+	: mEnd(0)
+	, mNumUsed(0)
+{
+	mSlots.reserve(16);
+}
+// ----------------------------------------------------------------------------
+int PointerSlotTable::acquire(int id, int deviceId, int sourceId, uint64_t time, Time serverTime,
+	const Vector2& position)
+{
+	int slot = find(id);
+	if (slot < 0)
+	{
+		// The lowest free slot keeps the indices dense
+		for (slot = 0; slot < mEnd && mSlots[slot].used; slot++)
+		{
+		}
+
+		if (slot == SLOT_MAX_SLOTS)
+		{
+			return -1;
+		}
+
+		if (slot == (int)mSlots.size())
+		{
+			mSlots.push_back(PointerSlot());
+		}
+		if (slot == mEnd)
+		{
+			mEnd++;
+		}
+		mNumUsed++;
+	}
+
+	PointerSlot& entry = mSlots[slot];
+	entry.id = id;
+	entry.deviceId = deviceId;
+	entry.sourceId = sourceId;
+	entry.used = true;
+	update(slot, time, serverTime, position);
+
+	return slot;
+}
+// ----------------------------------------------------------------------------
+int PointerSlotTable::find(int id) const
+{
+	for (int slot = 0; slot < mEnd; slot++)
+	{
+		if (mSlots[slot].used && mSlots[slot].id == id)
+		{
+			return slot;
+		}
+	}
+
+	return -1;
+}
+// ----------------------------------------------------------------------------
+void PointerSlotTable::update(int slot, uint64_t time, Time serverTime, const Vector2& position)
+{
+	PointerSlot& entry = mSlots[slot];
+	entry.time = time;
+	entry.serverTime = serverTime;
+	entry.position = position;
+}
+// ----------------------------------------------------------------------------
+void PointerSlotTable::release(int slot)
+{
+	if (!mSlots[slot].used)
+	{
+		return;
+	}
+
+	mSlots[slot].used = false;
+	mNumUsed--;
+
+	// Keep the scans short once the touches at the end have ended
+	while (mEnd > 0 && !mSlots[mEnd - 1].used)
+	{
+		mEnd--;
+	}
+}
+// ----------------------------------------------------------------------------
+void PointerSlotTable::clear()
+{
+	mSlots.clear();
+	mEnd = 0;
+	mNumUsed = 0;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <X11/Xlib.h>
+
+#include "X11TouchMultiWindowCommon.h"
+
+// Touches a handler can track at once, touches beginning while all slots are taken are dropped
+#define SLOT_MAX_SLOTS 256
+// Touches without events for this long are considered to have ended without reporting it, in seconds. Off by
+// default, the X server reports no events for a touch held still. Touches of a window that is unmapped or
+// destroyed are canceled regardless.
+#define SLOT_DEFAULT_TIMEOUT 0.0f
+
+/// @brief A touch occupying a slot.
+struct PointerSlot
+{
+	int id;
+	int deviceId;
+	int sourceId;
+	bool used;
+	/// CLOCK_MONOTONIC time in nanoseconds the latest event of the touch was dispatched at
+	uint64_t time;
+	/// X server time of the latest event of the touch in milliseconds
+	Time serverTime;
+	/// Latest position in window coordinates
+	Vector2 position;
+};
+
+/// @brief Maps the ever-increasing X11 touch ids to small indices that are stable while a touch is down. A
+/// touch beginning gets the lowest free index, so the managed side can keep its pointers in a flat array
+/// instead of hashing the touch id of every event. Touches are looked up by a scan over the slots in use,
+/// which are as many as there are fingers on the screen.
+class PointerSlotTable
+{
+private:
+	std::vector<PointerSlot> mSlots;
+	// Slots from this index on are free
+	int mEnd;
+	int mNumUsed;
+
+public:
+	PointerSlotTable();
+
+	/// @brief Returns the slot of a touch going down, the slot it already has if its end was never reported,
+	/// or -1 if all slots are taken.
+	int acquire(int id, int deviceId, int sourceId, uint64_t time, Time serverTime, const Vector2& position);
+	/// @brief Returns the slot of a touch, -1 if it has none.
+	int find(int id) const;
+	void update(int slot, uint64_t time, Time serverTime, const Vector2& position);
+	void release(int slot);
+	void clear();
+
+	const PointerSlot& getSlot(int slot) const { return mSlots[slot]; }
+	/// @brief Slots below this index may be in use.
+	int getEnd() const { return mEnd; }
+	int getNumUsed() const { return mNumUsed; }
+};
\ No newline at end of file
@@ -0,0 +1,210 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include "X11TouchMultiWindowTransform.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X11TOUCH_TRANSFORM_X86
+#include <immintrin.h>
+#endif
+
+// All kernels evaluate (x - offsetX) * scaleX and height - (y - offsetY) * scaleY in that order and without
+// fused multiply-adds, so every kernel produces the same floats as ScreenTransform::apply
+
+// ----------------------------------------------------------------------------
+ScreenTransform::ScreenTransform()
+	: offsetX(0.0f)
+	, offsetY(0.0f)
+	, scaleX(1.0f)
+	, scaleY(1.0f)
+	, height(0.0f)
+{
+
+}
+// ----------------------------------------------------------------------------
+ScreenTransform::ScreenTransform(int height, float offsetX, float offsetY, float scaleX, float scaleY)
+	: offsetX(offsetX)
+	, offsetY(offsetY)
+	, scaleX(scaleX)
+	, scaleY(scaleY)
+	, height((float)height)
+{
+
+}
+// ----------------------------------------------------------------------------
+template<bool Scaled, bool Offset>
+static void transformScalar(const ScreenTransform& transform, float* x, float* y, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		float px = x[i];
+		float py = y[i];
+		if (Offset)
+		{
+			px -= transform.offsetX;
+			py -= transform.offsetY;
+		}
+		if (Scaled)
+		{
+			px *= transform.scaleX;
+			py *= transform.scaleY;
+		}
+		if (Scaled || Offset)
+		{
+			x[i] = px;
+		}
+		y[i] = transform.height - py;
+	}
+}
+#ifdef X11TOUCH_TRANSFORM_X86
+// ----------------------------------------------------------------------------
+template<bool Scaled, bool Offset>
+__attribute__((target("sse2")))
+static size_t transformSse2(const ScreenTransform& transform, float* x, float* y, size_t numPoints)
+{
+	const __m128 offsetX = _mm_set1_ps(transform.offsetX);
+	const __m128 offsetY = _mm_set1_ps(transform.offsetY);
+	const __m128 scaleX = _mm_set1_ps(transform.scaleX);
+	const __m128 scaleY = _mm_set1_ps(transform.scaleY);
+	const __m128 height = _mm_set1_ps(transform.height);
+
+	size_t i = 0;
+	for (; i + 4 <= numPoints; i += 4)
+	{
+		__m128 py = _mm_loadu_ps(y + i);
+		if (Offset)
+		{
+			py = _mm_sub_ps(py, offsetY);
+		}
+		if (Scaled)
+		{
+			py = _mm_mul_ps(py, scaleY);
+		}
+		_mm_storeu_ps(y + i, _mm_sub_ps(height, py));
+
+		// Without offset and scale the X coordinates are left as they are
+		if (Scaled || Offset)
+		{
+			__m128 px = _mm_loadu_ps(x + i);
+			if (Offset)
+			{
+				px = _mm_sub_ps(px, offsetX);
+			}
+			if (Scaled)
+			{
+				px = _mm_mul_ps(px, scaleX);
+			}
+			_mm_storeu_ps(x + i, px);
+		}
+	}
+	return i;
+}
+// ----------------------------------------------------------------------------
+template<bool Scaled, bool Offset>
+__attribute__((target("avx2")))
+static size_t transformAvx2(const ScreenTransform& transform, float* x, float* y, size_t numPoints)
+{
+	const __m256 offsetX = _mm256_set1_ps(transform.offsetX);
+	const __m256 offsetY = _mm256_set1_ps(transform.offsetY);
+	const __m256 scaleX = _mm256_set1_ps(transform.scaleX);
+	const __m256 scaleY = _mm256_set1_ps(transform.scaleY);
+	const __m256 height = _mm256_set1_ps(transform.height);
+
+	size_t i = 0;
+	for (; i + 8 <= numPoints; i += 8)
+	{
+		__m256 py = _mm256_loadu_ps(y + i);
+		if (Offset)
+		{
+			py = _mm256_sub_ps(py, offsetY);
+		}
+		if (Scaled)
+		{
+			py = _mm256_mul_ps(py, scaleY);
+		}
+		_mm256_storeu_ps(y + i, _mm256_sub_ps(height, py));
+
+		if (Scaled || Offset)
+		{
+			__m256 px = _mm256_loadu_ps(x + i);
+			if (Offset)
+			{
+				px = _mm256_sub_ps(px, offsetX);
+			}
+			if (Scaled)
+			{
+				px = _mm256_mul_ps(px, scaleX);
+			}
+			_mm256_storeu_ps(x + i, px);
+		}
+	}
+	return i;
+}
+#endif
+// ----------------------------------------------------------------------------
+template<bool Scaled, bool Offset>
+static void transformWith(const ScreenTransform& transform, float* x, float* y, size_t numPoints,
+	TransformKernel kernel)
+{
+	size_t done = 0;
+#ifdef X11TOUCH_TRANSFORM_X86
+	if (kernel == TK_AVX2)
+	{
+		done = transformAvx2<Scaled, Offset>(transform, x, y, numPoints);
+	}
+	else if (kernel == TK_SSE2)
+	{
+		done = transformSse2<Scaled, Offset>(transform, x, y, numPoints);
+	}
+#endif
+	// The remainder that does not fill a vector
+	transformScalar<Scaled, Offset>(transform, x, y, done, numPoints);
+}
+// ----------------------------------------------------------------------------
+TransformKernel getTransformKernel()
+{
+#ifdef X11TOUCH_TRANSFORM_X86
+	static const TransformKernel kernel = __builtin_cpu_supports("avx2") ? TK_AVX2 :
+		(__builtin_cpu_supports("sse2") ? TK_SSE2 : TK_SCALAR);
+	return kernel;
+#else
+	return TK_SCALAR;
+#endif
+}
+// ----------------------------------------------------------------------------
+void transformPoints(const ScreenTransform& transform, float* x, float* y, size_t numPoints)
+{
+	transformPoints(transform, x, y, numPoints, getTransformKernel());
+}
+// ----------------------------------------------------------------------------
+void transformPoints(const ScreenTransform& transform, float* x, float* y, size_t numPoints,
+	TransformKernel kernel)
+{
+	if (kernel > getTransformKernel())
+	{
+		kernel = getTransformKernel();
+	}
+
+	if (transform.hasScale())
+	{
+		if (transform.hasOffset())
+		{
+			transformWith<true, true>(transform, x, y, numPoints, kernel);
+		}
+		else
+		{
+			transformWith<true, false>(transform, x, y, numPoints, kernel);
+		}
+	}
+	else
+	{
+		if (transform.hasOffset())
+		{
+			transformWith<false, true>(transform, x, y, numPoints, kernel);
+		}
+		else
+		{
+			transformWith<false, false>(transform, x, y, numPoints, kernel);
+		}
+	}
+}
\ No newline at end of file
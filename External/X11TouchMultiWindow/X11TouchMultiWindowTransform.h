@@ -0,0 +1,54 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <cstddef>
+
+#include "X11TouchMultiWindowCommon.h"
+
+/// @brief Instruction set the coordinates of a batch are transformed with.
+typedef enum
+{
+	TK_SCALAR = 0,
+	TK_SSE2 = 1,
+	TK_AVX2 = 2
+} TransformKernel;
+
+/// @brief Maps window coordinates to the screen space of a handler: the offset is subtracted, the result
+/// is scaled and the Y axis flipped, so the origin is at the bottom left of a screen of the given height.
+struct ScreenTransform
+{
+	float offsetX;
+	float offsetY;
+	float scaleX;
+	float scaleY;
+	float height;
+
+	ScreenTransform();
+	ScreenTransform(int height, float offsetX, float offsetY, float scaleX, float scaleY);
+
+	bool hasScale() const { return scaleX != 1.0f || scaleY != 1.0f; }
+	bool hasOffset() const { return offsetX != 0.0f || offsetY != 0.0f; }
+
+	Vector2 apply(const Vector2& point) const
+	{
+		return Vector2((point.x - offsetX) * scaleX, height - (point.y - offsetY) * scaleY);
+	}
+	/// @brief Transforms a direction, like a velocity, which is not affected by the offset.
+	Vector2 applyLinear(const Vector2& direction) const
+	{
+		return Vector2(direction.x * scaleX, -direction.y * scaleY);
+	}
+};
+
+/// @brief Returns the fastest kernel supported by the CPU.
+TransformKernel getTransformKernel();
+
+/// @brief Transforms points stored as separate X and Y arrays in place. Identity scales and zero offsets
+/// use specialized variants of the kernel that skip the multiply or add.
+void transformPoints(const ScreenTransform& transform, float* x, float* y, size_t numPoints);
+/// @brief Transforms with a specific kernel, used by the benchmarks. A kernel the CPU does not support falls
+/// back to the fastest one it does.
+void transformPoints(const ScreenTransform& transform, float* x, float* y, size_t numPoints,
+	TransformKernel kernel);
\ No newline at end of file
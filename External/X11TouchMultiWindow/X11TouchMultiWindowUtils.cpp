@@ -2,6 +2,7 @@
 @author Jorrit de Vries (jorrit@ijsfontein.nl)
 */
 #include <cstring>
+#include <ctime>
 #include <vector>
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
@@ -10,18 +11,9 @@
 #include "X11TouchMultiWindowUtils.h"
 
 // ----------------------------------------------------------------------------
-void sendMessage(MessageCallback messageCallback, MessageType messageType, const std::string& message)
+uint64_t getMonotonicTime()
 {
-	if (messageCallback)
-	{
-		// Allocate char array
-		char* cstr = new char[message.length() + 1];
-		strncpy(cstr, message.c_str(), message.length() + 1);
-
-		// Dispatch to callback
-		messageCallback((int)messageType, cstr);
-
-		// Unalloc char array
-		delete[] cstr;
-	}
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
\ No newline at end of file
@@ -3,12 +3,9 @@
 */
 #pragma once
 
-#include <string>
+#include <cstdint>
 
 #include "X11TouchMultiWindowCommon.h"
 
-/// @brief Sends a message to the given callback. This callback is passed from Unity.
-/// @param messageCallback 
-/// @param messageType 
-/// @param message 
-void sendMessage(MessageCallback messageCallback, MessageType messageType, const std::string& message);
\ No newline at end of file
+/// @brief Returns the current CLOCK_MONOTONIC time in nanoseconds.
+uint64_t getMonotonicTime();
\ No newline at end of file
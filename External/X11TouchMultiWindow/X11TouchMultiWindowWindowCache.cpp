@@ -0,0 +1,751 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#include <algorithm>
+#include <cstdlib>
+#include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+
+#include "X11TouchMultiWindowWindowCache.h"
+#include "X11TouchMultiWindowLogger.h"
+
+// Replies are collected after this many requests are in flight, which bounds the memory used for cookies
+#define MAX_PIPELINED_REQUESTS 256
+
+// ----------------------------------------------------------------------------
+// Returns the PID in a _NET_WM_PID reply, 0 if the window has none. The reply is freed.
+static unsigned long takePID(xcb_get_property_reply_t* reply)
+{
+	unsigned long pid = 0;
+	if (reply != nullptr)
+	{
+		if (reply->format == 32 && xcb_get_property_value_length(reply) >= 4)
+		{
+			pid = *(uint32_t*)xcb_get_property_value(reply);
+		}
+		free(reply);
+	}
+	return pid;
+}
+// ----------------------------------------------------------------------------
+WindowCache::WindowCache()
+	: mDisplay(NULL)
+	, mConnection(nullptr)
+	, mLogger(nullptr)
+	, mRootWindow(None)
+	, mAtomClientList(None)
+	, mAtomPID(None)
+	, mDirty(true)
+	, mRootWidth(0)
+	, mRootHeight(0)
+	, mGeometriesDirty(false)
+	, mStackDirty(true)
+{
+
+}
+// ----------------------------------------------------------------------------
+Result WindowCache::initialize(Display* display, Logger* logger)
+{
+	if (display == NULL)
+	{
+		return R_ERROR_NULL_POINTER;
+	}
+
+	mDisplay = display;
+	mConnection = XGetXCBConnection(display);
+	mLogger = logger;
+	mRootWindow = XDefaultRootWindow(display);
+	// The client list may only be created later by the window manager, so the atom must exist to match
+	// its notifications
+	mAtomClientList = XInternAtom(display, "_NET_CLIENT_LIST", False);
+	mAtomPID = XInternAtom(display, "_NET_WM_PID", False);
+
+	// The structure notifications of the root window itself report the screen being resized
+	XSelectInput(display, mRootWindow, StructureNotifyMask | SubstructureNotifyMask | PropertyChangeMask);
+	mDirty = true;
+	mStackDirty = true;
+
+	mRootWidth = DisplayWidth(display, DefaultScreen(display));
+	mRootHeight = DisplayHeight(display, DefaultScreen(display));
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+bool WindowCache::processEvent(const XEvent& event)
+{
+	processStackEvent(event);
+
+	switch (event.type)
+	{
+		case PropertyNotify:
+			if (event.xproperty.window == mRootWindow && event.xproperty.atom == mAtomClientList)
+			{
+				mDirty = true;
+			}
+			return true;
+		case CreateNotify:
+			mDirty = true;
+			return true;
+		case DestroyNotify:
+			{
+				remove(event.xdestroywindow.window);
+				mDirty = true;
+
+				WindowGeometry* geometry = findGeometry(event.xdestroywindow.window);
+				if (geometry != nullptr)
+				{
+					geometry->width = 0;
+					geometry->height = 0;
+					geometry->dirty = false;
+					if (geometry->mapped)
+					{
+						geometry->mapped = false;
+						mHiddenWindows.push_back(geometry->window);
+					}
+				}
+			}
+			return true;
+		case ReparentNotify:
+			{
+				// Mapped by the window manager into a frame, which is queried again
+				WindowGeometry* geometry = findGeometry(event.xreparent.window);
+				if (geometry != nullptr)
+				{
+					geometry->frame = None;
+					geometry->dirty = true;
+					mGeometriesDirty = true;
+				}
+			}
+			return true;
+		case ConfigureNotify:
+			{
+				const XConfigureEvent& configure = event.xconfigure;
+				if (configure.window == mRootWindow)
+				{
+					mRootWidth = configure.width;
+					mRootHeight = configure.height;
+					return true;
+				}
+
+				for (std::vector<WindowGeometry>::iterator it = mGeometries.begin(); it != mGeometries.end(); ++it)
+				{
+					if (it->window == configure.window && it->width > 0)
+					{
+						it->width = configure.width;
+						it->height = configure.height;
+						if (configure.send_event)
+						{
+							// Sent by the window manager when it moved the frame, in root coordinates
+							it->x = configure.x + configure.border_width;
+							it->y = configure.y + configure.border_width;
+						}
+						else
+						{
+							// Relative to the parent, which may be a frame
+							it->dirty = true;
+						}
+					}
+					else if (it->frame == configure.window && it->width > 0)
+					{
+						it->dirty = true;
+					}
+					mGeometriesDirty = mGeometriesDirty || it->dirty;
+				}
+			}
+			return true;
+		case MapNotify:
+			{
+				WindowGeometry* geometry = findGeometry(event.xmap.window);
+				if (geometry != nullptr)
+				{
+					geometry->mapped = true;
+				}
+			}
+			return true;
+		case UnmapNotify:
+			{
+				// Also reported for the windows of a client the window manager minimizes
+				WindowGeometry* geometry = findGeometry(event.xunmap.window);
+				if (geometry != nullptr && geometry->mapped)
+				{
+					geometry->mapped = false;
+					mHiddenWindows.push_back(geometry->window);
+				}
+			}
+			return true;
+		case GravityNotify:
+		case CirculateNotify:
+			// Also selected by SubstructureNotifyMask, but don't change the clients
+			return true;
+		default:
+			return false;
+	}
+}
+// ----------------------------------------------------------------------------
+void WindowCache::getWindowsOfProcess(unsigned long pid, std::vector<Window>& windows)
+{
+	if (mDisplay == NULL)
+	{
+		return;
+	}
+
+	if (mDirty)
+	{
+		refresh();
+	}
+
+	typedef std::unordered_multimap<unsigned long, Window>::const_iterator Iterator;
+	std::pair<Iterator, Iterator> range = mWindows.equal_range(pid);
+	for (Iterator it = range.first; it != range.second; ++it)
+	{
+		windows.push_back(it->second);
+	}
+
+	if (windows.empty())
+	{
+		// Without a window manager maintaining the client list, or for windows it doesn't manage
+		LOG_DEBUG(mLogger, "No client windows of process %lu, searching the window tree", pid);
+		queryTree(pid, windows);
+	}
+}
+// ----------------------------------------------------------------------------
+void WindowCache::trackGeometry(Window window)
+{
+	if (mDisplay == NULL || findGeometry(window) != nullptr)
+	{
+		return;
+	}
+
+	// Checked, so an invalid window is reported here instead of to the error handler of the display
+	uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+	xcb_generic_error_t* error = xcb_request_check(mConnection,
+		xcb_change_window_attributes_checked(mConnection, window, XCB_CW_EVENT_MASK, &mask));
+	if (error != nullptr)
+	{
+		LOG_WARNING(mLogger, "Failed to select the structure notifications of window %lu: %d", window,
+			error->error_code);
+		free(error);
+	}
+
+	WindowGeometry geometry;
+	geometry.window = window;
+	geometry.frame = None;
+	geometry.x = 0;
+	geometry.y = 0;
+	geometry.width = 0;
+	geometry.height = 0;
+	// Handlers are created for windows that are shown
+	geometry.mapped = true;
+	geometry.dirty = true;
+	mGeometries.push_back(geometry);
+	mGeometriesDirty = true;
+}
+// ----------------------------------------------------------------------------
+void WindowCache::untrackGeometry(Window window)
+{
+	for (std::vector<WindowGeometry>::iterator it = mGeometries.begin(); it != mGeometries.end(); ++it)
+	{
+		if (it->window == window)
+		{
+			// The window may already have been destroyed, the error is returned by the checked request
+			uint32_t mask = XCB_EVENT_MASK_NO_EVENT;
+			free(xcb_request_check(mConnection,
+				xcb_change_window_attributes_checked(mConnection, window, XCB_CW_EVENT_MASK, &mask)));
+			mGeometries.erase(it);
+			return;
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void WindowCache::takeHiddenWindows(std::vector<Window>& windows)
+{
+	windows.clear();
+	windows.swap(mHiddenWindows);
+}
+// ----------------------------------------------------------------------------
+const WindowGeometry* WindowCache::getGeometry(Window window)
+{
+	if (mGeometriesDirty)
+	{
+		refreshGeometries();
+	}
+
+	return findGeometry(window);
+}
+// ----------------------------------------------------------------------------
+Window WindowCache::findWindow(double x, double y)
+{
+	if (mGeometriesDirty)
+	{
+		refreshGeometries();
+	}
+	if (mStackDirty)
+	{
+		refreshStack();
+	}
+
+	// The topmost mapped child of the root window at the position receives the input, whichever client it is of
+	for (std::vector<StackedWindow>::reverse_iterator child = mStack.rbegin(); child != mStack.rend(); ++child)
+	{
+		if (!child->mapped || x < child->x || y < child->y || x >= child->x + child->width ||
+			y >= child->y + child->height)
+		{
+			continue;
+		}
+
+		// Without a window manager the tracked window is a child of the root window itself
+		for (std::vector<WindowGeometry>::const_iterator it = mGeometries.begin(); it != mGeometries.end(); ++it)
+		{
+			if (it->frame == child->window && it->mapped && x >= it->x && y >= it->y && x < it->x + it->width &&
+				y < it->y + it->height)
+			{
+				return it->window;
+			}
+		}
+
+		// Another window, or the decorations of the frame around a tracked window
+		return None;
+	}
+
+	return None;
+}
+// ----------------------------------------------------------------------------
+WindowGeometry* WindowCache::findGeometry(Window window)
+{
+	for (std::vector<WindowGeometry>::iterator it = mGeometries.begin(); it != mGeometries.end(); ++it)
+	{
+		if (it->window == window)
+		{
+			return &*it;
+		}
+	}
+
+	return nullptr;
+}
+// ----------------------------------------------------------------------------
+void WindowCache::refreshGeometries()
+{
+	mGeometriesDirty = false;
+
+	std::vector<xcb_translate_coordinates_cookie_t> positionCookies;
+	std::vector<xcb_get_geometry_cookie_t> sizeCookies;
+	std::vector<xcb_get_window_attributes_cookie_t> attributesCookies;
+	std::vector<WindowGeometry*> geometries;
+	for (std::vector<WindowGeometry>::iterator it = mGeometries.begin(); it != mGeometries.end(); ++it)
+	{
+		if (!it->dirty)
+		{
+			continue;
+		}
+
+		// Only after the window was reparented, which is rare enough to walk up the tree synchronously
+		if (it->frame == None)
+		{
+			it->frame = queryFrame(it->window);
+		}
+
+		positionCookies.push_back(xcb_translate_coordinates(mConnection, it->window, mRootWindow, 0, 0));
+		sizeCookies.push_back(xcb_get_geometry(mConnection, it->window));
+		attributesCookies.push_back(xcb_get_window_attributes(mConnection, it->window));
+		geometries.push_back(&*it);
+	}
+
+	for (size_t i = 0; i < geometries.size(); i++)
+	{
+		WindowGeometry& geometry = *geometries[i];
+		geometry.dirty = false;
+
+		xcb_generic_error_t* error = nullptr;
+		xcb_translate_coordinates_reply_t* position = xcb_translate_coordinates_reply(mConnection,
+			positionCookies[i], &error);
+		free(error);
+
+		error = nullptr;
+		xcb_get_geometry_reply_t* size = xcb_get_geometry_reply(mConnection, sizeCookies[i], &error);
+		free(error);
+
+		error = nullptr;
+		xcb_get_window_attributes_reply_t* attributes = xcb_get_window_attributes_reply(mConnection,
+			attributesCookies[i], &error);
+		free(error);
+
+		bool mapped = false;
+		if (position != nullptr && size != nullptr && attributes != nullptr)
+		{
+			geometry.x = position->dst_x;
+			geometry.y = position->dst_y;
+			geometry.width = size->width;
+			geometry.height = size->height;
+			mapped = attributes->map_state != XCB_MAP_STATE_UNMAPPED;
+		}
+		else
+		{
+			// Destroyed in the meantime
+			geometry.width = 0;
+			geometry.height = 0;
+		}
+		free(position);
+		free(size);
+		free(attributes);
+
+		// Unmapped before its notifications were selected
+		if (geometry.mapped && !mapped)
+		{
+			mHiddenWindows.push_back(geometry.window);
+		}
+		geometry.mapped = mapped;
+
+		LOG_DEBUG(mLogger, "Window %lu at %d, %d with size %dx%d", geometry.window, geometry.x, geometry.y,
+			geometry.width, geometry.height);
+	}
+}
+// ----------------------------------------------------------------------------
+Window WindowCache::queryFrame(Window window)
+{
+	Window frame = window;
+	while (true)
+	{
+		xcb_generic_error_t* error = nullptr;
+		xcb_query_tree_reply_t* tree = xcb_query_tree_reply(mConnection, xcb_query_tree(mConnection, frame), &error);
+		free(error);
+		if (tree == nullptr)
+		{
+			return frame;
+		}
+
+		Window parent = tree->parent;
+		free(tree);
+		if (parent == mRootWindow || parent == None)
+		{
+			return frame;
+		}
+		frame = parent;
+	}
+}
+// ----------------------------------------------------------------------------
+void WindowCache::processStackEvent(const XEvent& event)
+{
+	// Until the stack is queried again, which also happens before it is first used
+	if (mStackDirty)
+	{
+		return;
+	}
+
+	std::vector<StackedWindow>::iterator it;
+	switch (event.type)
+	{
+		case CreateNotify:
+			{
+				// New windows are created on top of their siblings, unmapped
+				const XCreateWindowEvent& create = event.xcreatewindow;
+				if (create.parent == mRootWindow)
+				{
+					StackedWindow child = { create.window, create.x, create.y, create.width + 2 * create.border_width,
+						create.height + 2 * create.border_width, false };
+					mStack.push_back(child);
+				}
+			}
+			break;
+		case DestroyNotify:
+			if (event.xdestroywindow.event == mRootWindow)
+			{
+				it = findStacked(event.xdestroywindow.window);
+				if (it != mStack.end())
+				{
+					mStack.erase(it);
+				}
+			}
+			break;
+		case MapNotify:
+		case UnmapNotify:
+			// The notifications of the window itself are reported with the window as event
+			if (event.xany.window == mRootWindow)
+			{
+				Window window = event.type == MapNotify ? event.xmap.window : event.xunmap.window;
+				it = findStacked(window);
+				if (it == mStack.end())
+				{
+					mStackDirty = true;
+					break;
+				}
+				it->mapped = event.type == MapNotify;
+			}
+			break;
+		case ConfigureNotify:
+			if (event.xconfigure.event == mRootWindow)
+			{
+				const XConfigureEvent& configure = event.xconfigure;
+				it = findStacked(configure.window);
+				if (it == mStack.end())
+				{
+					mStackDirty = true;
+					break;
+				}
+				it->x = configure.x;
+				it->y = configure.y;
+				it->width = configure.width + 2 * configure.border_width;
+				it->height = configure.height + 2 * configure.border_width;
+				restack(configure.window, configure.above);
+			}
+			break;
+		case ReparentNotify:
+		case CirculateNotify:
+			// Rare, mostly when the window manager frames a new window
+			if (event.xany.window == mRootWindow)
+			{
+				mStackDirty = true;
+			}
+			break;
+	}
+}
+// ----------------------------------------------------------------------------
+std::vector<StackedWindow>::iterator WindowCache::findStacked(Window window)
+{
+	std::vector<StackedWindow>::iterator it = mStack.begin();
+	while (it != mStack.end() && it->window != window)
+	{
+		++it;
+	}
+	return it;
+}
+// ----------------------------------------------------------------------------
+void WindowCache::restack(Window window, Window above)
+{
+	std::vector<StackedWindow>::iterator it = findStacked(window);
+	StackedWindow child = *it;
+	mStack.erase(it);
+
+	if (above == None)
+	{
+		mStack.insert(mStack.begin(), child);
+		return;
+	}
+
+	it = findStacked(above);
+	if (it == mStack.end())
+	{
+		mStackDirty = true;
+		return;
+	}
+	mStack.insert(it + 1, child);
+}
+// ----------------------------------------------------------------------------
+void WindowCache::refreshStack()
+{
+	mStackDirty = false;
+	mStack.clear();
+
+	xcb_generic_error_t* error = nullptr;
+	xcb_query_tree_reply_t* tree = xcb_query_tree_reply(mConnection, xcb_query_tree(mConnection, mRootWindow),
+		&error);
+	free(error);
+	if (tree == nullptr)
+	{
+		return;
+	}
+
+	// Bottom to top
+	const xcb_window_t* children = xcb_query_tree_children(tree);
+	size_t numChildren = xcb_query_tree_children_length(tree);
+
+	xcb_get_geometry_cookie_t geometryCookies[MAX_PIPELINED_REQUESTS];
+	xcb_get_window_attributes_cookie_t attributesCookies[MAX_PIPELINED_REQUESTS];
+	for (size_t first = 0; first < numChildren; first += MAX_PIPELINED_REQUESTS)
+	{
+		size_t count = std::min(numChildren - first, (size_t)MAX_PIPELINED_REQUESTS);
+		for (size_t i = 0; i < count; i++)
+		{
+			geometryCookies[i] = xcb_get_geometry(mConnection, children[first + i]);
+			attributesCookies[i] = xcb_get_window_attributes(mConnection, children[first + i]);
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			// Windows destroyed in the meantime are left out
+			error = nullptr;
+			xcb_get_geometry_reply_t* geometry = xcb_get_geometry_reply(mConnection, geometryCookies[i], &error);
+			free(error);
+
+			error = nullptr;
+			xcb_get_window_attributes_reply_t* attributes = xcb_get_window_attributes_reply(mConnection,
+				attributesCookies[i], &error);
+			free(error);
+
+			if (geometry != nullptr && attributes != nullptr)
+			{
+				StackedWindow child = { children[first + i], geometry->x, geometry->y,
+					geometry->width + 2 * geometry->border_width, geometry->height + 2 * geometry->border_width,
+					attributes->map_state != XCB_MAP_STATE_UNMAPPED };
+				mStack.push_back(child);
+			}
+			free(geometry);
+			free(attributes);
+		}
+	}
+	free(tree);
+
+	LOG_DEBUG(mLogger, "Window stack refreshed, %d children of the root window", (int)mStack.size());
+}
+// ----------------------------------------------------------------------------
+void WindowCache::refresh()
+{
+	mDirty = false;
+
+	std::vector<Window> clients;
+	if (!getClientList(clients))
+	{
+		mPIDs.clear();
+		mWindows.clear();
+		return;
+	}
+
+	std::sort(clients.begin(), clients.end());
+
+	// Drop windows that are no longer a client
+	std::vector<Window> removedWindows;
+	for (std::unordered_map<Window, unsigned long>::const_iterator it = mPIDs.begin(); it != mPIDs.end(); ++it)
+	{
+		if (!std::binary_search(clients.begin(), clients.end(), it->first))
+		{
+			removedWindows.push_back(it->first);
+		}
+	}
+	for (size_t i = 0; i < removedWindows.size(); i++)
+	{
+		remove(removedWindows[i]);
+	}
+
+	// Only new clients are queried
+	std::vector<Window> newWindows;
+	for (size_t i = 0; i < clients.size(); i++)
+	{
+		if (mPIDs.find(clients[i]) == mPIDs.end())
+		{
+			newWindows.push_back(clients[i]);
+		}
+	}
+	queryPIDs(newWindows.data(), newWindows.size());
+
+	LOG_DEBUG(mLogger, "Window cache refreshed, %d clients of which %d new", (int)clients.size(),
+		(int)newWindows.size());
+}
+// ----------------------------------------------------------------------------
+bool WindowCache::getClientList(std::vector<Window>& clients)
+{
+	xcb_get_property_cookie_t cookie = xcb_get_property(mConnection, 0, mRootWindow, mAtomClientList,
+		XCB_ATOM_WINDOW, 0, UINT32_MAX / 4);
+	xcb_get_property_reply_t* reply = xcb_get_property_reply(mConnection, cookie, nullptr);
+	if (reply == nullptr)
+	{
+		return false;
+	}
+
+	bool valid = reply->type == XCB_ATOM_WINDOW && reply->format == 32;
+	if (valid)
+	{
+		const uint32_t* windows = (const uint32_t*)xcb_get_property_value(reply);
+		int numWindows = xcb_get_property_value_length(reply) / 4;
+		clients.assign(windows, windows + numWindows);
+	}
+	free(reply);
+
+	return valid;
+}
+// ----------------------------------------------------------------------------
+void WindowCache::queryPIDs(const Window* windows, size_t numWindows)
+{
+	xcb_get_property_cookie_t cookies[MAX_PIPELINED_REQUESTS];
+	for (size_t first = 0; first < numWindows; first += MAX_PIPELINED_REQUESTS)
+	{
+		size_t count = std::min(numWindows - first, (size_t)MAX_PIPELINED_REQUESTS);
+		for (size_t i = 0; i < count; i++)
+		{
+			cookies[i] = xcb_get_property(mConnection, 0, windows[first + i], mAtomPID, XCB_ATOM_CARDINAL, 0, 1);
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			// Errors of windows destroyed in the meantime are returned here, instead of being passed
+			// to the error handler of the display
+			xcb_generic_error_t* error = nullptr;
+			unsigned long pid = takePID(xcb_get_property_reply(mConnection, cookies[i], &error));
+			free(error);
+
+			add(windows[first + i], pid);
+		}
+	}
+}
+// ----------------------------------------------------------------------------
+void WindowCache::queryTree(unsigned long pid, std::vector<Window>& windows)
+{
+	// Breadth first, all requests for a level of the tree are sent before the first reply is awaited
+	std::vector<Window> level(1, mRootWindow);
+	std::vector<Window> nextLevel;
+	std::vector<xcb_get_property_cookie_t> propertyCookies;
+	std::vector<xcb_query_tree_cookie_t> treeCookies;
+
+	while (!level.empty())
+	{
+		propertyCookies.resize(level.size());
+		treeCookies.resize(level.size());
+		for (size_t i = 0; i < level.size(); i++)
+		{
+			propertyCookies[i] = xcb_get_property(mConnection, 0, level[i], mAtomPID, XCB_ATOM_CARDINAL, 0, 1);
+			treeCookies[i] = xcb_query_tree(mConnection, level[i]);
+		}
+
+		nextLevel.clear();
+		for (size_t i = 0; i < level.size(); i++)
+		{
+			xcb_generic_error_t* error = nullptr;
+			if (takePID(xcb_get_property_reply(mConnection, propertyCookies[i], &error)) == pid)
+			{
+				windows.push_back(level[i]);
+			}
+			free(error);
+
+			error = nullptr;
+			xcb_query_tree_reply_t* tree = xcb_query_tree_reply(mConnection, treeCookies[i], &error);
+			free(error);
+			if (tree != nullptr)
+			{
+				const xcb_window_t* children = xcb_query_tree_children(tree);
+				nextLevel.insert(nextLevel.end(), children, children + xcb_query_tree_children_length(tree));
+				free(tree);
+			}
+		}
+
+		level.swap(nextLevel);
+	}
+}
+// ----------------------------------------------------------------------------
+void WindowCache::add(Window window, unsigned long pid)
+{
+	mPIDs[window] = pid;
+	if (pid != 0)
+	{
+		mWindows.insert(std::make_pair(pid, window));
+	}
+}
+// ----------------------------------------------------------------------------
+void WindowCache::remove(Window window)
+{
+	std::unordered_map<Window, unsigned long>::iterator it = mPIDs.find(window);
+	if (it == mPIDs.end())
+	{
+		return;
+	}
+
+	typedef std::unordered_multimap<unsigned long, Window>::iterator Iterator;
+	std::pair<Iterator, Iterator> range = mWindows.equal_range(it->second);
+	for (Iterator windowIt = range.first; windowIt != range.second; ++windowIt)
+	{
+		if (windowIt->second == window)
+		{
+			mWindows.erase(windowIt);
+			break;
+		}
+	}
+
+	mPIDs.erase(it);
+}
\ No newline at end of file
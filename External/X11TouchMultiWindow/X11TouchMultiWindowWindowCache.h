@@ -0,0 +1,128 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+#include "X11TouchMultiWindowCommon.h"
+
+class Logger;
+
+/// @brief Position of a window relative to the root window, and its size.
+struct WindowGeometry
+{
+	Window window;
+	/// Child of the root window containing the window, the frame of the window manager or the window itself.
+	/// None until it is queried.
+	Window frame;
+	int x;
+	int y;
+	/// 0 once the window was destroyed
+	int width;
+	int height;
+	/// Cleared while the window is unmapped, like while it is minimized
+	bool mapped;
+	/// Set when the window or its frame moved relative to the root window, the position is queried again
+	bool dirty;
+};
+
+/// @brief Outer bounds and map state of a child of the root window, which covers the windows below it.
+struct StackedWindow
+{
+	Window window;
+	/// Including the border
+	int x;
+	int y;
+	int width;
+	int height;
+	bool mapped;
+};
+
+/// @brief Caches the _NET_WM_PID of the client windows of the display. The cache is filled from
+/// _NET_CLIENT_LIST and kept current through the structure and property notifications of the root window,
+/// so only windows that were added since the last lookup are queried. Queries are pipelined over the
+/// XCB connection underlying the display, instead of a synchronous round trip per window.
+/// The geometry of the windows events are routed to is cached the same way, queried again only once the
+/// notifications of a window or its frame report it moved. Those notifications also report the window being
+/// unmapped or destroyed, which ends the touches in it without the X server reporting their ends.
+/// To find the window at a position, the children of the root window are kept in stacking order from the
+/// substructure notifications of the root window, including the windows of other clients.
+class WindowCache
+{
+private:
+	Display* mDisplay;
+	xcb_connection_t* mConnection;
+	Logger* mLogger;
+
+	Window mRootWindow;
+	Atom mAtomClientList;
+	Atom mAtomPID;
+
+	// Set when _NET_CLIENT_LIST or the children of the root window changed since the last refresh
+	bool mDirty;
+	std::unordered_map<Window, unsigned long> mPIDs;
+	std::unordered_multimap<unsigned long, Window> mWindows;
+
+	int mRootWidth;
+	int mRootHeight;
+	std::vector<WindowGeometry> mGeometries;
+	// Set when any of the geometries is dirty
+	bool mGeometriesDirty;
+	// Tracked windows unmapped or destroyed since the last takeHiddenWindows
+	std::vector<Window> mHiddenWindows;
+	// Children of the root window, bottom to top
+	std::vector<StackedWindow> mStack;
+	// Set when the stack is queried again before the next lookup, its notifications are ignored until then
+	bool mStackDirty;
+
+public:
+	WindowCache();
+
+	/// @brief Selects the notifications of the root window, which are delivered to the event queue of
+	/// the display and have to be passed to processEvent.
+	Result initialize(Display* display, Logger* logger);
+
+	/// @brief Returns whether the event was a notification of the root window.
+	bool processEvent(const XEvent& event);
+
+	void getWindowsOfProcess(unsigned long pid, std::vector<Window>& windows);
+
+	/// @brief Keeps the geometry and map state of the window current, selecting its structure notifications.
+	void trackGeometry(Window window);
+	void untrackGeometry(Window window);
+	/// @brief Moves the tracked windows that were unmapped or destroyed since the last call into windows, the
+	/// ends of the touches in them won't arrive.
+	void takeHiddenWindows(std::vector<Window>& windows);
+	/// @brief Returns the geometry of a tracked window, nullptr if the window is not tracked.
+	const WindowGeometry* getGeometry(Window window);
+	/// @brief Returns the tracked window containing the position relative to the root window, None if none does
+	/// or another window is on top of it there, including the frame of the window manager around it. Like the X
+	/// server, only mapped windows are hit, but input shapes are not taken into account.
+	Window findWindow(double x, double y);
+
+	int getRootWidth() const { return mRootWidth; }
+	int getRootHeight() const { return mRootHeight; }
+
+private:
+	void refresh();
+	bool getClientList(std::vector<Window>& clients);
+	void queryPIDs(const Window* windows, size_t numWindows);
+	void queryTree(unsigned long pid, std::vector<Window>& windows);
+
+	void add(Window window, unsigned long pid);
+	void remove(Window window);
+
+	WindowGeometry* findGeometry(Window window);
+	void refreshGeometries();
+	Window queryFrame(Window window);
+
+	void processStackEvent(const XEvent& event);
+	std::vector<StackedWindow>::iterator findStacked(Window window);
+	/// @brief Moves a child of the root window right above its sibling, to the bottom if above is None.
+	void restack(Window window, Window above);
+	void refreshStack();
+};
\ No newline at end of file
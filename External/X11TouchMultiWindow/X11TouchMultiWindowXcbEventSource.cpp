@@ -0,0 +1,296 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#ifdef X11TOUCH_XCB_BACKEND
+
+#include <cstdlib>
+#include <vector>
+#include <xcb/xinput.h>
+#include <X11/extensions/XInput2.h>
+
+#include "X11TouchMultiWindowDeviceAxes.h"
+#include "X11TouchMultiWindowXcbEventSource.h"
+#include "X11TouchMultiWindowLogger.h"
+#include "X11TouchMultiWindowUtils.h"
+
+// ----------------------------------------------------------------------------
+// Button, motion and touch events share the layout of xcb_input_button_press_event_t
+static void decodeDeviceEvent(const xcb_input_button_press_event_t* xcbEvent, uint64_t receiveTime,
+	const DeviceAxesTable& deviceAxes, DeviceEvent* event)
+{
+	event->window = xcbEvent->event;
+	event->type = xcbEvent->event_type;
+	event->deviceId = xcbEvent->deviceid;
+	event->sourceId = xcbEvent->sourceid;
+	event->detail = xcbEvent->detail;
+	event->flags = xcbEvent->flags;
+	event->x = xcbEvent->event_x / 65536.0;
+	event->y = xcbEvent->event_y / 65536.0;
+	event->time = xcbEvent->time;
+	event->receiveTime = receiveTime;
+	event->serverTime = 0;
+	event->dispatchTime = 0;
+
+	deviceAxes.decode(xcbEvent->sourceid, xcb_input_button_press_valuator_mask(xcbEvent),
+		xcbEvent->valuators_len, (const FixedPoint3232*)xcb_input_button_press_axisvalues(xcbEvent), event);
+}
+// ----------------------------------------------------------------------------
+// All raw events share the layout of xcb_input_raw_button_press_event_t
+static void decodeRawEvent(const xcb_input_raw_button_press_event_t* xcbEvent, uint64_t receiveTime,
+	const DeviceAxesTable& deviceAxes, DeviceEvent* event)
+{
+	event->window = None;
+	event->type = xcbEvent->event_type;
+	event->deviceId = xcbEvent->deviceid;
+	event->sourceId = xcbEvent->sourceid;
+	event->detail = xcbEvent->detail;
+	event->flags = xcbEvent->flags;
+	event->time = xcbEvent->time;
+	event->receiveTime = receiveTime;
+	event->serverTime = 0;
+	event->dispatchTime = 0;
+
+	// The accelerated values come first, followed by the same number of raw values
+	deviceAxes.decodeRaw(xcbEvent->sourceid, xcb_input_raw_button_press_valuator_mask(xcbEvent),
+		xcbEvent->valuators_len, (const FixedPoint3232*)xcb_input_raw_button_press_axisvalues(xcbEvent), event);
+}
+// ----------------------------------------------------------------------------
+static void decodeDeviceChangeEvent(const xcb_ge_generic_event_t* xcbEvent, uint64_t receiveTime,
+	std::vector<DeviceEvent>& events)
+{
+	DeviceEvent event = {};
+	event.type = xcbEvent->event_type;
+	event.receiveTime = receiveTime;
+
+	if (xcbEvent->event_type == XI_HierarchyChanged)
+	{
+		// The server reports every device, only the ones with flags set have changed
+		const xcb_input_hierarchy_event_t* hierarchyEvent = (const xcb_input_hierarchy_event_t*)xcbEvent;
+		const xcb_input_hierarchy_info_t* infos = xcb_input_hierarchy_infos(hierarchyEvent);
+		event.time = hierarchyEvent->time;
+		for (int i = 0; i < hierarchyEvent->num_infos; i++)
+		{
+			if (infos[i].flags != 0)
+			{
+				event.deviceId = infos[i].deviceid;
+				event.sourceId = infos[i].deviceid;
+				event.flags = infos[i].flags;
+				events.push_back(event);
+			}
+		}
+	}
+	else if (xcbEvent->event_type == XI_DeviceChanged)
+	{
+		const xcb_input_device_changed_event_t* changedEvent = (const xcb_input_device_changed_event_t*)xcbEvent;
+		event.time = changedEvent->time;
+		event.deviceId = changedEvent->deviceid;
+		event.sourceId = changedEvent->sourceid;
+		event.flags = changedEvent->reason;
+		events.push_back(event);
+	}
+}
+
+// ----------------------------------------------------------------------------
+XcbEventSource::XcbEventSource(Logger* logger, const DeviceAxesTable* deviceAxes, const char* displayName)
+	: EventSource(logger, deviceAxes)
+	, mDisplayName(displayName != NULL ? displayName : "")
+	, mConnection(NULL)
+	, mRoot(XCB_NONE)
+{
+
+}
+// ----------------------------------------------------------------------------
+XcbEventSource::~XcbEventSource()
+{
+	close();
+}
+// ----------------------------------------------------------------------------
+Result XcbEventSource::open()
+{
+	int screen = 0;
+	mConnection = xcb_connect(mDisplayName.empty() ? NULL : mDisplayName.c_str(), &screen);
+	if (xcb_connection_has_error(mConnection))
+	{
+		LOG_ERROR(mLogger, "Failed to open XCB connection for events to '%s'.",
+			XDisplayName(mDisplayName.empty() ? NULL : mDisplayName.c_str()));
+		close();
+		return R_ERROR_API;
+	}
+
+	const xcb_query_extension_reply_t* extension = xcb_get_extension_data(mConnection, &xcb_input_id);
+	if (extension == NULL || !extension->present)
+	{
+		LOG_ERROR(mLogger, "Failed to get the XInput extension for events.");
+		close();
+		return R_ERROR_API;
+	}
+	mOpcode = extension->major_opcode;
+
+	// XI2 events are only delivered in the XI2 format to clients that announced their version
+	xcb_input_xi_query_version_reply_t* version = xcb_input_xi_query_version_reply(mConnection,
+		xcb_input_xi_query_version(mConnection, 2, 3), NULL);
+	if (version == NULL || version->major_version < 2)
+	{
+		LOG_ERROR(mLogger, "Unsupported XInput extension version for events.");
+		free(version);
+		close();
+		return R_ERROR_API;
+	}
+	free(version);
+
+	xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(mConnection));
+	for (int i = 0; i < screen && it.rem > 0; i++)
+	{
+		xcb_screen_next(&it);
+	}
+	mRoot = it.data->root;
+
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void XcbEventSource::close()
+{
+	if (mConnection != NULL)
+	{
+		xcb_disconnect(mConnection);
+		mConnection = NULL;
+	}
+}
+// ----------------------------------------------------------------------------
+Result XcbEventSource::selectEvents(Window window, const int* deviceIds, size_t numDeviceIds)
+{
+	if (numDeviceIds == 0)
+	{
+		return R_OK;
+	}
+
+	uint32_t mask = XCB_INPUT_XI_EVENT_MASK_BUTTON_PRESS
+		| XCB_INPUT_XI_EVENT_MASK_BUTTON_RELEASE
+		| XCB_INPUT_XI_EVENT_MASK_MOTION
+		| XCB_INPUT_XI_EVENT_MASK_TOUCH_BEGIN
+		| XCB_INPUT_XI_EVENT_MASK_TOUCH_UPDATE
+		| XCB_INPUT_XI_EVENT_MASK_TOUCH_END;
+
+	// The masks of all devices go into a single request, each header followed by its mask
+	struct DeviceMask
+	{
+		xcb_input_event_mask_t header;
+		uint32_t mask;
+	};
+	std::vector<DeviceMask> masks(numDeviceIds);
+	for (size_t i = 0; i < numDeviceIds; i++)
+	{
+		masks[i].header.deviceid = deviceIds[i];
+		masks[i].header.mask_len = 1;
+		masks[i].mask = mask;
+	}
+
+	xcb_input_xi_select_events(mConnection, window, masks.size(), &masks[0].header);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result XcbEventSource::selectDeviceChangeEvents()
+{
+	struct
+	{
+		xcb_input_event_mask_t header;
+		uint32_t mask;
+	} mask;
+	mask.header.deviceid = XCB_INPUT_DEVICE_ALL;
+	mask.header.mask_len = 1;
+	mask.mask = XCB_INPUT_XI_EVENT_MASK_HIERARCHY | XCB_INPUT_XI_EVENT_MASK_DEVICE_CHANGED;
+
+	xcb_input_xi_select_events(mConnection, mRoot, 1, &mask.header);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+Result XcbEventSource::selectRawEvents()
+{
+	struct
+	{
+		xcb_input_event_mask_t header;
+		uint32_t mask;
+	} mask;
+	mask.header.deviceid = XCB_INPUT_DEVICE_ALL;
+	mask.header.mask_len = 1;
+	mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_PRESS
+		| XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_RELEASE
+		| XCB_INPUT_XI_EVENT_MASK_RAW_MOTION
+		| XCB_INPUT_XI_EVENT_MASK_RAW_TOUCH_BEGIN
+		| XCB_INPUT_XI_EVENT_MASK_RAW_TOUCH_UPDATE
+		| XCB_INPUT_XI_EVENT_MASK_RAW_TOUCH_END;
+
+	xcb_input_xi_select_events(mConnection, mRoot, 1, &mask.header);
+	return R_OK;
+}
+// ----------------------------------------------------------------------------
+void XcbEventSource::flush()
+{
+	xcb_flush(mConnection);
+}
+// ----------------------------------------------------------------------------
+bool XcbEventSource::hasPendingEvents()
+{
+	// Only void requests are issued on the connection after opening it, so nothing but read fills the
+	// event queue, and read only returns less than requested once the queue is empty
+	return mNumChangeEventsRead < mChangeEvents.size();
+}
+// ----------------------------------------------------------------------------
+size_t XcbEventSource::read(DeviceEvent* events, size_t maxEvents)
+{
+	size_t numEvents = takeChangeEvents(events, maxEvents);
+
+	// Only the first poll reads from the connection, the remaining events are taken from what that
+	// read buffered
+	bool readConnection = true;
+	while (numEvents < maxEvents)
+	{
+		xcb_generic_event_t* xcbEvent = readConnection ? xcb_poll_for_event(mConnection)
+			: xcb_poll_for_queued_event(mConnection);
+		readConnection = false;
+		if (xcbEvent == NULL)
+		{
+			break;
+		}
+
+		uint64_t receiveTime = getMonotonicTime();
+
+		uint8_t responseType = xcbEvent->response_type & ~0x80;
+		if (responseType == 0)
+		{
+			// Errors of the unchecked selection requests
+			xcb_generic_error_t* error = (xcb_generic_error_t*)xcbEvent;
+			LOG_ERROR(mLogger, "Request %d.%d failed: %d", error->major_code, error->minor_code, error->error_code);
+		}
+		else if (responseType == XCB_GE_GENERIC)
+		{
+			const xcb_ge_generic_event_t* genericEvent = (const xcb_ge_generic_event_t*)xcbEvent;
+			if (genericEvent->extension == mOpcode)
+			{
+				if (isDeviceEventType(genericEvent->event_type))
+				{
+					decodeDeviceEvent((const xcb_input_button_press_event_t*)genericEvent, receiveTime,
+						*mDeviceAxes, &events[numEvents]);
+					numEvents++;
+				}
+				else if (isRawEventType(genericEvent->event_type))
+				{
+					decodeRawEvent((const xcb_input_raw_button_press_event_t*)genericEvent, receiveTime,
+						*mDeviceAxes, &events[numEvents]);
+					numEvents++;
+				}
+				else if (isDeviceChangeEventType(genericEvent->event_type))
+				{
+					decodeDeviceChangeEvent(genericEvent, receiveTime, mChangeEvents);
+					numEvents += takeChangeEvents(events + numEvents, maxEvents - numEvents);
+				}
+			}
+		}
+
+		free(xcbEvent);
+	}
+
+	return numEvents;
+}
+
+#endif
\ No newline at end of file
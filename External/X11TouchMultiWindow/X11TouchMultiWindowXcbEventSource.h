@@ -0,0 +1,43 @@
+/*
+@author Jorrit de Vries (jorrit@ijsfontein.nl)
+*/
+#pragma once
+
+#ifdef X11TOUCH_XCB_BACKEND
+
+#include <string>
+#include <xcb/xcb.h>
+
+#include "X11TouchMultiWindowEventSource.h"
+
+/// @brief Reads events through libxcb and xcb-xinput on its own connection. Events are decoded straight
+/// from the wire structs returned by xcb_poll_for_queued_event, skipping the event copy, cookie lookup and
+/// conversion to Xlib structs done by XNextEvent and XGetEventData. Selections are sent as a single
+/// unchecked request per window, errors are reported as they are read from the connection.
+class XcbEventSource : public EventSource
+{
+private:
+	std::string mDisplayName;
+	xcb_connection_t* mConnection;
+	xcb_window_t mRoot;
+
+public:
+	/// @param displayName Display to connect to, NULL for the DISPLAY environment variable
+	XcbEventSource(Logger* logger, const DeviceAxesTable* deviceAxes, const char* displayName);
+	~XcbEventSource();
+
+	Result open() override;
+	void close() override;
+
+	int getFd() const override { return xcb_get_file_descriptor(mConnection); }
+
+	Result selectEvents(Window window, const int* deviceIds, size_t numDeviceIds) override;
+	Result selectDeviceChangeEvents() override;
+	Result selectRawEvents() override;
+	void flush() override;
+	bool hasPendingEvents() override;
+
+	size_t read(DeviceEvent* events, size_t maxEvents) override;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,699 @@
+/*
+Compares the cost of reading and decoding XInput2 events with the Xlib and XCB event backends. Both read
+from a loopback X server running in the benchmark process, which answers the setup requests of an event
+source and then streams a canned sequence of touch and mouse events, so neither an X server nor input
+devices are needed. The XCB backend is only measured if the library was built with X11TOUCH_XCB_BACKEND.
+Results are written as JSON to stdout, or to the file passed as the first argument.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "../X11TouchMultiWindowDeviceAxes.h"
+#include "../X11TouchMultiWindowEventSource.h"
+#include "../X11TouchMultiWindowLogger.h"
+#ifdef X11TOUCH_XCB_BACKEND
+#include "../X11TouchMultiWindowXcbEventSource.h"
+#endif
+
+#define NUM_EVENTS 2000000
+#define NUM_PASSES 3
+#define READ_BATCH_SIZE 64
+
+#define ROOT_WINDOW 0x100
+#define BENCH_WINDOW 0x200
+#define ROOT_VISUAL 0x21
+
+#define XINPUT_OPCODE 131
+#define XINPUT_FIRST_EVENT 66
+#define XINPUT_FIRST_ERROR 129
+#define GE_OPCODE 128
+
+#define MASTER_POINTER_ID 2
+#define MOUSE_DEVICE_ID 10
+#define TOUCH_DEVICE_ID 11
+
+typedef std::chrono::steady_clock Clock;
+
+// Wire protocol
+// ----------------------------------------------------------------------------
+// XIDeviceEvent as sent by the server, followed by the button mask, valuator mask and values
+struct WireDeviceEvent
+{
+	uint8_t type;
+	uint8_t extension;
+	uint16_t sequenceNumber;
+	uint32_t length;
+	uint16_t evtype;
+	uint16_t deviceid;
+	uint32_t time;
+	uint32_t detail;
+	uint32_t root;
+	uint32_t event;
+	uint32_t child;
+	int32_t rootX;
+	int32_t rootY;
+	int32_t eventX;
+	int32_t eventY;
+	uint16_t buttonsLen;
+	uint16_t valuatorsLen;
+	uint16_t sourceid;
+	uint16_t pad0;
+	uint32_t flags;
+	uint32_t mods[4];
+	uint8_t group[4];
+};
+
+struct WireTouchEvent
+{
+	WireDeviceEvent event;
+	uint32_t buttonMask;
+	uint32_t valuatorMask;
+	FixedPoint3232 values[5];
+};
+
+struct WireMotionEvent
+{
+	WireDeviceEvent event;
+	uint32_t buttonMask;
+	uint32_t valuatorMask;
+	FixedPoint3232 values[2];
+};
+
+static int32_t toFixedPoint1616(double value)
+{
+	return (int32_t)(value * 65536.0);
+}
+
+static FixedPoint3232 toFixedPoint3232(double value)
+{
+	FixedPoint3232 result;
+	result.integral = (int32_t)value;
+	result.frac = (uint32_t)((value - result.integral) * 4294967296.0);
+	return result;
+}
+
+static void initDeviceEvent(WireDeviceEvent& event, size_t size, int evtype, int sourceId, int detail,
+	uint32_t time, double x, double y)
+{
+	memset(&event, 0, sizeof(event));
+	event.type = 35;
+	event.extension = XINPUT_OPCODE;
+	event.length = (size - 32) / 4;
+	event.evtype = evtype;
+	event.deviceid = MASTER_POINTER_ID;
+	event.sourceid = sourceId;
+	event.time = time;
+	event.detail = detail;
+	event.root = ROOT_WINDOW;
+	event.event = BENCH_WINDOW;
+	event.rootX = toFixedPoint1616(x);
+	event.rootY = toFixedPoint1616(y);
+	event.eventX = toFixedPoint1616(x);
+	event.eventY = toFixedPoint1616(y);
+	event.buttonsLen = 1;
+	event.valuatorsLen = 1;
+}
+
+// Touch updates of five fingers interleaved with mouse motion, as seen by a kiosk with a mouse attached
+static void createEventStream(std::vector<char>& stream, std::vector<size_t>& sequenceOffsets)
+{
+	stream.clear();
+	sequenceOffsets.clear();
+
+	for (int i = 0; i < NUM_EVENTS; i++)
+	{
+		size_t offset = stream.size();
+		double x = 200.0 + (i % 400) * 0.5;
+		double y = 300.0 + (i % 200);
+		if (i % 4 == 3)
+		{
+			WireMotionEvent motion;
+			initDeviceEvent(motion.event, sizeof(motion), XI_Motion, MOUSE_DEVICE_ID, 0, i, x, y);
+			motion.buttonMask = 0;
+			motion.valuatorMask = 0x3;
+			motion.values[0] = toFixedPoint3232(x);
+			motion.values[1] = toFixedPoint3232(y);
+
+			stream.insert(stream.end(), (const char*)&motion, (const char*)&motion + sizeof(motion));
+		}
+		else
+		{
+			WireTouchEvent touch;
+			initDeviceEvent(touch.event, sizeof(touch), XI_TouchUpdate, TOUCH_DEVICE_ID, 1 + i % 5, i, x, y);
+			touch.buttonMask = 0;
+			// Position X and Y, pressure, touch major and orientation
+			touch.valuatorMask = 0x1f;
+			touch.values[0] = toFixedPoint3232(x);
+			touch.values[1] = toFixedPoint3232(y);
+			touch.values[2] = toFixedPoint3232(40.0 + i % 5);
+			touch.values[3] = toFixedPoint3232(12.5);
+			touch.values[4] = toFixedPoint3232(3.0);
+
+			stream.insert(stream.end(), (const char*)&touch, (const char*)&touch + sizeof(touch));
+		}
+
+		sequenceOffsets.push_back(offset + offsetof(WireDeviceEvent, sequenceNumber));
+	}
+}
+
+// Loopback server
+// ----------------------------------------------------------------------------
+/// Answers the requests issued while opening an event source, and streams the events once events are
+/// selected for BENCH_WINDOW. Requests are expected in the client byte order, which is the host order.
+class LoopbackServer
+{
+private:
+	int mListenFd;
+	int mDisplayNumber;
+	std::thread mThread;
+	std::atomic<bool> mRunning;
+
+	std::vector<char> mStream;
+	std::vector<size_t> mSequenceOffsets;
+
+public:
+	LoopbackServer()
+		: mListenFd(-1)
+		, mDisplayNumber(-1)
+		, mRunning(false)
+	{
+		createEventStream(mStream, mSequenceOffsets);
+	}
+
+	~LoopbackServer()
+	{
+		stop();
+	}
+
+	bool start()
+	{
+		// Listen on the abstract socket libxcb tries first, so nothing is created in /tmp/.X11-unix
+		for (int display = 64; display < 128 && mListenFd < 0; display++)
+		{
+			int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd < 0)
+			{
+				return false;
+			}
+
+			struct sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			int length = snprintf(address.sun_path + 1, sizeof(address.sun_path) - 1, "/tmp/.X11-unix/X%d",
+				display);
+			socklen_t addressLength = offsetof(struct sockaddr_un, sun_path) + 1 + length;
+
+			if (bind(fd, (struct sockaddr*)&address, addressLength) == 0 && listen(fd, 4) == 0)
+			{
+				mListenFd = fd;
+				mDisplayNumber = display;
+			}
+			else
+			{
+				close(fd);
+			}
+		}
+
+		if (mListenFd < 0)
+		{
+			return false;
+		}
+
+		mRunning = true;
+		mThread = std::thread(&LoopbackServer::run, this);
+		return true;
+	}
+
+	void stop()
+	{
+		if (mThread.joinable())
+		{
+			mRunning = false;
+			shutdown(mListenFd, SHUT_RDWR);
+			mThread.join();
+		}
+
+		if (mListenFd >= 0)
+		{
+			close(mListenFd);
+			mListenFd = -1;
+		}
+	}
+
+	int getDisplayNumber() const { return mDisplayNumber; }
+
+private:
+	void run()
+	{
+		while (mRunning)
+		{
+			int fd = accept(mListenFd, NULL, NULL);
+			if (fd < 0)
+			{
+				break;
+			}
+
+			serve(fd);
+			close(fd);
+		}
+	}
+
+	static bool readFully(int fd, void* data, size_t size)
+	{
+		char* p = (char*)data;
+		while (size > 0)
+		{
+			ssize_t r = ::read(fd, p, size);
+			if (r <= 0)
+			{
+				return false;
+			}
+			p += r;
+			size -= r;
+		}
+		return true;
+	}
+
+	static bool writeFully(int fd, const void* data, size_t size)
+	{
+		const char* p = (const char*)data;
+		while (size > 0)
+		{
+			ssize_t r = ::write(fd, p, size);
+			if (r <= 0)
+			{
+				return false;
+			}
+			p += r;
+			size -= r;
+		}
+		return true;
+	}
+
+	static bool sendSetup(int fd)
+	{
+		// Connection setup request, followed by the padded authorization name and data
+		uint8_t request[12];
+		if (!readFully(fd, request, sizeof(request)))
+		{
+			return false;
+		}
+
+		uint16_t nameLength, dataLength;
+		memcpy(&nameLength, request + 6, 2);
+		memcpy(&dataLength, request + 8, 2);
+		std::vector<uint8_t> authorization(((nameLength + 3) & ~3) + ((dataLength + 3) & ~3));
+		if (!authorization.empty() && !readFully(fd, authorization.data(), authorization.size()))
+		{
+			return false;
+		}
+
+		// A single 24 bit TrueColor screen
+		std::vector<uint8_t> reply(8 + 32 + 8 + 8 + 40 + 8 + 24, 0);
+		uint8_t* p = reply.data();
+		uint16_t u16;
+		uint32_t u32;
+		p[0] = 1;
+		u16 = 11; memcpy(p + 2, &u16, 2);
+		u16 = (reply.size() - 8) / 4; memcpy(p + 6, &u16, 2);
+		p += 8;
+		u32 = 0x00200000; memcpy(p + 4, &u32, 4);
+		u32 = 0x001fffff; memcpy(p + 8, &u32, 4);
+		u16 = 5; memcpy(p + 16, &u16, 2);
+		u16 = 0xffff; memcpy(p + 18, &u16, 2);
+		p[20] = 1;
+		p[21] = 1;
+		p[24] = 32;
+		p[25] = 32;
+		p[26] = 8;
+		p[27] = 255;
+		p += 32;
+		memcpy(p, "bench", 5);
+		p += 8;
+		p[0] = 24;
+		p[1] = 32;
+		p[2] = 32;
+		p += 8;
+		u32 = ROOT_WINDOW; memcpy(p, &u32, 4);
+		u32 = 0x20; memcpy(p + 4, &u32, 4);
+		u32 = 0xffffff; memcpy(p + 8, &u32, 4);
+		u16 = 1920; memcpy(p + 20, &u16, 2);
+		u16 = 1080; memcpy(p + 22, &u16, 2);
+		u16 = 508; memcpy(p + 24, &u16, 2);
+		u16 = 286; memcpy(p + 26, &u16, 2);
+		u16 = 1; memcpy(p + 28, &u16, 2);
+		u16 = 1; memcpy(p + 30, &u16, 2);
+		u32 = ROOT_VISUAL; memcpy(p + 32, &u32, 4);
+		p[38] = 24;
+		p[39] = 1;
+		p += 40;
+		p[0] = 24;
+		u16 = 1; memcpy(p + 2, &u16, 2);
+		p += 8;
+		u32 = ROOT_VISUAL; memcpy(p, &u32, 4);
+		p[4] = 4;
+		p[5] = 8;
+		u16 = 256; memcpy(p + 6, &u16, 2);
+		u32 = 0xff0000; memcpy(p + 8, &u32, 4);
+		u32 = 0x00ff00; memcpy(p + 12, &u32, 4);
+		u32 = 0x0000ff; memcpy(p + 16, &u32, 4);
+
+		return writeFully(fd, reply.data(), reply.size());
+	}
+
+	void serve(int fd)
+	{
+		if (!sendSetup(fd))
+		{
+			return;
+		}
+
+		uint16_t sequence = 0;
+		uint32_t nextAtom = 100;
+		std::vector<uint8_t> request;
+		while (mRunning)
+		{
+			uint8_t header[4];
+			if (!readFully(fd, header, sizeof(header)))
+			{
+				return;
+			}
+
+			uint16_t length;
+			memcpy(&length, header + 2, 2);
+			request.assign(header, header + 4);
+			request.resize(std::max(length * 4, 4));
+			if (request.size() > 4 && !readFully(fd, request.data() + 4, request.size() - 4))
+			{
+				return;
+			}
+			sequence++;
+
+			uint8_t reply[32];
+			memset(reply, 0, sizeof(reply));
+			reply[0] = 1;
+			memcpy(reply + 2, &sequence, 2);
+
+			uint8_t opcode = header[0];
+			uint8_t minorOpcode = header[1];
+			uint16_t u16;
+			if (opcode == 98)
+			{
+				// QueryExtension
+				memcpy(&u16, request.data() + 4, 2);
+				std::string name((const char*)request.data() + 8, u16);
+				if (name == "XInputExtension")
+				{
+					reply[8] = 1;
+					reply[9] = XINPUT_OPCODE;
+					reply[10] = XINPUT_FIRST_EVENT;
+					reply[11] = XINPUT_FIRST_ERROR;
+				}
+				else if (name == "Generic Event Extension")
+				{
+					reply[8] = 1;
+					reply[9] = GE_OPCODE;
+				}
+			}
+			else if (opcode == 16)
+			{
+				// InternAtom
+				memcpy(reply + 8, &nextAtom, 4);
+				nextAtom++;
+			}
+			else if (opcode == 20 || opcode == 43)
+			{
+				// GetProperty of an unset property, GetInputFocus
+			}
+			else if (opcode == GE_OPCODE && minorOpcode == 0)
+			{
+				// GEQueryVersion
+				u16 = 1; memcpy(reply + 8, &u16, 2);
+			}
+			else if (opcode == XINPUT_OPCODE && minorOpcode == 1)
+			{
+				// GetExtensionVersion
+				reply[1] = 1;
+				u16 = 2; memcpy(reply + 8, &u16, 2);
+				u16 = 3; memcpy(reply + 10, &u16, 2);
+				reply[12] = 1;
+			}
+			else if (opcode == XINPUT_OPCODE && minorOpcode == 47)
+			{
+				// XIQueryVersion
+				u16 = 2; memcpy(reply + 8, &u16, 2);
+				u16 = 3; memcpy(reply + 10, &u16, 2);
+			}
+			else
+			{
+				if (opcode == XINPUT_OPCODE && minorOpcode == 46)
+				{
+					// XISelectEvents
+					uint32_t window;
+					memcpy(&window, request.data() + 4, 4);
+					if (window == BENCH_WINDOW && !streamEvents(fd, sequence))
+					{
+						return;
+					}
+				}
+				continue;
+			}
+
+			if (!writeFully(fd, reply, sizeof(reply)))
+			{
+				return;
+			}
+		}
+	}
+
+	bool streamEvents(int fd, uint16_t sequence)
+	{
+		for (size_t i = 0; i < mSequenceOffsets.size(); i++)
+		{
+			memcpy(&mStream[mSequenceOffsets[i]], &sequence, 2);
+		}
+
+		return writeFully(fd, mStream.data(), mStream.size());
+	}
+};
+
+// Benchmark
+// ----------------------------------------------------------------------------
+static void messageCallback(int type, char* message)
+{
+	static const char* prefixes[] = { "debug", "info", "warning", "error" };
+	fprintf(stderr, "[%s] %s\n", type >= 0 && type < 4 ? prefixes[type] : "message", message);
+}
+
+static void createDevices(DeviceAxesTable& deviceAxes)
+{
+	// Position X and Y, pressure, touch major and orientation
+	const double maxValues[] = { 4095.0, 4095.0, 255.0, 255.0, 90.0 };
+	const Atom labels[] = { 1, 2, 3, 4, 5 };
+
+	deviceAxes.setLabel(DA_PRESSURE, 3);
+	deviceAxes.setLabel(DA_TOUCH_MAJOR, 4);
+	deviceAxes.setLabel(DA_TOUCH_MINOR, 100);
+	deviceAxes.setLabel(DA_ORIENTATION, 5);
+
+	XIValuatorClassInfo valuators[5];
+	XIAnyClassInfo* classes[5];
+	for (int i = 0; i < 5; i++)
+	{
+		memset(&valuators[i], 0, sizeof(XIValuatorClassInfo));
+		valuators[i].type = XIValuatorClass;
+		valuators[i].sourceid = TOUCH_DEVICE_ID;
+		valuators[i].number = i;
+		valuators[i].label = labels[i];
+		valuators[i].max = maxValues[i];
+		classes[i] = (XIAnyClassInfo*)&valuators[i];
+	}
+
+	XIDeviceInfo device;
+	memset(&device, 0, sizeof(device));
+	device.deviceid = TOUCH_DEVICE_ID;
+	device.use = XISlavePointer;
+	device.num_classes = 5;
+	device.classes = classes;
+	deviceAxes.update(device);
+}
+
+static double getThreadCpuTime()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+struct BenchmarkResult
+{
+	std::string backend;
+	unsigned long long numEvents;
+	double nsPerEvent;
+	double cpuNsPerEvent;
+	double checksum;
+};
+
+static bool runPass(EventSource& source, BenchmarkResult& result)
+{
+	if (source.open() != R_OK)
+	{
+		return false;
+	}
+
+	const int deviceIds[] = { MASTER_POINTER_ID };
+	source.selectEvents(BENCH_WINDOW, deviceIds, 1);
+
+	Clock::time_point start = Clock::now();
+	double cpuStart = getThreadCpuTime();
+	source.flush();
+
+	DeviceEvent events[READ_BATCH_SIZE];
+	unsigned long long numEvents = 0;
+	double checksum = 0.0;
+	struct pollfd fd;
+	fd.fd = source.getFd();
+	fd.events = POLLIN;
+	while (numEvents < NUM_EVENTS)
+	{
+		size_t n = source.read(events, READ_BATCH_SIZE);
+		for (size_t i = 0; i < n; i++)
+		{
+			checksum += events[i].x;
+			if (events[i].axesMask & (1 << DA_PRESSURE))
+			{
+				checksum += events[i].axes[DA_PRESSURE];
+			}
+		}
+		numEvents += n;
+
+		if (n < READ_BATCH_SIZE && numEvents < NUM_EVENTS && poll(&fd, 1, 2000) <= 0)
+		{
+			fprintf(stderr, "Timed out after %llu events\n", numEvents);
+			source.close();
+			return false;
+		}
+	}
+
+	double cpuTime = getThreadCpuTime() - cpuStart;
+	double time = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	source.close();
+
+	result.numEvents = numEvents;
+	result.nsPerEvent = time / numEvents;
+	result.cpuNsPerEvent = cpuTime / numEvents;
+	result.checksum = checksum;
+	return true;
+}
+
+template<typename CreateSource>
+static bool runBackend(const char* name, CreateSource createSource, std::vector<BenchmarkResult>& results)
+{
+	BenchmarkResult best;
+	best.backend = name;
+	best.cpuNsPerEvent = 0.0;
+	for (int pass = 0; pass < NUM_PASSES; pass++)
+	{
+		EventSource* source = createSource();
+		BenchmarkResult result;
+		bool success = runPass(*source, result);
+		delete source;
+
+		if (!success)
+		{
+			fprintf(stderr, "%s backend failed\n", name);
+			return false;
+		}
+
+		if (pass == 0 || result.cpuNsPerEvent < best.cpuNsPerEvent)
+		{
+			result.backend = name;
+			best = result;
+		}
+	}
+
+	fprintf(stderr, "%-6s %8.1f ns/event %8.1f cpu ns/event\n", name, best.nsPerEvent, best.cpuNsPerEvent);
+	results.push_back(best);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	LoopbackServer server;
+	if (!server.start())
+	{
+		fprintf(stderr, "Failed to start loopback server\n");
+		return 1;
+	}
+
+	char display[16];
+	snprintf(display, sizeof(display), ":%d", server.getDisplayNumber());
+	unsetenv("XAUTHORITY");
+
+	Logger logger(messageCallback, MT_WARNING);
+	DeviceAxesTable deviceAxes;
+	createDevices(deviceAxes);
+
+	std::vector<BenchmarkResult> results;
+	bool success = runBackend("xlib", [&]() -> EventSource*
+		{
+			return new XlibEventSource(&logger, &deviceAxes, display, NULL, nullptr);
+		}, results);
+#ifdef X11TOUCH_XCB_BACKEND
+	success = success && runBackend("xcb", [&]() -> EventSource*
+		{
+			return new XcbEventSource(&logger, &deviceAxes, display);
+		}, results);
+#endif
+
+	server.stop();
+
+	if (!success)
+	{
+		return 1;
+	}
+
+	FILE* file = stdout;
+	if (argc > 1)
+	{
+		file = fopen(argv[1], "w");
+		if (file == nullptr)
+		{
+			fprintf(stderr, "Failed to open %s\n", argv[1]);
+			return 1;
+		}
+	}
+
+	fprintf(file, "{\n  \"benchmark\": \"backend\",\n  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		fprintf(file, "    { \"backend\": \"%s\", \"events\": %llu, \"ns_per_event\": %.2f, "
+			"\"cpu_ns_per_event\": %.2f, \"checksum\": %.1f }%s\n", r.backend.c_str(), r.numEvents, r.nsPerEvent,
+			r.cpuNsPerEvent, r.checksum, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
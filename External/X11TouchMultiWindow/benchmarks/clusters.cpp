@@ -0,0 +1,239 @@
+/*
+Measures computing the transforms of clusters of pointers, as done by the transform gestures of a multi-user
+table every frame, with each kernel and with a two pass reference over an array of positions as the managed
+gestures do it. Splitting the pointers of a gesture into two clusters is measured as well. Every kernel is
+checked against the reference before it is timed.
+Results are written as JSON to stdout, or to the file passed as the first argument.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../X11TouchMultiWindowClusters.h"
+
+#define MIN_POINTS 20000000
+#define NUM_KERNELS 3
+#define RAD_TO_DEG 57.29577951308232
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* sKernelNames[NUM_KERNELS] = { "scalar", "sse2", "avx2" };
+
+struct Scenario
+{
+	const char* name;
+	int numClusters;
+	int pointsPerCluster;
+};
+
+struct Points
+{
+	std::vector<float> x, y, previousX, previousY;
+	std::vector<Vector2> positions, previousPositions;
+	std::vector<int> offsets;
+};
+
+// ----------------------------------------------------------------------------
+static void createPoints(const Scenario& scenario, Points& points)
+{
+	srand(1);
+	points.offsets.push_back(0);
+	for (int c = 0; c < scenario.numClusters; c++)
+	{
+		// Every cluster is pinched and rotated around its own center
+		float centerX = 100.0f + (c % 16) * 110.0f;
+		float centerY = 100.0f + (c / 16) * 110.0f;
+		float scale = 1.0f + (c % 5) * 0.01f;
+		float angle = (c % 7 - 3) * 0.01f;
+		for (int i = 0; i < scenario.pointsPerCluster; i++)
+		{
+			float px = (float)(rand() % 100 - 50);
+			float py = (float)(rand() % 100 - 50);
+			float qx = (px * std::cos(angle) - py * std::sin(angle)) * scale + 2.0f;
+			float qy = (px * std::sin(angle) + py * std::cos(angle)) * scale - 1.0f;
+			points.previousX.push_back(centerX + px);
+			points.previousY.push_back(centerY + py);
+			points.x.push_back(centerX + qx);
+			points.y.push_back(centerY + qy);
+			points.previousPositions.push_back(Vector2(centerX + px, centerY + py));
+			points.positions.push_back(Vector2(centerX + qx, centerY + qy));
+		}
+		points.offsets.push_back((int)points.x.size());
+	}
+}
+
+// The managed gestures compute the centroids in one pass and the spread around them in another
+// ----------------------------------------------------------------------------
+static void computeReference(const Points& points, int numClusters, ClusterTransform* transforms)
+{
+	for (int c = 0; c < numClusters; c++)
+	{
+		int begin = points.offsets[c];
+		int end = points.offsets[c + 1];
+		Vector2 center, previousCenter;
+		for (int i = begin; i < end; i++)
+		{
+			center.x += points.positions[i].x;
+			center.y += points.positions[i].y;
+			previousCenter.x += points.previousPositions[i].x;
+			previousCenter.y += points.previousPositions[i].y;
+		}
+		float n = (float)(end - begin);
+		center = Vector2(center.x / n, center.y / n);
+		previousCenter = Vector2(previousCenter.x / n, previousCenter.y / n);
+
+		float dot = 0.0f, cross = 0.0f, pp = 0.0f;
+		for (int i = begin; i < end; i++)
+		{
+			float px = points.previousPositions[i].x - previousCenter.x;
+			float py = points.previousPositions[i].y - previousCenter.y;
+			float qx = points.positions[i].x - center.x;
+			float qy = points.positions[i].y - center.y;
+			dot += px * qx + py * qy;
+			cross += px * qy - py * qx;
+			pp += px * px + py * py;
+		}
+
+		ClusterTransform& transform = transforms[c];
+		transform.center = center;
+		transform.previousCenter = previousCenter;
+		transform.translation = Vector2(center.x - previousCenter.x, center.y - previousCenter.y);
+		transform.scale = std::sqrt(dot * dot + cross * cross) / pp;
+		transform.rotation = (float)(std::atan2(cross, dot) * RAD_TO_DEG);
+		transform.numPoints = end - begin;
+	}
+}
+
+// ----------------------------------------------------------------------------
+static bool matches(const ClusterTransform& a, const ClusterTransform& b)
+{
+	return std::fabs(a.center.x - b.center.x) < 1e-2f && std::fabs(a.center.y - b.center.y) < 1e-2f &&
+		std::fabs(a.translation.x - b.translation.x) < 1e-2f &&
+		std::fabs(a.translation.y - b.translation.y) < 1e-2f &&
+		std::fabs(a.scale - b.scale) < 1e-4f && std::fabs(a.rotation - b.rotation) < 1e-2f;
+}
+
+// ----------------------------------------------------------------------------
+static double measure(const Points& points, int numClusters, std::vector<ClusterTransform>& transforms,
+	int kernel)
+{
+	size_t numPoints = points.x.size();
+	size_t numRepetitions = std::max((size_t)1, (size_t)MIN_POINTS / numPoints);
+	Clock::time_point start = Clock::now();
+	for (size_t r = 0; r < numRepetitions; r++)
+	{
+		if (kernel < 0)
+		{
+			computeReference(points, numClusters, transforms.data());
+		}
+		else
+		{
+			computeClusterTransforms(points.x.data(), points.y.data(), points.previousX.data(),
+				points.previousY.data(), points.offsets.data(), numClusters, transforms.data(),
+				(TransformKernel)kernel);
+		}
+	}
+	Clock::time_point end = Clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ((double)numRepetitions * numPoints);
+}
+
+int main(int argc, char** argv)
+{
+	const Scenario scenarios[] = {
+		// name, clusters, points per cluster
+		{ "pinch", 64, 2 },
+		{ "hands", 64, 10 },
+		{ "crowd", 16, 80 }
+	};
+	TransformKernel supportedKernel = getTransformKernel();
+
+	FILE* file = argc > 1 ? fopen(argv[1], "w") : stdout;
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	fprintf(file, "{\n  \"benchmark\": \"clusters\",\n  \"kernel\": \"%s\",\n  \"transforms\": [\n",
+		sKernelNames[supportedKernel]);
+	bool first = true;
+	for (const Scenario& scenario : scenarios)
+	{
+		Points points;
+		createPoints(scenario, points);
+		std::vector<ClusterTransform> expected(scenario.numClusters);
+		std::vector<ClusterTransform> transforms(scenario.numClusters);
+		computeReference(points, scenario.numClusters, expected.data());
+
+		double reference = measure(points, scenario.numClusters, transforms, -1);
+		fprintf(file, "%s    { \"scenario\": \"%s\", \"clusters\": %d, \"points_per_cluster\": %d, "
+			"\"kernel\": \"reference\", \"ns_per_point\": %.3f, \"speedup\": 1.00 }", first ? "" : ",\n",
+			scenario.name, scenario.numClusters, scenario.pointsPerCluster, reference);
+		first = false;
+
+		for (int k = 0; k <= supportedKernel; k++)
+		{
+			computeClusterTransforms(points.x.data(), points.y.data(), points.previousX.data(),
+				points.previousY.data(), points.offsets.data(), scenario.numClusters, transforms.data(),
+				(TransformKernel)k);
+			for (int c = 0; c < scenario.numClusters; c++)
+			{
+				if (!matches(transforms[c], expected[c]))
+				{
+					fprintf(stderr, "Kernel %s differs from the reference for cluster %d of %s\n", sKernelNames[k],
+						c, scenario.name);
+					return 1;
+				}
+			}
+
+			double kernel = measure(points, scenario.numClusters, transforms, k);
+			fprintf(file, ",\n    { \"scenario\": \"%s\", \"clusters\": %d, \"points_per_cluster\": %d, "
+				"\"kernel\": \"%s\", \"ns_per_point\": %.3f, \"speedup\": %.2f }", scenario.name,
+				scenario.numClusters, scenario.pointsPerCluster, sKernelNames[k], kernel, reference / kernel);
+		}
+	}
+	fprintf(file, "\n  ],\n  \"splits\": [\n");
+
+	const int splitSizes[] = { 4, 10, 80 };
+	for (size_t s = 0; s < sizeof(splitSizes) / sizeof(splitSizes[0]); s++)
+	{
+		// Two hands far apart
+		int numPoints = splitSizes[s];
+		std::vector<float> x(numPoints), y(numPoints);
+		std::vector<int> clusters(numPoints);
+		for (int i = 0; i < numPoints; i++)
+		{
+			x[i] = (i % 2 == 0 ? 200.0f : 900.0f) + (float)(rand() % 80);
+			y[i] = 400.0f + (float)(rand() % 80);
+		}
+
+		int hasClusters = 0;
+		size_t numRepetitions = std::max(1, MIN_POINTS / 10 / numPoints);
+		Clock::time_point start = Clock::now();
+		for (size_t r = 0; r < numRepetitions; r++)
+		{
+			splitClusters(x.data(), y.data(), numPoints, 50.0f, clusters.data(), &hasClusters);
+		}
+		Clock::time_point end = Clock::now();
+
+		bool separated = hasClusters != 0;
+		for (int i = 0; i < numPoints; i++)
+		{
+			separated = separated && clusters[i] == clusters[i % 2];
+		}
+		fprintf(file, "%s    { \"points\": %d, \"separated\": %s, \"ns_per_split\": %.1f }", s == 0 ? "" : ",\n",
+			numPoints, separated ? "true" : "false",
+			std::chrono::duration<double, std::nano>(end - start).count() / numRepetitions);
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,450 @@
+/*
+Measures the throughput of the event path from a decoded XInput2 device event to the managed side,
+without an X server. Synthesized XIDeviceEvent streams are decoded, routed by PointerHandlerSystem and
+processed by the handlers of their window, then consumed by a stub that mimics the managed side.
+Results are written as JSON to stdout, or to the file passed as the first argument.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../X11TouchMultiWindowDeviceAxes.h"
+#include "../X11TouchMultiWindowDeviceEvent.h"
+#include "../X11TouchMultiWindowPointerHandler.h"
+#include "../X11TouchMultiWindowPointerHandlerSystem.h"
+#include "../X11TouchMultiWindowUtils.h"
+
+#define WARMUP_FRAMES 200
+#define MIN_EVENTS 4000000
+#define MAX_EVENTS_PER_FRAME 1024
+// Roughly the cost of marshalling an event and updating a TouchScript pointer
+#define MANAGED_COST_ITERATIONS 24
+
+#define MASTER_POINTER_ID 2
+#define MOUSE_DEVICE_ID 10
+#define TOUCH_DEVICE_ID 11
+
+typedef std::chrono::steady_clock Clock;
+
+// Allocation counting
+// ----------------------------------------------------------------------------
+static unsigned long long sNumAllocations = 0;
+
+void* operator new(size_t size)
+{
+	sNumAllocations++;
+	void* p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+// Managed side stub
+// ----------------------------------------------------------------------------
+static float sManagedState[1024];
+
+static void consumeEvent(int id, int event, PointerType type, Vector2 position, const PointerData& data)
+{
+	float* state = &sManagedState[(id * 31 + type) & 1023];
+	float value = position.x * 0.5f + position.y * 0.25f + data.pressure;
+	for (int i = 0; i < MANAGED_COST_ITERATIONS; i++)
+	{
+		value = value * 0.999f + (float)event;
+	}
+	*state += value;
+}
+
+static void pointerCallback(int id, int event, PointerType type, Vector2 position, PointerData data)
+{
+	consumeEvent(id, event, type, position, data);
+}
+
+// Event synthesis
+// ----------------------------------------------------------------------------
+struct SyntheticEvent
+{
+	XIDeviceEvent event;
+	unsigned char valuatorMask[1];
+	double values[5];
+};
+
+class EventStream
+{
+private:
+	std::vector<SyntheticEvent> mEvents;
+	std::vector<size_t> mFrameEnds;
+
+public:
+	void add(int evtype, int sourceId, int detail, Window window, double x, double y, double pressure)
+	{
+		mEvents.push_back(SyntheticEvent());
+		SyntheticEvent& e = mEvents.back();
+		memset(&e, 0, sizeof(e));
+		e.event.type = GenericEvent;
+		e.event.evtype = evtype;
+		e.event.deviceid = MASTER_POINTER_ID;
+		e.event.sourceid = sourceId;
+		e.event.detail = detail;
+		e.event.event = window;
+		e.event.event_x = x;
+		e.event.event_y = y;
+		e.event.time = (Time)(mEvents.size() + 1);
+
+		if (sourceId == TOUCH_DEVICE_ID)
+		{
+			// Position, pressure, touch major and orientation
+			e.valuatorMask[0] = 0x1f;
+			e.values[0] = x;
+			e.values[1] = y;
+			e.values[2] = pressure;
+			e.values[3] = 12.0;
+			e.values[4] = 3.0;
+		}
+	}
+
+	void endFrame() { mFrameEnds.push_back(mEvents.size()); }
+
+	// Pointers into the records are only fixed once the stream is complete
+	void finish()
+	{
+		for (size_t i = 0; i < mEvents.size(); i++)
+		{
+			SyntheticEvent& e = mEvents[i];
+			e.event.valuators.mask_len = e.valuatorMask[0] != 0 ? 1 : 0;
+			e.event.valuators.mask = e.valuatorMask;
+			e.event.valuators.values = e.values;
+		}
+	}
+
+	size_t getNumFrames() const { return mFrameEnds.size(); }
+	size_t getFrameBegin(size_t frame) const { return frame == 0 ? 0 : mFrameEnds[frame - 1]; }
+	size_t getFrameEnd(size_t frame) const { return mFrameEnds[frame]; }
+	const XIDeviceEvent& getEvent(size_t index) const { return mEvents[index].event; }
+};
+
+static void addMouseEvents(EventStream& stream, Window window, int frame, int numMotions)
+{
+	bool click = (frame % 8) == 0;
+	if (click)
+	{
+		stream.add(XI_ButtonPress, MOUSE_DEVICE_ID, 1, window, 100.0 + frame, 100.0, 0.0);
+	}
+	for (int i = 0; i < numMotions; i++)
+	{
+		stream.add(XI_Motion, MOUSE_DEVICE_ID, 0, window, 100.0 + frame + i * 0.25, 100.0 + i, 0.0);
+	}
+	if (click)
+	{
+		stream.add(XI_ButtonRelease, MOUSE_DEVICE_ID, 1, window, 100.0 + frame, 100.0 + numMotions, 0.0);
+	}
+}
+
+// Fingers go down in the first frame of a gesture and up in the last, with updates in between
+static void addTouchEvents(EventStream& stream, const Window* windows, int numWindows, int numFingers,
+	int updatesPerFinger, int frame, int gestureLength)
+{
+	int gesture = frame / gestureLength;
+	int gestureFrame = frame % gestureLength;
+
+	for (int update = 0; update < updatesPerFinger; update++)
+	{
+		for (int finger = 0; finger < numFingers; finger++)
+		{
+			Window window = windows[finger % numWindows];
+			int touchId = gesture * numFingers + finger + 1;
+			double x = 200.0 + finger * 80.0 + gestureFrame * 2.0 + update * 0.5;
+			double y = 300.0 + finger * 10.0 + gestureFrame;
+
+			int evtype = XI_TouchUpdate;
+			if (gestureFrame == 0 && update == 0)
+			{
+				evtype = XI_TouchBegin;
+			}
+			else if (gestureFrame == gestureLength - 1 && update == updatesPerFinger - 1)
+			{
+				evtype = XI_TouchEnd;
+			}
+
+			stream.add(evtype, TOUCH_DEVICE_ID, touchId, window, x, y, 40.0 + finger);
+		}
+	}
+}
+
+struct Scenario
+{
+	const char* name;
+	int numWindows;
+	int numFingers;
+	int updatesPerFinger;
+	int numMouseMotions;
+};
+
+static void createStream(const Scenario& scenario, const std::vector<Window>& windows, EventStream& stream)
+{
+	const int numFrames = 240;
+	const int gestureLength = 30;
+
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		if (scenario.numFingers > 0)
+		{
+			addTouchEvents(stream, windows.data(), scenario.numWindows, scenario.numFingers,
+				scenario.updatesPerFinger, frame, gestureLength);
+		}
+		if (scenario.numMouseMotions > 0)
+		{
+			addMouseEvents(stream, windows[frame % scenario.numWindows], frame, scenario.numMouseMotions);
+		}
+		stream.endFrame();
+	}
+	stream.finish();
+}
+
+// Benchmark
+// ----------------------------------------------------------------------------
+static void createTouchDevice(DeviceAxesTable& deviceAxes)
+{
+	// Position X and Y, pressure, touch major and orientation
+	const double maxValues[] = { 4095.0, 4095.0, 255.0, 255.0, 90.0 };
+
+	// Label atoms are assigned directly, as there is no display connection to intern them. The device has
+	// no touch minor axis.
+	deviceAxes.setLabel(DA_PRESSURE, 3);
+	deviceAxes.setLabel(DA_TOUCH_MAJOR, 4);
+	deviceAxes.setLabel(DA_TOUCH_MINOR, 100);
+	deviceAxes.setLabel(DA_ORIENTATION, 5);
+
+	XIValuatorClassInfo valuators[5];
+	XIAnyClassInfo* classes[5];
+	for (int i = 0; i < 5; i++)
+	{
+		memset(&valuators[i], 0, sizeof(XIValuatorClassInfo));
+		valuators[i].type = XIValuatorClass;
+		valuators[i].sourceid = TOUCH_DEVICE_ID;
+		valuators[i].number = i;
+		valuators[i].label = (Atom)(i + 1);
+		valuators[i].min = 0.0;
+		valuators[i].max = maxValues[i];
+		classes[i] = (XIAnyClassInfo*)&valuators[i];
+	}
+
+	XIDeviceInfo device;
+	memset(&device, 0, sizeof(device));
+	device.deviceid = TOUCH_DEVICE_ID;
+	device.use = XISlavePointer;
+	device.num_classes = 5;
+	device.classes = classes;
+	deviceAxes.update(device);
+}
+
+struct BenchmarkResult
+{
+	std::string scenario;
+	bool buffered;
+	bool coalesce;
+	bool predict;
+	bool gestures;
+	unsigned long long numEvents;
+	double seconds;
+	double numAllocations;
+};
+
+static void runFrame(const EventStream& stream, size_t frame, const DeviceAxesTable& deviceAxes,
+	PointerHandlerSystem& system, const std::vector<HandlerHandle>& handles, bool buffered, bool gestures,
+	std::vector<DeviceEvent>& events, PointerEventData* pointerEvents, GestureEventData* gestureEvents)
+{
+	size_t begin = stream.getFrameBegin(frame);
+	size_t end = stream.getFrameEnd(frame);
+
+	events.resize(end - begin);
+	for (size_t i = begin; i < end; i++)
+	{
+		decodeDeviceEvent(&stream.getEvent(i), getMonotonicTime(), deviceAxes, &events[i - begin]);
+	}
+
+	system.processEvents(events.data(), events.size());
+
+	if (buffered)
+	{
+		for (size_t i = 0; i < handles.size(); i++)
+		{
+			PointerHandler* handler = system.getHandler(handles[i]);
+			int numEvents;
+			do
+			{
+				handler->getPointerEvents(pointerEvents, MAX_EVENTS_PER_FRAME, &numEvents);
+				for (int j = 0; j < numEvents; j++)
+				{
+					const PointerEventData& e = pointerEvents[j];
+					consumeEvent(e.id, e.event, e.type, e.position, e.data);
+				}
+			} while (numEvents == MAX_EVENTS_PER_FRAME);
+		}
+	}
+
+	// Gestures are buffered regardless of the mode of the handler
+	if (gestures)
+	{
+		for (size_t i = 0; i < handles.size(); i++)
+		{
+			PointerHandler* handler = system.getHandler(handles[i]);
+			int numEvents;
+			handler->getGestureEvents(gestureEvents, GESTURE_MAX_EVENTS, &numEvents);
+			for (int j = 0; j < numEvents; j++)
+			{
+				sManagedState[gestureEvents[j].id & 1023] += gestureEvents[j].position.x;
+			}
+		}
+	}
+}
+
+static BenchmarkResult runScenario(const Scenario& scenario, bool buffered, bool coalesce, bool predict,
+	bool gestures)
+{
+	std::vector<Window> windows;
+	for (int i = 0; i < scenario.numWindows; i++)
+	{
+		windows.push_back(0x3a00007 + i * 0x200000);
+	}
+
+	EventStream stream;
+	createStream(scenario, windows, stream);
+
+	DeviceAxesTable deviceAxes;
+	createTouchDevice(deviceAxes);
+
+	SystemSettings settings = {};
+	settings.minMessageType = MT_INFO;
+	PointerHandlerSystem system(nullptr, settings);
+
+	std::vector<HandlerHandle> handles;
+	for (int i = 0; i < scenario.numWindows; i++)
+	{
+		PointerHandler handler(NULL, i, windows[i], system.getLogger(), buffered ? nullptr : pointerCallback);
+		handler.setScreenParams(1920, 1080, 0.0f, 0.0f, 1.0f, 1.0f);
+		handler.setCoalescing(coalesce, false);
+		handler.setPrediction(predict, 16.0f);
+		handler.setGestureRecognition(gestures, nullptr);
+
+		HandlerHandle handle;
+		system.addHandler(std::move(handler), &handle);
+		handles.push_back(handle);
+	}
+
+	std::vector<DeviceEvent> events;
+	events.reserve(MAX_EVENTS_PER_FRAME);
+	PointerEventData* pointerEvents = new PointerEventData[MAX_EVENTS_PER_FRAME];
+	GestureEventData* gestureEvents = new GestureEventData[GESTURE_MAX_EVENTS];
+
+	// Let buffers grow to their steady state size
+	size_t frame = 0;
+	for (int i = 0; i < WARMUP_FRAMES; i++, frame++)
+	{
+		runFrame(stream, frame % stream.getNumFrames(), deviceAxes, system, handles, buffered, gestures, events,
+			pointerEvents, gestureEvents);
+	}
+
+	unsigned long long numEvents = 0;
+	unsigned long long numAllocations = sNumAllocations;
+	Clock::time_point start = Clock::now();
+	while (numEvents < MIN_EVENTS)
+	{
+		size_t index = frame % stream.getNumFrames();
+		runFrame(stream, index, deviceAxes, system, handles, buffered, gestures, events, pointerEvents,
+			gestureEvents);
+		numEvents += stream.getFrameEnd(index) - stream.getFrameBegin(index);
+		frame++;
+	}
+	Clock::time_point end = Clock::now();
+
+	BenchmarkResult result;
+	result.scenario = scenario.name;
+	result.buffered = buffered;
+	result.coalesce = coalesce;
+	result.predict = predict;
+	result.gestures = gestures;
+	result.numEvents = numEvents;
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	result.numAllocations = (double)(sNumAllocations - numAllocations);
+
+	delete[] pointerEvents;
+	delete[] gestureEvents;
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	const Scenario scenarios[] = {
+		// name, windows, fingers, updates per finger, mouse motions
+		{ "mouse", 1, 0, 0, 16 },
+		{ "touch10", 1, 10, 4, 0 },
+		{ "mixed", 1, 10, 4, 16 },
+		{ "windows64", 64, 128, 2, 0 }
+	};
+
+	std::vector<BenchmarkResult> results;
+	for (const Scenario& scenario : scenarios)
+	{
+		for (int buffered = 0; buffered < 2; buffered++)
+		{
+			for (int coalesce = 0; coalesce < 2; coalesce++)
+			{
+				// Prediction and gesture recognition are measured on their own
+				for (int feature = 0; feature < 3; feature++)
+				{
+					results.push_back(runScenario(scenario, buffered != 0, coalesce != 0, feature == 1,
+						feature == 2));
+					const BenchmarkResult& r = results.back();
+					fprintf(stderr, "%-10s %-8s %-10s %-9s %-8s %8.1f ns/event\n", r.scenario.c_str(),
+						r.buffered ? "buffered" : "callback", r.coalesce ? "coalesced" : "",
+						r.predict ? "predicted" : "", r.gestures ? "gestures" : "",
+						r.seconds * 1e9 / r.numEvents);
+				}
+			}
+		}
+	}
+
+	FILE* file = argc > 1 ? fopen(argv[1], "w") : stdout;
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	fprintf(file, "{\n  \"benchmark\": \"dispatch\",\n  \"managed_cost_iterations\": %d,\n  \"results\": [\n",
+		MANAGED_COST_ITERATIONS);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		fprintf(file, "    { \"scenario\": \"%s\", \"mode\": \"%s\", \"coalesce\": %s, \"predict\": %s, "
+			"\"gestures\": %s, \"events\": %llu, \"events_per_sec\": %.0f, \"ns_per_event\": %.2f, "
+			"\"allocations_per_event\": %.6f }%s\n",
+			r.scenario.c_str(), r.buffered ? "buffered" : "callback", r.coalesce ? "true" : "false",
+			r.predict ? "true" : "false", r.gestures ? "true" : "false", r.numEvents, r.numEvents / r.seconds,
+			r.seconds * 1e9 / r.numEvents, r.numAllocations / r.numEvents, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+Measures filtering the samples of many touches reported at 120 Hz by an overlay jittering at rest, interleaved as
+the overlay reports them. Touches at rest show how much of the jitter is filtered out and how many updates the
+dead zone suppresses, moving touches show how far the filtered position lags behind the true one. The errors are
+the root mean square distances of the raw and filtered positions to the true positions.
+Results are written as JSON to stdout, or to the file passed as the first argument.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../X11TouchMultiWindowFilter.h"
+
+#define SAMPLE_INTERVAL 8333333
+#define MIN_SAMPLES 4000000
+// Largest distance a sample jitters away from the true position, in pixels
+#define JITTER 3.0f
+#define DEAD_ZONE 1.5f
+// Speed of moving touches in pixels per second
+#define SPEED 1000.0f
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scenario
+{
+	const char* name;
+	int numTouches;
+	bool moving;
+};
+
+// ----------------------------------------------------------------------------
+static float jitter()
+{
+	return ((float)rand() / RAND_MAX * 2.0f - 1.0f) * JITTER;
+}
+
+int main(int argc, char** argv)
+{
+	const Scenario scenarios[] = {
+		{ "10_touches_rest", 10, false },
+		{ "80_touches_rest", 80, false },
+		{ "160_touches_rest", 160, false },
+		{ "10_touches_moving", 10, true },
+		{ "80_touches_moving", 80, true },
+		{ "160_touches_moving", 160, true }
+	};
+
+	FILE* file = argc > 1 ? fopen(argv[1], "w") : stdout;
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	FilterSettings settings;
+	settings.minCutoff = 1.0f;
+	settings.beta = 0.007f;
+	settings.derivativeCutoff = 1.0f;
+	settings.deadZone = DEAD_ZONE;
+
+	fprintf(file, "{\n  \"benchmark\": \"filter\",\n  \"results\": [\n");
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++)
+	{
+		const Scenario& scenario = scenarios[s];
+		int numFrames = MIN_SAMPLES / scenario.numTouches;
+
+		// The true positions of every frame, and the raw samples jittering around them
+		srand(1);
+		std::vector<Vector2> truePositions((size_t)numFrames * scenario.numTouches);
+		std::vector<Vector2> samples(truePositions.size());
+		for (int f = 0; f < numFrames; f++)
+		{
+			float distance = scenario.moving ? SPEED * f * (SAMPLE_INTERVAL * 1e-9f) : 0.0f;
+			for (int t = 0; t < scenario.numTouches; t++)
+			{
+				size_t i = (size_t)f * scenario.numTouches + t;
+				truePositions[i] = Vector2(fmodf(100.0f + 20.0f * t + distance, 3840.0f), 100.0f + 10.0f * t);
+				samples[i] = Vector2(truePositions[i].x + jitter(), truePositions[i].y + jitter());
+			}
+		}
+
+		PointerFilter filter;
+		filter.setSettings(settings);
+		std::vector<Vector2> filtered(samples.size());
+		std::vector<bool> emitted(samples.size());
+
+		Clock::time_point start = Clock::now();
+		for (int f = 0; f < numFrames; f++)
+		{
+			uint64_t time = (uint64_t)f * SAMPLE_INTERVAL;
+			PointerEvent event = f == 0 ? PE_DOWN : PE_UPDATE;
+			for (int t = 0; t < scenario.numTouches; t++)
+			{
+				size_t i = (size_t)f * scenario.numTouches + t;
+				Vector2 position = samples[i];
+				emitted[i] = filter.filter(t, event, time, position);
+				filtered[i] = position;
+			}
+		}
+		double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		// Skips the first second, while the filter settles
+		double rawError = 0.0, filteredError = 0.0, lag = 0.0;
+		unsigned long long numMeasured = 0, numSuppressed = 0;
+		for (size_t i = (size_t)120 * scenario.numTouches; i < samples.size(); i++)
+		{
+			float rawDx = samples[i].x - truePositions[i].x, rawDy = samples[i].y - truePositions[i].y;
+			float dx = filtered[i].x - truePositions[i].x, dy = filtered[i].y - truePositions[i].y;
+			// The x wraps around the screen while moving
+			if (fabsf(dx) > 100.0f)
+			{
+				continue;
+			}
+
+			rawError += rawDx * rawDx + rawDy * rawDy;
+			filteredError += dx * dx + dy * dy;
+			lag += sqrtf(dx * dx + dy * dy);
+			numMeasured++;
+			numSuppressed += emitted[i] ? 0 : 1;
+		}
+
+		fprintf(file, "%s    { \"scenario\": \"%s\", \"touches\": %d, \"samples\": %zu, \"ns_per_sample\": %.1f, "
+			"\"raw_error_px\": %.3f, \"filtered_error_px\": %.3f, \"mean_lag_px\": %.3f, "
+			"\"suppressed_fraction\": %.3f }", s == 0 ? "" : ",\n", scenario.name, scenario.numTouches,
+			samples.size(), elapsed / samples.size(), sqrt(rawError / numMeasured),
+			sqrt(filteredError / numMeasured), lag / numMeasured, (double)numSuppressed / numMeasured);
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
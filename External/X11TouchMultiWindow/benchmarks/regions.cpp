@@ -0,0 +1,212 @@
+/*
+Measures hit testing the pointers going down on a table with hundreds of registered regions, with the grid
+index of a handler and with a linear scan over all regions as a managed hit test would do it, and the cost of
+moving a region. The index is checked against the linear scan before it is timed.
+Results are written as JSON to stdout, or to the file passed as the first argument.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../X11TouchMultiWindowRegions.h"
+
+#define NUM_POINTS 4096
+#define MIN_HIT_TESTS 2000000
+#define SCREEN_WIDTH 3840
+#define SCREEN_HEIGHT 2160
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scenario
+{
+	const char* name;
+	int numRegions;
+};
+
+struct Regions
+{
+	std::vector<RegionData> regions;
+	std::vector<std::vector<Vector2> > vertices;
+};
+
+// ----------------------------------------------------------------------------
+static void createRegions(const Scenario& scenario, Regions& regions)
+{
+	srand(1);
+
+	// A background covering the whole table, with buttons, knobs and triangular tabs on top of it
+	RegionData background;
+	background.id = 1;
+	background.layer = 0;
+	background.shape = RS_RECT;
+	background.position = Vector2(0.0f, 0.0f);
+	background.size = Vector2(SCREEN_WIDTH, SCREEN_HEIGHT);
+	regions.regions.push_back(background);
+	regions.vertices.push_back(std::vector<Vector2>());
+
+	for (int i = 1; i < scenario.numRegions; i++)
+	{
+		RegionData region;
+		region.id = i + 1;
+		region.layer = 1 + rand() % 3;
+		region.shape = (RegionShape)(i % 3);
+		region.position = Vector2((float)(rand() % SCREEN_WIDTH), (float)(rand() % SCREEN_HEIGHT));
+		region.size = Vector2((float)(40 + rand() % 80), (float)(40 + rand() % 80));
+
+		std::vector<Vector2> vertices;
+		if (region.shape == RS_CIRCLE)
+		{
+			region.size.x *= 0.5f;
+		}
+		else if (region.shape == RS_POLYGON)
+		{
+			vertices.push_back(Vector2(0.0f, 0.0f));
+			vertices.push_back(Vector2(region.size.x, 0.0f));
+			vertices.push_back(Vector2(region.size.x * 0.5f, region.size.y));
+		}
+		regions.regions.push_back(region);
+		regions.vertices.push_back(vertices);
+	}
+}
+// ----------------------------------------------------------------------------
+static bool containsReference(const RegionData& region, const std::vector<Vector2>& vertices, const Vector2& point)
+{
+	float x = point.x - region.position.x;
+	float y = point.y - region.position.y;
+	switch (region.shape)
+	{
+		case RS_RECT:
+			return x >= 0.0f && y >= 0.0f && x <= region.size.x && y <= region.size.y;
+		case RS_CIRCLE:
+			return x * x + y * y <= region.size.x * region.size.x;
+		case RS_POLYGON:
+			{
+				bool inside = false;
+				for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+				{
+					if ((vertices[i].y > y) != (vertices[j].y > y) &&
+						x < (vertices[j].x - vertices[i].x) * (y - vertices[i].y) / (vertices[j].y - vertices[i].y) +
+						vertices[i].x)
+					{
+						inside = !inside;
+					}
+				}
+				return inside;
+			}
+	}
+	return false;
+}
+// ----------------------------------------------------------------------------
+static int hitTestReference(const Regions& regions, const Vector2& point)
+{
+	// Later regions are on top of earlier ones on the same layer
+	int top = -1;
+	for (size_t i = 0; i < regions.regions.size(); i++)
+	{
+		const RegionData& region = regions.regions[i];
+		if ((top < 0 || region.layer >= regions.regions[top].layer) &&
+			containsReference(region, regions.vertices[i], point))
+		{
+			top = (int)i;
+		}
+	}
+	return top >= 0 ? regions.regions[top].id : 0;
+}
+
+int main(int argc, char** argv)
+{
+	const Scenario scenarios[] = {
+		{ "hotspots_100", 100 },
+		{ "hotspots_500", 500 },
+		{ "hotspots_2000", 2000 }
+	};
+
+	FILE* file = argc > 1 ? fopen(argv[1], "w") : stdout;
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	fprintf(file, "{\n  \"benchmark\": \"regions\",\n  \"results\": [\n");
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++)
+	{
+		const Scenario& scenario = scenarios[s];
+		Regions regions;
+		createRegions(scenario, regions);
+
+		RegionIndex index;
+		for (size_t i = 0; i < regions.regions.size(); i++)
+		{
+			const std::vector<Vector2>& vertices = regions.vertices[i];
+			index.add(regions.regions[i], vertices.empty() ? nullptr : vertices.data(), (int)vertices.size());
+		}
+
+		std::vector<Vector2> points(NUM_POINTS);
+		for (int i = 0; i < NUM_POINTS; i++)
+		{
+			points[i] = Vector2((float)(rand() % SCREEN_WIDTH), (float)(rand() % SCREEN_HEIGHT));
+			if (index.hitTest(points[i]) != hitTestReference(regions, points[i]))
+			{
+				fprintf(stderr, "Index differs from the linear scan at (%.0f, %.0f) for %s\n", points[i].x,
+					points[i].y, scenario.name);
+				return 1;
+			}
+		}
+
+		int numRepetitions = std::max(1, MIN_HIT_TESTS / NUM_POINTS);
+		long long indexedSum = 0;
+		Clock::time_point start = Clock::now();
+		for (int r = 0; r < numRepetitions; r++)
+		{
+			for (int i = 0; i < NUM_POINTS; i++)
+			{
+				indexedSum += index.hitTest(points[i]);
+			}
+		}
+		Clock::time_point end = Clock::now();
+		double indexed = std::chrono::duration<double, std::nano>(end - start).count() /
+			((double)numRepetitions * NUM_POINTS);
+
+		// The linear scan is slow enough for a single repetition
+		long long linearSum = 0;
+		start = Clock::now();
+		for (int i = 0; i < NUM_POINTS; i++)
+		{
+			linearSum += hitTestReference(regions, points[i]);
+		}
+		end = Clock::now();
+		double linear = std::chrono::duration<double, std::nano>(end - start).count() / NUM_POINTS;
+		if (indexedSum != linearSum * numRepetitions)
+		{
+			fprintf(stderr, "Hit tests of the index and the linear scan differ for %s\n", scenario.name);
+			return 1;
+		}
+
+		// Regions dragged around by a pointer each, back and forth so the cells they move through are reused
+		int numMoves = MIN_HIT_TESTS / 10;
+		start = Clock::now();
+		for (int i = 0; i < numMoves; i++)
+		{
+			const RegionData& region = regions.regions[1 + i % (regions.regions.size() - 1)];
+			float offset = (float)((i / (int)regions.regions.size()) % 32) * 8.0f;
+			index.move(region.id, Vector2(region.position.x + offset, region.position.y));
+		}
+		end = Clock::now();
+		double move = std::chrono::duration<double, std::nano>(end - start).count() / numMoves;
+
+		fprintf(file, "%s    { \"scenario\": \"%s\", \"regions\": %d, \"ns_per_hit_test\": %.1f, "
+			"\"ns_per_linear_hit_test\": %.1f, \"speedup\": %.1f, \"ns_per_move\": %.1f }", s == 0 ? "" : ",\n",
+			scenario.name, scenario.numRegions, indexed, linear, linear / indexed, move);
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
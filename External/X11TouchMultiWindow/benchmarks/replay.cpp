@@ -0,0 +1,149 @@
+/*
+Replays a recording made with PointerHandlerSystem_StartRecording through a PointerHandlerSystem without
+an X server, either as fast as possible or at the recorded timing. All events are delivered to a single
+buffered handler with coalescing, as used by the managed side.
+
+Usage: X11TouchMultiWindowReplayBenchmark <recording> [--realtime] [--passes <n>] [--output <file>]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../X11TouchMultiWindowPointerHandler.h"
+#include "../X11TouchMultiWindowPointerHandlerSystem.h"
+#include "../X11TouchMultiWindowRecording.h"
+#include "../X11TouchMultiWindowUtils.h"
+
+#define BATCH_SIZE 1024
+#define FRAME_INTERVAL std::chrono::milliseconds(16)
+#define REPLAY_WINDOW 1
+
+static unsigned long long drainEvents(PointerHandler* handler, PointerEventData* events)
+{
+	unsigned long long numPointerEvents = 0;
+	int numEvents;
+	do
+	{
+		handler->getPointerEvents(events, BATCH_SIZE, &numEvents);
+		numPointerEvents += numEvents;
+	} while (numEvents == BATCH_SIZE);
+
+	return numPointerEvents;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = nullptr;
+	const char* outputPath = nullptr;
+	bool realtime = false;
+	int numPasses = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--realtime") == 0)
+		{
+			realtime = true;
+		}
+		else if (strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+		{
+			numPasses = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else
+		{
+			path = argv[i];
+		}
+	}
+
+	if (path == nullptr || numPasses < 1)
+	{
+		fprintf(stderr, "Usage: %s <recording> [--realtime] [--passes <n>] [--output <file>]\n", argv[0]);
+		return 1;
+	}
+
+	EventReplay replay;
+	if (replay.open(path) != R_OK)
+	{
+		fprintf(stderr, "Failed to open recording %s\n", path);
+		return 1;
+	}
+
+	for (int i = 0; i < replay.getNumDevices(); i++)
+	{
+		const RecordedDevice& device = replay.getDevice(i);
+		fprintf(stderr, "Device %d '%s', use %d, axes 0x%x\n", device.deviceId, device.name, device.use,
+			device.axesMask);
+	}
+
+	SystemSettings settings = {};
+	settings.minMessageType = MT_INFO;
+	PointerHandlerSystem system(nullptr, settings);
+
+	PointerHandler handler(NULL, 0, REPLAY_WINDOW, system.getLogger(), nullptr);
+	handler.setScreenParams(1920, 1080, 0.0f, 0.0f, 1.0f, 1.0f);
+	handler.setCoalescing(true, false);
+
+	HandlerHandle handle;
+	system.addHandler(std::move(handler), &handle);
+	PointerHandler* replayHandler = system.getHandler(handle);
+
+	std::vector<DeviceEvent> events(BATCH_SIZE);
+	std::vector<PointerEventData> pointerEvents(BATCH_SIZE);
+
+	unsigned long long numEvents = 0;
+	unsigned long long numPointerEvents = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < numPasses; pass++)
+	{
+		replay.start(getMonotonicTime(), REPLAY_WINDOW);
+		while (!replay.isFinished())
+		{
+			uint64_t time = realtime ? getMonotonicTime() : UINT64_MAX;
+			size_t count;
+			do
+			{
+				count = replay.read(events.data(), events.size(), time);
+				system.processEvents(events.data(), count);
+				numPointerEvents += drainEvents(replayHandler, pointerEvents.data());
+				numEvents += count;
+			} while (count == events.size());
+
+			if (realtime)
+			{
+				std::this_thread::sleep_for(FRAME_INTERVAL);
+			}
+		}
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(end - start).count();
+
+	LatencyStats stats;
+	replayHandler->getLatencyStats(&stats);
+
+	FILE* file = outputPath != nullptr ? fopen(outputPath, "w") : stdout;
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", outputPath);
+		return 1;
+	}
+
+	fprintf(file, "{\n  \"benchmark\": \"replay\",\n  \"recording\": \"%s\",\n  \"mode\": \"%s\",\n"
+		"  \"passes\": %d,\n  \"events\": %llu,\n  \"pointer_events\": %llu,\n  \"seconds\": %.6f,\n"
+		"  \"events_per_sec\": %.0f,\n  \"ns_per_event\": %.2f,\n"
+		"  \"queue_latency_us\": { \"p50\": %llu, \"p99\": %llu, \"max\": %llu }\n}\n",
+		path, realtime ? "realtime" : "fast", numPasses, numEvents, numPointerEvents, seconds,
+		numEvents / seconds, numEvents > 0 ? seconds * 1e9 / numEvents : 0.0,
+		stats.queueP50, stats.queueP99, stats.queueMax);
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
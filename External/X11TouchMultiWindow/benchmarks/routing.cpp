@@ -0,0 +1,128 @@
+/*
+Compares the cost of routing events to their handler by window, using the flat handler table
+against the std::map it replaced.
+*/
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "../X11TouchMultiWindowPointerHandler.h"
+#include "../X11TouchMultiWindowPointerHandlerTable.h"
+
+#define NUM_LOOKUPS 10000000
+// Events arrive in bursts per window, roughly a frame worth of touch updates
+#define BURST_LENGTH 16
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static std::vector<Window> createWindows(int numWindows)
+{
+	std::vector<Window> windows;
+	for (int i = 0; i < numWindows; i++)
+	{
+		// X server assigned ids are spread over the resource id range of the client
+		windows.push_back(0x3a00007 + i * 0x200000 + (i * 7919) % 97);
+	}
+	return windows;
+}
+
+static std::vector<Window> createEventWindows(const std::vector<Window>& windows)
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> distribution(0, windows.size() - 1);
+
+	std::vector<Window> eventWindows;
+	eventWindows.reserve(NUM_LOOKUPS);
+	while (eventWindows.size() < NUM_LOOKUPS)
+	{
+		Window window = windows[distribution(random)];
+		for (int i = 0; i < BURST_LENGTH && eventWindows.size() < NUM_LOOKUPS; i++)
+		{
+			eventWindows.push_back(window);
+		}
+	}
+	return eventWindows;
+}
+
+static double benchmarkMap(const std::vector<Window>& windows, const std::vector<Window>& eventWindows,
+	uintptr_t* checksum)
+{
+	std::map<Window, PointerHandler*> handlers;
+	for (size_t i = 0; i < windows.size(); i++)
+	{
+		handlers.insert(std::make_pair(windows[i], new PointerHandler(NULL, i, windows[i], nullptr, nullptr)));
+	}
+
+	uintptr_t sum = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < eventWindows.size(); i++)
+	{
+		std::map<Window, PointerHandler*>::iterator it = handlers.find(eventWindows[i]);
+		if (it != handlers.end())
+		{
+			sum += it->second->getTargetDisplay();
+		}
+	}
+	Clock::time_point end = Clock::now();
+
+	for (std::map<Window, PointerHandler*>::iterator it = handlers.begin(); it != handlers.end(); ++it)
+	{
+		delete it->second;
+	}
+
+	*checksum = sum;
+	return std::chrono::duration<double, std::nano>(end - start).count() / eventWindows.size();
+}
+
+static double benchmarkTable(const std::vector<Window>& windows, const std::vector<Window>& eventWindows,
+	uintptr_t* checksum)
+{
+	PointerHandlerTable handlers;
+	for (size_t i = 0; i < windows.size(); i++)
+	{
+		HandlerHandle handle;
+		handlers.add(PointerHandler(NULL, i, windows[i], nullptr, nullptr), &handle);
+	}
+
+	uintptr_t sum = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < eventWindows.size(); i++)
+	{
+		PointerHandler* handler = handlers.find(eventWindows[i]);
+		if (handler != nullptr)
+		{
+			sum += handler->getTargetDisplay();
+		}
+	}
+	Clock::time_point end = Clock::now();
+
+	*checksum = sum;
+	return std::chrono::duration<double, std::nano>(end - start).count() / eventWindows.size();
+}
+
+int main()
+{
+	const int windowCounts[] = { 1, 8, 64 };
+
+	printf("%8s %14s %14s %8s\n", "windows", "map ns/event", "table ns/event", "speedup");
+	for (int numWindows : windowCounts)
+	{
+		std::vector<Window> windows = createWindows(numWindows);
+		std::vector<Window> eventWindows = createEventWindows(windows);
+
+		uintptr_t mapChecksum, tableChecksum;
+		double mapTime = benchmarkMap(windows, eventWindows, &mapChecksum);
+		double tableTime = benchmarkTable(windows, eventWindows, &tableChecksum);
+		if (mapChecksum != tableChecksum)
+		{
+			fprintf(stderr, "Routing mismatch for %d windows\n", numWindows);
+			return 1;
+		}
+
+		printf("%8d %14.2f %14.2f %7.2fx\n", numWindows, mapTime, tableTime, mapTime / tableTime);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,223 @@
+/*
+Measures publishing decoded events to the shared ring of the broker and reading them back by the consumers of a
+window, each on its own thread as the processes reading through the broker would. Consumers wait for the wake up
+of the broker with poll, the latency is measured from publishing an event until a consumer read it. In the burst
+scenarios the broker publishes as fast as it can and never waits for its consumers, so they fall behind and lose
+events. Every consumer checks it reads all events in order, or notices the ones it lost.
+Results are written as JSON to stdout, or to the file passed as the first argument.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <poll.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "../X11TouchMultiWindowLogger.h"
+#include "../X11TouchMultiWindowSharedRingEventSource.h"
+#include "../X11TouchMultiWindowUtils.h"
+
+#define NUM_EVENTS 2000000
+#define BENCH_WINDOW 0x200
+#define READ_BATCH_SIZE 64
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scenario
+{
+	const char* name;
+	int numConsumers;
+	// Events published per cycle of the broker, before its consumers are woken up
+	int batchSize;
+	// Pause of the broker after each cycle in microseconds, 0 publishes as fast as possible
+	int cycleInterval;
+};
+
+struct ConsumerResult
+{
+	unsigned long long numEvents;
+	unsigned long long numDroppedEvents;
+	bool ordered;
+	std::vector<uint64_t> latencies;
+};
+
+// ----------------------------------------------------------------------------
+static void consume(SharedRingEventSource* source, std::atomic<bool>* done, ConsumerResult* result)
+{
+	std::vector<DeviceEvent> events(READ_BATCH_SIZE);
+	long long expected = 0;
+	result->numEvents = 0;
+	result->numDroppedEvents = 0;
+	result->ordered = true;
+
+	while (expected < NUM_EVENTS)
+	{
+		size_t numEvents = source->read(events.data(), events.size());
+		if (numEvents == 0)
+		{
+			if (done->load() && !source->hasPendingEvents())
+			{
+				break;
+			}
+
+			struct pollfd fd = { source->getFd(), POLLIN, 0 };
+			poll(&fd, 1, 10);
+			continue;
+		}
+
+		uint64_t time = getMonotonicTime();
+		for (size_t i = 0; i < numEvents; i++)
+		{
+			const DeviceEvent& event = events[i];
+			if (event.detail < expected)
+			{
+				result->ordered = false;
+			}
+			result->numDroppedEvents += event.detail - expected;
+			expected = event.detail + 1;
+
+			// Sampled, so the latencies don't take more memory than the ring
+			if ((event.detail & 63) == 0)
+			{
+				result->latencies.push_back(time - event.receiveTime);
+			}
+		}
+		result->numEvents += numEvents;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const Scenario scenarios[] = {
+		{ "1_consumer_burst", 1, 64, 0 },
+		{ "4_consumers_burst", 4, 64, 0 },
+		{ "1_consumer_1khz", 1, 10, 1000 },
+		{ "4_consumers_1khz", 4, 10, 1000 }
+	};
+
+	FILE* file = argc > 1 ? fopen(argv[1], "w") : stdout;
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	Logger logger(nullptr, MT_ERROR);
+	std::string name = "/x11touch-benchmark-" + std::to_string(getpid());
+
+	fprintf(file, "{\n  \"benchmark\": \"sharedring\",\n  \"results\": [\n");
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++)
+	{
+		const Scenario& scenario = scenarios[s];
+		int numEvents = scenario.cycleInterval > 0 ? NUM_EVENTS / 20 : NUM_EVENTS;
+
+		SharedRingWriter writer(&logger, name, false);
+		if (writer.open() != R_OK)
+		{
+			fprintf(stderr, "Failed to create shared memory '%s'\n", name.c_str());
+			return 1;
+		}
+
+		std::vector<SharedRingEventSource*> sources;
+		for (int c = 0; c < scenario.numConsumers; c++)
+		{
+			SharedRingEventSource* source = new SharedRingEventSource(&logger, name);
+			if (source->open() != R_OK || source->selectEvents(BENCH_WINDOW, nullptr, 0) != R_OK)
+			{
+				fprintf(stderr, "Failed to attach consumer %d\n", c);
+				return 1;
+			}
+			sources.push_back(source);
+		}
+
+		std::vector<Window> added, removed;
+		writer.update(added, removed);
+
+		std::atomic<bool> done(false);
+		std::vector<ConsumerResult> results(scenario.numConsumers);
+		std::vector<std::thread> consumers;
+		for (int c = 0; c < scenario.numConsumers; c++)
+		{
+			consumers.push_back(std::thread(consume, sources[c], &done, &results[c]));
+		}
+
+		DeviceEvent event = {};
+		event.window = BENCH_WINDOW;
+		event.type = XI_TouchUpdate;
+		event.deviceId = 11;
+		event.sourceId = 11;
+
+		// Only the time spent publishing, not the pauses between the cycles
+		double publishTime = 0.0;
+		for (int i = 0; i < numEvents; )
+		{
+			Clock::time_point start = Clock::now();
+			for (int b = 0; b < scenario.batchSize && i < numEvents; b++, i++)
+			{
+				event.detail = i;
+				event.x = (double)(i % 1920);
+				event.y = (double)(i % 1080);
+				event.receiveTime = getMonotonicTime();
+				writer.publish(event);
+			}
+			writer.notify();
+			publishTime += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+			if (scenario.cycleInterval > 0)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(scenario.cycleInterval));
+			}
+		}
+		done = true;
+		for (size_t c = 0; c < consumers.size(); c++)
+		{
+			consumers[c].join();
+		}
+
+		unsigned long long numRead = 0, numDropped = 0;
+		bool ordered = true;
+		std::vector<uint64_t> latencies;
+		for (size_t c = 0; c < results.size(); c++)
+		{
+			numRead += results[c].numEvents;
+			numDropped += results[c].numDroppedEvents;
+			ordered = ordered && results[c].ordered;
+			latencies.insert(latencies.end(), results[c].latencies.begin(), results[c].latencies.end());
+		}
+
+		if (!ordered || numRead + numDropped != (unsigned long long)numEvents * scenario.numConsumers)
+		{
+			fprintf(stderr, "Consumers read events out of order or lost them unnoticed in %s\n", scenario.name);
+			return 1;
+		}
+
+		std::sort(latencies.begin(), latencies.end());
+		double p50 = latencies.empty() ? 0.0 : latencies[latencies.size() / 2] / 1000.0;
+		double p99 = latencies.empty() ? 0.0 : latencies[latencies.size() * 99 / 100] / 1000.0;
+
+		fprintf(file, "%s    { \"scenario\": \"%s\", \"consumers\": %d, \"events\": %d, \"ns_per_publish\": %.1f, "
+			"\"dropped_events\": %llu, \"latency_p50_us\": %.1f, \"latency_p99_us\": %.1f }", s == 0 ? "" : ",\n",
+			scenario.name, scenario.numConsumers, numEvents, publishTime / numEvents, numDropped, p50, p99);
+
+		for (size_t c = 0; c < sources.size(); c++)
+		{
+			delete sources[c];
+		}
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	shm_unlink(name.c_str());
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+/*
+Measures the transform of window coordinates to the screen space of a handler, per event on an array of
+positions as the handlers did before, and in batches on separate X and Y arrays with each kernel. The
+coordinates are read from a recording made with PointerHandlerSystem_StartRecording, or synthesized if
+none is given. Every kernel is checked against the scalar one before it is timed.
+
+Usage: X11TouchMultiWindowTransformBenchmark [<recording>] [--output <file>]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../X11TouchMultiWindowDeviceEvent.h"
+#include "../X11TouchMultiWindowRecording.h"
+#include "../X11TouchMultiWindowTransform.h"
+#include "../X11TouchMultiWindowUtils.h"
+
+#define READ_BATCH_SIZE 1024
+#define SYNTHETIC_POINTS 100000
+#define MIN_POINTS 20000000
+#define NUM_KERNELS 3
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t sBatchSizes[] = { 1024, 10000, 100000 };
+static const char* sKernelNames[NUM_KERNELS] = { "scalar", "sse2", "avx2" };
+
+struct TransformCase
+{
+	const char* name;
+	ScreenTransform transform;
+};
+
+// Coordinates
+// ----------------------------------------------------------------------------
+static bool readRecording(const char* path, std::vector<float>& x, std::vector<float>& y)
+{
+	EventReplay replay;
+	if (replay.open(path) != R_OK)
+	{
+		return false;
+	}
+
+	std::vector<DeviceEvent> events(READ_BATCH_SIZE);
+	replay.start(getMonotonicTime(), None);
+	while (!replay.isFinished())
+	{
+		size_t count = replay.read(events.data(), events.size(), UINT64_MAX);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (isDeviceEventType(events[i].type))
+			{
+				x.push_back((float)events[i].x);
+				y.push_back((float)events[i].y);
+			}
+		}
+	}
+
+	return !x.empty();
+}
+
+static void synthesize(std::vector<float>& x, std::vector<float>& y)
+{
+	// Ten fingers drawing circles over a 1920x1080 window
+	for (int i = 0; i < SYNTHETIC_POINTS; i++)
+	{
+		int finger = i % 10;
+		float angle = (float)(i / 10) * 0.01f + finger * 0.6f;
+		x.push_back(960.0f + std::cos(angle) * (100.0f + finger * 40.0f));
+		y.push_back(540.0f + std::sin(angle) * (80.0f + finger * 30.0f));
+	}
+}
+
+// Kernels
+// ----------------------------------------------------------------------------
+static void transformPerEvent(const ScreenTransform& transform, Vector2* positions, size_t numPoints)
+{
+	for (size_t i = 0; i < numPoints; i++)
+	{
+		positions[i] = transform.apply(positions[i]);
+	}
+}
+
+static bool checkKernel(const ScreenTransform& transform, const std::vector<float>& x,
+	const std::vector<float>& y, TransformKernel kernel)
+{
+	// An odd count also covers the remainder that does not fill a vector
+	size_t numPoints = std::min(x.size(), (size_t)10007);
+	std::vector<float> expectedX(x.begin(), x.begin() + numPoints);
+	std::vector<float> expectedY(y.begin(), y.begin() + numPoints);
+	std::vector<float> actualX(expectedX);
+	std::vector<float> actualY(expectedY);
+	transformPoints(transform, expectedX.data(), expectedY.data(), numPoints, TK_SCALAR);
+	transformPoints(transform, actualX.data(), actualY.data(), numPoints, kernel);
+
+	for (size_t i = 0; i < numPoints; i++)
+	{
+		Vector2 position = transform.apply(Vector2(x[i], y[i]));
+		if (actualX[i] != expectedX[i] || actualY[i] != expectedY[i] ||
+			position.x != expectedX[i] || position.y != expectedY[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Measurement
+// ----------------------------------------------------------------------------
+// Each repetition starts from the source coordinates again, only the transform itself is timed
+static double measurePerEvent(const ScreenTransform& transform, const std::vector<Vector2>& source,
+	size_t batchSize)
+{
+	std::vector<Vector2> positions(batchSize);
+	size_t numRepetitions = std::max((size_t)1, (size_t)MIN_POINTS / batchSize);
+	Clock::duration elapsed = Clock::duration::zero();
+	for (size_t r = 0; r < numRepetitions; r++)
+	{
+		memcpy(positions.data(), source.data(), batchSize * sizeof(Vector2));
+		Clock::time_point start = Clock::now();
+		transformPerEvent(transform, positions.data(), batchSize);
+		elapsed += Clock::now() - start;
+	}
+	return std::chrono::duration<double, std::nano>(elapsed).count() / ((double)numRepetitions * batchSize);
+}
+
+static double measureBatch(const ScreenTransform& transform, const std::vector<float>& sourceX,
+	const std::vector<float>& sourceY, size_t batchSize, TransformKernel kernel)
+{
+	std::vector<float> x(batchSize);
+	std::vector<float> y(batchSize);
+	size_t numRepetitions = std::max((size_t)1, (size_t)MIN_POINTS / batchSize);
+	Clock::duration elapsed = Clock::duration::zero();
+	for (size_t r = 0; r < numRepetitions; r++)
+	{
+		memcpy(x.data(), sourceX.data(), batchSize * sizeof(float));
+		memcpy(y.data(), sourceY.data(), batchSize * sizeof(float));
+		Clock::time_point start = Clock::now();
+		transformPoints(transform, x.data(), y.data(), batchSize, kernel);
+		elapsed += Clock::now() - start;
+	}
+	return std::chrono::duration<double, std::nano>(elapsed).count() / ((double)numRepetitions * batchSize);
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = nullptr;
+	const char* outputPath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else
+		{
+			path = argv[i];
+		}
+	}
+
+	std::vector<float> recordedX;
+	std::vector<float> recordedY;
+	if (path != nullptr)
+	{
+		if (!readRecording(path, recordedX, recordedY))
+		{
+			fprintf(stderr, "Failed to read coordinates from recording %s\n", path);
+			return 1;
+		}
+	}
+	else
+	{
+		synthesize(recordedX, recordedY);
+	}
+
+	// Recordings shorter than the largest batch are repeated
+	size_t maxBatchSize = sBatchSizes[sizeof(sBatchSizes) / sizeof(sBatchSizes[0]) - 1];
+	std::vector<float> sourceX(maxBatchSize);
+	std::vector<float> sourceY(maxBatchSize);
+	std::vector<Vector2> sourcePositions(maxBatchSize);
+	for (size_t i = 0; i < maxBatchSize; i++)
+	{
+		sourceX[i] = recordedX[i % recordedX.size()];
+		sourceY[i] = recordedY[i % recordedY.size()];
+		sourcePositions[i] = Vector2(sourceX[i], sourceY[i]);
+	}
+
+	const TransformCase cases[] = {
+		{ "offset_scale", ScreenTransform(1080, 320.0f, 180.0f, 1.25f, 1.25f) },
+		{ "scale", ScreenTransform(1080, 0.0f, 0.0f, 0.75f, 0.75f) },
+		{ "identity", ScreenTransform(1080, 0.0f, 0.0f, 1.0f, 1.0f) }
+	};
+	const size_t numCases = sizeof(cases) / sizeof(cases[0]);
+	TransformKernel supportedKernel = getTransformKernel();
+
+	for (size_t c = 0; c < numCases; c++)
+	{
+		for (int k = 0; k <= supportedKernel; k++)
+		{
+			if (!checkKernel(cases[c].transform, sourceX, sourceY, (TransformKernel)k))
+			{
+				fprintf(stderr, "Kernel %s differs from the scalar transform for %s\n", sKernelNames[k],
+					cases[c].name);
+				return 1;
+			}
+		}
+	}
+
+	FILE* file = outputPath != nullptr ? fopen(outputPath, "w") : stdout;
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", outputPath);
+		return 1;
+	}
+
+	fprintf(file, "{\n  \"benchmark\": \"transform\",\n  \"source\": \"%s\",\n  \"points\": %zu,\n"
+		"  \"kernel\": \"%s\",\n  \"results\": [\n", path != nullptr ? path : "synthetic", recordedX.size(),
+		sKernelNames[supportedKernel]);
+
+	bool first = true;
+	for (size_t b = 0; b < sizeof(sBatchSizes) / sizeof(sBatchSizes[0]); b++)
+	{
+		size_t batchSize = sBatchSizes[b];
+		for (size_t c = 0; c < numCases; c++)
+		{
+			const ScreenTransform& transform = cases[c].transform;
+			double perEvent = measurePerEvent(transform, sourcePositions, batchSize);
+			fprintf(file, "%s    { \"batch\": %zu, \"transform\": \"%s\", \"kernel\": \"per_event\", "
+				"\"ns_per_point\": %.3f, \"speedup\": 1.00 }", first ? "" : ",\n", batchSize, cases[c].name,
+				perEvent);
+			first = false;
+
+			for (int k = 0; k <= supportedKernel; k++)
+			{
+				double batch = measureBatch(transform, sourceX, sourceY, batchSize, (TransformKernel)k);
+				fprintf(file, ",\n    { \"batch\": %zu, \"transform\": \"%s\", \"kernel\": \"%s\", "
+					"\"ns_per_point\": %.3f, \"speedup\": %.2f }", batchSize, cases[c].name, sKernelNames[k],
+					batch, perEvent / batch);
+			}
+		}
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+Owns the XInput2 connection of a display on behalf of all processes using the plugin on it, like one Unity
+process per projector. The devices are enumerated and the events are read and decoded once, then published to
+a shared memory ring with a partition per window. Processes created with SystemSettings.broker set claim the
+partitions of their windows and read their events from the shared memory instead of a connection of their own.
+
+Usage: X11TouchMultiWindowBroker [--threaded] [--raw] [--group] [--debug] [display]
+With --raw, raw events are selected once on the root window and routed to the claimed windows, instead of
+selecting the events of every claimed window.
+Only processes of the user running the broker can read the display, with --group also those of other users in
+its group.
+Runs until interrupted. A restarted broker keeps the windows claimed from its predecessor.
+*/
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "../X11TouchMultiWindowPointerHandlerSystem.h"
+
+// Claims of windows and consumers that exited are picked up at least this often
+#define UPDATE_INTERVAL_MS 1000
+
+static PointerHandlerSystem* sSystem = nullptr;
+static volatile sig_atomic_t sRunning = 1;
+
+// ----------------------------------------------------------------------------
+static void onSignal(int)
+{
+	sRunning = 0;
+
+	// Only writes to an eventfd, which is safe in a signal handler
+	if (sSystem != nullptr)
+	{
+		sSystem->wake();
+	}
+}
+// ----------------------------------------------------------------------------
+static void onMessage(int type, char* message)
+{
+	static const char* prefixes[] = { "debug", "info", "warning", "error" };
+	fprintf(stderr, "[%s] %s\n", type >= 0 && type < 4 ? prefixes[type] : "message", message);
+}
+
+int main(int argc, char** argv)
+{
+	SystemSettings settings = {};
+	settings.minMessageType = MT_INFO;
+	const char* displayName = NULL;
+	bool groupAccess = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--threaded") == 0)
+		{
+			settings.threaded = 1;
+		}
+		else if (strcmp(argv[i], "--raw") == 0)
+		{
+			settings.rawEvents = 1;
+		}
+		else if (strcmp(argv[i], "--group") == 0)
+		{
+			groupAccess = true;
+		}
+		else if (strcmp(argv[i], "--debug") == 0)
+		{
+			settings.minMessageType = MT_DEBUG;
+		}
+		else if (argv[i][0] != '-' && displayName == NULL)
+		{
+			displayName = argv[i];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--threaded] [--raw] [--group] [--debug] [display]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	PointerHandlerSystem system(onMessage, settings, displayName);
+	if (system.initialize() != R_OK || system.startPublishing(groupAccess) != R_OK)
+	{
+		return 1;
+	}
+
+	sSystem = &system;
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onSignal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	while (sRunning)
+	{
+		bool ready;
+		if (system.waitForEvents(UPDATE_INTERVAL_MS, &ready) != R_OK)
+		{
+			break;
+		}
+
+		system.processEventQueue();
+	}
+
+	sSystem = nullptr;
+	system.stopPublishing();
+
+	return 0;
+}
\ No newline at end of file
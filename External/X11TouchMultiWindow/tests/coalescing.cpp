@@ -0,0 +1,161 @@
+/*
+Checks which pointer events a PointerHandler with coalescing enabled merges: consecutive updates of a pointer
+within a drain cycle are merged into the latest one, downs and ups are never merged, updates are not merged across
+them, and neither updates retrieved by getPointerEvents nor those of previous cycles are merged into. Runs without
+an X server, exits with 1 on the first failed check.
+*/
+#include <cstdio>
+#include <vector>
+#include <X11/extensions/XInput2.h>
+
+#include "../X11TouchMultiWindowPointerHandler.h"
+#include "../X11TouchMultiWindowPointerHandlerSystem.h"
+
+#define WINDOW 0x3a00007
+#define SCREEN_WIDTH 1920
+#define SCREEN_HEIGHT 1080
+#define TOUCH 1000
+
+#define CHECK(condition) if (!(condition)) { fprintf(stderr, "Check failed at line %d: %s\n", __LINE__, \
+	#condition); return 1; }
+
+static std::vector<PointerEventData> sEvents;
+
+// ----------------------------------------------------------------------------
+static void pointerCallback(int id, int event, PointerType type, Vector2 position, PointerData data)
+{
+	PointerEventData eventData;
+	eventData.id = id;
+	eventData.event = (PointerEvent)event;
+	eventData.type = type;
+	eventData.position = position;
+	eventData.data = data;
+	sEvents.push_back(eventData);
+}
+// ----------------------------------------------------------------------------
+static void processTouch(PointerHandler& handler, int type, int id, double x)
+{
+	DeviceEvent event = {};
+	event.window = WINDOW;
+	event.type = type;
+	event.deviceId = 11;
+	event.sourceId = 11;
+	event.detail = id;
+	event.x = x;
+	event.y = SCREEN_HEIGHT - x;
+	handler.processEvent(event);
+}
+// ----------------------------------------------------------------------------
+static bool isEvent(const PointerEventData& eventData, PointerEvent event, int id, double x)
+{
+	// The Y axis is flipped to the screen, which leaves it equal to X
+	return eventData.event == event && eventData.type == PT_TOUCH && eventData.id == id &&
+		eventData.position.x == (float)x && eventData.position.y == (float)x;
+}
+// ----------------------------------------------------------------------------
+static int checkCycle(Logger* logger)
+{
+	PointerHandler handler(NULL, 0, WINDOW, logger, pointerCallback);
+	handler.setScreenParams(SCREEN_WIDTH, SCREEN_HEIGHT, 0.0f, 0.0f, 1.0f, 1.0f);
+	CHECK(handler.setCoalescing(true, false) == R_OK);
+
+	handler.beginEvents();
+	processTouch(handler, XI_TouchBegin, TOUCH, 10.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH, 20.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH, 30.0);
+	processTouch(handler, XI_TouchEnd, TOUCH, 40.0);
+	processTouch(handler, XI_TouchBegin, TOUCH + 1, 50.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH + 1, 60.0);
+	handler.flushEvents(0);
+
+	// Only the two updates between the first down and up are merged, into the position of the latest
+	CHECK(sEvents.size() == 5);
+	CHECK(isEvent(sEvents[0], PE_DOWN, TOUCH, 10.0));
+	CHECK(isEvent(sEvents[1], PE_UPDATE, TOUCH, 30.0));
+	CHECK(isEvent(sEvents[2], PE_UP, TOUCH, 40.0));
+	CHECK(isEvent(sEvents[3], PE_DOWN, TOUCH + 1, 50.0));
+	CHECK(isEvent(sEvents[4], PE_UPDATE, TOUCH + 1, 60.0));
+	CHECK(handler.getNumCoalescedEvents() == 1);
+
+	// A down followed by updates of another touch, an update is never merged into a down
+	sEvents.clear();
+	handler.beginEvents();
+	processTouch(handler, XI_TouchUpdate, TOUCH + 1, 70.0);
+	processTouch(handler, XI_TouchBegin, TOUCH + 2, 80.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH + 2, 90.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH + 1, 100.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH + 2, 110.0);
+	processTouch(handler, XI_TouchEnd, TOUCH + 2, 120.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH + 1, 130.0);
+	handler.flushEvents(0);
+
+	CHECK(sEvents.size() == 4);
+	CHECK(isEvent(sEvents[0], PE_UPDATE, TOUCH + 1, 130.0));
+	CHECK(isEvent(sEvents[1], PE_DOWN, TOUCH + 2, 80.0));
+	CHECK(isEvent(sEvents[2], PE_UPDATE, TOUCH + 2, 110.0));
+	CHECK(isEvent(sEvents[3], PE_UP, TOUCH + 2, 120.0));
+	CHECK(handler.getNumCoalescedEvents() == 4);
+
+	// Updates of different cycles are delivered separately
+	sEvents.clear();
+	handler.beginEvents();
+	processTouch(handler, XI_TouchUpdate, TOUCH + 1, 140.0);
+	handler.flushEvents(0);
+	CHECK(sEvents.size() == 1 && isEvent(sEvents[0], PE_UPDATE, TOUCH + 1, 140.0));
+	CHECK(handler.getNumCoalescedEvents() == 4);
+
+	return 0;
+}
+// ----------------------------------------------------------------------------
+static int checkRetrieved(Logger* logger)
+{
+	PointerHandler handler(NULL, 0, WINDOW, logger, nullptr);
+	handler.setScreenParams(SCREEN_WIDTH, SCREEN_HEIGHT, 0.0f, 0.0f, 1.0f, 1.0f);
+	CHECK(handler.setCoalescing(true, false) == R_OK);
+
+	handler.beginEvents();
+	processTouch(handler, XI_TouchBegin, TOUCH, 10.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH, 20.0);
+	handler.flushEvents(0);
+
+	PointerEventData events[4];
+	int numEvents = 0;
+	CHECK(handler.getPointerEvents(events, 4, &numEvents) == R_OK);
+	CHECK(numEvents == 2);
+	CHECK(isEvent(events[0], PE_DOWN, TOUCH, 10.0) && isEvent(events[1], PE_UPDATE, TOUCH, 20.0));
+
+	// The delivered update is not merged into, and neither are updates of previous cycles still waiting
+	handler.beginEvents();
+	processTouch(handler, XI_TouchUpdate, TOUCH, 30.0);
+	processTouch(handler, XI_TouchUpdate, TOUCH, 40.0);
+	handler.flushEvents(0);
+	handler.beginEvents();
+	processTouch(handler, XI_TouchUpdate, TOUCH, 50.0);
+	processTouch(handler, XI_TouchEnd, TOUCH, 60.0);
+	handler.flushEvents(0);
+
+	CHECK(handler.getPointerEvents(events, 4, &numEvents) == R_OK);
+	CHECK(numEvents == 3);
+	CHECK(isEvent(events[0], PE_UPDATE, TOUCH, 40.0));
+	CHECK(isEvent(events[1], PE_UPDATE, TOUCH, 50.0));
+	CHECK(isEvent(events[2], PE_UP, TOUCH, 60.0));
+	CHECK(handler.getNumCoalescedEvents() == 1);
+
+	return 0;
+}
+
+int main()
+{
+	SystemSettings settings = {};
+	settings.minMessageType = MT_ERROR;
+	PointerHandlerSystem system(nullptr, settings);
+
+	if (checkCycle(system.getLogger()) != 0 || checkRetrieved(system.getLogger()) != 0)
+	{
+		return 1;
+	}
+
+	printf("Pointer events coalesced\n");
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+/*
+Creates and destroys handlers from the pointer callbacks run while a PointerHandlerSystem flushes a drain cycle,
+as a managed callback may do. The handler whose callback destroys it keeps delivering the rest of its events, and
+the handlers created meanwhile receive events from the next cycle on. Runs without an X server, exits with 1 on
+the first failed check.
+*/
+#include <cstdio>
+#include <vector>
+
+#include "../X11TouchMultiWindowPointerHandler.h"
+#include "../X11TouchMultiWindowPointerHandlerSystem.h"
+
+#define FIRST_WINDOW 0x3a00007
+// Enough to reallocate the slots of the handler table while it is iterated
+#define NUM_CREATED_HANDLERS 64
+#define EVENTS_PER_CYCLE 8
+
+#define CHECK(condition) if (!(condition)) { fprintf(stderr, "Check failed at line %d: %s\n", __LINE__, \
+	#condition); return 1; }
+
+static PointerHandlerSystem* sSystem = nullptr;
+static HandlerHandle sFirstHandle = 0;
+static HandlerHandle sDestroyedHandle = 0;
+static std::vector<HandlerHandle> sCreatedHandles;
+static int sNumFirstEvents = 0;
+static int sNumCreatedEvents = 0;
+
+// ----------------------------------------------------------------------------
+static void createdCallback(int, int, PointerType, Vector2, PointerData)
+{
+	sNumCreatedEvents++;
+}
+// ----------------------------------------------------------------------------
+static void firstCallback(int, int, PointerType, Vector2, PointerData)
+{
+	// On the first event, create handlers and destroy both this handler and another one that is not flushed yet
+	if (sNumFirstEvents++ > 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < NUM_CREATED_HANDLERS; i++)
+	{
+		HandlerHandle handle;
+		PointerHandler handler(NULL, 0, FIRST_WINDOW + 0x200000 * (i + 2), sSystem->getLogger(), createdCallback);
+		if (sSystem->addHandler(std::move(handler), &handle) == R_OK)
+		{
+			sCreatedHandles.push_back(handle);
+		}
+	}
+
+	sSystem->destroyHandler(sDestroyedHandle);
+	sSystem->destroyHandler(sFirstHandle);
+}
+// ----------------------------------------------------------------------------
+static void addEvents(std::vector<DeviceEvent>& events, Window window)
+{
+	for (int i = 0; i < EVENTS_PER_CYCLE; i++)
+	{
+		DeviceEvent event = {};
+		event.window = window;
+		event.type = XI_Motion;
+		event.deviceId = 2;
+		event.sourceId = 2;
+		event.x = i;
+		event.y = i;
+		events.push_back(event);
+	}
+}
+
+int main()
+{
+	SystemSettings settings = {};
+	settings.minMessageType = MT_ERROR;
+	PointerHandlerSystem system(nullptr, settings);
+	sSystem = &system;
+
+	PointerHandler first(NULL, 0, FIRST_WINDOW, system.getLogger(), firstCallback);
+	CHECK(system.addHandler(std::move(first), &sFirstHandle) == R_OK);
+	PointerHandler destroyed(NULL, 0, FIRST_WINDOW + 0x200000, system.getLogger(), createdCallback);
+	CHECK(system.addHandler(std::move(destroyed), &sDestroyedHandle) == R_OK);
+
+	std::vector<DeviceEvent> events;
+	addEvents(events, FIRST_WINDOW);
+	addEvents(events, FIRST_WINDOW + 0x200000);
+	CHECK(system.processEvents(events.data(), events.size()) == R_OK);
+
+	// The first handler delivered all of its events, the other one was destroyed before it was flushed
+	CHECK(sNumFirstEvents == EVENTS_PER_CYCLE);
+	CHECK(sNumCreatedEvents == 0);
+	CHECK((int)sCreatedHandles.size() == NUM_CREATED_HANDLERS);
+	CHECK(system.getNumHandlers() == NUM_CREATED_HANDLERS);
+	CHECK(system.getHandler(sFirstHandle) == nullptr);
+	CHECK(system.getHandler(sDestroyedHandle) == nullptr);
+	CHECK(system.getHandler((Window)FIRST_WINDOW) == nullptr);
+
+	// The created handlers are routed to from the next cycle on, events of destroyed windows are dropped
+	events.clear();
+	addEvents(events, FIRST_WINDOW);
+	for (int i = 0; i < NUM_CREATED_HANDLERS; i++)
+	{
+		addEvents(events, FIRST_WINDOW + 0x200000 * (i + 2));
+	}
+	CHECK(system.processEvents(events.data(), events.size()) == R_OK);
+	CHECK(sNumFirstEvents == EVENTS_PER_CYCLE);
+	CHECK(sNumCreatedEvents == NUM_CREATED_HANDLERS * EVENTS_PER_CYCLE);
+
+	for (size_t i = 0; i < sCreatedHandles.size(); i++)
+	{
+		CHECK(system.destroyHandler(sCreatedHandles[i]) == R_OK);
+	}
+	CHECK(system.getNumHandlers() == 0);
+
+	sSystem = nullptr;
+	printf("Handlers created and destroyed from callbacks\n");
+
+	return 0;
+}
\ No newline at end of file
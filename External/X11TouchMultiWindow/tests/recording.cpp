@@ -0,0 +1,162 @@
+/*
+Records synthetic device events with an EventRecorder and reads them back, first directly with an EventReplay and
+then replayed by a PointerHandlerSystem in RM_FAST mode. The fields, times and order of the events and the device
+table survive the round trip, including server times wrapping around 32 bits, and replayed server times don't
+reach the clock estimate of the live events. Runs without an X server, exits with 1 on the first failed check.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <X11/extensions/XInput2.h>
+#include <unistd.h>
+
+// unistd.h defines R_OK for access(), which clashes with Result
+#undef R_OK
+
+#include "../X11TouchMultiWindowPointerHandler.h"
+#include "../X11TouchMultiWindowPointerHandlerSystem.h"
+#include "../X11TouchMultiWindowRecording.h"
+
+#define WINDOW 0x3a00007
+#define OTHER_WINDOW 0x3c00007
+#define NUM_UPDATES 16
+// Server time of the first event, the times wrap around 32 bits halfway through the touch
+#define START_SERVER_TIME 0xfffffff0u
+#define START_RECEIVE_TIME 5000000000ull
+
+#define CHECK(condition) if (!(condition)) { fprintf(stderr, "Check failed at line %d: %s\n", __LINE__, \
+	#condition); return 1; }
+
+// ----------------------------------------------------------------------------
+static DeviceEvent createEvent(Window window, int type, int detail, int index)
+{
+	DeviceEvent event = {};
+	event.window = window;
+	event.type = type;
+	event.deviceId = 11;
+	event.sourceId = 11;
+	event.detail = detail;
+	event.flags = type == XI_TouchBegin ? XITouchEmulatingPointer : 0;
+	// Exactly representable as floats
+	event.x = 100.5 + index;
+	event.y = 200.25 - index;
+	// Two milliseconds apart on the server, received with varying latency in whole microseconds
+	event.time = (uint32_t)(START_SERVER_TIME + 2 * index);
+	event.receiveTime = START_RECEIVE_TIME + index * 2000000ull + (index % 3) * 250000ull;
+	event.axesMask = (1 << DA_PRESSURE) | (1 << DA_TOUCH_MAJOR);
+	event.axes[DA_PRESSURE] = 0.5f;
+	event.axes[DA_TOUCH_MAJOR] = 0.125f * (index % 4);
+	return event;
+}
+// ----------------------------------------------------------------------------
+static std::vector<DeviceEvent> createEvents()
+{
+	std::vector<DeviceEvent> events;
+	int index = 0;
+	events.push_back(createEvent(WINDOW, XI_TouchBegin, 7, index++));
+	for (int i = 0; i < NUM_UPDATES; i++)
+	{
+		events.push_back(createEvent(WINDOW, XI_TouchUpdate, 7, index++));
+		if (i == NUM_UPDATES / 2)
+		{
+			events.push_back(createEvent(OTHER_WINDOW, XI_Motion, 0, index++));
+		}
+	}
+	events.push_back(createEvent(WINDOW, XI_TouchEnd, 7, index++));
+	return events;
+}
+
+int main()
+{
+	char path[] = "/tmp/x11touch-recording-XXXXXX";
+	int fd = mkstemp(path);
+	CHECK(fd >= 0);
+	close(fd);
+
+	std::vector<DeviceEvent> events = createEvents();
+	CHECK((Time)(uint32_t)events.back().time < START_SERVER_TIME);
+
+	RecordedDevice devices[2];
+	memset(devices, 0, sizeof(devices));
+	devices[0].deviceId = 11;
+	devices[0].use = XISlavePointer;
+	devices[0].axesMask = (1 << DA_PRESSURE) | (1 << DA_TOUCH_MAJOR);
+	strcpy(devices[0].name, "Synthetic touchscreen");
+	devices[1].deviceId = 2;
+	devices[1].use = XIMasterPointer;
+	strcpy(devices[1].name, "Virtual core pointer");
+
+	EventRecorder recorder;
+	CHECK(recorder.open(path, devices, 2) == R_OK);
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		recorder.record(events[i]);
+	}
+	CHECK(recorder.getNumRecords() == events.size());
+	CHECK(recorder.close() == R_OK);
+
+	// Read back directly, with the receive times shifted to the start of the replay
+	EventReplay replay;
+	CHECK(replay.open(path) == R_OK);
+	CHECK(replay.getNumRecords() == events.size());
+	CHECK(replay.getNumDevices() == 2);
+	CHECK(replay.getDevice(0).deviceId == 11 && replay.getDevice(0).use == XISlavePointer);
+	CHECK(replay.getDevice(0).axesMask == devices[0].axesMask);
+	CHECK(strcmp(replay.getDevice(0).name, "Synthetic touchscreen") == 0);
+	CHECK(replay.getDevice(1).deviceId == 2 && strcmp(replay.getDevice(1).name, "Virtual core pointer") == 0);
+
+	const uint64_t startTime = 1000;
+	replay.start(startTime, None);
+	std::vector<DeviceEvent> replayed(events.size() + 1);
+	CHECK(replay.read(replayed.data(), replayed.size(), UINT64_MAX) == events.size());
+	CHECK(replay.isFinished());
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const DeviceEvent& original = events[i];
+		const DeviceEvent& event = replayed[i];
+		CHECK(event.window == original.window);
+		CHECK(event.type == original.type);
+		CHECK(event.deviceId == original.deviceId && event.sourceId == original.sourceId);
+		CHECK(event.detail == original.detail);
+		CHECK(event.flags == original.flags);
+		CHECK(event.x == original.x && event.y == original.y);
+		CHECK(event.time == original.time);
+		CHECK(event.receiveTime == startTime + original.receiveTime - START_RECEIVE_TIME);
+		CHECK(event.axesMask == original.axesMask);
+		CHECK(memcmp(event.axes, original.axes, sizeof(event.axes)) == 0);
+	}
+
+	// Replayed by a system in fast mode, to the window of a buffered handler
+	SystemSettings settings = {};
+	settings.minMessageType = MT_ERROR;
+	PointerHandlerSystem system(nullptr, settings);
+	HandlerHandle handle;
+	PointerHandler handler(NULL, 0, WINDOW, system.getLogger(), nullptr);
+	CHECK(system.addHandler(std::move(handler), &handle) == R_OK);
+
+	CHECK(system.startReplay(path, RM_FAST, WINDOW) == R_OK);
+	CHECK(system.processEventQueue() == R_OK);
+	CHECK(!system.isReplaying());
+	CHECK(!system.getServerClock().isValid());
+
+	std::vector<PointerEventData> pointerEvents(events.size() + 1);
+	int numEvents = 0;
+	CHECK(system.getHandler(handle)->getPointerEvents(pointerEvents.data(), pointerEvents.size(), &numEvents) ==
+		R_OK);
+	CHECK(numEvents == (int)events.size());
+	for (int i = 0; i < numEvents; i++)
+	{
+		const PointerEventData& event = pointerEvents[i];
+		PointerEvent expected = events[i].type == XI_TouchBegin ? PE_DOWN :
+			events[i].type == XI_TouchEnd ? PE_UP : PE_UPDATE;
+		CHECK(event.event == expected);
+		CHECK(event.type == (events[i].type == XI_Motion ? PT_MOUSE : PT_TOUCH));
+		CHECK(event.data.pressure == 0.5f);
+	}
+
+	unlink(path);
+	printf("%d events recorded and replayed\n", (int)events.size());
+
+	return 0;
+}
\ No newline at end of file
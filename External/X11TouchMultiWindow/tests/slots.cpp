@@ -0,0 +1,155 @@
+/*
+Checks the slots touches get, directly on a PointerSlotTable and through the events of a PointerHandler: a touch
+going down gets the lowest free slot and keeps it until it is released, touches beyond SLOT_MAX_SLOTS are dropped,
+and cancelTouches ends every touch with PF_CANCELED and frees its slot. Runs without an X server, exits with 1 on
+the first failed check.
+*/
+#include <cstdio>
+#include <vector>
+#include <X11/extensions/XInput2.h>
+
+#include "../X11TouchMultiWindowPointerHandler.h"
+#include "../X11TouchMultiWindowPointerHandlerSystem.h"
+#include "../X11TouchMultiWindowSlots.h"
+
+#define WINDOW 0x3a00007
+// Touch ids keep increasing in the X server, far beyond the number of slots
+#define FIRST_TOUCH 1000
+
+#define CHECK(condition) if (!(condition)) { fprintf(stderr, "Check failed at line %d: %s\n", __LINE__, \
+	#condition); return 1; }
+
+static std::vector<PointerEventData> sEvents;
+
+// ----------------------------------------------------------------------------
+static void pointerCallback(int id, int event, PointerType type, Vector2 position, PointerData data)
+{
+	PointerEventData eventData;
+	eventData.id = id;
+	eventData.event = (PointerEvent)event;
+	eventData.type = type;
+	eventData.position = position;
+	eventData.data = data;
+	sEvents.push_back(eventData);
+}
+// ----------------------------------------------------------------------------
+static void processTouch(PointerHandler& handler, int type, int id)
+{
+	DeviceEvent event = {};
+	event.window = WINDOW;
+	event.type = type;
+	event.deviceId = 11;
+	event.sourceId = 11;
+	event.detail = id;
+	event.x = 10.0;
+	event.y = 20.0;
+
+	handler.beginEvents();
+	handler.processEvent(event);
+	handler.flushEvents(0);
+}
+// ----------------------------------------------------------------------------
+static int checkTable()
+{
+	PointerSlotTable slots;
+	Vector2 position(1.0f, 2.0f);
+	CHECK(slots.acquire(FIRST_TOUCH, 11, 11, 0, 0, position) == 0);
+	CHECK(slots.acquire(FIRST_TOUCH + 1, 11, 11, 0, 0, position) == 1);
+	CHECK(slots.acquire(FIRST_TOUCH + 2, 11, 11, 0, 0, position) == 2);
+	CHECK(slots.getNumUsed() == 3 && slots.getEnd() == 3);
+
+	// Releasing a touch leaves the slots of the others as they are, the next touch gets the lowest free slot
+	slots.release(1);
+	CHECK(slots.find(FIRST_TOUCH) == 0 && slots.find(FIRST_TOUCH + 1) == -1 && slots.find(FIRST_TOUCH + 2) == 2);
+	slots.update(2, 1, 1, Vector2(3.0f, 4.0f));
+	CHECK(slots.find(FIRST_TOUCH + 2) == 2 && slots.getSlot(2).position.x == 3.0f);
+	CHECK(slots.acquire(FIRST_TOUCH + 3, 11, 11, 0, 0, position) == 1);
+
+	// A touch whose end was never reported keeps its slot
+	CHECK(slots.acquire(FIRST_TOUCH + 2, 11, 11, 0, 0, position) == 2);
+	CHECK(slots.getNumUsed() == 3);
+
+	// Exhausted at SLOT_MAX_SLOTS, until a slot is released
+	for (int i = 3; i < SLOT_MAX_SLOTS; i++)
+	{
+		CHECK(slots.acquire(FIRST_TOUCH + 1000 + i, 11, 11, 0, 0, position) == i);
+	}
+	CHECK(slots.getNumUsed() == SLOT_MAX_SLOTS);
+	CHECK(slots.acquire(FIRST_TOUCH + 5000, 11, 11, 0, 0, position) == -1);
+	slots.release(100);
+	CHECK(slots.acquire(FIRST_TOUCH + 5000, 11, 11, 0, 0, position) == 100);
+
+	slots.clear();
+	CHECK(slots.getNumUsed() == 0 && slots.find(FIRST_TOUCH) == -1);
+	CHECK(slots.acquire(FIRST_TOUCH + 6000, 11, 11, 0, 0, position) == 0);
+
+	return 0;
+}
+// ----------------------------------------------------------------------------
+static int checkHandler(Logger* logger)
+{
+	PointerHandler handler(NULL, 0, WINDOW, logger, pointerCallback);
+
+	// The slots are reported with the events
+	processTouch(handler, XI_TouchBegin, FIRST_TOUCH);
+	processTouch(handler, XI_TouchBegin, FIRST_TOUCH + 1);
+	processTouch(handler, XI_TouchUpdate, FIRST_TOUCH + 1);
+	processTouch(handler, XI_TouchEnd, FIRST_TOUCH);
+	processTouch(handler, XI_TouchBegin, FIRST_TOUCH + 2);
+	CHECK(sEvents.size() == 5);
+	CHECK(sEvents[0].event == PE_DOWN && sEvents[0].data.slot == 0);
+	CHECK(sEvents[1].event == PE_DOWN && sEvents[1].data.slot == 1);
+	CHECK(sEvents[2].event == PE_UPDATE && sEvents[2].data.slot == 1);
+	CHECK(sEvents[3].event == PE_UP && sEvents[3].data.slot == 0 && !(sEvents[3].data.flags & PF_CANCELED));
+	CHECK(sEvents[4].event == PE_DOWN && sEvents[4].data.slot == 0 && sEvents[4].id == FIRST_TOUCH + 2);
+	CHECK(handler.getNumTouches() == 2);
+
+	// Touches beyond the last slot are dropped, with all of their events
+	for (int i = 2; i < SLOT_MAX_SLOTS; i++)
+	{
+		processTouch(handler, XI_TouchBegin, FIRST_TOUCH + 1000 + i);
+	}
+	CHECK(handler.getNumTouches() == SLOT_MAX_SLOTS);
+	sEvents.clear();
+	processTouch(handler, XI_TouchBegin, FIRST_TOUCH + 5000);
+	processTouch(handler, XI_TouchUpdate, FIRST_TOUCH + 5000);
+	CHECK(sEvents.empty());
+
+	// Canceled outside of a drain cycle, the ends are delivered at once
+	handler.cancelTouches(XIAllDevices);
+	CHECK((int)sEvents.size() == SLOT_MAX_SLOTS);
+	std::vector<bool> canceled(SLOT_MAX_SLOTS, false);
+	for (size_t i = 0; i < sEvents.size(); i++)
+	{
+		CHECK(sEvents[i].event == PE_UP && sEvents[i].type == PT_TOUCH);
+		CHECK(sEvents[i].data.flags & PF_CANCELED);
+		CHECK(sEvents[i].data.slot >= 0 && sEvents[i].data.slot < SLOT_MAX_SLOTS && !canceled[sEvents[i].data.slot]);
+		canceled[sEvents[i].data.slot] = true;
+	}
+	CHECK(handler.getNumTouches() == 0);
+
+	// Later events of canceled touches are dropped, and new touches start from the lowest slot again
+	sEvents.clear();
+	processTouch(handler, XI_TouchUpdate, FIRST_TOUCH + 1);
+	processTouch(handler, XI_TouchEnd, FIRST_TOUCH + 1);
+	processTouch(handler, XI_TouchBegin, FIRST_TOUCH + 6000);
+	CHECK(sEvents.size() == 1 && sEvents[0].event == PE_DOWN && sEvents[0].data.slot == 0);
+
+	return 0;
+}
+
+int main()
+{
+	SystemSettings settings = {};
+	settings.minMessageType = MT_ERROR;
+	PointerHandlerSystem system(nullptr, settings);
+
+	if (checkTable() != 0 || checkHandler(system.getLogger()) != 0)
+	{
+		return 1;
+	}
+
+	printf("Slots acquired, released and canceled\n");
+
+	return 0;
+}
\ No newline at end of file
@@ -56,6 +56,13 @@ public bool ShouldUpdateInputHandlersOnStart
             get => shouldUpdateInputHandlers;
             set => shouldUpdateInputHandlers = value;
         }
+
+#if UNITY_STANDALONE_LINUX
+        /// <summary>
+        /// Gets the system reading the pointer input of the default X display.
+        /// </summary>
+        public X11PointerHandlerSystem PointerHandlerSystem => pointerHandlerSystem;
+#endif
         
         private static bool shuttingDown;
         private static MultiWindowManagerInstance instance;
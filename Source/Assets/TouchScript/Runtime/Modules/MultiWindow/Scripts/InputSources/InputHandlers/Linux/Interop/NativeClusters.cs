@@ -0,0 +1,58 @@
+#if UNITY_STANDALONE_LINUX
+using System.Runtime.InteropServices;
+
+namespace TouchScript.InputSources.InputHandlers.Interop
+{
+    /// <summary>
+    /// Cluster math of the transform gestures computed natively over arrays of positions, so gestures with many
+    /// pointers don't iterate them in managed code every frame.
+    /// </summary>
+    public static class NativeClusters
+    {
+        #region Native Methods
+
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result Clusters_ComputeTransforms(float[] x, float[] y, float[] previousX,
+            float[] previousY, int[] clusterOffsets, int numClusters, [Out] ClusterTransform[] transforms);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result Clusters_Split(float[] x, float[] y, int numPoints, float minPointDistance,
+            [Out] int[] clusters, out int hasClusters);
+
+        #endregion
+
+        /// <summary>
+        /// Computes the centroid, translation, scale and rotation of every cluster. For two pointers these are the
+        /// values the screen transform gestures compute from the line between them.
+        /// </summary>
+        /// <param name="x">Current positions, the points of a cluster are stored consecutively.</param>
+        /// <param name="previousX">Previous positions in the same order.</param>
+        /// <param name="clusterOffsets"><paramref name="numClusters"/> + 1 offsets, cluster i holds the points from
+        /// clusterOffsets[i] up to clusterOffsets[i + 1].</param>
+        /// <param name="transforms">Receives a transform per cluster.</param>
+        public static void ComputeTransforms(float[] x, float[] y, float[] previousX, float[] previousY,
+            int[] clusterOffsets, int numClusters, ClusterTransform[] transforms)
+        {
+            var result = Clusters_ComputeTransforms(x, y, previousX, previousY, clusterOffsets, numClusters,
+                transforms);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Splits points into two clusters the way <see cref="TouchScript.Clusters.Clusters2D"/> does.
+        /// </summary>
+        /// <param name="clusters">Receives 0 or 1 per point.</param>
+        /// <returns><c>true</c> if at least two points are <paramref name="minPointDistance"/> apart and the points
+        /// were split.</returns>
+        public static bool Split(float[] x, float[] y, int numPoints, float minPointDistance, int[] clusters)
+        {
+            var result = Clusters_Split(x, y, numPoints, minPointDistance, clusters, out var hasClusters);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+            return hasClusters != 0;
+        }
+    }
+}
+#endif
\ No newline at end of file
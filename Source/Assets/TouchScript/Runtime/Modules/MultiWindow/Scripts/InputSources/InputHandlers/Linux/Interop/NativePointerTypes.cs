@@ -2,6 +2,7 @@
 
 using System;
 using System.Runtime.InteropServices;
+using UnityEngine;
 
 namespace TouchScript.InputSources.InputHandlers.Interop
 {
@@ -32,7 +33,8 @@ enum PointerFlags
         FifthButton = 0x00000100,
         Down = 0x00010000,
         Update = 0x00020000,
-        Up = 0x00040000
+        Up = 0x00040000,
+        Canceled = 0x00080000
     };
 
     enum ButtonChangeType
@@ -50,11 +52,385 @@ enum ButtonChangeType
         FifthUp
     }
 
+    [Flags]
+    enum TouchMask
+    {
+        None = 0x00000000,
+        ContactArea = 0x00000001,
+        Orientation = 0x00000002,
+        Pressure = 0x00000004,
+        Prediction = 0x00000008
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     struct PointerData
     {
         public PointerFlags PointerFlags;
         public ButtonChangeType ChangedButtons;
+        public TouchMask Mask;
+        public float Pressure;
+        public float Orientation;
+        public float TouchMajor;
+        public float TouchMinor;
+        public Vector2 Velocity;
+        public Vector2 PredictedPosition;
+        public int Region;
+        public int Slot;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct PointerEventData
+    {
+        public int Id;
+        public PointerEvent Event;
+        public PointerType Type;
+        public Vector2 Position;
+        public PointerData Data;
+    }
+
+    /// <summary>
+    /// Shapes of the regions pointers going down in are tagged with natively.
+    /// </summary>
+    public enum NativeRegionShape
+    {
+        Rect = 0,
+        Circle = 1,
+        Polygon = 2
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct RegionData
+    {
+        public int Id;
+        public int Layer;
+        public NativeRegionShape Shape;
+        public Vector2 Position;
+        public Vector2 Size;
+    }
+
+    /// <summary>
+    /// Single pointer gestures recognized by the native plugin.
+    /// </summary>
+    public enum NativeGestureType
+    {
+        None = 0,
+        Tap = 1,
+        LongPress = 2,
+        Flick = 3
+    }
+
+    /// <summary>
+    /// Parameters of the native One Euro filter smoothing touch positions. Distances are in window pixels,
+    /// frequencies in Hz.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NativeFilterSettings
+    {
+        /// <summary>
+        /// Cutoff frequency of a touch at rest, lower values smooth out more jitter but lag more.
+        /// </summary>
+        public float MinCutoff;
+        /// <summary>
+        /// Raise of the cutoff per pixel per second the touch moves, higher values lag less while moving.
+        /// </summary>
+        public float Beta;
+        public float DerivativeCutoff;
+        /// <summary>
+        /// Updates moving less than this from the last position reported are dropped, 0 reports all updates.
+        /// </summary>
+        public float DeadZone;
+
+        /// <summary>
+        /// The defaults of the native filter, with the given dead zone.
+        /// </summary>
+        public static NativeFilterSettings WithDeadZone(float deadZone) => new NativeFilterSettings
+        {
+            MinCutoff = 1f,
+            Beta = .007f,
+            DerivativeCutoff = 1f,
+            DeadZone = deadZone
+        };
+    }
+
+    /// <summary>
+    /// Thresholds of the native gesture recognizer. Distances are in screen pixels, times in seconds.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NativeGestureSettings
+    {
+        /// <summary>
+        /// Bit per <see cref="NativeGestureType"/> to recognize.
+        /// </summary>
+        public int Mask;
+        /// <summary>
+        /// Longest a pointer may be down for a tap, and between the taps of a multi tap.
+        /// </summary>
+        public float TapTimeLimit;
+        /// <summary>
+        /// Farthest a pointer may move while down for a tap, and between the taps of a multi tap.
+        /// </summary>
+        public float TapDistanceLimit;
+        public float LongPressTime;
+        public float LongPressDistanceLimit;
+        /// <summary>
+        /// Only the movement during this time before the pointer is released makes up a flick.
+        /// </summary>
+        public float FlickTime;
+        /// <summary>
+        /// Distance a pointer has to move from where it went down before it can flick.
+        /// </summary>
+        public float FlickMovementThreshold;
+        public float FlickMinDistance;
+        /// <summary>
+        /// Slowest flick in pixels per second.
+        /// </summary>
+        public float FlickMinVelocity;
+
+        /// <summary>
+        /// The defaults of the managed gestures, converted to pixels with the given screen density.
+        /// </summary>
+        public static NativeGestureSettings FromDotsPerCentimeter(float dotsPerCentimeter) => new NativeGestureSettings
+        {
+            Mask = (1 << (int)NativeGestureType.Tap) | (1 << (int)NativeGestureType.LongPress) |
+                (1 << (int)NativeGestureType.Flick),
+            TapTimeLimit = .3f,
+            TapDistanceLimit = .5f * dotsPerCentimeter,
+            LongPressTime = 1f,
+            LongPressDistanceLimit = .5f * dotsPerCentimeter,
+            FlickTime = .1f,
+            FlickMovementThreshold = .5f * dotsPerCentimeter,
+            FlickMinDistance = 1f * dotsPerCentimeter,
+            FlickMinVelocity = 0f
+        };
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct GestureEventData
+    {
+        public NativeGestureType Type;
+        public int Id;
+        public PointerType PointerType;
+        public int Count;
+        public Vector2 Position;
+        public Vector2 Vector;
+        public float Duration;
+        public ulong Time;
+    }
+
+    /// <summary>
+    /// A gesture recognized by the native plugin.
+    /// </summary>
+    public struct NativeGesture
+    {
+        public NativeGestureType Type;
+        /// <summary>
+        /// Id of the <see cref="TouchScript.Pointers.Pointer"/> that completed the gesture.
+        /// </summary>
+        public int PointerId;
+        /// <summary>
+        /// Number of consecutive taps, 1 for the other gestures.
+        /// </summary>
+        public int Count;
+        /// <summary>
+        /// Screen position of the pointer when the gesture was recognized.
+        /// </summary>
+        public Vector2 ScreenPosition;
+        /// <summary>
+        /// Movement of a flick during the flick time.
+        /// </summary>
+        public Vector2 ScreenFlickVector;
+        /// <summary>
+        /// Seconds the pointer was down for a tap or long press, the time of the movement for a flick.
+        /// </summary>
+        public float Duration;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct ActivePointerData
+    {
+        public int Id;
+        public PointerType Type;
+        public int Slot;
+        public PointerEvent Event;
+        public PointerFlags Buttons;
+        public Vector2 Position;
+        public float Pressure;
+        public float Age;
+        public ulong Time;
+    }
+
+    /// <summary>
+    /// Current state of a pointer as tracked by the native plugin.
+    /// </summary>
+    public struct NativeActivePointer
+    {
+        /// <summary>
+        /// Id of the <see cref="TouchScript.Pointers.Pointer"/>, -1 if the pointer was not added yet.
+        /// </summary>
+        public int PointerId;
+        public TouchScript.Pointers.Pointer.PointerType Type;
+        /// <summary>
+        /// Screen position of the latest event of the pointer.
+        /// </summary>
+        public Vector2 ScreenPosition;
+        /// <summary>
+        /// Pressure of the latest event, 0 if the device doesn't report it.
+        /// </summary>
+        public float Pressure;
+        /// <summary>
+        /// Whether a touch is down or the mouse buttons that are pressed.
+        /// </summary>
+        public TouchScript.Pointers.Pointer.PointerButtonState Buttons;
+        /// <summary>
+        /// Seconds since a touch went down, or since the first pressed mouse button was pressed.
+        /// </summary>
+        public float Age;
+        /// <summary>
+        /// Time of the latest event of the pointer, in nanoseconds of <see cref="X11PointerHandlerSystem.GetTime"/>.
+        /// </summary>
+        public ulong Time;
+    }
+
+    /// <summary>
+    /// Transform of a cluster of pointers between their previous and current positions.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ClusterTransform
+    {
+        public Vector2 Center;
+        public Vector2 PreviousCenter;
+        /// <summary>
+        /// Movement of the centroid.
+        /// </summary>
+        public Vector2 Translation;
+        /// <summary>
+        /// Change of the spread of the pointers around the centroid, 1 for clusters of less than two pointers.
+        /// </summary>
+        public float Scale;
+        /// <summary>
+        /// Rotation of the pointers around the centroid in degrees.
+        /// </summary>
+        public float Rotation;
+        public int NumPoints;
+    }
+
+    /// <summary>
+    /// Timing of a replayed recording.
+    /// </summary>
+    public enum ReplayMode
+    {
+        /// <summary>
+        /// Events are dispatched once their recorded time has passed since the replay started.
+        /// </summary>
+        Realtime = 0,
+        /// <summary>
+        /// A fixed number of events is dispatched per frame.
+        /// </summary>
+        Fast = 1
+    }
+
+    /// <summary>
+    /// Implementation the native plugin reads events from the X server with.
+    /// </summary>
+    public enum EventBackend
+    {
+        /// <summary>
+        /// Xlib, always available.
+        /// </summary>
+        Xlib = 0,
+        /// <summary>
+        /// libxcb and xcb-xinput, falls back to Xlib if the plugin was built without it.
+        /// </summary>
+        Xcb = 1
+    }
+
+    /// <summary>
+    /// Latencies of the events dispatched to a native pointer handler, in microseconds.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct LatencyStats
+    {
+        /// <summary>
+        /// Number of events recorded since the handler was created or the stats were reset.
+        /// </summary>
+        public ulong NumEvents;
+        /// <summary>
+        /// From the X server timestamp of an event to its dispatch, corrected for the clock offset.
+        /// </summary>
+        public ulong EventP50;
+        public ulong EventP99;
+        public ulong EventMax;
+        /// <summary>
+        /// From reading an event from the X connection to its dispatch.
+        /// </summary>
+        public ulong QueueP50;
+        public ulong QueueP99;
+        public ulong QueueMax;
+        /// <summary>
+        /// Estimated offset of X server time to CLOCK_MONOTONIC.
+        /// </summary>
+        public long ClockOffset;
+        /// <summary>
+        /// Estimated drift of the X server clock in parts per million.
+        /// </summary>
+        public double ClockDrift;
+    }
+
+    /// <summary>
+    /// Settings of the native pointer handler system.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SystemSettings
+    {
+        /// <summary>
+        /// Read events on a dedicated native thread with its own display connection.
+        /// </summary>
+        [MarshalAs(UnmanagedType.Bool)] public bool Threaded;
+        /// <summary>
+        /// SCHED_FIFO priority of the reader thread, 0 keeps the default scheduling policy.
+        /// </summary>
+        public int ThreadPriority;
+        /// <summary>
+        /// Mask of the CPUs the reader thread may run on, 0 leaves the affinity untouched.
+        /// </summary>
+        public ulong ThreadAffinityMask;
+        /// <summary>
+        /// Number of events the reader thread can queue ahead of the main thread, 0 selects the default.
+        /// </summary>
+        public int QueueCapacity;
+        /// <summary>
+        /// Native messages of a lower type are discarded before they are formatted. 0 is debug, 1 info, 2 warning
+        /// and 3 error.
+        /// </summary>
+        public int MinMessageType;
+        /// <summary>
+        /// Implementation events are read with.
+        /// </summary>
+        public EventBackend Backend;
+        /// <summary>
+        /// Read the events published by the X11TouchMultiWindowBroker of the display, instead of opening a
+        /// connection that selects them, so several processes on one display share a single decoded event stream.
+        /// Falls back to reading from the display if no broker is running.
+        /// </summary>
+        [MarshalAs(UnmanagedType.Bool)] public bool Broker;
+        /// <summary>
+        /// Select raw touch, motion and button events once on the root window and route them to the windows
+        /// natively, instead of selecting the events of every window. Touches stay with the window they began in.
+        /// Ignored when reading through the broker, which has its own option for it.
+        /// </summary>
+        [MarshalAs(UnmanagedType.Bool)] public bool RawEvents;
+
+        /// <summary>
+        /// Default settings, debug messages are only passed on when TOUCHSCRIPT_DEBUG is defined.
+        /// </summary>
+        public static SystemSettings Default => new SystemSettings
+        {
+#if TOUCHSCRIPT_DEBUG
+            MinMessageType = 0
+#else
+            MinMessageType = 1
+#endif
+        };
     }
 }
 #endif
\ No newline at end of file
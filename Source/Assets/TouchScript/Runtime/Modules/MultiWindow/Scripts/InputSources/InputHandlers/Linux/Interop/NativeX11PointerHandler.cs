@@ -1,6 +1,7 @@
 #if UNITY_STANDALONE_LINUX
 using System;
 using System.Runtime.InteropServices;
+using UnityEngine;
 
 namespace TouchScript.InputSources.InputHandlers.Interop
 {
@@ -9,31 +10,94 @@ sealed class NativeX11PointerHandler : IDisposable
         #region Native Methods
 
         [DllImport("libX11TouchMultiWindow")]
-        private static extern Result PointerHandler_Create(int targetDisplay, IntPtr window,
-            PointerCallback pointerCallback, ref IntPtr handle);
+        private static extern Result PointerHandler_Create(IntPtr system, int targetDisplay,
+            IntPtr window, PointerCallback pointerCallback, ref uint handle);
         [DllImport("libX11TouchMultiWindow")]
-        private static extern Result PointerHandler_Destroy(IntPtr handle);
+        private static extern Result PointerHandler_Destroy(IntPtr system, uint handle);
         [DllImport("libX11TouchMultiWindow")]
-        private static extern Result PointerHandler_SetTargetDisplay(IntPtr handle, int targetDisplay);
+        private static extern Result PointerHandler_SetTargetDisplay(IntPtr system, uint handle, int targetDisplay);
         [DllImport("libX11TouchMultiWindow")]
-        private static extern Result PointerHandler_GetScreenParams(IntPtr handle, out int x, out int y, out int width,
-            out int height, out int screenWidth, out int screenHeight);
+        private static extern Result PointerHandler_GetScreenParams(IntPtr system, uint handle, out int x, out int y,
+            out int width, out int height, out int screenWidth, out int screenHeight);
         [DllImport("libX11TouchMultiWindow")]
-        private static extern Result PointerHandler_SetScreenParams(IntPtr handle, int width, int height,
-            float offsetX, float offsetY, float scaleX, float scaleY);
+        private static extern Result PointerHandler_SetScreenParams(IntPtr system, uint handle, int width,
+            int height, float offsetX, float offsetY, float scaleX, float scaleY);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetPointerEvents(IntPtr system, uint handle,
+            [Out] PointerEventData[] events, int maxEvents, out int numEvents);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetNumDroppedEvents(IntPtr system, uint handle,
+            out ulong numEvents);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_SetCoalescing(IntPtr system, uint handle, int coalesce,
+            int keepHistory);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetNumCoalescedEvents(IntPtr system, uint handle,
+            out ulong numEvents);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetPointerHistory(IntPtr system, uint handle, PointerType type,
+            int id, [Out] Vector2[] samples, int maxSamples, out int numSamples);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetActivePointers(IntPtr system, uint handle,
+            [Out] ActivePointerData[] pointers, int maxPointers, out int numPointers);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_SetFiltering(IntPtr system, uint handle, int filter,
+            ref NativeFilterSettings settings);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetNumSuppressedUpdates(IntPtr system, uint handle,
+            out ulong numUpdates);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_SetPrediction(IntPtr system, uint handle, int predict,
+            float horizon);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_SetResampling(IntPtr system, uint handle, int resample,
+            float maxExtrapolation);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_SetGestureRecognition(IntPtr system, uint handle, int recognize,
+            ref NativeGestureSettings settings);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetGestureEvents(IntPtr system, uint handle,
+            [Out] GestureEventData[] events, int maxEvents, out int numEvents);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_AddRegion(IntPtr system, uint handle, ref RegionData region,
+            Vector2[] vertices, int numVertices);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_RemoveRegion(IntPtr system, uint handle, int id);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_MoveRegion(IntPtr system, uint handle, int id, float x, float y);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_ClearRegions(IntPtr system, uint handle);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_SetSlotTimeout(IntPtr system, uint handle, float timeout);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_CancelTouches(IntPtr system, uint handle);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetNumCanceledTouches(IntPtr system, uint handle,
+            out ulong numTouches);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_GetLatencyStats(IntPtr system, uint handle,
+            out LatencyStats stats);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandler_ResetLatencyStats(IntPtr system, uint handle);
         
         #endregion
         
-        private IntPtr handle;
+        // System the native handler belongs to, handles are only valid within their system
+        private readonly X11PointerHandlerSystem system;
+        // Generational handle of the native handler, 0 is never a valid handle
+        private uint handle;
 
-        internal NativeX11PointerHandler(int targetDisplay, IntPtr window, PointerCallback pointerCallback)
+        internal NativeX11PointerHandler(X11PointerHandlerSystem system, int targetDisplay, IntPtr window,
+            PointerCallback pointerCallback)
         {
+            this.system = system;
+            
             // Create native resources
-            handle = new IntPtr();
-            var result = PointerHandler_Create(targetDisplay, window, pointerCallback, ref handle);
+            handle = 0;
+            var result = PointerHandler_Create(system.Handle, targetDisplay, window, pointerCallback, ref handle);
             if (result != Result.Ok)
             {
-                handle = IntPtr.Zero;
+                handle = 0;
                 ResultHelper.CheckResult(result);
             }
         }
@@ -58,16 +122,17 @@ private void Dispose(bool disposing)
             }
 
             // Free native resources
-            if (handle != IntPtr.Zero)
+            // A destroyed system already destroyed its handlers
+            if (handle != 0 && system.Handle != IntPtr.Zero)
             {
-                PointerHandler_Destroy(handle);
-                handle = IntPtr.Zero;
+                PointerHandler_Destroy(system.Handle, handle);
+                handle = 0;
             }
         }
 
         internal void SetTargetDisplay(int value)
         {
-            var result = PointerHandler_SetTargetDisplay(handle, value);
+            var result = PointerHandler_SetTargetDisplay(system.Handle, handle, value);
 #if TOUCHSCRIPT_DEBUG
             ResultHelper.CheckResult(result);
 #endif
@@ -75,7 +140,7 @@ internal void SetTargetDisplay(int value)
 
         internal void GetScreenResolution(out int x, out int y, out int width, out int height, out int screenWidth, out int screenHeight)
         {
-            var result = PointerHandler_GetScreenParams(handle, out x, out y, out width, out height, out screenWidth, out screenHeight);
+            var result = PointerHandler_GetScreenParams(system.Handle, handle, out x, out y, out width, out height, out screenWidth, out screenHeight);
 #if TOUCHSCRIPT_DEBUG
             ResultHelper.CheckResult(result);
 #endif
@@ -84,7 +149,229 @@ internal void GetScreenResolution(out int x, out int y, out int width, out int h
         internal void SetScreenParams(int width, int height,
             float offsetX, float offsetY, float scaleX, float scaleY)
         {
-            var result = PointerHandler_SetScreenParams(handle, width, height, offsetX, offsetY, scaleX, scaleY);
+            var result = PointerHandler_SetScreenParams(system.Handle, handle, width, height, offsetX, offsetY, scaleX, scaleY);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Copies the pending events of a handler created without a pointer callback into the given buffer.
+        /// </summary>
+        internal void GetPointerEvents(PointerEventData[] events, out int numEvents)
+        {
+            var result = PointerHandler_GetPointerEvents(system.Handle, handle, events, events.Length, out numEvents);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Returns the number of events dropped because too many were waiting to be retrieved.
+        /// </summary>
+        internal ulong GetNumDroppedEvents()
+        {
+            var result = PointerHandler_GetNumDroppedEvents(system.Handle, handle, out var numEvents);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+            return numEvents;
+        }
+
+        /// <summary>
+        /// Merges consecutive updates of a pointer within a frame into the latest one.
+        /// </summary>
+        internal void SetCoalescing(bool coalesce, bool keepHistory)
+        {
+            var result = PointerHandler_SetCoalescing(system.Handle, handle, coalesce ? 1 : 0, keepHistory ? 1 : 0);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        internal ulong GetNumCoalescedEvents()
+        {
+            var result = PointerHandler_GetNumCoalescedEvents(system.Handle, handle, out var numEvents);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+            return numEvents;
+        }
+
+        /// <summary>
+        /// Copies the positions of the updates of a pointer that were merged during the last frame, oldest first.
+        /// </summary>
+        internal void GetPointerHistory(PointerType type, int id, Vector2[] samples, out int numSamples)
+        {
+            var result = PointerHandler_GetPointerHistory(system.Handle, handle, type, id, samples, samples.Length, out numSamples);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Copies the pointers that are down, and the mouse once it has moved, into the given buffer.
+        /// </summary>
+        internal void GetActivePointers(ActivePointerData[] pointers, out int numPointers)
+        {
+            var result = PointerHandler_GetActivePointers(system.Handle, handle, pointers, pointers.Length,
+                out numPointers);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Smooths the positions of touches, dropping the updates within the dead zone.
+        /// </summary>
+        internal void SetFiltering(bool filter, NativeFilterSettings settings)
+        {
+            var result = PointerHandler_SetFiltering(system.Handle, handle, filter ? 1 : 0, ref settings);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Returns the number of touch updates dropped within the dead zone since the handler was created.
+        /// </summary>
+        internal ulong GetNumSuppressedUpdates()
+        {
+            var result = PointerHandler_GetNumSuppressedUpdates(system.Handle, handle, out var numUpdates);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+            return numUpdates;
+        }
+
+        /// <summary>
+        /// Estimates the velocity of every pointer update and predicts its position the horizon ahead.
+        /// </summary>
+        /// <param name="horizon">Time to predict ahead in milliseconds.</param>
+        internal void SetPrediction(bool predict, float horizon)
+        {
+            var result = PointerHandler_SetPrediction(system.Handle, handle, predict ? 1 : 0, horizon);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Moves the last update of every pointer in a frame to its position at the frame time.
+        /// </summary>
+        /// <param name="maxExtrapolation">Milliseconds a position may be extrapolated past the latest sample.</param>
+        internal void SetResampling(bool resample, float maxExtrapolation)
+        {
+            var result = PointerHandler_SetResampling(system.Handle, handle, resample ? 1 : 0, maxExtrapolation);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Recognizes taps, long presses and flicks of the pointers of the handler natively.
+        /// </summary>
+        internal void SetGestureRecognition(bool recognize, NativeGestureSettings settings)
+        {
+            var result = PointerHandler_SetGestureRecognition(system.Handle, handle, recognize ? 1 : 0, ref settings);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Copies the gestures recognized since the last call into the given buffer.
+        /// </summary>
+        internal void GetGestureEvents(GestureEventData[] events, out int numEvents)
+        {
+            var result = PointerHandler_GetGestureEvents(system.Handle, handle, events, events.Length, out numEvents);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Registers a region pointers going down in are tagged with, in screen space.
+        /// </summary>
+        /// <param name="vertices">Vertices of a polygon relative to the position of the region, null for other
+        /// shapes.</param>
+        internal void AddRegion(RegionData region, Vector2[] vertices)
+        {
+            var result = PointerHandler_AddRegion(system.Handle, handle, ref region, vertices,
+                vertices?.Length ?? 0);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        internal void RemoveRegion(int id)
+        {
+            var result = PointerHandler_RemoveRegion(system.Handle, handle, id);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        internal void MoveRegion(int id, Vector2 position)
+        {
+            var result = PointerHandler_MoveRegion(system.Handle, handle, id, position.x, position.y);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        internal void ClearRegions()
+        {
+            var result = PointerHandler_ClearRegions(system.Handle, handle);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Sets how long a touch may go without events before it is canceled and its slot reused.
+        /// </summary>
+        /// <param name="timeout">In seconds, 0 to never time out touches.</param>
+        internal void SetSlotTimeout(float timeout)
+        {
+            var result = PointerHandler_SetSlotTimeout(system.Handle, handle, timeout);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Ends all touches with an up event flagged <see cref="PointerFlags.Canceled"/>.
+        /// </summary>
+        internal void CancelTouches()
+        {
+            var result = PointerHandler_CancelTouches(system.Handle, handle);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        internal ulong GetNumCanceledTouches()
+        {
+            var result = PointerHandler_GetNumCanceledTouches(system.Handle, handle, out var numTouches);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+            return numTouches;
+        }
+
+        internal LatencyStats GetLatencyStats()
+        {
+            var result = PointerHandler_GetLatencyStats(system.Handle, handle, out var stats);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+            return stats;
+        }
+
+        internal void ResetLatencyStats()
+        {
+            var result = PointerHandler_ResetLatencyStats(system.Handle, handle);
 #if TOUCHSCRIPT_DEBUG
             ResultHelper.CheckResult(result);
 #endif
@@ -25,20 +25,43 @@ public override int TargetDisplay
             }
         }
         
-        private PointerCallback pointerCallback;
+        private readonly X11PointerHandlerSystem system;
         private NativeX11PointerHandler pointerHandler;
-        private readonly Dictionary<int, TouchPointer> x11TouchToInternalId = new Dictionary<int, TouchPointer>(10);
+        private readonly PointerEventData[] pointerEvents = new PointerEventData[256];
+        // Touch pointers by the native slot of their touch, slots are small indices reused from the lowest one
+        private TouchPointer[] touchSlots = new TouchPointer[16];
+        private readonly Dictionary<Pointer, Vector2> pointerVelocities = new Dictionary<Pointer, Vector2>(10);
+        // Regions the pointers went down in, as hit tested natively
+        private readonly Dictionary<Pointer, int> pointerRegions = new Dictionary<Pointer, int>(10);
+        private bool predictPositions;
+        private bool resample;
+        private readonly GestureEventData[] gestureEvents = new GestureEventData[64];
+        // Native pointer ids to the ids of their pointers, kept until the gestures of the frame they ended in
+        // are dispatched
+        private readonly Dictionary<int, int> nativeToPointerId = new Dictionary<int, int>(10);
+        private readonly List<int> endedTouches = new List<int>(10);
+        private bool recognizeGestures;
+        private ActivePointerData[] activePointers = new ActivePointerData[16];
+
+        /// <summary>
+        /// Raised from <see cref="UpdateInput"/> for every gesture recognized natively, after the pointer events
+        /// of the frame were processed. See <see cref="SetGestureRecognition"/>.
+        /// </summary>
+        public event Action<NativeGesture> GestureRecognized;
         
-        public X11MultiWindowPointerHandler(int targetDisplay, IntPtr window, PointerDelegate addPointer,
-            PointerDelegate updatePointer, PointerDelegate pressPointer, PointerDelegate releasePointer,
-            PointerDelegate removePointer, PointerDelegate cancelPointer)
+        public X11MultiWindowPointerHandler(X11PointerHandlerSystem system, int targetDisplay, IntPtr window,
+            PointerDelegate addPointer, PointerDelegate updatePointer, PointerDelegate pressPointer,
+            PointerDelegate releasePointer, PointerDelegate removePointer, PointerDelegate cancelPointer)
             : base(targetDisplay, addPointer, updatePointer, pressPointer, releasePointer, removePointer, cancelPointer)
         {
             mousePool = new ObjectPool<MousePointer>(4, () => new MousePointer(this), null, resetPointer);
             mousePointer = internalAddMousePointer(Vector3.zero);
 
-            pointerCallback = OnNativePointerEvent;
-            pointerHandler = new NativeX11PointerHandler(targetDisplay, window, pointerCallback);
+            this.system = system;
+
+            // No pointer callback, events are retrieved in batches in UpdateInput
+            pointerHandler = new NativeX11PointerHandler(system, targetDisplay, window, null);
+            if (system.CoalesceUpdates) pointerHandler.SetCoalescing(true, false);
             
             disablePressAndHold();
             setScaling();
@@ -53,10 +76,21 @@ public override void Dispose()
                 mousePointer = null;
             }
 
-            foreach (var i in x11TouchToInternalId) cancelPointer(i.Value);
-            x11TouchToInternalId.Clear();
+            for (var i = 0; i < touchSlots.Length; i++)
+            {
+                if (touchSlots[i] == null) continue;
+                cancelPointer(touchSlots[i]);
+                touchSlots[i] = null;
+            }
+            pointerVelocities.Clear();
+            pointerRegions.Clear();
+            nativeToPointerId.Clear();
+            endedTouches.Clear();
 
             enablePressAndHold();
+
+            if (resample) system.NumResamplingHandlers--;
+            resample = false;
             
             pointerHandler.Dispose();
             pointerHandler = null;
@@ -65,32 +99,298 @@ public override void Dispose()
         /// <inheritdoc />
         public override bool UpdateInput()
         {
+            int numEvents;
+            do
+            {
+                pointerHandler.GetPointerEvents(pointerEvents, out numEvents);
+                for (var i = 0; i < numEvents; i++)
+                {
+                    ref var pointerEvent = ref pointerEvents[i];
+                    processPointerEvent(pointerEvent.Id, pointerEvent.Event, pointerEvent.Type, pointerEvent.Position,
+                        ref pointerEvent.Data);
+                }
+            } while (numEvents == pointerEvents.Length);
+
+            if (recognizeGestures) processGestureEvents();
+            
             return true;
         }
 
-        /// <inheritdoc />
-        public override bool CancelPointer(Pointer pointer, bool shouldReturn)
+        /// <summary>
+        /// Returns the number of pointer updates dropped natively because they were not retrieved in time, like
+        /// while <see cref="UpdateInput"/> is not called for a hidden window. Only updates are dropped, each into
+        /// the latest update of its pointer, so pointers are always added and removed.
+        /// </summary>
+        public ulong GetNumDroppedEvents()
         {
-            var touch = pointer as TouchPointer;
-            if (touch == null) return false;
+            return pointerHandler.GetNumDroppedEvents();
+        }
+
+        /// <summary>
+        /// Enables merging consecutive updates of a pointer within a frame into the latest one natively, so a touch
+        /// panel reporting faster than the frame rate costs a single update per pointer and frame. Presses and
+        /// releases are never merged. Starts as <see cref="X11PointerHandlerSystem.CoalesceUpdates"/>.
+        /// </summary>
+        /// <param name="enabled">Whether updates are merged.</param>
+        public void SetCoalescing(bool enabled)
+        {
+            pointerHandler.SetCoalescing(enabled, false);
+        }
+
+        /// <summary>
+        /// Returns the number of pointer updates merged into later ones, see <see cref="SetCoalescing"/>.
+        /// </summary>
+        public ulong GetNumCoalescedEvents()
+        {
+            return pointerHandler.GetNumCoalescedEvents();
+        }
+
+        /// <summary>
+        /// Enables smoothing touch positions natively with a One Euro filter, so the jitter of a touch held still
+        /// doesn't update its pointer every frame. Applied before prediction, resampling and gesture recognition.
+        /// </summary>
+        /// <param name="enabled">Whether touch positions are filtered.</param>
+        /// <param name="settings">Parameters, see <see cref="NativeFilterSettings.WithDeadZone"/>.</param>
+        public void SetFiltering(bool enabled, NativeFilterSettings settings)
+        {
+            pointerHandler.SetFiltering(enabled, settings);
+        }
+
+        /// <summary>
+        /// Returns the number of touch updates dropped within the dead zone of the filter, see
+        /// <see cref="SetFiltering"/>.
+        /// </summary>
+        public ulong GetNumSuppressedUpdates()
+        {
+            return pointerHandler.GetNumSuppressedUpdates();
+        }
 
-            int internalTouchId = -1;
-            foreach (var t in x11TouchToInternalId)
+        /// <summary>
+        /// Enables estimating pointer velocities natively, see <see cref="TryGetVelocity"/>.
+        /// </summary>
+        /// <param name="enabled">Whether velocities are estimated, disabling it has no cost.</param>
+        /// <param name="horizonMs">Pointer positions are predicted this far ahead to hide input latency, 0 keeps
+        /// the reported positions. Clamped to 100 ms.</param>
+        public void SetPrediction(bool enabled, float horizonMs)
+        {
+            pointerHandler.SetPrediction(enabled, horizonMs);
+            predictPositions = enabled && horizonMs > 0;
+            if (!enabled) pointerVelocities.Clear();
+        }
+
+        /// <summary>
+        /// Enables resampling pointer positions to the frame time, so a drag doesn't jitter when the touch panel
+        /// reports at a rate that is not aligned to the display refresh.
+        /// </summary>
+        /// <param name="enabled">Whether positions are resampled.</param>
+        /// <param name="maxExtrapolationMs">Milliseconds a position may be extrapolated past the latest sample when
+        /// the frame time is later, clamped to 20 ms.</param>
+        /// <seealso cref="X11PointerHandlerSystem.ResampleLatency"/>
+        public void SetResampling(bool enabled, float maxExtrapolationMs = 8f)
+        {
+            pointerHandler.SetResampling(enabled, maxExtrapolationMs);
+            if (enabled != resample) system.NumResamplingHandlers += enabled ? 1 : -1;
+            resample = enabled;
+        }
+
+        /// <summary>
+        /// Enables recognizing taps, long presses and flicks natively, reported by <see cref="GestureRecognized"/>.
+        /// Each pointer is recognized on its own, so gestures can use the results instead of tracking every pointer
+        /// update.
+        /// </summary>
+        /// <param name="enabled">Whether gestures are recognized.</param>
+        /// <param name="settings">Thresholds, see <see cref="NativeGestureSettings.FromDotsPerCentimeter"/>.</param>
+        public void SetGestureRecognition(bool enabled, NativeGestureSettings settings)
+        {
+            pointerHandler.SetGestureRecognition(enabled, settings);
+            recognizeGestures = enabled;
+        }
+
+        /// <summary>
+        /// Registers a rectangular region, see <see cref="TryGetRegion"/>.
+        /// </summary>
+        /// <param name="id">Id reported for the pointers going down in the region, must not be 0.</param>
+        /// <param name="layer">Regions of a higher layer are on top, of regions on the same layer the one added
+        /// last.</param>
+        /// <param name="rect">Area of the region in screen coordinates.</param>
+        public void AddRegion(int id, int layer, Rect rect)
+        {
+            pointerHandler.AddRegion(new RegionData
             {
-                if (t.Value == touch)
-                {
-                    internalTouchId = t.Key;
-                    break;
-                }
+                Id = id,
+                Layer = layer,
+                Shape = NativeRegionShape.Rect,
+                Position = rect.position,
+                Size = rect.size
+            }, null);
+        }
+
+        /// <summary>
+        /// Registers a circular region, see <see cref="AddRegion(int, int, Rect)"/>.
+        /// </summary>
+        public void AddRegion(int id, int layer, Vector2 center, float radius)
+        {
+            pointerHandler.AddRegion(new RegionData
+            {
+                Id = id,
+                Layer = layer,
+                Shape = NativeRegionShape.Circle,
+                Position = center,
+                Size = new Vector2(radius, 0)
+            }, null);
+        }
+
+        /// <summary>
+        /// Registers a polygonal region, see <see cref="AddRegion(int, int, Rect)"/>.
+        /// </summary>
+        /// <param name="origin">Screen position the vertices are relative to, moved by <see cref="MoveRegion"/>.
+        /// </param>
+        /// <param name="vertices">At least three vertices, the polygon may be concave.</param>
+        public void AddRegion(int id, int layer, Vector2 origin, Vector2[] vertices)
+        {
+            pointerHandler.AddRegion(new RegionData
+            {
+                Id = id,
+                Layer = layer,
+                Shape = NativeRegionShape.Polygon,
+                Position = origin
+            }, vertices);
+        }
+
+        /// <summary>
+        /// Moves a region to the given minimum corner of a rect, center of a circle or origin of a polygon.
+        /// </summary>
+        public void MoveRegion(int id, Vector2 position)
+        {
+            pointerHandler.MoveRegion(id, position);
+        }
+
+        public void RemoveRegion(int id)
+        {
+            pointerHandler.RemoveRegion(id);
+        }
+
+        public void ClearRegions()
+        {
+            pointerHandler.ClearRegions();
+        }
+
+        /// <summary>
+        /// Returns the topmost registered region the pointer went down in. The regions are hit tested natively
+        /// when the pointer goes down, so a pointer in a region doesn't need to be raycast to find its target.
+        /// </summary>
+        public bool TryGetRegion(Pointer pointer, out int regionId)
+        {
+            return pointerRegions.TryGetValue(pointer, out regionId);
+        }
+
+        /// <summary>
+        /// Returns the velocity of a pointer at its latest update in pixels per second, as estimated natively
+        /// over its recent samples when prediction is enabled.
+        /// </summary>
+        public bool TryGetVelocity(Pointer pointer, out Vector2 velocity)
+        {
+            return pointerVelocities.TryGetValue(pointer, out velocity);
+        }
+
+        /// <summary>
+        /// Copies the state of the touches that are down and of the mouse into the given buffer, as of the events
+        /// processed so far. Querying the snapshot costs a single native call whatever the number of pointers, so
+        /// it suits code polling all pointers at once better than following their individual events.
+        /// </summary>
+        /// <returns>Number of pointers copied, at most the length of the buffer.</returns>
+        public int GetActivePointers(NativeActivePointer[] pointers)
+        {
+            int numPointers;
+            while (true)
+            {
+                pointerHandler.GetActivePointers(activePointers, out numPointers);
+                if (numPointers < activePointers.Length || activePointers.Length >= pointers.Length) break;
+                activePointers = new ActivePointerData[activePointers.Length * 2];
             }
-            if (internalTouchId > -1)
+
+            numPointers = Math.Min(numPointers, pointers.Length);
+            for (var i = 0; i < numPointers; i++)
             {
-                cancelPointer(touch);
-                x11TouchToInternalId.Remove(internalTouchId);
-                if (shouldReturn) x11TouchToInternalId[internalTouchId] = internalReturnTouchPointer(touch);
-                return true;
+                var data = activePointers[i];
+                Pointer pointer = null;
+                if (data.Type == PointerType.Mouse) pointer = mousePointer;
+                else if (data.Slot >= 0 && data.Slot < touchSlots.Length) pointer = touchSlots[data.Slot];
+
+                pointers[i] = new NativeActivePointer()
+                {
+                    PointerId = pointer?.Id ?? Pointer.INVALID_POINTER,
+                    Type = data.Type == PointerType.Mouse ? Pointer.PointerType.Mouse : Pointer.PointerType.Touch,
+                    ScreenPosition = data.Position,
+                    Pressure = data.Pressure,
+                    Buttons = (Pointer.PointerButtonState)(((uint)data.Buttons >> 4) & 0x1F),
+                    Age = data.Age,
+                    Time = data.Time
+                };
             }
-            return false;
+
+            return numPointers;
+        }
+
+        /// <summary>
+        /// Sets how long a touch may go without events before its end is considered lost. The touch is then
+        /// canceled. A touch held still reports no events, so only set this if the device is known to lose the
+        /// ends of its touches. Touches are canceled anyway when the window is unmapped or destroyed.
+        /// </summary>
+        /// <param name="seconds">0 to never time out touches, which is the default.</param>
+        public void SetTouchTimeout(float seconds)
+        {
+            pointerHandler.SetSlotTimeout(seconds);
+        }
+
+        /// <summary>
+        /// Cancels all touches with the next <see cref="UpdateInput"/>, for when their ends won't arrive anymore.
+        /// Touches of a removed device are canceled automatically.
+        /// </summary>
+        public void CancelTouches()
+        {
+            pointerHandler.CancelTouches();
+        }
+
+        /// <summary>
+        /// Returns the number of touches that were canceled because their end never arrived.
+        /// </summary>
+        public ulong GetNumCanceledTouches()
+        {
+            return pointerHandler.GetNumCanceledTouches();
+        }
+
+        /// <summary>
+        /// Returns the input latency percentiles of the events received for this window.
+        /// </summary>
+        public LatencyStats GetLatencyStats()
+        {
+            return pointerHandler.GetLatencyStats();
+        }
+
+        /// <summary>
+        /// Restarts recording the input latencies.
+        /// </summary>
+        public void ResetLatencyStats()
+        {
+            pointerHandler.ResetLatencyStats();
+        }
+
+        /// <inheritdoc />
+        public override bool CancelPointer(Pointer pointer, bool shouldReturn)
+        {
+            var touch = pointer as TouchPointer;
+            if (touch == null) return false;
+
+            var slot = Array.IndexOf(touchSlots, touch);
+            if (slot < 0) return false;
+
+            cancelPointer(touch);
+            touchSlots[slot] = null;
+            pointerVelocities.Remove(touch);
+            pointerRegions.Remove(touch);
+            if (shouldReturn) touchSlots[slot] = internalReturnTouchPointer(touch);
+            return true;
         }
 
         /// <inheritdoc />
@@ -123,9 +423,11 @@ protected override void setScaling()
             pointerHandler.SetScreenParams(width, height, 0, 0, 1, 1);
         }
 
-        [AOT.MonoPInvokeCallback(typeof(PointerCallback))]
-        private void OnNativePointerEvent(int id, PointerEvent evt, PointerType type, Vector2 position, PointerData data)
+        private void processPointerEvent(int id, PointerEvent evt, PointerType type, Vector2 position, ref PointerData data)
         {
+            var predicted = (data.Mask & TouchMask.Prediction) > 0;
+            if (predicted && predictPositions) position = data.PredictedPosition;
+            
             switch (type)
             {
                 case PointerType.Mouse:
@@ -135,10 +437,13 @@ private void OnNativePointerEvent(int id, PointerEvent evt, PointerType type, Ve
                             case PointerEvent.Down:
                                 mousePointer.Buttons = updateButtons(mousePointer.Buttons, data.PointerFlags,
                                     data.ChangedButtons);
+                                nativeToPointerId[id] = mousePointer.Id;
+                                if (data.Region != 0) pointerRegions[mousePointer] = data.Region;
                                 pressPointer(mousePointer);
                                 break;
                             case PointerEvent.Update:
                                 mousePointer.Position = position;
+                                if (predicted) pointerVelocities[mousePointer] = data.Velocity;
                                 mousePointer.Buttons = updateButtons(mousePointer.Buttons, data.PointerFlags,
                                     data.ChangedButtons);
                                 updatePointer(mousePointer);
@@ -146,6 +451,7 @@ private void OnNativePointerEvent(int id, PointerEvent evt, PointerType type, Ve
                             case PointerEvent.Up:
                                 mousePointer.Buttons = updateButtons(mousePointer.Buttons, data.PointerFlags,
                                     data.ChangedButtons);
+                                pointerRegions.Remove(mousePointer);
                                 releasePointer(mousePointer);
                                 break;
                         }
@@ -153,11 +459,17 @@ private void OnNativePointerEvent(int id, PointerEvent evt, PointerType type, Ve
                     break;
                 case PointerType.Touch:
                     {
-                        TouchPointer touchPointer;
+                        // Events of touches without a slot are dropped natively
+                        var slot = data.Slot;
+                        if (slot >= touchSlots.Length)
+                        {
+                            Array.Resize(ref touchSlots, Math.Max(slot + 1, touchSlots.Length * 2));
+                        }
+                        var touchPointer = touchSlots[slot];
                         switch (evt)
                         {
                             case PointerEvent.Down:
-                                if (!x11TouchToInternalId.ContainsKey(id))
+                                if (touchPointer == null)
                                 {
                                     // Only add touch pointer when there is none for the given native touch pointer id
                                     // It seems in some cases the system reports multiple events of this type with the
@@ -165,7 +477,10 @@ private void OnNativePointerEvent(int id, PointerEvent evt, PointerType type, Ve
                                     touchPointer = internalAddTouchPointer(position);
                                     touchPointer.Pressure = getTouchPressure(ref data);
                                     touchPointer.Rotation = getTouchRotation(ref data);
-                                    x11TouchToInternalId.Add(id, touchPointer);
+                                    touchSlots[slot] = touchPointer;
+                                    nativeToPointerId[id] = touchPointer.Id;
+                                    if (predicted) pointerVelocities[touchPointer] = data.Velocity;
+                                    if (data.Region != 0) pointerRegions[touchPointer] = data.Region;
                                 }
                                 else
                                 {
@@ -173,17 +488,23 @@ private void OnNativePointerEvent(int id, PointerEvent evt, PointerType type, Ve
                                 }
                                 break;
                             case PointerEvent.Update:
-                                if (!x11TouchToInternalId.TryGetValue(id, out touchPointer)) return;
+                                if (touchPointer == null) return;
                                 touchPointer.Position = position;
                                 touchPointer.Pressure = getTouchPressure(ref data);
                                 touchPointer.Rotation = getTouchRotation(ref data);
+                                if (predicted) pointerVelocities[touchPointer] = data.Velocity;
                                 updatePointer(touchPointer);
                                 break;
                             case PointerEvent.Up:
-                                if (x11TouchToInternalId.TryGetValue(id, out touchPointer))
+                                if (touchPointer != null)
                                 {
-                                    x11TouchToInternalId.Remove(id);
-                                    internalRemoveTouchPointer(touchPointer);
+                                    touchSlots[slot] = null;
+                                    pointerVelocities.Remove(touchPointer);
+                                    pointerRegions.Remove(touchPointer);
+                                    if (recognizeGestures) endedTouches.Add(id);
+                                    else nativeToPointerId.Remove(id);
+                                    if ((data.PointerFlags & PointerFlags.Canceled) > 0) cancelPointer(touchPointer);
+                                    else internalRemoveTouchPointer(touchPointer);
                                 }
                                 else
                                 {
@@ -197,6 +518,32 @@ private void OnNativePointerEvent(int id, PointerEvent evt, PointerType type, Ve
             }
         }
 
+        private void processGestureEvents()
+        {
+            int numEvents;
+            do
+            {
+                pointerHandler.GetGestureEvents(gestureEvents, out numEvents);
+                for (var i = 0; i < numEvents; i++)
+                {
+                    ref var gestureEvent = ref gestureEvents[i];
+                    if (!nativeToPointerId.TryGetValue(gestureEvent.Id, out var pointerId)) continue;
+                    GestureRecognized?.Invoke(new NativeGesture
+                    {
+                        Type = gestureEvent.Type,
+                        PointerId = pointerId,
+                        Count = gestureEvent.Count,
+                        ScreenPosition = gestureEvent.Position,
+                        ScreenFlickVector = gestureEvent.Vector,
+                        Duration = gestureEvent.Duration
+                    });
+                }
+            } while (numEvents == gestureEvents.Length);
+
+            foreach (var id in endedTouches) nativeToPointerId.Remove(id);
+            endedTouches.Clear();
+        }
+
         private Pointer.PointerButtonState updateButtons(Pointer.PointerButtonState current, PointerFlags flags, ButtonChangeType change)
         {
             var currentUpDown = ((uint)current) & 0xFFFFFC00;
@@ -209,15 +556,15 @@ private Pointer.PointerButtonState updateButtons(Pointer.PointerButtonState curr
 
         private float getTouchPressure(ref PointerData data)
         {
-            // var reliable = (data.Mask & (uint) TouchMask.Pressure) > 0;
-            // if (reliable) return data.Pressure / 1024f;
+            var reliable = (data.Mask & TouchMask.Pressure) > 0;
+            if (reliable) return data.Pressure;
             return TouchPointer.DEFAULT_PRESSURE;
         }
 
         private float getTouchRotation(ref PointerData data)
         {
-            // var reliable = (data.Mask & (uint) TouchMask.Orientation) > 0;
-            // if (reliable) return data.Rotation / 180f * Mathf.PI;
+            var reliable = (data.Mask & TouchMask.Orientation) > 0;
+            if (reliable) return data.Orientation;
             return TouchPointer.DEFAULT_ROTATION;
         }
     }
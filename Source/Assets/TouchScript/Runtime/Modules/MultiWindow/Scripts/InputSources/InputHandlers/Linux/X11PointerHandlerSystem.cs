@@ -11,26 +11,82 @@ namespace TouchScript.InputSources.InputHandlers
     public class X11PointerHandlerSystem : IInputSourceSystem, IDisposable
     {
         [DllImport("libX11TouchMultiWindow")]
-        private static extern Result PointerHandlerSystem_Create(MessageCallback messageCallback, ref IntPtr handle);
+        private static extern Result PointerHandlerSystem_Create(string displayName, MessageCallback messageCallback,
+            ref SystemSettings settings, ref IntPtr handle);
         [DllImport("libX11TouchMultiWindow")]
-        private static extern Result PointerHandlerSystem_ProcessEventQueue(IntPtr handle);
+        private static extern Result PointerHandlerSystem_ProcessEventQueue(IntPtr handle, ulong frameTime);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_GetTime(IntPtr handle, out ulong time);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_GetFd(IntPtr handle, out int fd);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_WaitForEvents(IntPtr handle, int timeoutMs, out int ready);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_Wake(IntPtr handle);
         [DllImport("libX11TouchMultiWindow")]
         private static extern Result PointerHandlerSystem_GetWindowsOfProcess(IntPtr handle, int pid, out IntPtr windows, out uint numWindows);
         [DllImport("libX11TouchMultiWindow")]
         private static extern Result PointerHandlerSystem_FreeWindowsOfProcess(IntPtr handle, IntPtr windows);
         [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_StartRecording(IntPtr handle, string path);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_StopRecording(IntPtr handle);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_StartReplay(IntPtr handle, string path, ReplayMode mode,
+            IntPtr window);
+        [DllImport("libX11TouchMultiWindow")]
+        private static extern Result PointerHandlerSystem_StopReplay(IntPtr handle);
+        [DllImport("libX11TouchMultiWindow")]
         private static extern Result PointerHandlerSystem_Destroy(IntPtr handle);
 
         private MessageCallback messageCallback;
         private IntPtr handle;
 
-        public X11PointerHandlerSystem()
+        /// <summary>
+        /// Display the system reads input from, <c>null</c> for the <c>DISPLAY</c> environment variable.
+        /// </summary>
+        public string DisplayName { get; }
+
+        // Native handle the handlers of this system are created with, zero once disposed
+        internal IntPtr Handle => handle;
+
+        /// <summary>
+        /// Milliseconds the frame time pointers are resampled to lags behind <see cref="PrepareInputs()"/>, so most
+        /// frames interpolate between two samples instead of extrapolating. Only affects handlers with resampling
+        /// enabled.
+        /// </summary>
+        public float ResampleLatency { get; set; } = 5f;
+
+        /// <summary>
+        /// Whether the handlers created from now on merge consecutive updates of a pointer within a frame, see
+        /// <see cref="X11MultiWindowPointerHandler.SetCoalescing"/>. Off by default, so every update the touch panel
+        /// reports reaches the pointers.
+        /// </summary>
+        public bool CoalesceUpdates { get; set; }
+
+        // Handlers with resampling enabled, without any there is no frame time to resample to
+        internal int NumResamplingHandlers { get; set; }
+
+        public X11PointerHandlerSystem() : this(null, SystemSettings.Default)
+        {
+        }
+
+        public X11PointerHandlerSystem(SystemSettings settings) : this(null, settings)
         {
+        }
+
+        /// <summary>
+        /// Creates a system for a specific display, systems of different displays are independent of each other.
+        /// </summary>
+        /// <param name="displayName">Display to connect to, like ":0.1", <c>null</c> for the <c>DISPLAY</c> environment variable.</param>
+        public X11PointerHandlerSystem(string displayName, SystemSettings settings)
+        {
+            DisplayName = displayName;
             messageCallback = OnNativeMessage;
             
             // Create native resources
             handle = new IntPtr();
-            var result = PointerHandlerSystem_Create(messageCallback, ref handle);
+            var result = PointerHandlerSystem_Create(displayName, messageCallback, ref settings, ref handle);
             if (result != Result.Ok)
             {
                 handle = IntPtr.Zero;
@@ -65,9 +121,74 @@ private void Dispose(bool disposing)
             }
         }
 
+        /// <summary>
+        /// Processes the native events, resampling the pointers of handlers with resampling enabled to the current
+        /// time minus <see cref="ResampleLatency"/>. The time is only queried if a handler has resampling enabled.
+        /// </summary>
         public void PrepareInputs()
         {
-            var result = PointerHandlerSystem_ProcessEventQueue(handle);
+            if (NumResamplingHandlers == 0)
+            {
+                PrepareInputs(0);
+                return;
+            }
+
+            var latency = (ulong)(Math.Max(ResampleLatency, 0f) * 1000000f);
+            PrepareInputs(GetTime() - latency);
+        }
+
+        /// <summary>
+        /// Processes the native events, resampling the pointers of handlers with resampling enabled to the frame time.
+        /// </summary>
+        /// <param name="frameTime">Time in nanoseconds on the clock of <see cref="GetTime"/>, 0 to not resample.</param>
+        public void PrepareInputs(ulong frameTime)
+        {
+            var result = PointerHandlerSystem_ProcessEventQueue(handle, frameTime);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+        }
+
+        /// <summary>
+        /// Returns the current time of the clock native events are timestamped with, in nanoseconds.
+        /// </summary>
+        public ulong GetTime()
+        {
+            var result = PointerHandlerSystem_GetTime(handle, out var time);
+#if TOUCHSCRIPT_DEBUG
+            ResultHelper.CheckResult(result);
+#endif
+            return time;
+        }
+
+        /// <summary>
+        /// Returns a file descriptor that polls readable when <see cref="PrepareInputs"/> has events to process.
+        /// </summary>
+        public int GetFd()
+        {
+            var result = PointerHandlerSystem_GetFd(handle, out var fd);
+            ResultHelper.CheckResult(result);
+            return fd;
+        }
+
+        /// <summary>
+        /// Blocks until events are available, <see cref="Wake"/> is called or the timeout passed.
+        /// </summary>
+        /// <param name="timeoutMs">Timeout in milliseconds, -1 waits indefinitely.</param>
+        /// <returns>Whether <see cref="PrepareInputs"/> has events to process.</returns>
+        public bool WaitForEvents(int timeoutMs)
+        {
+            var result = PointerHandlerSystem_WaitForEvents(handle, timeoutMs, out var ready);
+            ResultHelper.CheckResult(result);
+            return ready != 0;
+        }
+
+        /// <summary>
+        /// Interrupts <see cref="WaitForEvents"/>, may be called from any thread.
+        /// </summary>
+        public void Wake()
+        {
+            var result = PointerHandlerSystem_Wake(handle);
 #if TOUCHSCRIPT_DEBUG
             ResultHelper.CheckResult(result);
 #endif
@@ -89,6 +210,37 @@ public void GetWindowsOfProcess(int pid, List<IntPtr> procWindows)
             procWindows.AddRange(w);
         }
         
+        /// <summary>
+        /// Writes all native pointer events to a file until <see cref="StopRecording"/> is called.
+        /// </summary>
+        public void StartRecording(string path)
+        {
+            var result = PointerHandlerSystem_StartRecording(handle, path);
+            ResultHelper.CheckResult(result);
+        }
+
+        public void StopRecording()
+        {
+            var result = PointerHandlerSystem_StopRecording(handle);
+            ResultHelper.CheckResult(result);
+        }
+
+        /// <summary>
+        /// Dispatches the events of a recording in addition to live input, until the recording ends.
+        /// </summary>
+        /// <param name="window">Window to deliver all events to, <see cref="IntPtr.Zero"/> keeps the recorded windows.</param>
+        public void StartReplay(string path, ReplayMode mode, IntPtr window)
+        {
+            var result = PointerHandlerSystem_StartReplay(handle, path, mode, window);
+            ResultHelper.CheckResult(result);
+        }
+
+        public void StopReplay()
+        {
+            var result = PointerHandlerSystem_StopReplay(handle);
+            ResultHelper.CheckResult(result);
+        }
+
         // Attribute used for IL2CPP
         [AOT.MonoPInvokeCallback(typeof(MessageCallback))]
         private void OnNativeMessage(int messageType, string message)
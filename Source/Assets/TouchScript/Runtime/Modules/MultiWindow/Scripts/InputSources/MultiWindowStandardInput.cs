@@ -253,8 +253,9 @@ private void EnableTouch()
                 return;
             }
 
-            var x11PointerHandler = new X11MultiWindowPointerHandler(TargetDisplay, window, addPointer, updatePointer,
-                pressPointer, releasePointer, removePointer, cancelPointer);
+            var x11PointerHandler = new X11MultiWindowPointerHandler(multiWindowManager.PointerHandlerSystem,
+                TargetDisplay, window, addPointer, updatePointer, pressPointer, releasePointer, removePointer,
+                cancelPointer);
             pointerHandler = x11PointerHandler;
 
             Debug.Log($"[TouchScript] Initialized X11 pointer input for display {TargetDisplay + 1}.");